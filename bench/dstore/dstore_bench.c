@@ -0,0 +1,854 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Dstore benchmark
+ *
+ * Generates a synthetic cluster configuration (N nodes, each with K
+ * keys drawn from a pool of values of configurable cardinality, a
+ * fraction of which carry multiple values) and times the dstore API
+ * against it - everything goes through the dstore base, so the cache,
+ * group commit and shared-memory publication are all part of what is
+ * measured. Commit and load are reported under the name of the dstore
+ * that serves them; find and set work on the configuration in memory
+ * and are reported under "base".
+ *
+ * If no dstore component is available, or --mock is given, a stand-in
+ * is registered that keeps each configuration in a file of its own in
+ * a scratch directory. Commit writes the file and flush makes it
+ * durable, so group commit has real syncs to coalesce.
+ *
+ * Results are emitted as CSV (default) or JSON so they can be
+ * collected and compared across releases.
+ */
+
+#include <src/include/ww_config.h>
+#include <ww_types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
+#include "src/util/argv.h"
+#include "src/mca/dstore/base/base.h"
+
+typedef struct {
+    int nodes;
+    int keys;
+    int cardinality;
+    double multi;
+    int iterations;
+    int batch;
+    int threads;
+    unsigned int seed;
+    bool mock;
+    char *dir;
+    bool json;
+    FILE *out;
+} bench_params_t;
+
+typedef struct {
+    const char *component;
+    const char *op;
+    int count;
+    double total;
+    double min;
+    double max;
+    double wall;        // elapsed time, if the operations overlapped
+} bench_result_t;
+
+static bench_params_t params = {
+    .nodes = 1000,
+    .keys = 20,
+    .cardinality = 100,
+    .multi = 0.1,
+    .iterations = 100,
+    .batch = 64,
+    .threads = 4,
+    .seed = 1,
+    .mock = false,
+    .dir = NULL,
+    .json = false,
+    .out = NULL
+};
+
+static int nresults = 0;
+
+static double now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+}
+
+static void result_start(bench_result_t *res, const char *component, const char *op)
+{
+    res->component = component;
+    res->op = op;
+    res->count = 0;
+    res->total = 0.0;
+    res->min = 0.0;
+    res->max = 0.0;
+    res->wall = 0.0;
+}
+
+static void result_add(bench_result_t *res, double usec)
+{
+    if (0 == res->count || usec < res->min) {
+        res->min = usec;
+    }
+    if (usec > res->max) {
+        res->max = usec;
+    }
+    res->total += usec;
+    res->count++;
+}
+
+static void result_report(bench_result_t *res)
+{
+    double mean = (0 < res->count) ? res->total / res->count : 0.0;
+    double elapsed = (0.0 < res->wall) ? res->wall : res->total;
+    double rate = (0.0 < elapsed) ? res->count * 1000000.0 / elapsed : 0.0;
+
+    if (params.json) {
+        fprintf(params.out, "%s  {\"component\": \"%s\", \"op\": \"%s\", "
+                "\"nodes\": %d, \"keys\": %d, \"cardinality\": %d, \"multi\": %.3f, "
+                "\"count\": %d, \"total_usec\": %.3f, \"mean_usec\": %.3f, "
+                "\"min_usec\": %.3f, \"max_usec\": %.3f, \"ops_per_sec\": %.1f}",
+                (0 < nresults) ? ",\n" : "",
+                res->component, res->op, params.nodes, params.keys,
+                params.cardinality, params.multi, res->count, res->total,
+                mean, res->min, res->max, rate);
+    } else {
+        fprintf(params.out, "%s,%s,%d,%d,%d,%.3f,%d,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+                res->component, res->op, params.nodes, params.keys,
+                params.cardinality, params.multi, res->count, res->total,
+                mean, res->min, res->max, rate);
+    }
+    nresults++;
+}
+
+static ww_kval_t* make_kval(const char *key, char **values)
+{
+    ww_kval_t *kv;
+
+    kv = WW_NEW(ww_kval_t);
+    kv->key = strdup(key);
+    kv->values = ww_argv_copy(values);
+    return kv;
+}
+
+static ww_kval_t* make_directive(const char *key, const char *value)
+{
+    char *vals[2];
+
+    vals[0] = (char*)value;
+    vals[1] = NULL;
+    return make_kval(key, vals);
+}
+
+/* build a synthetic configuration. Passing the same seed produces
+ * an identical configuration, so runs can be compared */
+static ww_configuration_t* generate_config(const char *name, unsigned int seed)
+{
+    ww_configuration_t *config;
+    ww_type_object_t *nodes;
+    ww_building_block_t *blk;
+    char key[64], val[64], **vals;
+    int n, k, v, nvals;
+
+    config = WW_NEW(ww_configuration_t);
+    config->name = strdup(name);
+
+    nodes = WW_NEW(ww_type_object_t);
+    nodes->type = strdup("nodes");
+    ww_pointer_array_add(&config->types, nodes);
+
+    for (n=0; n < params.nodes; n++) {
+        blk = WW_NEW(ww_building_block_t);
+        if (0 > asprintf(&blk->uuid, "node%06d", n)) {
+            WW_RELEASE(blk);
+            continue;
+        }
+        for (k=0; k < params.keys; k++) {
+            snprintf(key, sizeof(key), "key%d", k);
+            nvals = 1;
+            if ((double)rand_r(&seed) / RAND_MAX < params.multi) {
+                nvals += 1 + rand_r(&seed) % 3;
+            }
+            vals = NULL;
+            for (v=0; v < nvals; v++) {
+                snprintf(val, sizeof(val), "val%d", rand_r(&seed) % params.cardinality);
+                ww_argv_append_nosize(&vals, val);
+            }
+            ww_pointer_array_add(&blk->keyvals, make_kval(key, vals));
+            blk->nkvals++;
+            ww_argv_free(vals);
+        }
+        ww_pointer_array_add(&nodes->blocks, blk);
+        nodes->nblocks++;
+    }
+    return config;
+}
+
+/****    STAND-IN DSTORE    ****/
+static ww_mutex_t mock_lock = WW_MUTEX_STATIC_INIT;
+static int *mock_pending = NULL;        // written but not yet flushed
+static int mock_npending = 0;
+static int mock_size = 0;
+static bool mock_madedir = false;
+
+static char* mock_path(const char *name)
+{
+    char *path, *p;
+
+    if (0 > asprintf(&path, "%s/%s", params.dir, name)) {
+        return NULL;
+    }
+    for (p=path + strlen(params.dir) + 1; '\0' != *p; p++) {
+        if ('/' == *p) {
+            *p = '_';
+        }
+    }
+    return path;
+}
+
+/* one line per item, fields separated by tabs - enough for the
+ * generated configurations, which never hold a tab or newline */
+static void mock_write(FILE *fp, ww_configuration_t *config)
+{
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    ww_kval_t *kv;
+    int i, j, k, n;
+
+    fprintf(fp, "C\t%s\n", config->name);
+    for (i=0; i < config->types.size; i++) {
+        if (NULL == (typ = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, i))) {
+            continue;
+        }
+        fprintf(fp, "T\t%s\n", (NULL == typ->type) ? "" : typ->type);
+        for (j=0; j < typ->blocks.size; j++) {
+            if (NULL == (blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, j))) {
+                continue;
+            }
+            fprintf(fp, "B\t%s\n", (NULL == blk->uuid) ? "" : blk->uuid);
+            ww_mutex_lock(&blk->mutex);
+            for (k=0; k < blk->keyvals.size; k++) {
+                if (NULL == (kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, k))) {
+                    continue;
+                }
+                fprintf(fp, "K\t%s", kv->key);
+                for (n=0; NULL != kv->values && NULL != kv->values[n]; n++) {
+                    fprintf(fp, "\t%s", kv->values[n]);
+                }
+                fputc('\n', fp);
+            }
+            ww_mutex_unlock(&blk->mutex);
+        }
+    }
+}
+
+static ww_status_t mock_commit(ww_configuration_t *config, ww_list_t *directives)
+{
+    char *path, *tmp = NULL, *buf = NULL;
+    size_t len = 0, off;
+    ssize_t n;
+    FILE *fp;
+    int fd, *grown;
+
+    if (NULL == config->name || NULL == (path = mock_path(config->name))) {
+        return WW_ERR_BAD_PARAM;
+    }
+    if (NULL == (fp = open_memstream(&buf, &len))) {
+        free(path);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    mock_write(fp, config);
+    fclose(fp);
+
+    /* write it alongside and move it into place, as a real file
+     * dstore would, so that a reader never sees half of it */
+    if (0 > asprintf(&tmp, "%s.tmp", path) ||
+        0 > (fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600))) {
+        free(tmp);
+        free(path);
+        free(buf);
+        return WW_ERROR;
+    }
+    for (off=0; off < len; off += n) {
+        if (0 >= (n = write(fd, buf + off, len - off))) {
+            close(fd);
+            unlink(tmp);
+            free(tmp);
+            free(path);
+            free(buf);
+            return WW_ERROR;
+        }
+    }
+    free(buf);
+    if (0 != rename(tmp, path)) {
+        close(fd);
+        unlink(tmp);
+        free(tmp);
+        free(path);
+        return WW_ERROR;
+    }
+    free(tmp);
+    free(path);
+
+    /* durable once flushed */
+    ww_mutex_lock(&mock_lock);
+    if (mock_npending == mock_size) {
+        if (NULL == (grown = (int*)realloc(mock_pending, (mock_size + 16) * sizeof(int)))) {
+            ww_mutex_unlock(&mock_lock);
+            fsync(fd);
+            close(fd);
+            return WW_SUCCESS;
+        }
+        mock_pending = grown;
+        mock_size += 16;
+    }
+    mock_pending[mock_npending++] = fd;
+    ww_mutex_unlock(&mock_lock);
+    return WW_SUCCESS;
+}
+
+static ww_status_t mock_flush(void)
+{
+    int *fds, nfds, i, dfd;
+    ww_status_t rc = WW_SUCCESS;
+
+    ww_mutex_lock(&mock_lock);
+    fds = mock_pending;
+    nfds = mock_npending;
+    mock_pending = NULL;
+    mock_npending = 0;
+    mock_size = 0;
+    ww_mutex_unlock(&mock_lock);
+
+    for (i=0; i < nfds; i++) {
+        if (0 != fsync(fds[i])) {
+            rc = WW_ERROR;
+        }
+        close(fds[i]);
+    }
+    free(fds);
+    /* and the renames */
+    if (0 < nfds && 0 <= (dfd = open(params.dir, O_RDONLY))) {
+        fsync(dfd);
+        close(dfd);
+    }
+    return rc;
+}
+
+static ww_configuration_t* mock_load(char *name, ww_list_t *directives)
+{
+    ww_configuration_t *config = NULL;
+    ww_type_object_t *typ = NULL;
+    ww_building_block_t *blk = NULL;
+    ww_kval_t *kv;
+    char *path, *line = NULL, *p, *field;
+    size_t size = 0;
+    ssize_t len;
+    FILE *fp;
+
+    if (NULL == (path = mock_path(name))) {
+        return NULL;
+    }
+    fp = fopen(path, "r");
+    free(path);
+    if (NULL == fp) {
+        return NULL;
+    }
+    config = WW_NEW(ww_configuration_t);
+    while (0 < (len = getline(&line, &size, fp))) {
+        if ('\n' == line[len-1]) {
+            line[len-1] = '\0';
+        }
+        if (len < 2 || '\t' != line[1]) {
+            continue;
+        }
+        p = line + 2;
+        switch (line[0]) {
+        case 'C':
+            config->name = strdup(p);
+            break;
+        case 'T':
+            typ = WW_NEW(ww_type_object_t);
+            typ->type = strdup(p);
+            ww_pointer_array_add(&config->types, typ);
+            blk = NULL;
+            break;
+        case 'B':
+            if (NULL != typ) {
+                blk = WW_NEW(ww_building_block_t);
+                blk->uuid = strdup(p);
+                ww_pointer_array_add(&typ->blocks, blk);
+                typ->nblocks++;
+            }
+            break;
+        case 'K':
+            if (NULL != blk) {
+                kv = WW_NEW(ww_kval_t);
+                kv->key = strdup(strsep(&p, "\t"));
+                while (NULL != (field = strsep(&p, "\t"))) {
+                    ww_argv_append_nosize(&kv->values, field);
+                }
+                ww_pointer_array_add(&blk->keyvals, kv);
+                blk->nkvals++;
+            }
+            break;
+        }
+    }
+    free(line);
+    fclose(fp);
+    return config;
+}
+
+static ww_dsmeta_t* mock_stat(char *name)
+{
+    ww_dsmeta_t *meta;
+    struct stat buf;
+    char *path;
+
+    if (NULL == (path = mock_path(name))) {
+        return NULL;
+    }
+    if (0 != stat(path, &buf)) {
+        free(path);
+        return NULL;
+    }
+    free(path);
+    meta = WW_NEW(ww_dsmeta_t);
+    meta->name = strdup("bench");
+    if (0 > asprintf(&meta->mtime, "%ld.%09ld", (long)buf.st_mtim.tv_sec,
+                     (long)buf.st_mtim.tv_nsec)) {
+        meta->mtime = NULL;
+    }
+    if (0 > asprintf(&meta->version, "%lu.%lu", (unsigned long)buf.st_ino,
+                     (unsigned long)buf.st_size)) {
+        meta->version = NULL;
+    }
+    return meta;
+}
+
+static ww_dstore_module_t mock_module = {
+    .load = mock_load,
+    .commit = mock_commit,
+    .stat = mock_stat,
+    .flush = mock_flush
+};
+
+static ww_dstore_base_component_t mock_component = {
+    .base = {
+        .mca_component_name = "bench"
+    }
+};
+
+static bool mock_register(void)
+{
+    if (NULL == params.dir) {
+        if (NULL == (params.dir = strdup("/tmp/dstore_bench.XXXXXX")) ||
+            NULL == mkdtemp(params.dir)) {
+            fprintf(stderr, "Could not create a scratch directory: %s\n", strerror(errno));
+            return false;
+        }
+        mock_madedir = true;
+    }
+    /* ahead of anything real */
+    return (WW_SUCCESS == ww_dstore_base_add_module(&mock_component, &mock_module, 1000000));
+}
+
+static void mock_unlink(ww_configuration_t *config)
+{
+    char *path;
+
+    if (NULL != (path = mock_path(config->name))) {
+        unlink(path);
+        free(path);
+    }
+}
+
+static void mock_cleanup(ww_configuration_t *config, ww_configuration_t **configs)
+{
+    int i;
+
+    mock_flush();
+    mock_unlink(config);
+    for (i=0; i < params.threads; i++) {
+        mock_unlink(configs[i]);
+    }
+    if (mock_madedir) {
+        rmdir(params.dir);
+    }
+}
+
+/****    PHASES    ****/
+static void bench_commit(const char *dstore, ww_configuration_t *config)
+{
+    bench_result_t res;
+    ww_configuration_t *cfg;
+    double start;
+    int i;
+
+    result_start(&res, dstore, "commit");
+    for (i=0; i < params.iterations; i++) {
+        config->modified = true;
+        start = now_usec();
+        ww_dstore.commit(config, NULL);
+        result_add(&res, now_usec() - start);
+    }
+    result_report(&res);
+
+    /* every commit drops the cached copy, so the load that follows
+     * one has to go back to the dstore (or shared memory) */
+    result_start(&res, dstore, "load");
+    for (i=0; i < params.iterations; i++) {
+        ww_dstore.commit(config, NULL);
+        start = now_usec();
+        cfg = ww_dstore.load(config->name, NULL);
+        result_add(&res, now_usec() - start);
+        if (NULL != cfg) {
+            WW_RELEASE(cfg);
+        }
+    }
+    result_report(&res);
+
+    result_start(&res, dstore, "load_cached");
+    for (i=0; i < params.iterations; i++) {
+        start = now_usec();
+        cfg = ww_dstore.load(config->name, NULL);
+        result_add(&res, now_usec() - start);
+        if (NULL != cfg) {
+            WW_RELEASE(cfg);
+        }
+    }
+    result_report(&res);
+}
+
+typedef struct {
+    ww_configuration_t *config;
+    bench_result_t res;
+} bench_committer_t;
+
+static ww_mutex_t committer_lock = WW_MUTEX_STATIC_INIT;
+
+static void* committer(ww_object_t *obj)
+{
+    ww_thread_t *thread = (ww_thread_t*)obj;
+    bench_committer_t *c = (bench_committer_t*)thread->t_arg;
+    double start;
+    int i;
+
+    for (i=0; i < params.iterations; i++) {
+        start = now_usec();
+        ww_dstore.commit(c->config, NULL);
+        ww_mutex_lock(&committer_lock);
+        result_add(&c->res, now_usec() - start);
+        ww_mutex_unlock(&committer_lock);
+    }
+    return NULL;
+}
+
+/* several threads committing configurations of their own at once -
+ * what group commit is there to speed up */
+static void bench_commit_concurrent(const char *dstore, ww_configuration_t **configs)
+{
+    bench_committer_t *cs;
+    ww_thread_t *threads;
+    double start;
+    int i, n;
+
+    cs = (bench_committer_t*)calloc(params.threads, sizeof(bench_committer_t));
+    threads = (ww_thread_t*)calloc(params.threads, sizeof(ww_thread_t));
+    if (NULL == cs || NULL == threads) {
+        free(cs);
+        free(threads);
+        fprintf(stderr, "Out of memory - skipping concurrent commits\n");
+        return;
+    }
+    start = now_usec();
+    for (n=0; n < params.threads; n++) {
+        cs[n].config = configs[n];
+        result_start(&cs[n].res, dstore, "commit_concurrent");
+        WW_CONSTRUCT(&threads[n], ww_thread_t);
+        threads[n].t_run = committer;
+        threads[n].t_arg = &cs[n];
+        if (WW_SUCCESS != ww_thread_start(&threads[n])) {
+            WW_DESTRUCT(&threads[n]);
+            break;
+        }
+    }
+    for (i=0; i < n; i++) {
+        ww_thread_join(&threads[i], NULL);
+        WW_DESTRUCT(&threads[i]);
+    }
+    /* fold the threads' samples together */
+    for (i=1; i < n; i++) {
+        if (0 < cs[i].res.count) {
+            if (0 == cs[0].res.count || cs[i].res.min < cs[0].res.min) {
+                cs[0].res.min = cs[i].res.min;
+            }
+            if (cs[i].res.max > cs[0].res.max) {
+                cs[0].res.max = cs[i].res.max;
+            }
+            cs[0].res.total += cs[i].res.total;
+            cs[0].res.count += cs[i].res.count;
+        }
+    }
+    if (0 < n) {
+        cs[0].res.wall = now_usec() - start;
+        result_report(&cs[0].res);
+    }
+    free(cs);
+    free(threads);
+}
+
+static void bench_find(ww_configuration_t *config, const char *op,
+                       const char *directive, const char *pattern)
+{
+    bench_result_t res;
+    ww_list_t directives, results;
+    double start;
+    int i;
+
+    WW_CONSTRUCT(&directives, ww_list_t);
+    ww_list_append(&directives, &make_directive(directive, pattern)->super);
+
+    result_start(&res, "base", op);
+    for (i=0; i < params.iterations; i++) {
+        WW_CONSTRUCT(&results, ww_list_t);
+        start = now_usec();
+        ww_dstore.find(config, "nodes", "key0", &directives, &results);
+        result_add(&res, now_usec() - start);
+        WW_LIST_DESTRUCT(&results);
+    }
+    result_report(&res);
+    WW_LIST_DESTRUCT(&directives);
+}
+
+static void bench_base(ww_configuration_t *config)
+{
+    bench_result_t res;
+    ww_type_object_t *nodes;
+    ww_building_block_t *blk;
+    ww_kval_t *kv;
+    ww_list_t directives;
+    char val[64];
+    double start;
+    int i, b;
+
+    bench_find(config, "find_exact", WW_SRCH_EXACT_MATCH, "val0");
+    bench_find(config, "find_partial", WW_SRCH_PARTIAL_MATCH, "val1");
+    bench_find(config, "find_template", WW_SRCH_TEMPLATE_MATCH, "val1*");
+
+    nodes = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, 0);
+
+    WW_CONSTRUCT(&directives, ww_list_t);
+    ww_list_append(&directives, &make_directive(WW_SET_OVERWRITE_ALLOWED, "true")->super);
+
+    /* one set per call, cycling across the nodes */
+    result_start(&res, "base", "set");
+    for (i=0; i < params.iterations; i++) {
+        blk = (ww_building_block_t*)ww_pointer_array_get_item(&nodes->blocks, i % params.nodes);
+        snprintf(val, sizeof(val), "val%d", i % params.cardinality);
+        kv = make_directive("key0", val);
+        start = now_usec();
+        ww_dstore.set(blk, kv, &directives);
+        result_add(&res, now_usec() - start);
+        WW_RELEASE(kv);
+    }
+    result_report(&res);
+
+    /* a batch of sets against consecutive nodes, timed as a unit */
+    result_start(&res, "base", "set_batch");
+    for (i=0; i < params.iterations; i++) {
+        start = now_usec();
+        for (b=0; b < params.batch; b++) {
+            blk = (ww_building_block_t*)ww_pointer_array_get_item(&nodes->blocks,
+                                                                 (i * params.batch + b) % params.nodes);
+            snprintf(val, sizeof(val), "val%d", b % params.cardinality);
+            kv = make_directive("key1", val);
+            ww_dstore.set(blk, kv, &directives);
+            WW_RELEASE(kv);
+        }
+        result_add(&res, now_usec() - start);
+    }
+    result_report(&res);
+    WW_LIST_DESTRUCT(&directives);
+}
+
+static void usage(const char *cmd)
+{
+    fprintf(stderr, "Usage: %s [options]\n"
+            "  -n, --nodes N          number of nodes in the configuration (default: %d)\n"
+            "  -k, --keys K           number of keys per node (default: %d)\n"
+            "  -c, --cardinality C    number of distinct values per key (default: %d)\n"
+            "  -m, --multi R          fraction of keys holding multiple values (default: %.2f)\n"
+            "  -i, --iterations I     iterations per operation (default: %d)\n"
+            "  -b, --batch B          sets per batch in the batched set test (default: %d)\n"
+            "  -t, --threads T        threads in the concurrent commit test (default: %d)\n"
+            "  -s, --seed S           seed for the configuration generator (default: %u)\n"
+            "  -M, --mock             commit to the stand-in dstore even if a real one is available\n"
+            "  -d, --dir DIR          directory the stand-in dstore keeps its files in\n"
+            "                         (default: a new directory under /tmp)\n"
+            "  -j, --json             emit JSON instead of CSV\n"
+            "  -o, --output FILE      write results to FILE instead of stdout\n",
+            cmd, params.nodes, params.keys, params.cardinality, params.multi,
+            params.iterations, params.batch, params.threads, params.seed);
+}
+
+int main(int argc, char **argv)
+{
+    static struct option longopts[] = {
+        {"nodes", required_argument, NULL, 'n'},
+        {"keys", required_argument, NULL, 'k'},
+        {"cardinality", required_argument, NULL, 'c'},
+        {"multi", required_argument, NULL, 'm'},
+        {"iterations", required_argument, NULL, 'i'},
+        {"batch", required_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 's'},
+        {"mock", no_argument, NULL, 'M'},
+        {"dir", required_argument, NULL, 'd'},
+        {"json", no_argument, NULL, 'j'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    ww_dstore_base_active_module_t *active;
+    ww_configuration_t *config, **configs;
+    const char *dstore;
+    char name[64];
+    int opt, rc, n;
+
+    params.out = stdout;
+    while (-1 != (opt = getopt_long(argc, argv, "n:k:c:m:i:b:t:s:Md:jo:h", longopts, NULL))) {
+        switch (opt) {
+        case 'n':
+            params.nodes = atoi(optarg);
+            break;
+        case 'k':
+            params.keys = atoi(optarg);
+            break;
+        case 'c':
+            params.cardinality = atoi(optarg);
+            break;
+        case 'm':
+            params.multi = atof(optarg);
+            break;
+        case 'i':
+            params.iterations = atoi(optarg);
+            break;
+        case 'b':
+            params.batch = atoi(optarg);
+            break;
+        case 't':
+            params.threads = atoi(optarg);
+            break;
+        case 's':
+            params.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'M':
+            params.mock = true;
+            break;
+        case 'd':
+            params.dir = strdup(optarg);
+            break;
+        case 'j':
+            params.json = true;
+            break;
+        case 'o':
+            if (NULL == (params.out = fopen(optarg, "w"))) {
+                fprintf(stderr, "Could not open %s for writing\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return ('h' == opt) ? 0 : 1;
+        }
+    }
+    if (params.nodes <= 0 || params.keys <= 0 || params.cardinality <= 0 ||
+        params.iterations <= 0 || params.batch <= 0 || params.threads <= 0 ||
+        params.multi < 0.0 || params.multi > 1.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (WW_SUCCESS != (rc = ww_init(&argc, &argv))) {
+        fprintf(stderr, "ww_init failed: %d\n", rc);
+        return 1;
+    }
+
+    if (params.mock || ww_list_is_empty(&ww_dstore_globals.actives)) {
+        if (!mock_register()) {
+            ww_finalize();
+            return 1;
+        }
+        params.mock = true;
+    }
+    active = (ww_dstore_base_active_module_t*)ww_list_get_first(&ww_dstore_globals.actives);
+    dstore = active->component->base.mca_component_name;
+
+    config = generate_config("dstore_bench", params.seed);
+    /* one for each committing thread, so that they do not simply
+     * replace each other's work */
+    if (NULL == (configs = (ww_configuration_t**)calloc(params.threads, sizeof(ww_configuration_t*)))) {
+        fprintf(stderr, "Out of memory\n");
+        WW_RELEASE(config);
+        ww_finalize();
+        return 1;
+    }
+    for (n=0; n < params.threads; n++) {
+        snprintf(name, sizeof(name), "dstore_bench.%d", n);
+        configs[n] = generate_config(name, params.seed + n);
+    }
+
+    if (params.json) {
+        fprintf(params.out, "[\n");
+    } else {
+        fprintf(params.out, "component,op,nodes,keys,cardinality,multi,count,"
+                "total_usec,mean_usec,min_usec,max_usec,ops_per_sec\n");
+    }
+
+    bench_commit(dstore, config);
+    bench_commit_concurrent(dstore, configs);
+    bench_base(config);
+
+    if (params.json) {
+        fprintf(params.out, "\n]\n");
+    }
+    if (stdout != params.out) {
+        fclose(params.out);
+    }
+
+    if (params.mock) {
+        mock_cleanup(config, configs);
+    }
+    for (n=0; n < params.threads; n++) {
+        WW_RELEASE(configs[n]);
+    }
+    free(configs);
+    WW_RELEASE(config);
+    ww_finalize();
+    return 0;
+}
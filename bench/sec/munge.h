@@ -0,0 +1,57 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * The part of the libmunge client API that the munge sec component
+ * uses, so that the benchmark can build the component against the
+ * stand-in munged in munged_standin.c rather than the real library.
+ * The names, signatures and error codes follow libmunge.
+ */
+
+#ifndef WW_BENCH_MUNGE_H
+#define WW_BENCH_MUNGE_H
+
+#include <sys/types.h>
+
+typedef enum munge_err {
+    EMUNGE_SUCCESS              = 0,
+    EMUNGE_SNAFU                = 1,
+    EMUNGE_BAD_ARG              = 2,
+    EMUNGE_BAD_LENGTH           = 3,
+    EMUNGE_OVERFLOW             = 4,
+    EMUNGE_NO_MEMORY            = 5,
+    EMUNGE_SOCKET               = 6,
+    EMUNGE_TIMEOUT              = 7,
+    EMUNGE_BAD_CRED             = 8,
+    EMUNGE_BAD_VERSION          = 9,
+    EMUNGE_BAD_CIPHER           = 10,
+    EMUNGE_BAD_MAC              = 11,
+    EMUNGE_BAD_ZIP              = 12,
+    EMUNGE_BAD_REALM            = 13,
+    EMUNGE_CRED_INVALID         = 14,
+    EMUNGE_CRED_EXPIRED         = 15,
+    EMUNGE_CRED_REWOUND         = 16,
+    EMUNGE_CRED_REPLAYED        = 17,
+    EMUNGE_CRED_UNAUTHORIZED    = 18
+} munge_err_t;
+
+/* options are not supported - always pass NULL */
+typedef struct munge_ctx *munge_ctx_t;
+
+munge_err_t munge_encode(char **cred, munge_ctx_t ctx,
+                         const void *buf, int len);
+
+munge_err_t munge_decode(const char *cred, munge_ctx_t ctx,
+                         void **buf, int *len, uid_t *uid, gid_t *gid);
+
+const char* munge_strerror(munge_err_t e);
+
+#endif
@@ -0,0 +1,498 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* A stand-in for munged, so that the munge sec component can be
+ * benchmarked on hosts that have no munge installation.
+ *
+ * Like the real thing it is a server on a UNIX socket: every
+ * munge_encode and munge_decode call connects, sends one request,
+ * reads one reply and closes, and the server handles connections one
+ * at a time. The caller's uid and gid come from the socket. That
+ * keeps the round trip - the cost the component's caches and
+ * credential pool exist to avoid - in the measurements.
+ *
+ * A credential is "MUNGE:" followed by the hex of the uid, gid,
+ * encode time, a serial number and the payload, then ":" and the hex
+ * of a siphash MAC of those under a key chosen at startup. Decoding
+ * checks the MAC and the age of the credential, and refuses to decode
+ * the same serial twice. Nothing is encrypted, and the serials seen
+ * are remembered for the life of the server.
+ */
+
+#include <src/include/ww_config.h>
+#include <ww_types.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "src/class/ww_hash_table.h"
+#include "src/threads/threads.h"
+#include "src/util/siphash.h"
+#include "src/mca/sec/base/base.h"
+
+#include "munge.h"
+#include "munged_standin.h"
+
+#define STANDIN_PREFIX      "MUNGE:"
+/* seconds a credential can be decoded for, as munged's default */
+#define STANDIN_TTL         300
+/* uid, gid, encode time and serial */
+#define STANDIN_HDR_LEN     24
+/* status, uid and gid */
+#define STANDIN_REPLY_LEN   12
+
+#define STANDIN_ENCODE      'E'
+#define STANDIN_DECODE      'D'
+
+static char sockdir[] = "/tmp/ww-munged-XXXXXX";
+static struct sockaddr_un addr;
+static bool running = false;
+static volatile bool stopping = false;
+static int lsd = -1;
+static ww_thread_t server_thread;
+static uint8_t key[WW_SIPHASH_KEYLEN];
+/* only touched by the server thread */
+static uint64_t next_serial = 0;
+static ww_hash_table_t seen;
+
+static void put_le(uint8_t *p, uint64_t v, int n)
+{
+    int i;
+
+    for (i=0; i < n; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint64_t get_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    int i;
+
+    for (i=0; i < n; i++) {
+        v |= ((uint64_t)p[i]) << (8 * i);
+    }
+    return v;
+}
+
+static void to_hex(char *out, const uint8_t *in, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t i;
+
+    for (i=0; i < len; i++) {
+        out[2*i] = digits[in[i] >> 4];
+        out[2*i+1] = digits[in[i] & 0x0f];
+    }
+    out[2*len] = '\0';
+}
+
+static int hex_digit(char c)
+{
+    if ('0' <= c && c <= '9') {
+        return c - '0';
+    }
+    if ('a' <= c && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static bool from_hex(uint8_t *out, const char *in, size_t len)
+{
+    size_t i;
+    int hi, lo;
+
+    for (i=0; i < len; i++) {
+        if (0 > (hi = hex_digit(in[2*i])) || 0 > (lo = hex_digit(in[2*i+1]))) {
+            return false;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+/* server side: mint a credential for uid/gid carrying the payload */
+static munge_err_t encode(uid_t uid, gid_t gid, const uint8_t *data, size_t len,
+                          char **cred, size_t *credlen)
+{
+    uint8_t *raw, mac[8];
+    size_t rawlen = STANDIN_HDR_LEN + len;
+    char *out;
+
+    if (NULL == (raw = (uint8_t*)malloc(rawlen))) {
+        return EMUNGE_NO_MEMORY;
+    }
+    put_le(raw, uid, 4);
+    put_le(raw + 4, gid, 4);
+    put_le(raw + 8, (uint64_t)time(NULL), 8);
+    put_le(raw + 16, next_serial++, 8);
+    if (0 < len) {
+        memcpy(raw + STANDIN_HDR_LEN, data, len);
+    }
+    put_le(mac, ww_siphash(key, raw, rawlen), 8);
+
+    *credlen = strlen(STANDIN_PREFIX) + 2 * rawlen + 1 + 2 * sizeof(mac);
+    if (NULL == (out = (char*)malloc(*credlen + 1))) {
+        free(raw);
+        return EMUNGE_NO_MEMORY;
+    }
+    strcpy(out, STANDIN_PREFIX);
+    to_hex(out + strlen(STANDIN_PREFIX), raw, rawlen);
+    out[strlen(STANDIN_PREFIX) + 2 * rawlen] = ':';
+    to_hex(out + strlen(STANDIN_PREFIX) + 2 * rawlen + 1, mac, sizeof(mac));
+    free(raw);
+    *cred = out;
+    return EMUNGE_SUCCESS;
+}
+
+/* server side: check a credential and return the raw bytes */
+static munge_err_t decode(const char *cred, size_t credlen,
+                          uint8_t **raw, size_t *rawlen)
+{
+    const char *hex, *sep;
+    uint8_t *buf, mac[8];
+    uint64_t serial;
+    time_t minted, now;
+    void *dummy;
+    munge_err_t rc;
+
+    if (credlen < strlen(STANDIN_PREFIX) ||
+        0 != strncmp(cred, STANDIN_PREFIX, strlen(STANDIN_PREFIX))) {
+        return EMUNGE_BAD_CRED;
+    }
+    hex = cred + strlen(STANDIN_PREFIX);
+    if (NULL == (sep = strchr(hex, ':')) ||
+        0 != (sep - hex) % 2 || STANDIN_HDR_LEN > (size_t)(sep - hex) / 2 ||
+        2 * sizeof(mac) != strlen(sep + 1)) {
+        return EMUNGE_BAD_CRED;
+    }
+    *rawlen = (sep - hex) / 2;
+    if (NULL == (buf = (uint8_t*)malloc(*rawlen))) {
+        return EMUNGE_NO_MEMORY;
+    }
+
+    now = time(NULL);
+    if (!from_hex(buf, hex, *rawlen) || !from_hex(mac, sep + 1, sizeof(mac))) {
+        rc = EMUNGE_BAD_CRED;
+    } else if (ww_siphash(key, buf, *rawlen) != get_le(mac, 8)) {
+        rc = EMUNGE_BAD_MAC;
+    } else if (now > (minted = (time_t)get_le(buf + 8, 8)) + STANDIN_TTL) {
+        rc = EMUNGE_CRED_EXPIRED;
+    } else if (minted > now) {
+        rc = EMUNGE_CRED_REWOUND;
+    } else if (WW_SUCCESS == ww_hash_table_get_value_uint64(&seen,
+                                 (serial = get_le(buf + 16, 8)), &dummy)) {
+        rc = EMUNGE_CRED_REPLAYED;
+    } else {
+        ww_hash_table_set_value_uint64(&seen, serial, (void*)1);
+        *raw = buf;
+        return EMUNGE_SUCCESS;
+    }
+    free(buf);
+    return rc;
+}
+
+static void serve(int sd)
+{
+    uint8_t *req, *raw = NULL, *reply;
+    char *cred = NULL;
+    const uint8_t *payload = NULL;
+    uint32_t reqlen;
+    size_t len = 0;
+    uid_t uid;
+    gid_t gid;
+    munge_err_t rc;
+
+    if (WW_SUCCESS != ww_sec_base_recv_blob(sd, (void**)&req, &reqlen)) {
+        return;
+    }
+    if (!ww_sec_base_peer_creds(sd, &uid, &gid)) {
+        /* no way to ask the socket - but the client is in this process */
+        uid = geteuid();
+        gid = getegid();
+    }
+
+    if (0 == reqlen) {
+        rc = EMUNGE_BAD_ARG;
+    } else if (STANDIN_ENCODE == req[0]) {
+        rc = encode(uid, gid, req + 1, reqlen - 1, &cred, &len);
+        payload = (const uint8_t*)cred;
+    } else if (STANDIN_DECODE == req[0]) {
+        if (EMUNGE_SUCCESS == (rc = decode((const char*)req + 1, reqlen - 1, &raw, &len))) {
+            uid = (uid_t)get_le(raw, 4);
+            gid = (gid_t)get_le(raw + 4, 4);
+            payload = raw + STANDIN_HDR_LEN;
+            len -= STANDIN_HDR_LEN;
+        }
+    } else {
+        rc = EMUNGE_BAD_ARG;
+    }
+    free(req);
+
+    if (EMUNGE_SUCCESS != rc) {
+        len = 0;
+    }
+    if (NULL == (reply = (uint8_t*)malloc(STANDIN_REPLY_LEN + len))) {
+        rc = EMUNGE_NO_MEMORY;
+        len = 0;
+        reply = (uint8_t*)malloc(STANDIN_REPLY_LEN);
+    }
+    if (NULL != reply) {
+        put_le(reply, rc, 4);
+        put_le(reply + 4, uid, 4);
+        put_le(reply + 8, gid, 4);
+        if (0 < len) {
+            memcpy(reply + STANDIN_REPLY_LEN, payload, len);
+        }
+        (void)ww_sec_base_send_blob(sd, reply, STANDIN_REPLY_LEN + len);
+        free(reply);
+    }
+    if (NULL != cred) {
+        free(cred);
+    }
+    if (NULL != raw) {
+        free(raw);
+    }
+}
+
+static void* server(ww_object_t *obj)
+{
+    int sd;
+
+    while (true) {
+        if (0 > (sd = accept(lsd, NULL, NULL))) {
+            if (EINTR == errno || ECONNABORTED == errno) {
+                continue;
+            }
+            break;
+        }
+        if (stopping) {
+            close(sd);
+            break;
+        }
+        serve(sd);
+        close(sd);
+    }
+    return NULL;
+}
+
+/* client side: one request, one reply, as libmunge does */
+static munge_err_t transact(char op, const void *buf, size_t len,
+                            uint8_t **reply, uint32_t *rlen)
+{
+    uint8_t *req;
+    munge_err_t rc;
+    int sd;
+
+    *reply = NULL;
+    if (!running) {
+        return EMUNGE_SOCKET;
+    }
+    if (WW_SEC_MAX_BLOB <= len) {
+        return EMUNGE_BAD_LENGTH;
+    }
+    if (NULL == (req = (uint8_t*)malloc(len + 1))) {
+        return EMUNGE_NO_MEMORY;
+    }
+    req[0] = (uint8_t)op;
+    if (0 < len) {
+        memcpy(req + 1, buf, len);
+    }
+
+    if (0 > (sd = socket(AF_UNIX, SOCK_STREAM, 0))) {
+        free(req);
+        return EMUNGE_SOCKET;
+    }
+    if (0 != connect(sd, (struct sockaddr*)&addr, sizeof(addr)) ||
+        WW_SUCCESS != ww_sec_base_send_blob(sd, req, (uint32_t)(len + 1)) ||
+        WW_SUCCESS != ww_sec_base_recv_blob(sd, (void**)reply, rlen)) {
+        rc = EMUNGE_SOCKET;
+    } else if (STANDIN_REPLY_LEN > *rlen) {
+        rc = EMUNGE_SNAFU;
+    } else {
+        rc = (munge_err_t)get_le(*reply, 4);
+    }
+    close(sd);
+    free(req);
+    /* callers only want the reply if it worked */
+    if (EMUNGE_SUCCESS != rc && NULL != *reply) {
+        free(*reply);
+        *reply = NULL;
+    }
+    return rc;
+}
+
+munge_err_t munge_encode(char **cred, munge_ctx_t ctx, const void *buf, int len)
+{
+    uint8_t *reply;
+    uint32_t rlen;
+    munge_err_t rc;
+
+    if (NULL == cred || 0 > len || (NULL == buf && 0 < len)) {
+        return EMUNGE_BAD_ARG;
+    }
+    *cred = NULL;
+    if (EMUNGE_SUCCESS != (rc = transact(STANDIN_ENCODE, buf, len, &reply, &rlen))) {
+        return rc;
+    }
+    /* the reply is terminated, so the credential can stay in place */
+    rlen -= STANDIN_REPLY_LEN;
+    memmove(reply, reply + STANDIN_REPLY_LEN, rlen + 1);
+    *cred = (char*)reply;
+    return EMUNGE_SUCCESS;
+}
+
+munge_err_t munge_decode(const char *cred, munge_ctx_t ctx,
+                         void **buf, int *len, uid_t *uid, gid_t *gid)
+{
+    uint8_t *reply;
+    uint32_t rlen;
+    munge_err_t rc;
+
+    if (NULL != buf) {
+        *buf = NULL;
+    }
+    if (NULL != len) {
+        *len = 0;
+    }
+    if (NULL == cred) {
+        return EMUNGE_BAD_ARG;
+    }
+    if (EMUNGE_SUCCESS != (rc = transact(STANDIN_DECODE, cred, strlen(cred), &reply, &rlen))) {
+        return rc;
+    }
+    if (NULL != uid) {
+        *uid = (uid_t)get_le(reply + 4, 4);
+    }
+    if (NULL != gid) {
+        *gid = (gid_t)get_le(reply + 8, 4);
+    }
+    rlen -= STANDIN_REPLY_LEN;
+    if (NULL != buf && 0 < rlen) {
+        memmove(reply, reply + STANDIN_REPLY_LEN, rlen + 1);
+        *buf = reply;
+        reply = NULL;
+    }
+    if (NULL != len) {
+        *len = (int)rlen;
+    }
+    if (NULL != reply) {
+        free(reply);
+    }
+    return EMUNGE_SUCCESS;
+}
+
+const char* munge_strerror(munge_err_t e)
+{
+    static const char *msgs[] = {
+        "Success",
+        "Internal error",
+        "Invalid argument",
+        "Exceeded maximum message length",
+        "Buffer overflow",
+        "Out of memory",
+        "Socket communication error",
+        "Socket timeout",
+        "Invalid credential format",
+        "Invalid credential version",
+        "Invalid cipher type",
+        "Invalid MAC type",
+        "Invalid compression type",
+        "Unrecognized security realm",
+        "Invalid credential",
+        "Expired credential",
+        "Rewound credential",
+        "Replayed credential",
+        "Unauthorized credential decode"
+    };
+
+    if (0 > (int)e || sizeof(msgs) / sizeof(msgs[0]) <= (size_t)e) {
+        return "Unknown error";
+    }
+    return msgs[e];
+}
+
+ww_status_t ww_munged_standin_start(void)
+{
+    ww_status_t rc;
+
+    if (running) {
+        return WW_SUCCESS;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_random(key, sizeof(key)))) {
+        return rc;
+    }
+    if (NULL == mkdtemp(sockdir)) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/socket", sockdir);
+
+    if (0 > (lsd = socket(AF_UNIX, SOCK_STREAM, 0))) {
+        rmdir(sockdir);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    if (0 != bind(lsd, (struct sockaddr*)&addr, sizeof(addr)) ||
+        0 != listen(lsd, SOMAXCONN)) {
+        close(lsd);
+        lsd = -1;
+        unlink(addr.sun_path);
+        rmdir(sockdir);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+
+    WW_CONSTRUCT(&seen, ww_hash_table_t);
+    ww_hash_table_init(&seen, 1024);
+    WW_CONSTRUCT(&server_thread, ww_thread_t);
+    server_thread.t_run = server;
+    stopping = false;
+    if (WW_SUCCESS != (rc = ww_thread_start(&server_thread))) {
+        WW_DESTRUCT(&server_thread);
+        WW_DESTRUCT(&seen);
+        close(lsd);
+        lsd = -1;
+        unlink(addr.sun_path);
+        rmdir(sockdir);
+        return rc;
+    }
+    running = true;
+    return WW_SUCCESS;
+}
+
+void ww_munged_standin_stop(void)
+{
+    int sd;
+
+    if (!running) {
+        return;
+    }
+    running = false;
+    /* wake the server out of accept */
+    stopping = true;
+    if (0 <= (sd = socket(AF_UNIX, SOCK_STREAM, 0))) {
+        (void)connect(sd, (struct sockaddr*)&addr, sizeof(addr));
+        close(sd);
+    }
+    ww_thread_join(&server_thread, NULL);
+    WW_DESTRUCT(&server_thread);
+    WW_DESTRUCT(&seen);
+    close(lsd);
+    lsd = -1;
+    unlink(addr.sun_path);
+    rmdir(sockdir);
+}
@@ -0,0 +1,24 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#ifndef WW_BENCH_MUNGED_STANDIN_H
+#define WW_BENCH_MUNGED_STANDIN_H
+
+#include <src/include/ww_config.h>
+#include <ww_types.h>
+
+/* start the stand-in munged in a private directory under /tmp -
+ * until then munge_encode and munge_decode fail with EMUNGE_SOCKET */
+ww_status_t ww_munged_standin_start(void);
+
+/* stop it and remove its socket */
+void ww_munged_standin_stop(void);
+
+#endif
@@ -0,0 +1,471 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Sec benchmark
+ *
+ * Times create_cred and validate_cred for each active sec component,
+ * first from a single thread and then from each requested number of
+ * concurrent threads. Every thread validates the credentials it
+ * created, since components such as munge refuse to accept the same
+ * credential twice. Components that issue session tokens are also
+ * timed validating a token in place of a credential.
+ *
+ * Components only become active if they can run here - munge needs
+ * a munged to talk to. So that the munge code can be measured without
+ * one, the benchmark carries its own copy of the munge component,
+ * built against the stand-in munged in munged_standin.c, and runs it
+ * as "munge-standin" whenever munge itself is not active (or always,
+ * with --standin). The stand-in costs a socket round trip per call as
+ * munged does, but none of munged's cryptography.
+ *
+ * Results are emitted as CSV (default) or JSON, with throughput and
+ * latency percentiles, so they can be collected and compared across
+ * releases.
+ */
+
+#include <src/include/ww_config.h>
+#include <ww_types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
+#include "src/util/argv.h"
+#include "src/mca/sec/base/base.h"
+
+#include "munged_standin.h"
+#include "sec_munge.h"
+
+typedef struct {
+    int iterations;
+    char **threads;
+    bool json;
+    bool standin;
+    FILE *out;
+} bench_params_t;
+
+typedef enum {
+    BENCH_CREATE,
+    BENCH_VALIDATE,
+    BENCH_VALIDATE_TOKEN
+} bench_op_t;
+
+/* state for one worker thread */
+typedef struct {
+    ww_thread_t thread;
+    ww_sec_module_t *module;
+    ww_peer_t *peer;
+    bench_op_t op;
+    char **creds;       // created by BENCH_CREATE, consumed by BENCH_VALIDATE
+    char *token;
+    double *lat;        // latency of each operation in usec
+    int count;
+    int failed;
+} bench_worker_t;
+
+static bench_params_t params = {
+    .iterations = 10000,
+    .threads = NULL,
+    .json = false,
+    .standin = false,
+    .out = NULL
+};
+
+static int nresults = 0;
+
+static double now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* nearest-rank percentile of a sorted array */
+static double percentile(double *sorted, int n, double pct)
+{
+    int idx;
+
+    if (0 == n) {
+        return 0.0;
+    }
+    idx = (int)(pct / 100.0 * n + 0.5) - 1;
+    if (idx < 0) {
+        idx = 0;
+    } else if (idx >= n) {
+        idx = n - 1;
+    }
+    return sorted[idx];
+}
+
+static void* worker(ww_object_t *obj)
+{
+    ww_thread_t *t = (ww_thread_t*)obj;
+    bench_worker_t *w = (bench_worker_t*)t->t_arg;
+    double start;
+    int i, rc;
+
+    for (i=0; i < params.iterations; i++) {
+        switch (w->op) {
+        case BENCH_CREATE:
+            start = now_usec();
+            w->creds[i] = w->module->create_cred();
+            w->lat[w->count++] = now_usec() - start;
+            if (NULL == w->creds[i]) {
+                w->failed++;
+            }
+            break;
+        case BENCH_VALIDATE:
+            if (NULL == w->creds[i]) {
+                continue;
+            }
+            start = now_usec();
+            rc = w->module->validate_cred(w->peer, w->creds[i]);
+            w->lat[w->count++] = now_usec() - start;
+            if (WW_SUCCESS != rc) {
+                w->failed++;
+            }
+            break;
+        case BENCH_VALIDATE_TOKEN:
+            start = now_usec();
+            rc = w->module->validate_cred(w->peer, w->token);
+            w->lat[w->count++] = now_usec() - start;
+            if (WW_SUCCESS != rc) {
+                w->failed++;
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void report(const char *component, const char *op, int nthreads,
+                   bench_worker_t *workers, double elapsed)
+{
+    double *lat, total = 0.0, mean, rate;
+    int i, n = 0, failed = 0;
+
+    for (i=0; i < nthreads; i++) {
+        n += workers[i].count;
+        failed += workers[i].failed;
+    }
+    if (NULL == (lat = (double*)malloc((n + 1) * sizeof(double)))) {
+        return;
+    }
+    n = 0;
+    for (i=0; i < nthreads; i++) {
+        memcpy(&lat[n], workers[i].lat, workers[i].count * sizeof(double));
+        n += workers[i].count;
+    }
+    qsort(lat, n, sizeof(double), cmp_double);
+    for (i=0; i < n; i++) {
+        total += lat[i];
+    }
+    mean = (0 < n) ? total / n : 0.0;
+    /* throughput is what the threads achieved together */
+    rate = (0.0 < elapsed) ? n * 1000000.0 / elapsed : 0.0;
+
+    if (params.json) {
+        fprintf(params.out, "%s  {\"component\": \"%s\", \"op\": \"%s\", "
+                "\"threads\": %d, \"count\": %d, \"failed\": %d, "
+                "\"elapsed_usec\": %.3f, \"ops_per_sec\": %.1f, \"mean_usec\": %.3f, "
+                "\"p50_usec\": %.3f, \"p90_usec\": %.3f, \"p99_usec\": %.3f, "
+                "\"p999_usec\": %.3f, \"max_usec\": %.3f}",
+                (0 < nresults) ? ",\n" : "",
+                component, op, nthreads, n, failed, elapsed, rate, mean,
+                percentile(lat, n, 50.0), percentile(lat, n, 90.0),
+                percentile(lat, n, 99.0), percentile(lat, n, 99.9),
+                (0 < n) ? lat[n-1] : 0.0);
+    } else {
+        fprintf(params.out, "%s,%s,%d,%d,%d,%.3f,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                component, op, nthreads, n, failed, elapsed, rate, mean,
+                percentile(lat, n, 50.0), percentile(lat, n, 90.0),
+                percentile(lat, n, 99.0), percentile(lat, n, 99.9),
+                (0 < n) ? lat[n-1] : 0.0);
+    }
+    nresults++;
+    free(lat);
+}
+
+/* run one operation on every worker concurrently and return
+ * the wall-clock time they took */
+static double run(bench_worker_t *workers, int nthreads, bench_op_t op)
+{
+    double start;
+    int i;
+
+    for (i=0; i < nthreads; i++) {
+        workers[i].op = op;
+        workers[i].count = 0;
+        workers[i].failed = 0;
+        WW_CONSTRUCT(&workers[i].thread, ww_thread_t);
+        workers[i].thread.t_run = worker;
+        workers[i].thread.t_arg = &workers[i];
+    }
+    start = now_usec();
+    if (1 == nthreads) {
+        /* no need to pay for a thread */
+        worker(&workers[0].thread.super);
+    } else {
+        for (i=0; i < nthreads; i++) {
+            ww_thread_start(&workers[i].thread);
+        }
+        for (i=0; i < nthreads; i++) {
+            ww_thread_join(&workers[i].thread, NULL);
+        }
+    }
+    start = now_usec() - start;
+    for (i=0; i < nthreads; i++) {
+        WW_DESTRUCT(&workers[i].thread);
+    }
+    return start;
+}
+
+static void free_workers(bench_worker_t *workers, int nthreads)
+{
+    int i, j;
+
+    for (i=0; i < nthreads; i++) {
+        if (NULL != workers[i].creds) {
+            for (j=0; j < params.iterations; j++) {
+                if (NULL != workers[i].creds[j]) {
+                    free(workers[i].creds[j]);
+                }
+            }
+            free(workers[i].creds);
+        }
+        if (NULL != workers[i].lat) {
+            free(workers[i].lat);
+        }
+    }
+    free(workers);
+}
+
+static int bench_component(const char *cname, ww_sec_module_t *module, int nthreads)
+{
+    bench_worker_t *workers;
+    ww_peer_t *peer;
+    char *token = NULL;
+    double elapsed;
+    int i;
+
+    if (NULL == module || NULL == module->create_cred || NULL == module->validate_cred) {
+        return WW_SUCCESS;
+    }
+
+    if (NULL == (workers = (bench_worker_t*)calloc(nthreads, sizeof(bench_worker_t)))) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    for (i=0; i < nthreads; i++) {
+        workers[i].creds = (char**)calloc(params.iterations, sizeof(char*));
+        workers[i].lat = (double*)malloc(params.iterations * sizeof(double));
+        if (NULL == workers[i].creds || NULL == workers[i].lat) {
+            free_workers(workers, nthreads);
+            return WW_ERR_OUT_OF_RESOURCE;
+        }
+    }
+
+    /* we validate our own credentials */
+    peer = WW_NEW(ww_peer_t);
+    peer->uid = ww_globals.uid;
+    peer->gid = ww_globals.gid;
+    for (i=0; i < nthreads; i++) {
+        workers[i].module = module;
+        workers[i].peer = peer;
+    }
+
+    elapsed = run(workers, nthreads, BENCH_CREATE);
+    report(cname, "create_cred", nthreads, workers, elapsed);
+
+    elapsed = run(workers, nthreads, BENCH_VALIDATE);
+    report(cname, "validate_cred", nthreads, workers, elapsed);
+
+    if (NULL != module->issue_token &&
+        NULL != (token = module->issue_token(peer))) {
+        for (i=0; i < nthreads; i++) {
+            workers[i].token = token;
+        }
+        elapsed = run(workers, nthreads, BENCH_VALIDATE_TOKEN);
+        report(cname, "validate_token", nthreads, workers, elapsed);
+        free(token);
+    }
+
+    free_workers(workers, nthreads);
+    WW_RELEASE(peer);
+    return WW_SUCCESS;
+}
+
+/* run every thread count against one module, stopping
+ * if we run out of memory */
+static int bench_module(const char *cname, ww_sec_module_t *module)
+{
+    int i, rc;
+
+    for (i=0; NULL != params.threads[i]; i++) {
+        if (WW_SUCCESS != (rc = bench_component(cname, module, atoi(params.threads[i])))) {
+            fprintf(stderr, "%s: could not allocate %d threads x %d iterations\n",
+                    cname, atoi(params.threads[i]), params.iterations);
+            return rc;
+        }
+    }
+    return WW_SUCCESS;
+}
+
+/* bring up our own copy of the munge component on the stand-in munged */
+static ww_sec_module_t* standin_init(void)
+{
+    int rc;
+
+    if (WW_SUCCESS != (rc = ww_munged_standin_start())) {
+        fprintf(stderr, "Could not start the stand-in munged: %d\n", rc);
+        return NULL;
+    }
+    if (WW_SUCCESS != (rc = ww_munge_module.init())) {
+        fprintf(stderr, "munge-standin init failed: %d\n", rc);
+        ww_munged_standin_stop();
+        return NULL;
+    }
+    return &ww_munge_module;
+}
+
+static void standin_finalize(void)
+{
+    ww_munge_module.finalize();
+    ww_munged_standin_stop();
+}
+
+static void usage(const char *cmd)
+{
+    fprintf(stderr, "Usage: %s [options]\n"
+            "  -i, --iterations I     operations per thread (default: %d)\n"
+            "  -t, --threads LIST     comma-separated thread counts to run with (default: 1,4)\n"
+            "  -j, --json             emit JSON instead of CSV\n"
+            "  -M, --standin          also run munge-standin when munge is active\n"
+            "  -o, --output FILE      write results to FILE instead of stdout\n",
+            cmd, params.iterations);
+}
+
+int main(int argc, char **argv)
+{
+    static struct option longopts[] = {
+        {"iterations", required_argument, NULL, 'i'},
+        {"threads", required_argument, NULL, 't'},
+        {"json", no_argument, NULL, 'j'},
+        {"standin", no_argument, NULL, 'M'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    ww_sec_base_active_module_t *active;
+    ww_sec_module_t *standin = NULL;
+    bool have_munge = false;
+    int opt, rc, i;
+
+    params.out = stdout;
+    while (-1 != (opt = getopt_long(argc, argv, "i:t:jMo:h", longopts, NULL))) {
+        switch (opt) {
+        case 'i':
+            params.iterations = atoi(optarg);
+            break;
+        case 't':
+            ww_argv_free(params.threads);
+            params.threads = ww_argv_split(optarg, ',');
+            break;
+        case 'j':
+            params.json = true;
+            break;
+        case 'M':
+            params.standin = true;
+            break;
+        case 'o':
+            if (NULL == (params.out = fopen(optarg, "w"))) {
+                fprintf(stderr, "Could not open %s for writing\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return ('h' == opt) ? 0 : 1;
+        }
+    }
+    if (NULL == params.threads) {
+        params.threads = ww_argv_split("1,4", ',');
+    }
+    if (params.iterations <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (i=0; NULL != params.threads[i]; i++) {
+        if (0 >= atoi(params.threads[i])) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (WW_SUCCESS != (rc = ww_init(&argc, &argv))) {
+        fprintf(stderr, "ww_init failed: %d\n", rc);
+        return 1;
+    }
+    WW_LIST_FOREACH(active, &ww_sec_globals.actives, ww_sec_base_active_module_t) {
+        if (0 == strcmp(active->component->base.mca_component_name, "munge")) {
+            have_munge = true;
+        }
+    }
+    if ((params.standin || !have_munge) && NULL == (standin = standin_init())) {
+        ww_finalize();
+        return 1;
+    }
+
+    if (params.json) {
+        fprintf(params.out, "[\n");
+    } else {
+        fprintf(params.out, "component,op,threads,count,failed,elapsed_usec,ops_per_sec,"
+                "mean_usec,p50_usec,p90_usec,p99_usec,p999_usec,max_usec\n");
+    }
+
+    rc = WW_SUCCESS;
+    WW_LIST_FOREACH(active, &ww_sec_globals.actives, ww_sec_base_active_module_t) {
+        if (WW_SUCCESS != (rc = bench_module(active->component->base.mca_component_name,
+                                             active->module))) {
+            break;
+        }
+    }
+    if (WW_SUCCESS == rc && NULL != standin) {
+        rc = bench_module("munge-standin", standin);
+    }
+
+    if (params.json) {
+        fprintf(params.out, "\n]\n");
+    }
+    if (stdout != params.out) {
+        fclose(params.out);
+    }
+
+    if (NULL != standin) {
+        standin_finalize();
+    }
+    ww_argv_free(params.threads);
+    ww_finalize();
+    return (WW_SUCCESS == rc) ? 0 : 1;
+}
@@ -336,7 +336,9 @@ AC_DEFUN([WW_SETUP_CORE],[
                       time.h unistd.h \
                       crt_externs.h signal.h \
                       ioLib.h sockLib.h hostLib.h limits.h \
-                      sys/statfs.h sys/statvfs.h])
+                      sys/statfs.h sys/statvfs.h sys/mman.h \
+                      fnmatch.h sys/eventfd.h ucontext.h \
+                      sys/syscall.h linux/io_uring.h])
 
     # Note that sometimes we have <stdbool.h>, but it doesn't work (e.g.,
     # have both Portland and GNU installed; using pgcc will find GNU's
@@ -414,6 +416,13 @@ AC_DEFUN([WW_SETUP_CORE],[
     AC_MSG_RESULT([$MSG2])
     WW_VAR_SCOPE_POP
 
+    # kernel-supplied credentials of a Unix-domain peer
+    AC_CHECK_TYPES([struct ucred], [], [], [AC_INCLUDES_DEFAULT
+                                            #if HAVE_SYS_SOCKET_H
+                                            #include <sys/socket.h>
+                                            #endif
+                                           ])
+
     AC_CHECK_MEMBERS([struct sockaddr.sa_len], [], [], [
                          #include <sys/types.h>
                          #if HAVE_SYS_SOCKET_H
@@ -537,7 +546,14 @@ AC_DEFUN([WW_SETUP_CORE],[
     # Darwin doesn't need -lm, as it's a symlink to libSystem.dylib
     WW_SEARCH_LIBS_CORE([ceil], [m])
 
-    AC_CHECK_FUNCS([asprintf snprintf vasprintf vsnprintf strsignal socketpair strncpy_s usleep statfs statvfs])
+    # Older glibc keeps the POSIX shared memory calls in -lrt
+    WW_SEARCH_LIBS_CORE([shm_open], [rt])
+
+    # dladdr lets the progress thread watchdog name stalled callbacks
+    AC_CHECK_HEADERS([dlfcn.h])
+    WW_SEARCH_LIBS_CORE([dladdr], [dl])
+
+    AC_CHECK_FUNCS([asprintf snprintf vasprintf vsnprintf strsignal socketpair strncpy_s usleep statfs statvfs getpeereid getgrouplist sched_setaffinity makecontext])
 
     # On some hosts, htonl is a define, so the AC_CHECK_FUNC will get
     # confused.  On others, it's in the standard library, but stubbed with
@@ -690,6 +706,9 @@ AC_DEFUN([WW_SETUP_CORE],[
         lib/Warewulf/ACVars.pm
         lib/Warewulf/Makefile
         ww_config_prefix[src/tools/submanager/Makefile]
+        ww_config_prefix[bench/Makefile]
+        ww_config_prefix[bench/dstore/Makefile]
+        ww_config_prefix[bench/sec/Makefile]
         )
 
     # Success
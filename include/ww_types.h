@@ -118,6 +118,7 @@ typedef struct event ww_event_t;
 #define ww_event_loop(a, b) event_base_loop(a, b)
 #define ww_event_base_loopbreak(a) event_base_loopbreak(a)
 #define WW_EVLOOP_ONCE  EVLOOP_ONCE
+#define WW_EVLOOP_NONBLOCK  EVLOOP_NONBLOCK
 #define WW_EV_PERSIST EV_PERSIST
 
 /* define maximum value and key sizes */
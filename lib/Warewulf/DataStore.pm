@@ -30,6 +30,20 @@ use Warewulf::ObjectSet;
 
 our @ISA = ('Warewulf::Object');
 
+# Use the C dstore framework when the native binding has been built
+# and installed; otherwise fall back to reading the JSON file directly.
+our $NATIVE = eval {
+    require XSLoader;
+    XSLoader::load('Warewulf::DataStore');
+    1;
+} || 0;
+
+# END blocks run before Perl destroys whatever is still referenced, so
+# this only finalizes once the last native datastore has been destroyed
+END {
+    Warewulf::DataStore::Native::finalize() if ($NATIVE);
+}
+
 =head1 NAME
 
 Warewulf::DataStore - Warewulf's data storage class
@@ -60,6 +74,12 @@ Warewulf::DataStore - Warewulf's data storage class
 C<Warewulf::DataStore> Is the storage vector for Warewulf ObjectSets of
 a given "type".
 
+If the native binding is available, C<open>, C<get_value>,
+C<set_value>, C<create_new>, C<find> and C<commit> are handled by the
+C dstore framework, with the datastore file name used as the name of
+the configuration. Datastores that no dstore component can provide
+are handled in Perl as before.
+
 =head1 METHODS
 
 =over 4
@@ -115,6 +135,19 @@ open($)
     my $json = $self->get("JSON");
 
     $self->set("FILE", $json_file);
+    delete($self->{"NATIVE"});
+
+    if ( $NATIVE ) {
+        my $config = Warewulf::DataStore::Native->load($json_file);
+
+        if ( ! $config and ! -f "$json_file" ) {
+            $config = Warewulf::DataStore::Native->create($json_file);
+        }
+        if ( $config ) {
+            $self->{"NATIVE"} = $config;
+            return(0);
+        }
+    }
 
     if ( -f "$json_file" ) {
         my $fd;
@@ -145,8 +178,21 @@ commit($)
 {
     my ($self, $json_file) = @_;
     my $json = $self->get("JSON");
+    my $data = $self->{"DATA"};
     my $fd;
 
+    if ( exists($self->{"NATIVE"}) ) {
+        if ( ! $json_file or $json_file eq $self->get("FILE") ) {
+            if ( $self->{"NATIVE"}->commit() != 0 ) {
+                printf("ERROR: Could not commit %s\n", $self->get("FILE"));
+                return(undef);
+            }
+            return(1);
+        }
+        # Writing a copy elsewhere, so export what the dstore holds
+        $data = { "WAREWULF" => { "OBJECTS" => $self->{"NATIVE"}->objects() } };
+    }
+
     if ( ! $json_file ) {
         $json_file = $self->get("FILE");
     }
@@ -156,7 +202,7 @@ commit($)
         return(undef);
     }
 
-    print $fd $json->encode($self->{"DATA"});
+    print $fd $json->encode($data);
 
     close($fd);
 
@@ -175,6 +221,10 @@ get_value($$$)
 {
     my ($self, $id, $key) = @_;
 
+    if ( exists($self->{"NATIVE"}) ) {
+        return($self->{"NATIVE"}->get_value($id, $key));
+    }
+
     if ( exists($self->{"DATA"}) ) {
         if ( exists($self->{"DATA"}{"WAREWULF"}{"OBJECTS"}{$id}{$key})) {
             return($self->{"DATA"}{"WAREWULF"}{"OBJECTS"}{$id}{$key});
@@ -197,6 +247,10 @@ set_value($$$)
     my ($self, $id, $key, $value) = @_;
     my $count = 0;
 
+    if ( exists($self->{"NATIVE"}) ) {
+        return($self->{"NATIVE"}->set_value($id, $key, $value));
+    }
+
     if ( exists($self->{"DATA"}) ) {
         if ( exists($self->{"DATA"}{"WAREWULF"}{"OBJECTS"}{$id}) ) {
             $self->{"DATA"}{"WAREWULF"}{"OBJECTS"}{$id}{$key} = $value;
@@ -225,6 +279,13 @@ create_new($$$)
     close($fd);
     chomp($id);
 
+    if ( exists($self->{"NATIVE"}) ) {
+        if ( ! $self->{"NATIVE"}->create_new($id) ) {
+            return(undef);
+        }
+        return($id);
+    }
+
     if ( exists($self->{"DATA"}) ) {
         if ( exists($self->{"DATA"}{"WAREWULF"}{"OBJECTS"}{$id}) ) {
             return(undef);
@@ -250,6 +311,11 @@ find($$$)
     my @ids;
     my $count = 0;
 
+    if ( exists($self->{"NATIVE"}) ) {
+        # Keys and values compare exactly as they do below
+        return($self->{"NATIVE"}->find($key, $value));
+    }
+
     if ( exists($self->{"DATA"}) ) {
         foreach my $id ( keys %{$self->{"DATA"}{"WAREWULF"}{"OBJECTS"}} ) {
             if ( $key ) {
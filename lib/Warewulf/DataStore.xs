@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Perl binding for the dstore framework. Warewulf::DataStore keeps
+ * its objects in the "OBJECTS" type of a configuration named after
+ * the datastore file, with the object ID as the building block uuid
+ * and one key-value per attribute. The blocks are indexed by ID, so
+ * reaching an object costs what it does in a Perl hash. */
+
+#include <src/include/ww_config.h>
+#include <ww_types.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/class/ww_hash_table.h"
+#include "src/runtime/ww_rte.h"
+#include "src/util/argv.h"
+#include "src/mca/dstore/base/base.h"
+
+/* the Perl headers and the code xsubpp generates around them are
+ * not clean under the warnings we build the library with */
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wpedantic"
+#pragma GCC diagnostic ignored "-Wformat"
+#endif
+
+#include "EXTERN.h"
+#include "perl.h"
+#include "XSUB.h"
+
+#define WW_DATASTORE_OBJECTS    "OBJECTS"
+#define WW_DATASTORE_ID         "ID"
+
+/* a configuration, and its objects by ID */
+typedef struct {
+    ww_configuration_t *config;
+    ww_hash_table_t blocks;
+} ww_datastore_native_t;
+typedef ww_datastore_native_t* Warewulf__DataStore__Native;
+
+static bool initialized = false;
+/* configurations handed out to Perl and not yet destroyed - the
+ * library cannot be finalized until they are gone, and Perl runs END
+ * blocks before destroying whatever is still referenced */
+static int nconfigs = 0;
+static bool finalize_pending = false;
+
+static bool native_init(void)
+{
+    if (!initialized) {
+        if (WW_SUCCESS != ww_init(NULL, NULL)) {
+            return false;
+        }
+        initialized = true;
+        finalize_pending = false;
+    }
+    return true;
+}
+
+static void native_finalize(void)
+{
+    if (initialized) {
+        ww_finalize();
+        initialized = false;
+    }
+    finalize_pending = false;
+}
+
+static ww_type_object_t* get_type(ww_configuration_t *config, bool create)
+{
+    ww_type_object_t *typ;
+    int i;
+
+    for (i=0; i < config->types.size; i++) {
+        if (NULL != (typ = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, i)) &&
+            NULL != typ->type && 0 == strcmp(typ->type, WW_DATASTORE_OBJECTS)) {
+            return typ;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    typ = WW_NEW(ww_type_object_t);
+    typ->type = strdup(WW_DATASTORE_OBJECTS);
+    ww_pointer_array_add(&config->types, typ);
+    return typ;
+}
+
+static ww_building_block_t* get_block(ww_datastore_native_t *nat, const char *id)
+{
+    ww_building_block_t *blk;
+
+    if (WW_SUCCESS != ww_hash_table_get_value_ptr(&nat->blocks, id, strlen(id), (void**)&blk)) {
+        return NULL;
+    }
+    return blk;
+}
+
+/* take over a configuration, indexing the objects in it */
+static ww_datastore_native_t* new_native(ww_configuration_t *config)
+{
+    ww_datastore_native_t *nat;
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    int i;
+
+    if (NULL == (nat = (ww_datastore_native_t*)malloc(sizeof(ww_datastore_native_t)))) {
+        WW_RELEASE(config);
+        return NULL;
+    }
+    nat->config = config;
+    WW_CONSTRUCT(&nat->blocks, ww_hash_table_t);
+    ww_hash_table_init(&nat->blocks, 1024);
+    if (NULL != (typ = get_type(config, false))) {
+        for (i=0; i < typ->blocks.size; i++) {
+            blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, i);
+            if (NULL != blk && NULL != blk->uuid) {
+                ww_hash_table_set_value_ptr(&nat->blocks, blk->uuid, strlen(blk->uuid), blk);
+            }
+        }
+    }
+    nconfigs++;
+    return nat;
+}
+
+/* an object matches if the key holds exactly the value - as a Perl
+ * string comparison would, a list of values never matches */
+static bool match_block(ww_building_block_t *blk, const char *key, const char *value)
+{
+    ww_kval_t *kv;
+    bool match = false;
+    int i;
+
+    ww_mutex_lock(&blk->mutex);
+    for (i=0; i < blk->keyvals.size; i++) {
+        kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, i);
+        if (NULL == kv || NULL == kv->key || 0 != strcmp(kv->key, key)) {
+            continue;
+        }
+        match = (NULL != kv->values && NULL != kv->values[0] && NULL == kv->values[1] &&
+                 0 == strcmp(kv->values[0], value));
+        break;
+    }
+    ww_mutex_unlock(&blk->mutex);
+    return match;
+}
+
+/* a single value comes back as a plain scalar, several as a
+ * reference to an array of them */
+static SV* values_to_sv(char **values)
+{
+    AV *av;
+    int n;
+
+    if (NULL == values || NULL == values[0]) {
+        return newSV(0);
+    }
+    if (NULL == values[1]) {
+        return newSVpv(values[0], 0);
+    }
+    av = newAV();
+    for (n=0; NULL != values[n]; n++) {
+        av_push(av, newSVpv(values[n], 0));
+    }
+    return newRV_noinc((SV*)av);
+}
+
+/* accept either a plain scalar or a reference to an array of them */
+static char** sv_to_values(SV *value)
+{
+    char **values = NULL;
+    AV *av;
+    SV **elem;
+    SSize_t i;
+
+    if (SvROK(value) && SVt_PVAV == SvTYPE(SvRV(value))) {
+        av = (AV*)SvRV(value);
+        for (i=0; i <= av_len(av); i++) {
+            if (NULL != (elem = av_fetch(av, i, 0)) && SvOK(*elem)) {
+                ww_argv_append_nosize(&values, SvPV_nolen(*elem));
+            }
+        }
+    } else if (SvOK(value)) {
+        ww_argv_append_nosize(&values, SvPV_nolen(value));
+    }
+    return values;
+}
+
+MODULE = Warewulf::DataStore    PACKAGE = Warewulf::DataStore::Native
+
+PROTOTYPES: DISABLE
+
+Warewulf::DataStore::Native
+load(class, name)
+        const char *class
+        char *name
+    PREINIT:
+        ww_configuration_t *config;
+    CODE:
+        PERL_UNUSED_VAR(class);
+        if (!native_init() ||
+            NULL == (config = ww_dstore.load(name, NULL)) ||
+            NULL == (RETVAL = new_native(config))) {
+            XSRETURN_UNDEF;
+        }
+    OUTPUT:
+        RETVAL
+
+Warewulf::DataStore::Native
+create(class, name)
+        const char *class
+        char *name
+    PREINIT:
+        ww_configuration_t *config;
+    CODE:
+        PERL_UNUSED_VAR(class);
+        /* nothing to create it in unless a dstore is available */
+        if (!native_init() || ww_list_is_empty(&ww_dstore_globals.actives)) {
+            XSRETURN_UNDEF;
+        }
+        config = WW_NEW(ww_configuration_t);
+        config->name = strdup(name);
+        get_type(config, true);
+        if (NULL == (RETVAL = new_native(config))) {
+            XSRETURN_UNDEF;
+        }
+    OUTPUT:
+        RETVAL
+
+SV*
+get_value(nat, id, key)
+        Warewulf::DataStore::Native nat
+        const char *id
+        const char *key
+    PREINIT:
+        ww_building_block_t *blk;
+        ww_kval_t *kv;
+        int i;
+    CODE:
+        RETVAL = NULL;
+        if (NULL != (blk = get_block(nat, id))) {
+            ww_mutex_lock(&blk->mutex);
+            for (i=0; i < blk->keyvals.size && NULL == RETVAL; i++) {
+                kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, i);
+                if (NULL == kv || NULL == kv->key || 0 != strcmp(kv->key, key)) {
+                    continue;
+                }
+                if (NULL == kv->values || NULL == kv->values[0]) {
+                    break;
+                }
+                RETVAL = values_to_sv(kv->values);
+            }
+            ww_mutex_unlock(&blk->mutex);
+        }
+        if (NULL == RETVAL) {
+            XSRETURN_UNDEF;
+        }
+    OUTPUT:
+        RETVAL
+
+int
+set_value(nat, id, key, value)
+        Warewulf::DataStore::Native nat
+        const char *id
+        const char *key
+        SV *value
+    PREINIT:
+        ww_building_block_t *blk;
+        ww_kval_t kv;
+    CODE:
+        RETVAL = 0;
+        if (NULL != (blk = get_block(nat, id))) {
+            WW_CONSTRUCT(&kv, ww_kval_t);
+            kv.key = strdup(key);
+            kv.values = sv_to_values(value);
+            if (WW_SUCCESS == ww_dstore.set(blk, &kv, NULL)) {
+                nat->config->modified = true;
+                RETVAL = 1;
+            }
+            WW_DESTRUCT(&kv);
+        }
+    OUTPUT:
+        RETVAL
+
+int
+create_new(nat, id)
+        Warewulf::DataStore::Native nat
+        const char *id
+    PREINIT:
+        ww_type_object_t *typ;
+        ww_building_block_t *blk;
+        ww_kval_t kv;
+    CODE:
+        RETVAL = 0;
+        if (NULL == get_block(nat, id)) {
+            typ = get_type(nat->config, true);
+            blk = WW_NEW(ww_building_block_t);
+            blk->uuid = strdup(id);
+            ww_pointer_array_add(&typ->blocks, blk);
+            typ->nblocks++;
+            ww_hash_table_set_value_ptr(&nat->blocks, blk->uuid, strlen(blk->uuid), blk);
+            WW_CONSTRUCT(&kv, ww_kval_t);
+            kv.key = strdup(WW_DATASTORE_ID);
+            ww_argv_append_nosize(&kv.values, id);
+            ww_dstore.set(blk, &kv, NULL);
+            WW_DESTRUCT(&kv);
+            nat->config->modified = true;
+            RETVAL = 1;
+        }
+    OUTPUT:
+        RETVAL
+
+void
+find(nat, key = NULL, value = NULL)
+        Warewulf::DataStore::Native nat
+        char *key
+        char *value
+    PREINIT:
+        ww_type_object_t *typ;
+        ww_building_block_t *blk;
+        int i;
+    PPCODE:
+        /* a single pass, matching as the pure-Perl version does */
+        if (NULL != key && '\0' == *key) {
+            key = NULL;
+        }
+        if (NULL != (typ = get_type(nat->config, false))) {
+            for (i=0; i < typ->blocks.size; i++) {
+                blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, i);
+                if (NULL == blk || NULL == blk->uuid) {
+                    continue;
+                }
+                if (NULL != key && !match_block(blk, key, (NULL == value) ? "" : value)) {
+                    continue;
+                }
+                XPUSHs(sv_2mortal(newSVpv(blk->uuid, 0)));
+            }
+        }
+
+SV*
+objects(nat)
+        Warewulf::DataStore::Native nat
+    PREINIT:
+        ww_type_object_t *typ;
+        ww_building_block_t *blk;
+        ww_kval_t *kv;
+        HV *objs, *obj;
+        int i, n;
+    CODE:
+        /* everything in the datastore, laid out as the pure-Perl
+         * version keeps it under {"WAREWULF"}{"OBJECTS"} */
+        objs = newHV();
+        if (NULL != (typ = get_type(nat->config, false))) {
+            for (i=0; i < typ->blocks.size; i++) {
+                blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, i);
+                if (NULL == blk || NULL == blk->uuid) {
+                    continue;
+                }
+                obj = newHV();
+                ww_mutex_lock(&blk->mutex);
+                for (n=0; n < blk->keyvals.size; n++) {
+                    kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, n);
+                    if (NULL != kv && NULL != kv->key) {
+                        (void)hv_store(obj, kv->key, strlen(kv->key),
+                                       values_to_sv(kv->values), 0);
+                    }
+                }
+                ww_mutex_unlock(&blk->mutex);
+                (void)hv_store(objs, blk->uuid, strlen(blk->uuid),
+                               newRV_noinc((SV*)obj), 0);
+            }
+        }
+        RETVAL = newRV_noinc((SV*)objs);
+    OUTPUT:
+        RETVAL
+
+int
+commit(nat)
+        Warewulf::DataStore::Native nat
+    CODE:
+        RETVAL = ww_dstore.commit(nat->config, NULL);
+        if (WW_SUCCESS == RETVAL) {
+            nat->config->modified = false;
+        }
+    OUTPUT:
+        RETVAL
+
+void
+DESTROY(nat)
+        Warewulf::DataStore::Native nat
+    CODE:
+        WW_DESTRUCT(&nat->blocks);
+        WW_RELEASE(nat->config);
+        free(nat);
+        if (0 == --nconfigs && finalize_pending) {
+            native_finalize();
+        }
+
+void
+finalize()
+    CODE:
+        /* put off until the last configuration has been destroyed */
+        if (0 < nconfigs) {
+            finalize_pending = true;
+        } else {
+            native_finalize();
+        }
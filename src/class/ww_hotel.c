@@ -18,27 +18,31 @@
 #include "src/class/ww_hotel.h"
 
 
-static void local_eviction_callback(int fd, short flags, void *arg)
+static void local_eviction_callback(ww_timer_wheel_t *wheel,
+                                    ww_timer_wheel_entry_t *entry)
 {
-    ww_hotel_room_eviction_callback_arg_t *eargs =
-        (ww_hotel_room_eviction_callback_arg_t*) arg;
-    void *occupant = eargs->hotel->rooms[eargs->room_num].occupant;
+    /* The wheel is embedded in the hotel and the timer in the room,
+       so there is no need to store either with every room */
+    ww_hotel_t *hotel = (ww_hotel_t*)
+        ((char*) wheel - offsetof(ww_hotel_t, wheel));
+    ww_hotel_room_t *room = (ww_hotel_room_t*)
+        ((char*) entry - offsetof(ww_hotel_room_t, eviction_timer));
+    int room_num = (int) (room - hotel->rooms);
+    void *occupant = room->occupant;
 
     /* Remove the occurpant from the room.
 
        Do not change this logic without also changing the same logic
        in ww_hotel_checkout() and
        ww_hotel_checkout_and_return_occupant(). */
-    ww_hotel_t *hotel = eargs->hotel;
-    ww_hotel_room_t *room = &(hotel->rooms[eargs->room_num]);
     room->occupant = NULL;
     hotel->last_unoccupied_room++;
     assert(hotel->last_unoccupied_room < hotel->num_rooms);
-    hotel->unoccupied_rooms[hotel->last_unoccupied_room] = eargs->room_num;
+    hotel->unoccupied_rooms[hotel->last_unoccupied_room] = room_num;
 
     /* Invoke the user callback to tell them that they were evicted */
     hotel->evict_callback_fn(hotel,
-                             eargs->room_num,
+                             room_num,
                              occupant);
 }
 
@@ -49,7 +53,8 @@ int ww_hotel_init(ww_hotel_t *h, int num_rooms,
                     int eviction_event_priority,
                     ww_hotel_eviction_callback_fn_t evict_callback_fn)
 {
-    int i;
+    uint32_t tick;
+    int i, rc;
 
     /* Bozo check */
     if (num_rooms <= 0 ||
@@ -59,14 +64,21 @@ int ww_hotel_init(ww_hotel_t *h, int num_rooms,
 
     h->num_rooms = num_rooms;
     h->evbase = evbase;
-    h->eviction_timeout.tv_usec = eviction_timeout % 1000000;
-    h->eviction_timeout.tv_sec = eviction_timeout / 1000000;
     h->evict_callback_fn = evict_callback_fn;
-    h->rooms = (ww_hotel_room_t*)malloc(num_rooms * sizeof(ww_hotel_room_t));
-    if (NULL != evict_callback_fn) {
-        h->eviction_args =
-            (ww_hotel_room_eviction_callback_arg_t*)malloc(num_rooms * sizeof(ww_hotel_room_eviction_callback_arg_t));
+    if (NULL != h->evbase) {
+        /* Tick often enough that evictions are not too late */
+        tick = eviction_timeout / WW_HOTEL_TICKS_PER_TIMEOUT;
+        if (0 == tick) {
+            tick = 1;
+        }
+        rc = ww_timer_wheel_init(&h->wheel, h->evbase, tick,
+                                 local_eviction_callback);
+        if (WW_SUCCESS != rc) {
+            return rc;
+        }
+        h->eviction_ticks = ww_timer_wheel_ticks(&h->wheel, eviction_timeout);
     }
+    h->rooms = (ww_hotel_room_t*)malloc(num_rooms * sizeof(ww_hotel_room_t));
     h->unoccupied_rooms = (int*) malloc(num_rooms * sizeof(int));
     h->last_unoccupied_room = num_rooms - 1;
 
@@ -77,17 +89,9 @@ int ww_hotel_init(ww_hotel_t *h, int num_rooms,
         /* Setup this room in the unoccupied index array */
         h->unoccupied_rooms[i] = i;
 
-        /* Setup the eviction callback args */
-        h->eviction_args[i].hotel = h;
-        h->eviction_args[i].room_num = i;
-
-        /* Create this room's event (but don't add it) */
-        if (NULL != h->evbase) {
-            event_assign(&(h->rooms[i].eviction_timer_event),
-                         h->evbase,
-                         -1, 0, local_eviction_callback,
-                         &(h->eviction_args[i]));
-        }
+        /* This room's timer is not pending */
+        h->rooms[i].eviction_timer.next = NULL;
+        h->rooms[i].eviction_timer.prev = NULL;
     }
 
     return WW_SUCCESS;
@@ -97,34 +101,22 @@ static void constructor(ww_hotel_t *h)
 {
     h->num_rooms = 0;
     h->evbase = NULL;
-    h->eviction_timeout.tv_sec = 0;
-    h->eviction_timeout.tv_usec = 0;
+    WW_CONSTRUCT(&h->wheel, ww_timer_wheel_t);
+    h->eviction_ticks = 0;
     h->evict_callback_fn = NULL;
     h->rooms = NULL;
-    h->eviction_args = NULL;
     h->unoccupied_rooms = NULL;
     h->last_unoccupied_room = -1;
 }
 
 static void destructor(ww_hotel_t *h)
 {
-    int i;
-
-    /* Go through all occupied rooms and destroy their events */
-    if (NULL != h->evbase) {
-        for (i = 0; i < h->num_rooms; ++i) {
-            if (NULL != h->rooms[i].occupant) {
-                event_del(&(h->rooms[i].eviction_timer_event));
-            }
-        }
-    }
+    /* Stop the wheel - the rooms' timers go away with the rooms */
+    WW_DESTRUCT(&h->wheel);
 
     if (NULL != h->rooms) {
         free(h->rooms);
     }
-    if (NULL != h->eviction_args) {
-        free(h->eviction_args);
-    }
     if (NULL != h->unoccupied_rooms) {
         free(h->unoccupied_rooms);
     }
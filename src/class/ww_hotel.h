@@ -17,7 +17,8 @@
  * - An arbitrary data pointer can check into an empty room at any time
  * - The occupant of a room can check out at any time
  * - Optionally, the occupant of a room can be forcibly evicted at a
- *   given time (i.e., when an ww timer event expires).
+ *   given time (i.e., when its timer on the hotel's timer wheel
+ *   expires).
  * - The hotel has finite occupancy; if you try to checkin a new
  *   occupant and the hotel is already full, it will gracefully fail
  *   to checkin.
@@ -43,9 +44,17 @@
  *
  * There is an ww_hotel_init() function to create a hotel, but no
  * corresponding finalize; the destructor will handle all finalization
- * issues.  Note that when a hotel is destroyed, it will delete all
- * pending events from the event base (i.e., all pending eviction
+ * issues.  Note that when a hotel is destroyed, it will delete its
+ * timer event from the event base (i.e., all pending eviction
  * callbacks); no further eviction callbacks will be invoked.
+ *
+ * All rooms share a single timer wheel (see ww_timer_wheel.h), which
+ * is driven by one timer event on the event base while anyone is
+ * checked in. Starting and cancelling a room's eviction timer is
+ * therefore O(1) and never touches libevent. Evictions happen on a
+ * tick of the wheel, so they can be up to two ticks - that is,
+ * 2/WW_HOTEL_TICKS_PER_TIMEOUT of the eviction timeout - late, but
+ * never early.
  */
 
 #ifndef WW_HOTEL_H
@@ -56,6 +65,7 @@
 #include "src/include/prefetch.h"
 #include "ww.h"
 #include "src/class/ww_object.h"
+#include "src/class/ww_timer_wheel.h"
 #include WW_EVENT_HEADER
 
 #include "src/util/output.h"
@@ -64,6 +74,9 @@ BEGIN_C_DECLS
 
 struct ww_hotel_t;
 
+/* Number of ticks of the timer wheel per eviction timeout */
+#define WW_HOTEL_TICKS_PER_TIMEOUT 16
+
 /* User-supplied function to be invoked when an occupant is evicted. */
 typedef void (*ww_hotel_eviction_callback_fn_t)(struct ww_hotel_t *hotel,
                                                   int room_num,
@@ -81,32 +94,9 @@ typedef void (*ww_hotel_eviction_callback_fn_t)(struct ww_hotel_t *hotel,
    contiguous set of rooms in an array. */
 typedef struct {
     void *occupant;
-    ww_event_t eviction_timer_event;
+    ww_timer_wheel_entry_t eviction_timer;
 } ww_hotel_room_t;
 
-/* Note that this is an internal data structure; it is not part of the
-   public ww_hotel interface.  Public consumers of ww_hotel
-   shouldn't need to use this struct at all (we only have it here in
-   this .h file because some functions are inlined for speed, and need
-   to get to the internals of this struct).
-
-   Use a unique struct for holding the arguments for eviction
-   callbacks.  We *could* make the to-be-evicted ww_hotel_room_t
-   instance as the argument, but we don't, for 2 reasons:
-
-   1. We want as many ww_hotel_room_t's to fit in a cache line as
-      possible (i.e., to be as cache-friendly as possible).  The
-      common/fast code path only needs to access the data in the
-      ww_hotel_room_t (and not the callback argument data).
-
-   2. Evictions will be uncommon, so we don't mind penalizing them a
-      bit by making the data be in a separate cache line.
-*/
-typedef struct {
-    struct ww_hotel_t *hotel;
-    int room_num;
-} ww_hotel_room_eviction_callback_arg_t;
-
 typedef struct ww_hotel_t {
     /* make this an object */
     ww_object_t super;
@@ -116,16 +106,13 @@ typedef struct ww_hotel_t {
 
     /* event base to be used for eviction timeout */
     ww_event_base_t *evbase;
-    struct timeval eviction_timeout;
+    ww_timer_wheel_t wheel;
+    uint64_t eviction_ticks;
     ww_hotel_eviction_callback_fn_t evict_callback_fn;
 
     /* All rooms in this hotel */
     ww_hotel_room_t *rooms;
 
-    /* Separate array for all the eviction callback arguments (see
-       rationale above for why this is a separate array) */
-    ww_hotel_room_eviction_callback_arg_t *eviction_args;
-
     /* All currently unoccupied rooms in this hotel (not necessarily
        in any particular order) */
     int *unoccupied_rooms;
@@ -199,10 +186,10 @@ static inline int ww_hotel_checkin(ww_hotel_t *hotel,
     room = &(hotel->rooms[*room_num]);
     room->occupant = occupant;
 
-    /* Assign the event and make it pending */
+    /* Start the eviction timer */
     if (NULL != hotel->evbase) {
-        event_add(&(room->eviction_timer_event),
-                  &(hotel->eviction_timeout));
+        ww_timer_wheel_add(&hotel->wheel, &room->eviction_timer,
+                           hotel->eviction_ticks);
     }
 
     return WW_SUCCESS;
@@ -224,10 +211,10 @@ static inline void ww_hotel_checkin_with_res(ww_hotel_t *hotel,
     assert(room->occupant == NULL);
     room->occupant = occupant;
 
-    /* Assign the event and make it pending */
+    /* Start the eviction timer */
     if (NULL != hotel->evbase) {
-        event_add(&(room->eviction_timer_event),
-                  &(hotel->eviction_timeout));
+        ww_timer_wheel_add(&hotel->wheel, &room->eviction_timer,
+                           hotel->eviction_ticks);
     }
 }
 
@@ -257,7 +244,7 @@ static inline void ww_hotel_checkout(ww_hotel_t *hotel, int room_num)
            ww_hotel.c:local_eviction_callback(). */
         room->occupant = NULL;
         if (NULL != hotel->evbase) {
-            event_del(&(room->eviction_timer_event));
+            ww_timer_wheel_del(&hotel->wheel, &room->eviction_timer);
         }
         hotel->last_unoccupied_room++;
         assert(hotel->last_unoccupied_room < hotel->num_rooms);
@@ -297,7 +284,7 @@ static inline void ww_hotel_checkout_and_return_occupant(ww_hotel_t *hotel, int
         *occupant = room->occupant;
         room->occupant = NULL;
         if (NULL != hotel->evbase) {
-            event_del(&(room->eviction_timer_event));
+            ww_timer_wheel_del(&hotel->wheel, &room->eviction_timer);
         }
         hotel->last_unoccupied_room++;
         assert(hotel->last_unoccupied_room < hotel->num_rooms);
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/ww_config.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <time.h>
+
+#include WW_EVENT_HEADER
+#include "src/class/ww_timer_wheel.h"
+
+#define WW_TIMER_WHEEL_MASK     (WW_TIMER_WHEEL_SLOTS - 1)
+/* the furthest ahead the top level can see */
+#define WW_TIMER_WHEEL_SPAN     (1ULL << (WW_TIMER_WHEEL_BITS * WW_TIMER_WHEEL_LEVELS))
+
+static uint64_t mono_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void ww_timer_wheel_insert(ww_timer_wheel_t *wheel,
+                           ww_timer_wheel_entry_t *entry)
+{
+    ww_timer_wheel_entry_t *head;
+    uint64_t expires = entry->expires;
+    uint64_t delta = expires - wheel->now;
+    int level;
+
+    for (level = 0; level < WW_TIMER_WHEEL_LEVELS - 1; ++level) {
+        if (delta < (1ULL << (WW_TIMER_WHEEL_BITS * (level + 1)))) {
+            break;
+        }
+    }
+    if (WW_TIMER_WHEEL_SPAN <= delta) {
+        /* too far out to place exactly - park it in the last slot the
+           top level can see, and it will be placed again from there */
+        expires = wheel->now + WW_TIMER_WHEEL_SPAN - 1;
+    }
+
+    head = &wheel->slots[level * WW_TIMER_WHEEL_SLOTS +
+                         ((expires >> (WW_TIMER_WHEEL_BITS * level)) & WW_TIMER_WHEEL_MASK)];
+    entry->next = head;
+    entry->prev = head->prev;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+/* move everything in one slot of a higher level down to where it now
+   belongs */
+static void cascade(ww_timer_wheel_t *wheel, int level)
+{
+    ww_timer_wheel_entry_t *head, *entry;
+
+    head = &wheel->slots[level * WW_TIMER_WHEEL_SLOTS +
+                         ((wheel->now >> (WW_TIMER_WHEEL_BITS * level)) & WW_TIMER_WHEEL_MASK)];
+    while (head->next != head) {
+        entry = head->next;
+        head->next = entry->next;
+        entry->next->prev = head;
+        ww_timer_wheel_insert(wheel, entry);
+    }
+}
+
+/* advance the wheel by one tick, expiring whatever is due */
+static void advance(ww_timer_wheel_t *wheel)
+{
+    ww_timer_wheel_entry_t *head, *entry;
+    int level;
+
+    wheel->now++;
+
+    /* each level is cascaded when the ones below it wrap */
+    for (level = 1; level < WW_TIMER_WHEEL_LEVELS; ++level) {
+        if (0 != (wheel->now & ((1ULL << (WW_TIMER_WHEEL_BITS * level)) - 1))) {
+            break;
+        }
+        cascade(wheel, level);
+    }
+
+    /* everything left in the current level 0 slot is due now. New
+       timers cannot land here, as they are due at least one tick
+       from now - but callbacks may cancel timers that are */
+    head = &wheel->slots[wheel->now & WW_TIMER_WHEEL_MASK];
+    while (head->next != head) {
+        entry = head->next;
+        ww_timer_wheel_del(wheel, entry);
+        wheel->callback_fn(wheel, entry);
+    }
+}
+
+static void tick_callback(int fd, short flags, void *arg)
+{
+    ww_timer_wheel_t *wheel = (ww_timer_wheel_t*) arg;
+    uint64_t t = mono_usec();
+    uint64_t n, i;
+    struct timeval tv;
+
+    /* catch up on every tick since the last one - the event base
+       may have been busy. The wheel stays marked as armed meanwhile,
+       so that callbacks adding timers do not restart the tick */
+    n = (t - wheel->now_usec) / wheel->tick_usec;
+    for (i = 0; i < n; ++i) {
+        if (0 == wheel->pending) {
+            /* nothing left to expire, so just skip ahead */
+            wheel->now += n - i;
+            break;
+        }
+        advance(wheel);
+    }
+    wheel->now_usec += n * wheel->tick_usec;
+
+    /* keep ticking for as long as there are timers */
+    if (0 < wheel->pending) {
+        t = wheel->now_usec + wheel->tick_usec - t;
+        tv.tv_sec = t / 1000000;
+        tv.tv_usec = t % 1000000;
+        event_add(&wheel->tick_event, &tv);
+    } else {
+        wheel->armed = false;
+    }
+}
+
+void ww_timer_wheel_arm(ww_timer_wheel_t *wheel)
+{
+    struct timeval tv;
+
+    if (NULL == wheel->evbase) {
+        return;
+    }
+    /* the wheel has been idle, so its current tick starts now */
+    wheel->now_usec = mono_usec();
+    tv.tv_sec = wheel->tick_usec / 1000000;
+    tv.tv_usec = wheel->tick_usec % 1000000;
+    event_add(&wheel->tick_event, &tv);
+    wheel->armed = true;
+}
+
+int ww_timer_wheel_init(ww_timer_wheel_t *wheel,
+                        ww_event_base_t *evbase,
+                        uint32_t tick_usec,
+                        ww_timer_wheel_callback_fn_t callback_fn)
+{
+    /* Bozo check */
+    if (NULL == evbase || 0 == tick_usec || NULL == callback_fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+
+    wheel->evbase = evbase;
+    wheel->tick_usec = tick_usec;
+    wheel->callback_fn = callback_fn;
+    event_assign(&wheel->tick_event, evbase, -1, 0, tick_callback, wheel);
+
+    return WW_SUCCESS;
+}
+
+static void constructor(ww_timer_wheel_t *wheel)
+{
+    int i;
+
+    wheel->evbase = NULL;
+    wheel->armed = false;
+    wheel->tick_usec = 0;
+    wheel->now = 0;
+    wheel->now_usec = 0;
+    wheel->pending = 0;
+    wheel->callback_fn = NULL;
+    for (i = 0; i < WW_TIMER_WHEEL_LEVELS * WW_TIMER_WHEEL_SLOTS; ++i) {
+        wheel->slots[i].next = &wheel->slots[i];
+        wheel->slots[i].prev = &wheel->slots[i];
+    }
+}
+
+static void destructor(ww_timer_wheel_t *wheel)
+{
+    /* pending timers belong to the caller - they are simply forgotten */
+    if (wheel->armed) {
+        event_del(&wheel->tick_event);
+    }
+}
+
+WW_CLASS_INSTANCE(ww_timer_wheel_t,
+                  ww_object_t,
+                  constructor,
+                  destructor);
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * This file provides a hierarchical timer wheel:
+ *
+ * - Time is counted in ticks of a fixed length, chosen when the wheel
+ *   is initialized.
+ * - Timers are intrusive: the caller embeds a ww_timer_wheel_entry_t
+ *   in whatever is being timed, so adding and cancelling a timer
+ *   never allocates, and both are O(1).
+ * - A single timer event on the wheel's event base drives the wheel,
+ *   and it is only armed while the wheel holds a timer.
+ *
+ * The wheel has WW_TIMER_WHEEL_LEVELS levels of
+ * WW_TIMER_WHEEL_SLOTS slots each. Level 0 holds timers due within
+ * the next WW_TIMER_WHEEL_SLOTS ticks, one slot per tick; each level
+ * above covers WW_TIMER_WHEEL_SLOTS times the span of the one below.
+ * Whenever a lower level wraps, the next slot of the level above is
+ * cascaded down. A timer is therefore only touched a handful of
+ * times however long it runs, and most - those cancelled before they
+ * expire - are touched only when added and cancelled.
+ *
+ * A timer added for n ticks expires on the first tick boundary at
+ * least n whole ticks away, so it can fire up to one tick late but
+ * never early. Callbacks run from the wheel's event base, and like
+ * everything else on a base, the wheel must only be used from the
+ * thread progressing it.
+ */
+
+#ifndef WW_TIMER_WHEEL_H
+#define WW_TIMER_WHEEL_H
+
+#include <src/include/ww_config.h>
+#include "ww_types.h"
+#include "src/include/prefetch.h"
+#include "src/class/ww_object.h"
+#include WW_EVENT_HEADER
+
+BEGIN_C_DECLS
+
+#define WW_TIMER_WHEEL_BITS     6
+#define WW_TIMER_WHEEL_SLOTS    (1 << WW_TIMER_WHEEL_BITS)
+#define WW_TIMER_WHEEL_LEVELS   4
+
+struct ww_timer_wheel_t;
+
+/* A timer. While it is pending, it is linked into one of the wheel's
+   slots; next is NULL while it is not. */
+typedef struct ww_timer_wheel_entry_t {
+    struct ww_timer_wheel_entry_t *next;
+    struct ww_timer_wheel_entry_t *prev;
+    uint64_t expires;
+} ww_timer_wheel_entry_t;
+
+/* User-supplied function to be invoked when a timer expires. The timer
+   has already been removed from the wheel, so the callback may add it
+   again. */
+typedef void (*ww_timer_wheel_callback_fn_t)(struct ww_timer_wheel_t *wheel,
+                                             ww_timer_wheel_entry_t *entry);
+
+typedef struct ww_timer_wheel_t {
+    /* make this an object */
+    ww_object_t super;
+
+    /* event base that drives the wheel */
+    ww_event_base_t *evbase;
+    ww_event_t tick_event;
+    bool armed;
+
+    /* length of a tick */
+    uint64_t tick_usec;
+    /* the current tick, and the time at which it began */
+    uint64_t now;
+    uint64_t now_usec;
+
+    /* number of pending timers */
+    int pending;
+
+    ww_timer_wheel_callback_fn_t callback_fn;
+
+    /* the list heads for every slot of every level */
+    ww_timer_wheel_entry_t slots[WW_TIMER_WHEEL_LEVELS * WW_TIMER_WHEEL_SLOTS];
+} ww_timer_wheel_t;
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_timer_wheel_t);
+
+/**
+ * Initialize the wheel.
+ *
+ * @param wheel Pointer to a wheel (IN)
+ * @param evbase Event base that will drive the wheel (IN)
+ * @param tick_usec Length of a tick in microseconds (IN)
+ * @param callback_fn Function invoked when a timer expires (IN)
+ *
+ * @return WW_SUCCESS, or WW_ERR_BAD_PARAM if any argument is missing.
+ */
+WW_DECLSPEC int ww_timer_wheel_init(ww_timer_wheel_t *wheel,
+                                    ww_event_base_t *evbase,
+                                    uint32_t tick_usec,
+                                    ww_timer_wheel_callback_fn_t callback_fn);
+
+/**
+ * Convert a duration in microseconds into ticks of the wheel,
+ * rounding up.
+ */
+static inline uint64_t ww_timer_wheel_ticks(ww_timer_wheel_t *wheel, uint64_t usec)
+{
+    return (usec + wheel->tick_usec - 1) / wheel->tick_usec;
+}
+
+/* Internal: link a timer into the slot for its expiry */
+WW_DECLSPEC void ww_timer_wheel_insert(ww_timer_wheel_t *wheel,
+                                       ww_timer_wheel_entry_t *entry);
+
+/* Internal: start the tick event when the wheel stops being empty */
+WW_DECLSPEC void ww_timer_wheel_arm(ww_timer_wheel_t *wheel);
+
+/**
+ * Start a timer that expires the given number of ticks from now.
+ * The timer must not already be pending.
+ *
+ * @param wheel Pointer to wheel (IN)
+ * @param entry Timer to start (IN)
+ * @param ticks Number of ticks until it expires - at least one (IN)
+ */
+static inline void ww_timer_wheel_add(ww_timer_wheel_t *wheel,
+                                      ww_timer_wheel_entry_t *entry,
+                                      uint64_t ticks)
+{
+    assert(NULL == entry->next);
+
+    if (WW_UNLIKELY(!wheel->armed)) {
+        ww_timer_wheel_arm(wheel);
+    }
+    /* the current tick is already under way, so count from the
+       next one - otherwise the timer could expire almost a whole
+       tick short of what was asked for */
+    entry->expires = wheel->now + ((0 < ticks) ? ticks : 1) + 1;
+    ww_timer_wheel_insert(wheel, entry);
+    wheel->pending++;
+}
+
+/**
+ * Cancel a timer. Cancelling a timer that is not pending (e.g.,
+ * because it has already expired) does nothing.
+ *
+ * @param wheel Pointer to wheel (IN)
+ * @param entry Timer to cancel (IN)
+ */
+static inline void ww_timer_wheel_del(ww_timer_wheel_t *wheel,
+                                      ww_timer_wheel_entry_t *entry)
+{
+    if (WW_LIKELY(NULL != entry->next)) {
+        entry->prev->next = entry->next;
+        entry->next->prev = entry->prev;
+        entry->next = NULL;
+        entry->prev = NULL;
+        wheel->pending--;
+    }
+    /* the tick event is left to lapse if that was the last timer */
+}
+
+/**
+ * Returns true if the timer is pending.
+ */
+static inline bool ww_timer_wheel_is_pending(ww_timer_wheel_entry_t *entry)
+{
+    return (NULL != entry->next);
+}
+
+END_C_DECLS
+
+#endif /* WW_TIMER_WHEEL_H */
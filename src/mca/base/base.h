@@ -69,6 +69,9 @@ WW_DECLSPEC WW_CLASS_DECLARATION(mca_base_component_priority_list_item_t);
 WW_DECLSPEC extern char *mca_base_component_path;
 WW_DECLSPEC extern bool mca_base_component_show_load_errors;
 WW_DECLSPEC extern bool mca_base_component_disable_dlopen;
+WW_DECLSPEC extern bool mca_base_component_index;
+WW_DECLSPEC extern char *mca_base_component_index_dir;
+WW_DECLSPEC extern bool mca_base_component_index_refresh;
 WW_DECLSPEC extern char *mca_base_system_default_path;
 WW_DECLSPEC extern char *mca_base_user_default_path;
 
@@ -232,6 +232,62 @@ int mca_base_components_filter (mca_base_framework_t *framework, uint32_t filter
 
 #if WW_HAVE_DL_SUPPORT
 
+/*
+ * Check that everything a described component requires is available,
+ * either built into this framework or as a dynamic component.
+ */
+static bool requires_met (mca_base_framework_t *framework,
+                          mca_base_component_repository_item_t *ri)
+{
+    const mca_base_component_t **static_components = framework->framework_static_components;
+    char type[MCA_BASE_MAX_TYPE_NAME_LEN + 1];
+    const char *name;
+    size_t len;
+    bool found;
+
+    for (int i = 0 ; NULL != ri->ri_requires && NULL != ri->ri_requires[i] ; ++i) {
+        /* each requirement is framework:component */
+        name = strchr (ri->ri_requires[i], ':');
+        if (NULL == name || MCA_BASE_MAX_TYPE_NAME_LEN < (len = name - ri->ri_requires[i])) {
+            return false;
+        }
+        memcpy (type, ri->ri_requires[i], len);
+        type[len] = '\0';
+        ++name;
+
+        found = mca_base_component_repository_has (type, name);
+        if (!found && 0 == strcmp (type, framework->framework_name) && NULL != static_components) {
+            for (int j = 0 ; NULL != static_components[j] ; ++j) {
+                if (0 == strcmp (static_components[j]->mca_component_name, name)) {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, framework->framework_output,
+                               "mca: base: component_find: %s \"%s\" requires %s, which is "
+                               "not available (not loaded)", ri->ri_type, ri->ri_name,
+                               ri->ri_requires[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* highest priority first, then by name so that the order is stable */
+static int described_compare (const void *a, const void *b)
+{
+    const mca_base_component_repository_item_t *ria = *(mca_base_component_repository_item_t * const *) a;
+    const mca_base_component_repository_item_t *rib = *(mca_base_component_repository_item_t * const *) b;
+
+    if (ria->ri_priority != rib->ri_priority) {
+        return (ria->ri_priority > rib->ri_priority) ? -1 : 1;
+    }
+    return strcmp (ria->ri_name, rib->ri_name);
+}
+
 /*
  * Open up all directories in a given path and search for components of
  * the specified type (and possibly of a given name).
@@ -243,9 +299,9 @@ int mca_base_components_filter (mca_base_framework_t *framework, uint32_t filter
 static void find_dyn_components(const char *path, mca_base_framework_t *framework,
                                 const char **names, bool include_mode)
 {
-    mca_base_component_repository_item_t *ri;
+    mca_base_component_repository_item_t *ri, **described = NULL;
     ww_list_t *dy_components;
-    int ret;
+    int ret, ndescribed = 0, loaded = 0;
 
     if (NULL != path) {
         ret = mca_base_component_repository_add (path);
@@ -259,12 +315,72 @@ static void find_dyn_components(const char *path, mca_base_framework_t *framewor
         return;
     }
 
-    /* Iterate through the repository and find components that can be included */
+    /* described components are ranked before any of them is loaded -
+       without the memory to rank them, they are loaded as they come */
+    if (0 < ww_list_get_size (dy_components)) {
+        described = (mca_base_component_repository_item_t **)
+            malloc (ww_list_get_size (dy_components) * sizeof (*described));
+    }
+
+    /* Iterate through the repository and find components that can be
+       included. Those without a descriptor can only be judged by
+       loading them; those with one are filtered here and loaded
+       below */
     WW_LIST_FOREACH(ri, dy_components, mca_base_component_repository_item_t) {
-        if (use_component(include_mode, names, ri->ri_name)) {
+        if (!use_component(include_mode, names, ri->ri_name)) {
+            continue;
+        }
+
+        if (!ri->ri_described) {
             mca_base_component_repository_open (framework, ri);
+            continue;
+        }
+
+        if (!requires_met (framework, ri)) {
+            continue;
+        }
+
+        /* a negative priority means "only if asked for" */
+        if (0 > ri->ri_priority && !(include_mode && NULL != names)) {
+            ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, framework->framework_output,
+                               "mca: base: component_find: %s \"%s\" has priority %d and "
+                               "was not requested (not loaded)", ri->ri_type, ri->ri_name,
+                               ri->ri_priority);
+            continue;
         }
+
+        if (NULL == described) {
+            mca_base_component_repository_open (framework, ri);
+            continue;
+        }
+        described[ndescribed++] = ri;
     }
+
+    if (0 == ndescribed) {
+        free (described);
+        return;
+    }
+
+    qsort (described, ndescribed, sizeof (*described), described_compare);
+
+    /* load the winners - if one fails, the next in line takes its
+       place. Components asked for by name are all winners */
+    for (int i = 0 ; i < ndescribed ; ++i) {
+        if (0 < framework->framework_load_max && loaded >= framework->framework_load_max &&
+            !(include_mode && NULL != names)) {
+            ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, framework->framework_output,
+                               "mca: base: component_find: %s \"%s\" (priority %d) is below the "
+                               "%d highest priority components (not loaded)", described[i]->ri_type,
+                               described[i]->ri_name, described[i]->ri_priority,
+                               framework->framework_load_max);
+            continue;
+        }
+        if (WW_SUCCESS == mca_base_component_repository_open (framework, described[i])) {
+            ++loaded;
+        }
+    }
+
+    free (described);
 }
 
 #endif /* WW_HAVE_DL_SUPPORT */
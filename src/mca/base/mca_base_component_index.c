@@ -0,0 +1,755 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/*
+ * On-disk index of the component files in a component directory.
+ *
+ * Finding the components means reading every directory on the
+ * component path and stat'ing every file in it, on every start. The
+ * index records the files found, so that as long as the directory has
+ * not been modified - adding, removing or renaming a file changes its
+ * mtime - one stat of the directory and one read of the index will
+ * do. It also remembers which files are not usable components - no
+ * component struct, or an MCA interface we do not speak - so that
+ * they are not dlopen'ed again until they change. A file that merely
+ * failed to dlopen (e.g., a library it needs was not on the path this
+ * time) is not remembered, as that may not be its fault.
+ *
+ * The index also caches each file's descriptor, if it has one, so
+ * that it is not read on every start either. A descriptor that was
+ * added or removed changed the directory, and one that was edited
+ * in place changed its own mtime or size - the latter is checked
+ * with a stat, and only for files that have a descriptor.
+ *
+ * Each index is a text file:
+ *
+ *   ww-component-index 3 <MCA version> <dir mtime sec> <dir mtime nsec>
+ *   <mtime> <size> <status> <desc mtime> <desc size> <framework> <name> <priority> <requires> <path>
+ *   ...
+ *   end <number of entries>
+ *
+ * where a descriptor mtime (in nanoseconds) of -1 means there is none,
+ * and -2 that it was never looked at. Missing fields are written as
+ * "-", and the requirements are separated by commas.
+ *
+ * A file that does not parse, lacks the trailer, was written for
+ * another MCA interface version, or names a file outside its
+ * directory, is simply ignored. The directory mtime is the one seen
+ * before the directory was scanned, so that anything added during
+ * the scan makes the index stale rather than going unnoticed.
+ *
+ * An index decides which components are never loaded, so whoever can
+ * write one can hide a component. Only an index owned by us or by
+ * root, and writable by nobody else, is believed. Ordinary runs never
+ * write to the component directories: the index there is only created
+ * or refreshed when mca_base_component_index_refresh is set, which is
+ * meant for whoever installs the components. Otherwise indexes are
+ * kept in a per-user cache (mca_base_component_index_dir, by default
+ * under $XDG_CACHE_HOME or ~/.cache), which is looked at first. They
+ * are written at finalize, and only if something changed.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "ww_types.h"
+#include "src/class/ww_list.h"
+#include "src/mca/mca.h"
+#include "src/mca/base/base.h"
+#include "src/mca/base/mca_base_component_repository.h"
+#include "src/mca/dl/base/base.h"
+#include "src/util/argv.h"
+#include "src/util/basename.h"
+#include "src/util/output.h"
+#include "src/util/ww_environ.h"
+
+#define MCA_BASE_COMPONENT_INDEX_NAME     ".ww-component-index"
+#define MCA_BASE_COMPONENT_INDEX_CACHE    "warewulf/component-index"
+#define MCA_BASE_COMPONENT_INDEX_VERSION  3
+/* descriptor mtimes with special meanings */
+#define MCA_BASE_COMPONENT_INDEX_NO_DESC       -1
+#define MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC  -2
+/* times to rescan a directory that keeps changing under us */
+#define MCA_BASE_COMPONENT_INDEX_SCANS    3
+
+struct mca_base_component_index_t {
+    ww_list_item_t super;
+
+    /** the component directory, and the file the index is written
+     * to - the one in the directory when refreshing, or in the cache
+     * (if there is one) otherwise */
+    char *ci_dir;
+    char *ci_file;
+    /** the directory's mtime before it was scanned, as recorded in
+     * the index */
+    int64_t ci_mtime_sec;
+    int64_t ci_mtime_nsec;
+    /** the entries need writing out */
+    bool ci_dirty;
+    ww_list_t ci_entries;
+};
+typedef struct mca_base_component_index_t mca_base_component_index_t;
+
+static void ci_constructor (mca_base_component_index_t *ci)
+{
+    ci->ci_dir = NULL;
+    ci->ci_file = NULL;
+    ci->ci_mtime_sec = 0;
+    ci->ci_mtime_nsec = 0;
+    ci->ci_dirty = false;
+    WW_CONSTRUCT(&ci->ci_entries, ww_list_t);
+}
+
+static void ci_destructor (mca_base_component_index_t *ci)
+{
+    free (ci->ci_dir);
+    free (ci->ci_file);
+    WW_LIST_DESTRUCT(&ci->ci_entries);
+}
+
+static WW_CLASS_INSTANCE(mca_base_component_index_t, ww_list_item_t,
+                         ci_constructor, ci_destructor);
+
+static void ie_constructor (mca_base_component_index_entry_t *ie)
+{
+    ie->ie_index = NULL;
+    ie->ie_path = NULL;
+    ie->ie_mtime = 0;
+    ie->ie_size = 0;
+    ie->ie_status = MCA_BASE_COMPONENT_INDEX_UNKNOWN;
+    ie->ie_desc_known = false;
+    ie->ie_desc_mtime = MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC;
+    ie->ie_desc_size = 0;
+    ie->ie_desc_framework = NULL;
+    ie->ie_desc_name = NULL;
+    ie->ie_desc_priority = 0;
+    ie->ie_desc_requires = NULL;
+}
+
+static void ie_desc_clear (mca_base_component_index_entry_t *ie)
+{
+    free (ie->ie_desc_framework);
+    free (ie->ie_desc_name);
+    ww_argv_free (ie->ie_desc_requires);
+    ie->ie_desc_known = false;
+    ie->ie_desc_mtime = MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC;
+    ie->ie_desc_size = 0;
+    ie->ie_desc_framework = NULL;
+    ie->ie_desc_name = NULL;
+    ie->ie_desc_priority = 0;
+    ie->ie_desc_requires = NULL;
+}
+
+static void ie_destructor (mca_base_component_index_entry_t *ie)
+{
+    free (ie->ie_path);
+    ie_desc_clear (ie);
+}
+
+WW_CLASS_INSTANCE(mca_base_component_index_entry_t, ww_list_item_t,
+                  ie_constructor, ie_destructor);
+
+static ww_list_t indexes;
+static bool indexes_init = false;
+
+/* the suffixes the dlopen component tries by default - the index
+ * wants the file itself, but is handed the name without suffix */
+static const char *entry_suffixes[] = {"", ".so", ".dylib", ".dll", ".sl", NULL};
+
+static int entry_stat (const char *path, int64_t *mtime, int64_t *size)
+{
+    struct stat buf;
+    char *name;
+    int i, ret;
+
+    for (i = 0 ; NULL != entry_suffixes[i] ; ++i) {
+        if (0 > asprintf (&name, "%s%s", path, entry_suffixes[i])) {
+            return WW_ERR_OUT_OF_RESOURCE;
+        }
+        ret = stat (name, &buf);
+        free (name);
+        if (0 == ret && S_ISREG(buf.st_mode)) {
+            *mtime = (int64_t) buf.st_mtime;
+            *size = (int64_t) buf.st_size;
+            return WW_SUCCESS;
+        }
+    }
+
+    return WW_ERR_NOT_FOUND;
+}
+
+/* the per-user cache directory, created if need be - NULL if there
+ * is none we can trust */
+static char *index_cache_dir (void)
+{
+    struct stat buf;
+    const char *base;
+    char *dir, *p;
+
+    if (NULL != mca_base_component_index_dir) {
+        if ('\0' == mca_base_component_index_dir[0]) {
+            return NULL;
+        }
+        dir = strdup (mca_base_component_index_dir);
+    } else if (NULL != (base = getenv ("XDG_CACHE_HOME")) && '/' == base[0]) {
+        if (0 > asprintf (&dir, "%s/%s", base, MCA_BASE_COMPONENT_INDEX_CACHE)) {
+            dir = NULL;
+        }
+    } else if (NULL != (base = ww_home_directory ()) && '/' == base[0]) {
+        if (0 > asprintf (&dir, "%s/.cache/%s", base, MCA_BASE_COMPONENT_INDEX_CACHE)) {
+            dir = NULL;
+        }
+    } else {
+        return NULL;
+    }
+    if (NULL == dir) {
+        return NULL;
+    }
+
+    for (p = strchr (dir + 1, '/') ; ; p = strchr (p + 1, '/')) {
+        if (NULL != p) {
+            *p = '\0';
+        }
+        (void) mkdir (dir, 0700);
+        if (NULL == p) {
+            break;
+        }
+        *p = '/';
+    }
+
+    /* anyone who can write the directory can replace our indexes */
+    if (0 != stat (dir, &buf) || !S_ISDIR(buf.st_mode) || buf.st_uid != geteuid () ||
+        0 != (buf.st_mode & (S_IWGRP | S_IWOTH))) {
+        ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                           "mca: base: component_index: not using cache directory %s", dir);
+        free (dir);
+        return NULL;
+    }
+    return dir;
+}
+
+/* the name of the index of dir in the cache directory */
+static char *index_file_name (const char *cache, const char *dir)
+{
+    char *file, *p;
+    const char *q;
+    size_t len;
+
+    /* flatten the directory into a file name. '/' and '_' are both
+     * escaped, so that no two directories share a name (e.g., /a_b
+     * and /a/b) */
+    len = strlen (cache);
+    file = (char *) malloc (len + 1 + 3 * strlen (dir) + 1);
+    if (NULL == file) {
+        return NULL;
+    }
+    memcpy (file, cache, len);
+    p = file + len;
+    *p++ = '/';
+    for (q = dir ; '\0' != *q ; ++q) {
+        if ('/' == *q || '_' == *q) {
+            p += sprintf (p, "_%02X", (unsigned char) *q);
+        } else {
+            *p++ = *q;
+        }
+    }
+    *p = '\0';
+    return file;
+}
+
+/* only believe an index nobody but us (or root) can have written */
+static bool index_trusted (int fd, const char *file)
+{
+    struct stat buf;
+
+    if (0 != fstat (fd, &buf) || !S_ISREG(buf.st_mode) ||
+        (buf.st_uid != geteuid () && 0 != buf.st_uid) ||
+        0 != (buf.st_mode & (S_IWGRP | S_IWOTH))) {
+        ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                           "mca: base: component_index: ignoring %s - not owned by us or root, "
+                           "or writable by others", file);
+        return false;
+    }
+    return true;
+}
+
+/* entries must name a file directly in the directory - anything else
+ * did not come from a scan of it */
+static bool index_path_ok (mca_base_component_index_t *ci, const char *path)
+{
+    size_t len = strlen (ci->ci_dir);
+    const char *name;
+
+    if (0 != strncmp (path, ci->ci_dir, len) || '/' != path[len]) {
+        return false;
+    }
+    name = path + len + 1;
+    return ('\0' != name[0] && NULL == strchr (name, '/') &&
+            0 != strcmp (name, ".") && 0 != strcmp (name, ".."));
+}
+
+static int index_read (mca_base_component_index_t *ci, const char *file)
+{
+    mca_base_component_index_entry_t *ie;
+    char line[4096], *nl;
+    char framework[256], name[256], requires[4096];
+    long long mtime_sec, mtime_nsec, mtime, size, desc_mtime, desc_size;
+    int version, mca_version[3], status, priority, n, fd, count = 0, expected = -1;
+    FILE *fp;
+
+    if (NULL == file || 0 > (fd = open (file, O_RDONLY))) {
+        return WW_ERR_NOT_FOUND;
+    }
+    if (!index_trusted (fd, file) || NULL == (fp = fdopen (fd, "r"))) {
+        close (fd);
+        return WW_ERR_NOT_FOUND;
+    }
+
+    if (NULL == fgets (line, sizeof (line), fp) ||
+        6 != sscanf (line, "ww-component-index %d %d.%d.%d %lld %lld", &version,
+                     &mca_version[0], &mca_version[1], &mca_version[2], &mtime_sec, &mtime_nsec) ||
+        MCA_BASE_COMPONENT_INDEX_VERSION != version ||
+        /* what was unusable may not be any more */
+        MCA_BASE_VERSION_MAJOR != mca_version[0] || MCA_BASE_VERSION_MINOR != mca_version[1] ||
+        MCA_BASE_VERSION_RELEASE != mca_version[2] ||
+        mtime_sec != ci->ci_mtime_sec || mtime_nsec != ci->ci_mtime_nsec) {
+        /* not ours, or stale */
+        fclose (fp);
+        return WW_ERR_NOT_FOUND;
+    }
+
+    while (NULL != fgets (line, sizeof (line), fp)) {
+        if (NULL == (nl = strchr (line, '\n'))) {
+            /* truncated */
+            break;
+        }
+        *nl = '\0';
+
+        if (1 == sscanf (line, "end %d", &expected)) {
+            break;
+        }
+
+        ie = WW_NEW(mca_base_component_index_entry_t);
+        if (9 != sscanf (line, "%lld %lld %d %lld %lld %255s %255s %d %4095s %n", &mtime, &size,
+                         &status, &desc_mtime, &desc_size, framework, name, &priority,
+                         requires, &n) ||
+            !index_path_ok (ci, line + n) || status < MCA_BASE_COMPONENT_INDEX_UNKNOWN ||
+            status > MCA_BASE_COMPONENT_INDEX_BAD ||
+            desc_mtime < MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC) {
+            WW_RELEASE(ie);
+            break;
+        }
+        ie->ie_index = ci;
+        ie->ie_mtime = mtime;
+        ie->ie_size = size;
+        ie->ie_status = (mca_base_component_index_status_t) status;
+        ie->ie_path = strdup (line + n);
+        if (MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC != desc_mtime) {
+            ie->ie_desc_known = true;
+            ie->ie_desc_mtime = desc_mtime;
+            ie->ie_desc_size = desc_size;
+            if (MCA_BASE_COMPONENT_INDEX_NO_DESC != desc_mtime) {
+                ie->ie_desc_framework = strdup (framework);
+                ie->ie_desc_name = strdup (name);
+                ie->ie_desc_priority = priority;
+                if (0 != strcmp (requires, "-")) {
+                    ie->ie_desc_requires = ww_argv_split (requires, ',');
+                }
+            }
+        }
+        ww_list_append (&ci->ci_entries, &ie->super);
+        ++count;
+    }
+    fclose (fp);
+
+    if (expected != count) {
+        /* incomplete - perhaps it was being written as we read it */
+        WW_LIST_DESTRUCT(&ci->ci_entries);
+        WW_CONSTRUCT(&ci->ci_entries, ww_list_t);
+        return WW_ERR_NOT_FOUND;
+    }
+
+    return WW_SUCCESS;
+}
+
+/* ww_dl_foreachfile callback used to (re)build an index */
+static int index_add_file (const char *filename, void *data)
+{
+    mca_base_component_index_t *ci = (mca_base_component_index_t *) data;
+    mca_base_component_index_entry_t *ie;
+    char *base;
+
+    /* only component files are of interest */
+    base = ww_basename (filename);
+    if (NULL == base) {
+        return WW_ERROR;
+    }
+    if (0 != strncmp (base, "mca_", 4)) {
+        free (base);
+        return WW_SUCCESS;
+    }
+    free (base);
+
+    ie = WW_NEW(mca_base_component_index_entry_t);
+    ie->ie_index = ci;
+    ie->ie_path = strdup (filename);
+    if (NULL == ie->ie_path) {
+        WW_RELEASE(ie);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    (void) entry_stat (filename, &ie->ie_mtime, &ie->ie_size);
+    ww_list_append (&ci->ci_entries, &ie->super);
+
+    return WW_SUCCESS;
+}
+
+static mca_base_component_index_t *index_load (const char *dir)
+{
+    mca_base_component_index_t *ci;
+    struct stat buf;
+    char *in_dir, *cache;
+    int fd, scans, ret;
+
+    if (!indexes_init) {
+        WW_CONSTRUCT(&indexes, ww_list_t);
+        indexes_init = true;
+    }
+
+    /* the same directory may be added more than once */
+    WW_LIST_FOREACH(ci, &indexes, mca_base_component_index_t) {
+        if (0 == strcmp (ci->ci_dir, dir)) {
+            return ci;
+        }
+    }
+
+    if (0 != stat (dir, &buf) || !S_ISDIR(buf.st_mode)) {
+        return NULL;
+    }
+
+    ci = WW_NEW(mca_base_component_index_t);
+    ci->ci_dir = strdup (dir);
+    if (NULL == ci->ci_dir || 0 > asprintf (&in_dir, "%s/%s", dir, MCA_BASE_COMPONENT_INDEX_NAME)) {
+        WW_RELEASE(ci);
+        return NULL;
+    }
+
+    if (mca_base_component_index_refresh) {
+        ci->ci_file = in_dir;
+        in_dir = NULL;
+        if (0 != access (ci->ci_file, F_OK)) {
+            /* creating the index modifies the directory, so get it over
+             * with before looking at the mtime - writing it at finalize
+             * then rewrites it in place, which does not */
+            fd = open (ci->ci_file, O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (0 <= fd) {
+                close (fd);
+            }
+            if (0 != stat (dir, &buf)) {
+                WW_RELEASE(ci);
+                return NULL;
+            }
+        }
+    } else if (NULL != (cache = index_cache_dir ())) {
+        ci->ci_file = index_file_name (cache, dir);
+        free (cache);
+    }
+    ci->ci_mtime_sec = (int64_t) buf.st_mtim.tv_sec;
+    ci->ci_mtime_nsec = (int64_t) buf.st_mtim.tv_nsec;
+
+    /* our own cache may know of changes the installed index does not */
+    ret = index_read (ci, ci->ci_file);
+    if (WW_SUCCESS != ret && NULL != in_dir) {
+        ret = index_read (ci, in_dir);
+    }
+    free (in_dir);
+
+    if (WW_SUCCESS == ret) {
+        ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                           "mca: base: component_index: using index of %s (%d components)",
+                           dir, (int) ww_list_get_size (&ci->ci_entries));
+    } else {
+        for (scans = 0 ; ; ++scans) {
+            ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                               "mca: base: component_index: scanning %s", dir);
+            if (0 != ww_dl_foreachfile (dir, index_add_file, ci) || 0 != stat (dir, &buf)) {
+                WW_RELEASE(ci);
+                return NULL;
+            }
+            if ((int64_t) buf.st_mtim.tv_sec == ci->ci_mtime_sec &&
+                (int64_t) buf.st_mtim.tv_nsec == ci->ci_mtime_nsec) {
+                break;
+            }
+            /* it changed while we looked - the scan may have missed
+             * something, so look again */
+            ci->ci_mtime_sec = (int64_t) buf.st_mtim.tv_sec;
+            ci->ci_mtime_nsec = (int64_t) buf.st_mtim.tv_nsec;
+            if (MCA_BASE_COMPONENT_INDEX_SCANS <= scans + 1) {
+                /* still changing - use what we have, but record an
+                 * mtime that can never match so the next start looks
+                 * again */
+                ci->ci_mtime_sec = -1;
+                break;
+            }
+            WW_LIST_DESTRUCT(&ci->ci_entries);
+            WW_CONSTRUCT(&ci->ci_entries, ww_list_t);
+        }
+        ci->ci_dirty = true;
+    }
+
+    ww_list_append (&indexes, &ci->super);
+    return ci;
+}
+
+int mca_base_component_index_foreachfile (const char *dir,
+                                          int (*func)(const char *filename, void *data))
+{
+    mca_base_component_index_entry_t *ie;
+    mca_base_component_index_t *ci;
+    int ret;
+
+    if (!mca_base_component_index || NULL == (ci = index_load (dir))) {
+        return ww_dl_foreachfile (dir, func, NULL);
+    }
+
+    WW_LIST_FOREACH(ie, &ci->ci_entries, mca_base_component_index_entry_t) {
+        if (WW_SUCCESS != (ret = func (ie->ie_path, ie))) {
+            return ret;
+        }
+    }
+
+    return WW_SUCCESS;
+}
+
+bool mca_base_component_index_skip (mca_base_component_index_entry_t *entry)
+{
+    int64_t mtime, size;
+
+    if (NULL == entry || MCA_BASE_COMPONENT_INDEX_BAD != entry->ie_status) {
+        return false;
+    }
+
+    if (WW_SUCCESS == entry_stat (entry->ie_path, &mtime, &size) &&
+        mtime == entry->ie_mtime && size == entry->ie_size) {
+        return true;
+    }
+
+    /* it has changed - worth another try */
+    entry->ie_status = MCA_BASE_COMPONENT_INDEX_UNKNOWN;
+    entry->ie_index->ci_dirty = true;
+    return false;
+}
+
+static int64_t desc_mtime (const struct stat *buf)
+{
+    return (int64_t) buf->st_mtim.tv_sec * 1000000000 + (int64_t) buf->st_mtim.tv_nsec;
+}
+
+bool mca_base_component_index_descriptor (mca_base_component_index_entry_t *entry,
+                                          const char *file, const char **framework,
+                                          const char **name, int *priority,
+                                          char ***requires)
+{
+    struct stat buf;
+
+    if (NULL == entry || !entry->ie_desc_known) {
+        return false;
+    }
+
+    /* had there been a descriptor added since, the directory would
+     * have changed and the entry would not have come from the index */
+    if (MCA_BASE_COMPONENT_INDEX_NO_DESC != entry->ie_desc_mtime) {
+        if (0 != stat (file, &buf) || desc_mtime (&buf) != entry->ie_desc_mtime ||
+            (int64_t) buf.st_size != entry->ie_desc_size) {
+            /* edited or gone - read it afresh */
+            ie_desc_clear (entry);
+            entry->ie_index->ci_dirty = true;
+            return false;
+        }
+    }
+
+    *framework = entry->ie_desc_framework;
+    *name = entry->ie_desc_name;
+    *priority = entry->ie_desc_priority;
+    *requires = entry->ie_desc_requires;
+    return true;
+}
+
+/* the fields are written space separated, so anything with
+ * whitespace in it cannot be cached */
+static bool desc_field_ok (const char *str)
+{
+    return (NULL != str && '\0' != str[0] && NULL == strpbrk (str, " \t\n\r\v\f"));
+}
+
+void mca_base_component_index_record_descriptor (mca_base_component_index_entry_t *entry,
+                                                 int fd, const char *framework,
+                                                 const char *name, int priority,
+                                                 char **requires)
+{
+    struct stat buf;
+    int i;
+
+    if (NULL == entry) {
+        return;
+    }
+
+    ie_desc_clear (entry);
+    entry->ie_index->ci_dirty = true;
+    if (0 > fd) {
+        entry->ie_desc_known = true;
+        entry->ie_desc_mtime = MCA_BASE_COMPONENT_INDEX_NO_DESC;
+        return;
+    }
+    /* the descriptor was read from fd, so this is the version that
+     * was read even if it has been replaced since */
+    if (0 != fstat (fd, &buf)) {
+        return;
+    }
+
+    if (!desc_field_ok (framework) || !desc_field_ok (name)) {
+        return;
+    }
+    for (i = 0 ; NULL != requires && NULL != requires[i] ; ++i) {
+        if (!desc_field_ok (requires[i]) || NULL != strchr (requires[i], ',')) {
+            return;
+        }
+    }
+
+    entry->ie_desc_known = true;
+    entry->ie_desc_mtime = desc_mtime (&buf);
+    entry->ie_desc_size = (int64_t) buf.st_size;
+    entry->ie_desc_framework = strdup (framework);
+    entry->ie_desc_name = strdup (name);
+    entry->ie_desc_priority = priority;
+    entry->ie_desc_requires = ww_argv_copy (requires);
+}
+
+void mca_base_component_index_record (mca_base_component_index_entry_t *entry,
+                                      const mca_base_component_t *component)
+{
+    if (NULL == entry) {
+        return;
+    }
+
+    (void) entry_stat (entry->ie_path, &entry->ie_mtime, &entry->ie_size);
+    entry->ie_status = (NULL == component) ? MCA_BASE_COMPONENT_INDEX_BAD : MCA_BASE_COMPONENT_INDEX_OK;
+    entry->ie_index->ci_dirty = true;
+}
+
+static void index_write (mca_base_component_index_t *ci)
+{
+    mca_base_component_index_entry_t *ie;
+    char *data = NULL, *line, *requires;
+    size_t len = 0;
+    int fd, ret, count = 0;
+
+    if (NULL == ci->ci_file) {
+        return;
+    }
+
+    /* a file in the directory itself was created when it was scanned -
+     * this only creates files in the cache, which are for us alone */
+    fd = open (ci->ci_file, O_WRONLY | O_CREAT | O_NOFOLLOW,
+               mca_base_component_index_refresh ? 0644 : 0600);
+    if (0 > fd) {
+        ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                           "mca: base: component_index: cannot write %s (ignored)",
+                           ci->ci_file);
+        return;
+    }
+    /* an index nobody would believe is not worth writing */
+    if (!index_trusted (fd, ci->ci_file)) {
+        close (fd);
+        return;
+    }
+
+    /* the mtime from before the scan - if the directory changed
+     * since, the index is stale as soon as it is written */
+    ret = asprintf (&data, "ww-component-index %d %d.%d.%d %lld %lld\n",
+                    MCA_BASE_COMPONENT_INDEX_VERSION, MCA_BASE_VERSION_MAJOR,
+                    MCA_BASE_VERSION_MINOR, MCA_BASE_VERSION_RELEASE,
+                    (long long) ci->ci_mtime_sec, (long long) ci->ci_mtime_nsec);
+    if (0 > ret) {
+        close (fd);
+        return;
+    }
+    len = ret;
+
+    WW_LIST_FOREACH(ie, &ci->ci_entries, mca_base_component_index_entry_t) {
+        requires = NULL;
+        if (NULL != ie->ie_desc_requires && NULL != ie->ie_desc_requires[0] &&
+            NULL == (requires = ww_argv_join (ie->ie_desc_requires, ','))) {
+            free (data);
+            close (fd);
+            return;
+        }
+        ret = asprintf (&line, "%s%lld %lld %d %lld %lld %s %s %d %s %s\n", data,
+                        (long long) ie->ie_mtime, (long long) ie->ie_size, (int) ie->ie_status,
+                        (long long) (ie->ie_desc_known ? ie->ie_desc_mtime :
+                                     MCA_BASE_COMPONENT_INDEX_UNKNOWN_DESC),
+                        (long long) ie->ie_desc_size,
+                        (NULL != ie->ie_desc_framework) ? ie->ie_desc_framework : "-",
+                        (NULL != ie->ie_desc_name) ? ie->ie_desc_name : "-",
+                        ie->ie_desc_priority, (NULL != requires) ? requires : "-",
+                        ie->ie_path);
+        free (requires);
+        free (data);
+        if (0 > ret) {
+            close (fd);
+            return;
+        }
+        data = line;
+        len = ret;
+        ++count;
+    }
+
+    ret = asprintf (&line, "%send %d\n", data, count);
+    free (data);
+    if (0 > ret) {
+        close (fd);
+        return;
+    }
+    data = line;
+    len = ret;
+
+    if ((ssize_t) len != pwrite (fd, data, len, 0) || 0 != ftruncate (fd, len)) {
+        /* leave nothing half written behind */
+        (void) ftruncate (fd, 0);
+    }
+    free (data);
+    close (fd);
+}
+
+void mca_base_component_index_finalize (void)
+{
+    mca_base_component_index_t *ci;
+
+    if (!indexes_init) {
+        return;
+    }
+
+    WW_LIST_FOREACH(ci, &indexes, mca_base_component_index_t) {
+        if (ci->ci_dirty) {
+            index_write (ci);
+        }
+    }
+
+    WW_LIST_DESTRUCT(&indexes);
+    indexes_init = false;
+}
@@ -28,6 +28,7 @@
 #ifdef HAVE_SYS_TYPES_H
 #include <sys/types.h>
 #endif
+#include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -43,6 +44,7 @@
 #include "ww_types.h"
 #include "src/class/ww_hash_table.h"
 #include "src/util/basename.h"
+#include "src/util/argv.h"
 
 #if WW_HAVE_DL_SUPPORT
 
@@ -71,13 +73,119 @@ static ww_hash_table_t mca_base_component_repository;
 #define STRINGIFYX(x) #x
 #define STRINGIFY(x) STRINGIFYX(x)
 
+/* strip leading and trailing whitespace in place */
+static char *descriptor_trim (char *str)
+{
+    char *end;
+
+    while (isspace ((unsigned char) *str)) {
+        ++str;
+    }
+    end = str + strlen (str);
+    while (end > str && isspace ((unsigned char) end[-1])) {
+        *--end = '\0';
+    }
+    return str;
+}
+
+/*
+ * Read the component's descriptor, if it has one - from the index if
+ * it has the descriptor cached. A descriptor that does not agree with
+ * the file name is ignored, leaving the component to be examined by
+ * loading it as usual.
+ */
+static void read_descriptor (mca_base_component_repository_item_t *ri)
+{
+    char line[1024], *key, *value, *tok, *ctx;
+    char *framework = NULL, *name = NULL;
+    const char *cached_framework, *cached_name;
+    char **requires = NULL, **cached_requires;
+    int priority = 0;
+    char *file;
+    FILE *fp;
+
+    if (0 > asprintf (&file, "%s%s", ri->ri_path, MCA_BASE_COMPONENT_DESCRIPTOR_SUFFIX)) {
+        return;
+    }
+
+    if (mca_base_component_index_descriptor (ri->ri_index_entry, file, &cached_framework,
+                                             &cached_name, &priority, &cached_requires)) {
+        if (NULL == cached_framework) {
+            /* no descriptor - the common case */
+            free (file);
+            return;
+        }
+        framework = strdup (cached_framework);
+        name = strdup (cached_name);
+        requires = ww_argv_copy (cached_requires);
+    } else {
+        fp = fopen (file, "r");
+        if (NULL == fp) {
+            mca_base_component_index_record_descriptor (ri->ri_index_entry, -1, NULL, NULL,
+                                                        0, NULL);
+            free (file);
+            return;
+        }
+
+        while (NULL != fgets (line, sizeof (line), fp)) {
+            if (NULL != (tok = strchr (line, '#'))) {
+                *tok = '\0';
+            }
+            if (NULL == (value = strchr (line, '='))) {
+                continue;
+            }
+            *value++ = '\0';
+            key = descriptor_trim (line);
+            value = descriptor_trim (value);
+
+            if (0 == strcmp (key, "framework")) {
+                free (framework);
+                framework = strdup (value);
+            } else if (0 == strcmp (key, "name")) {
+                free (name);
+                name = strdup (value);
+            } else if (0 == strcmp (key, "priority")) {
+                priority = (int) strtol (value, NULL, 10);
+            } else if (0 == strcmp (key, "requires")) {
+                for (tok = strtok_r (value, ", \t", &ctx) ; NULL != tok ;
+                     tok = strtok_r (NULL, ", \t", &ctx)) {
+                    ww_argv_append_nosize (&requires, tok);
+                }
+            }
+            /* anything else is for some later version */
+        }
+        mca_base_component_index_record_descriptor (ri->ri_index_entry, fileno (fp), framework,
+                                                    name, priority, requires);
+        fclose (fp);
+    }
+
+    if (NULL == framework || 0 != strcmp (framework, ri->ri_type) ||
+        NULL == name || 0 != strcmp (name, ri->ri_name)) {
+        ww_output_verbose (MCA_BASE_VERBOSE_COMPONENT, 0,
+                           "mca: base: component_repository: descriptor %s does not match "
+                           "%s component \"%s\" (ignored)", file, ri->ri_type, ri->ri_name);
+        ww_argv_free (requires);
+        free (framework);
+        free (name);
+        free (file);
+        return;
+    }
+    free (framework);
+    free (name);
+    free (file);
+
+    ri->ri_described = true;
+    ri->ri_priority = priority;
+    ri->ri_requires = requires;
+}
+
 static int process_repository_item (const char *filename, void *data)
 {
     char name[MCA_BASE_MAX_COMPONENT_NAME_LEN + 1];
     char type[MCA_BASE_MAX_TYPE_NAME_LEN + 1];
     mca_base_component_repository_item_t *ri;
     ww_list_t *component_list;
-    char *base;
+    char *base, *names;
     int ret;
 
     base = ww_basename (filename);
@@ -92,8 +200,13 @@ static int process_repository_item (const char *filename, void *data)
     }
 
     /* read framework and component names. framework names may not include an _
-     * but component names may */
-    ret = sscanf (base, "mca_%" STRINGIFY(MCA_BASE_MAX_TYPE_NAME_LEN) "[^_]_%"
+     * but component names may. Our own components are installed with the
+     * project name in front (mca_ww_<framework>_<component>) */
+    names = base + 4;
+    if (0 == strncmp (names, "ww_", 3)) {
+        names += 3;
+    }
+    ret = sscanf (names, "%" STRINGIFY(MCA_BASE_MAX_TYPE_NAME_LEN) "[^_]_%"
                   STRINGIFY(MCA_BASE_MAX_COMPONENT_NAME_LEN) "s", type, name);
     if (0 > ret) {
         /* does not patch the expected template. skip */
@@ -137,6 +250,7 @@ static int process_repository_item (const char *filename, void *data)
     }
 
     ri->ri_base = base;
+    ri->ri_index_entry = (mca_base_component_index_entry_t *) data;
 
     ri->ri_path = strdup (filename);
     if (NULL == ri->ri_path) {
@@ -151,6 +265,8 @@ static int process_repository_item (const char *filename, void *data)
     ri->ri_name[MCA_BASE_MAX_TYPE_NAME_LEN] = '\0';
     strncpy (ri->ri_name, name, MCA_BASE_MAX_COMPONENT_NAME_LEN);
 
+    read_descriptor (ri);
+
     ww_list_append (component_list, &ri->super);
 
     return WW_SUCCESS;
@@ -200,7 +316,7 @@ int mca_base_component_repository_add (const char *path)
             dir = mca_base_system_default_path;
         }
 
-        if (0 != ww_dl_foreachfile(dir, process_repository_item, NULL)) {
+        if (0 != mca_base_component_index_foreachfile(dir, process_repository_item)) {
             break;
         }
     } while (NULL != (dir = strtok_r (NULL, sep, &ctx)));
@@ -320,6 +436,15 @@ void mca_base_component_repository_release(const mca_base_component_t *component
 #endif
 }
 
+bool mca_base_component_repository_has (const char *type, const char *name)
+{
+#if WW_HAVE_DL_SUPPORT
+    return NULL != find_component (type, name);
+#else
+    return false;
+#endif
+}
+
 int mca_base_component_repository_retain_component (const char *type, const char *name)
 {
 #if WW_HAVE_DL_SUPPORT
@@ -387,6 +512,14 @@ int mca_base_component_repository_open (mca_base_framework_t *framework,
         return WW_ERR_NOT_SUPPORTED;
     }
 
+    /* Don't bother loading a file that failed last time and has not
+       changed since */
+    if (mca_base_component_index_skip (ri->ri_index_entry)) {
+        ww_output_verbose(vl, 0, "mca_base_component_repository_open: %s failed to load previously "
+                          "and has not changed (ignored)", ri->ri_base);
+        return WW_ERR_BAD_PARAM;
+    }
+
     /* Now try to load the component */
 
     char *err_msg = NULL;
@@ -409,6 +542,8 @@ int mca_base_component_repository_open (mca_base_framework_t *framework,
         }
         ww_output_verbose(vl, 0, "mca_base_component_repository_open: unable to open %s: %s (ignored)",
                             ri->ri_base, err_msg);
+        /* not cached in the index - a library the component needs may
+           just not have been found this time */
         return WW_ERR_BAD_PARAM;
     }
 
@@ -476,6 +611,7 @@ int mca_base_component_repository_open (mca_base_framework_t *framework,
         ri->ri_component_struct = mitem->cli_component = component_struct;
         ri->ri_refcnt = 1;
         ww_list_append(&framework->framework_components, &mitem->super);
+        mca_base_component_index_record (ri->ri_index_entry, component_struct);
 
         ww_output_verbose (MCA_BASE_VERBOSE_INFO, 0, "mca_base_component_repository_open: opened dynamic %s MCA "
                              "component \"%s\"", ri->ri_type, ri->ri_name);
@@ -491,6 +627,12 @@ int mca_base_component_repository_open (mca_base_framework_t *framework,
         free (struct_name);
     }
 
+    if (WW_ERR_BAD_PARAM == ret) {
+        /* the file itself is no good - no component in it, or one
+           we cannot use */
+        mca_base_component_index_record (ri->ri_index_entry, NULL);
+    }
+
     ww_dl_close (ri->ri_dlhandle);
     ri->ri_dlhandle = NULL;
 
@@ -528,6 +670,8 @@ void mca_base_component_repository_finalize(void)
                                                 node, &node);
     }
 
+    mca_base_component_index_finalize ();
+
     (void) mca_base_framework_close(&ww_dl_base_framework);
     WW_DESTRUCT(&mca_base_component_repository);
 #endif
@@ -544,6 +688,10 @@ static void ri_constructor (mca_base_component_repository_item_t *ri)
     ri->ri_dlhandle = NULL;
     ri->ri_component_struct = NULL;
     ri->ri_path = NULL;
+    ri->ri_index_entry = NULL;
+    ri->ri_described = false;
+    ri->ri_priority = 0;
+    ri->ri_requires = NULL;
 }
 
 
@@ -567,6 +715,10 @@ static void ri_destructor (mca_base_component_repository_item_t *ri)
     if (ri->ri_base) {
         free (ri->ri_base);
     }
+
+    if (ri->ri_requires) {
+        ww_argv_free (ri->ri_requires);
+    }
 }
 
 #endif /* WW_HAVE_DL_SUPPORT */
@@ -43,6 +43,50 @@
 #include "src/mca/dl/base/base.h"
 
 BEGIN_C_DECLS
+/*
+ * What the component index remembers about a component file
+ */
+typedef enum {
+    /** never loaded, or changed since it was */
+    MCA_BASE_COMPONENT_INDEX_UNKNOWN,
+    /** loaded and checked out */
+    MCA_BASE_COMPONENT_INDEX_OK,
+    /** loaded, but is not a usable component */
+    MCA_BASE_COMPONENT_INDEX_BAD
+} mca_base_component_index_status_t;
+
+struct mca_base_component_index_t;
+
+/*
+ * One component file in a directory's index
+ */
+struct mca_base_component_index_entry_t {
+    ww_list_item_t super;
+
+    /** index this entry belongs to */
+    struct mca_base_component_index_t *ie_index;
+    /** path as passed to ww_dl_open (i.e., without suffix) */
+    char *ie_path;
+    /** the file as last seen */
+    int64_t ie_mtime;
+    int64_t ie_size;
+
+    mca_base_component_index_status_t ie_status;
+
+    /** the file's descriptor (see below) is known */
+    bool ie_desc_known;
+    /** the descriptor as last read - mtime is -1 if there is none */
+    int64_t ie_desc_mtime;
+    int64_t ie_desc_size;
+    char *ie_desc_framework;
+    char *ie_desc_name;
+    int ie_desc_priority;
+    char **ie_desc_requires;
+};
+typedef struct mca_base_component_index_entry_t mca_base_component_index_entry_t;
+
+WW_CLASS_DECLARATION(mca_base_component_index_entry_t);
+
 struct mca_base_component_repository_item_t {
     ww_list_item_t super;
 
@@ -56,11 +100,45 @@ struct mca_base_component_repository_item_t {
     const mca_base_component_t *ri_component_struct;
 
     int ri_refcnt;
+
+    /** index entry for the file, if the directory is indexed */
+    mca_base_component_index_entry_t *ri_index_entry;
+
+    /** the component has a descriptor (see below) */
+    bool ri_described;
+    /** priority and dependencies from the descriptor */
+    int ri_priority;
+    char **ri_requires;
 };
 typedef struct mca_base_component_repository_item_t mca_base_component_repository_item_t;
 
 WW_CLASS_DECLARATION(mca_base_component_repository_item_t);
 
+/*
+ * Component descriptors
+ *
+ * A component file may be accompanied by a descriptor - a file of the
+ * same name with MCA_BASE_COMPONENT_DESCRIPTOR_SUFFIX in place of the
+ * library suffix (e.g., mca_ww_sec_munge.ww-component next to
+ * mca_ww_sec_munge.so) - holding "key = value" lines:
+ *
+ *   framework = sec
+ *   name = munge
+ *   priority = 10
+ *   requires = dstore:hash, ...
+ *
+ * The framework and name must match those in the file name. Given a
+ * descriptor, the component can be filtered and ranked before it is
+ * loaded: components whose requirements are missing, or whose
+ * priority is negative and which were not asked for by name, are
+ * never loaded. Of the rest, only the highest priority one that loads
+ * is loaded by default - <framework>_base_load_max raises that limit,
+ * and components asked for by name are always loaded. The component
+ * struct is looked up as mca_<framework>_<name>_component, the same
+ * name the static component lists use.
+ */
+#define MCA_BASE_COMPONENT_DESCRIPTOR_SUFFIX ".ww-component"
+
 /**
  * @brief initialize the component repository
  *
@@ -92,6 +170,16 @@ WW_DECLSPEC int mca_base_component_repository_add (const char *path);
 WW_DECLSPEC int mca_base_component_repository_get_components (mca_base_framework_t *framework,
                                                                 ww_list_t **framework_components);
 
+/**
+ * @brief check whether a dynamic component is in the repository
+ *
+ * @param[in] type        framework name
+ * @param[in] name        component name
+ *
+ * The component need not have been loaded.
+ */
+WW_DECLSPEC bool mca_base_component_repository_has (const char *type, const char *name);
+
 /**
  * @brief finalize the mca component repository
  */
@@ -128,6 +216,83 @@ void mca_base_component_repository_release (const mca_base_component_t *componen
  */
 int mca_base_component_repository_retain_component (const char *type, const char *name);
 
+/**
+ * @brief invoke func on every component file in a directory
+ *
+ * @param[in] dir         directory to scan
+ * @param[in] func        callback, as for ww_dl_foreachfile(); its
+ *                        data is the file's index entry
+ *
+ * Each component directory has an on-disk index of the component
+ * files in it. If the directory has not been modified since the index
+ * was written, the files are taken from the index instead of scanning
+ * the directory. Otherwise the directory is scanned and the index is
+ * rebuilt, to be written out by mca_base_component_index_finalize().
+ */
+int mca_base_component_index_foreachfile (const char *dir,
+                                          int (*func)(const char *filename, void *data));
+
+/**
+ * @brief check whether a component file is known to be unusable
+ *
+ * Returns true if the file was found not to be a usable component
+ * last time and has not changed since, in which case it need not be
+ * loaded again.
+ */
+bool mca_base_component_index_skip (mca_base_component_index_entry_t *entry);
+
+/**
+ * @brief record the result of loading a component file
+ *
+ * @param[in] entry       index entry for the file
+ * @param[in] component   the component, or NULL if it was unusable
+ *
+ * Only record a NULL component for faults of the file itself. A file
+ * that could not be dlopen'ed may have failed for reasons outside it.
+ */
+void mca_base_component_index_record (mca_base_component_index_entry_t *entry,
+                                      const mca_base_component_t *component);
+
+/**
+ * @brief look up a component file's descriptor in the index
+ *
+ * @param[in]  entry      index entry for the file
+ * @param[in]  file       the descriptor's path
+ * @param[out] framework  framework named by the descriptor, or NULL
+ *                        if the file has none
+ * @param[out] name       component named by the descriptor
+ * @param[out] priority   priority given by the descriptor
+ * @param[out] requires   requirements given by the descriptor
+ *
+ * Returns true if the index knows the descriptor as it is now, in
+ * which case it need not be read. The strings belong to the entry.
+ */
+bool mca_base_component_index_descriptor (mca_base_component_index_entry_t *entry,
+                                          const char *file, const char **framework,
+                                          const char **name, int *priority,
+                                          char ***requires);
+
+/**
+ * @brief record what was read from a component file's descriptor
+ *
+ * @param[in] entry       index entry for the file
+ * @param[in] fd          the descriptor as it was read, or -1 if the
+ *                        file has none
+ * @param[in] framework   as read from the descriptor
+ * @param[in] name        as read from the descriptor
+ * @param[in] priority    as read from the descriptor
+ * @param[in] requires    as read from the descriptor (copied)
+ */
+void mca_base_component_index_record_descriptor (mca_base_component_index_entry_t *entry,
+                                                 int fd, const char *framework,
+                                                 const char *name, int priority,
+                                                 char **requires);
+
+/**
+ * @brief write out any indexes that changed and release them all
+ */
+void mca_base_component_index_finalize (void);
+
 END_C_DECLS
 
 #endif /* MCA_BASE_COMPONENT_REPOSITORY_H */
@@ -112,6 +112,27 @@ int mca_base_framework_register (struct mca_base_framework_t *framework,
             return ret;
         }
 
+        if (!(flags & MCA_BASE_REGISTER_STATIC_ONLY)) {
+            ret = asprintf (&desc, "Maximum number of dynamic %s components with a descriptor "
+                            "to load, highest descriptor priority first, unless they are "
+                            "requested by name (0: no limit)", framework->framework_name);
+            if (0 > ret) {
+                return WW_ERR_OUT_OF_RESOURCE;
+            }
+
+            framework->framework_load_max = 1;
+            ret = mca_base_framework_var_register (framework, "load_max", desc,
+                                                   MCA_BASE_VAR_TYPE_INT, NULL, 0,
+                                                   MCA_BASE_VAR_FLAG_SETTABLE,
+                                                   WW_INFO_LVL_9,
+                                                   MCA_BASE_VAR_SCOPE_READONLY,
+                                                   &framework->framework_load_max);
+            free(desc);
+            if (0 > ret) {
+                return ret;
+            }
+        }
+
         /* check the initial verbosity and open the output if necessary. we
            will recheck this on open */
         framework_open_output (framework);
@@ -153,6 +153,9 @@ typedef struct mca_base_framework_t {
     int                                      framework_verbose;
     /** Pmix output for this framework (or -1) */
     int                                      framework_output;
+    /** Maximum number of described dynamic components to load, unless
+        they are requested by name (0 for no limit) */
+    int                                      framework_load_max;
     /** List of selected components (filled in by mca_base_framework_register()
         or mca_base_framework_open() */
     ww_list_t                              framework_components;
@@ -239,6 +242,7 @@ WW_DECLSPEC bool mca_base_framework_is_open (struct mca_base_framework_t *framew
         .framework_static_components = static_components,               \
         .framework_selection         = NULL,                            \
         .framework_verbose           = 0,                               \
-        .framework_output            = -1}
+        .framework_output            = -1,                              \
+        .framework_load_max          = 1}
 
 #endif /* WW_MCA_BASE_FRAMEWORK_H */
@@ -50,6 +50,9 @@ char *mca_base_system_default_path = NULL;
 char *mca_base_user_default_path = NULL;
 bool mca_base_component_show_load_errors = true;
 bool mca_base_component_disable_dlopen = false;
+bool mca_base_component_index = true;
+char *mca_base_component_index_dir = NULL;
+bool mca_base_component_index_refresh = false;
 
 static char *mca_base_verbose = NULL;
 
@@ -121,6 +124,34 @@ int mca_base_open(void)
     (void) mca_base_var_register_synonym(var_id, "Warewulf", "mca", NULL, "component_disable_dlopen",
                                          MCA_BASE_VAR_SYN_FLAG_DEPRECATED);
 
+    mca_base_component_index = true;
+    (void) mca_base_var_register("Warewulf", "mca", "base", "component_index",
+                                 "Whether to keep an index of the component files in each component "
+                                 "directory, so that unchanged directories need not be rescanned",
+                                 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                 WW_INFO_LVL_9,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_base_component_index);
+
+    mca_base_component_index_dir = NULL;
+    (void) mca_base_var_register("Warewulf", "mca", "base", "component_index_dir",
+                                 "Per-user directory in which to keep the component indexes (default: "
+                                 "warewulf/component-index under $XDG_CACHE_HOME or ~/.cache; empty: "
+                                 "do not cache them)",
+                                 MCA_BASE_VAR_TYPE_STRING, NULL, 0, 0,
+                                 WW_INFO_LVL_9,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_base_component_index_dir);
+
+    mca_base_component_index_refresh = false;
+    (void) mca_base_var_register("Warewulf", "mca", "base", "component_index_refresh",
+                                 "Write the index into each component directory, for everyone to use "
+                                 "(meant to be run once by whoever installs the components)",
+                                 MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                 WW_INFO_LVL_9,
+                                 MCA_BASE_VAR_SCOPE_READONLY,
+                                 &mca_base_component_index_refresh);
+
     /* What verbosity level do we want for the default 0 stream? */
     mca_base_verbose = "stderr";
     var_id = mca_base_var_register("Warewulf", "mca", "base", "verbose",
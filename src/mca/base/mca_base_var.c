@@ -78,6 +78,27 @@ static int mca_base_var_count = 0;
 
 static ww_hash_table_t mca_base_var_index_hash;
 
+/*
+ * Frozen index of the variable names: a perfect hash table over every
+ * variable registered when mca_base_var_index_freeze() was called, in
+ * which a name hashes to a bucket, and the bucket's seed takes it to
+ * a slot of its own. A lookup is then two hash computations, one slot
+ * and one comparison, and never allocates. Registering another
+ * variable discards the index until it is frozen again; lookups use
+ * mca_base_var_index_hash in the meantime.
+ */
+typedef struct {
+    uint32_t nbuckets;
+    uint32_t nslots;
+    uint32_t *seeds;
+    int *slots;
+} mca_base_var_frozen_index_t;
+
+static mca_base_var_frozen_index_t *mca_base_var_frozen_index = NULL;
+
+/* longest name var_find() will assemble on the stack */
+#define MCA_BASE_VAR_FIND_NAME_MAX 256
+
 const char *var_type_names[] = {
     "int",
     "unsigned_int",
@@ -904,6 +925,264 @@ int mca_base_var_env_name(const char *param_name,
     return WW_SUCCESS;
 }
 
+/*
+ * Hash a name given as its parts, as joined by
+ * mca_base_var_generate_full_name4() - so that hashing the parts and
+ * hashing the full name give the same result. FNV-1a, with the bits
+ * mixed at the end, as FNV leaves similar names with similar upper
+ * bits.
+ */
+static uint64_t var_name_hash (const char * const *names, int count)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    bool empty = true;
+    const char *p;
+
+    for (int i = 0 ; i < count ; ++i) {
+        if (NULL == names[i]) {
+            continue;
+        }
+        if (!empty) {
+            hash = (hash ^ (uint64_t) '_') * 0x100000001b3ULL;
+        }
+        for (p = names[i] ; '\0' != *p ; ++p) {
+            hash = (hash ^ (uint64_t) (unsigned char) *p) * 0x100000001b3ULL;
+            empty = false;
+        }
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* compare a full name with a name given as its parts */
+static bool var_name_equal (const char *full_name, const char * const *names, int count)
+{
+    bool empty = true;
+    const char *p;
+
+    for (int i = 0 ; i < count ; ++i) {
+        if (NULL == names[i]) {
+            continue;
+        }
+        if (!empty && '_' != *full_name++) {
+            return false;
+        }
+        for (p = names[i] ; '\0' != *p ; ++p, ++full_name) {
+            if (*p != *full_name) {
+                return false;
+            }
+            empty = false;
+        }
+    }
+
+    return '\0' == *full_name;
+}
+
+/* take a name's hash to a slot with a bucket's seed */
+static inline uint32_t var_frozen_slot (const mca_base_var_frozen_index_t *index,
+                                        uint64_t hash, uint32_t seed)
+{
+    hash ^= (uint64_t) seed * 0x9e3779b97f4a7c15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    /* scale rather than divide - it is the division that would cost */
+    return (uint32_t) (((hash & 0xffffffffULL) * index->nslots) >> 32);
+}
+
+/* the bucket comes from the other half of the hash */
+static inline uint32_t var_frozen_bucket (const mca_base_var_frozen_index_t *index,
+                                          uint64_t hash)
+{
+    return (uint32_t) (((hash >> 32) * index->nbuckets) >> 32);
+}
+
+static int var_frozen_find (const char * const *names, int count)
+{
+    const mca_base_var_frozen_index_t *index = mca_base_var_frozen_index;
+    uint64_t hash = var_name_hash (names, count);
+    mca_base_var_t *var;
+    int vari;
+
+    vari = index->slots[var_frozen_slot (index, hash, index->seeds[var_frozen_bucket (index, hash)])];
+    if (0 > vari) {
+        return WW_ERR_NOT_FOUND;
+    }
+
+    var = ww_pointer_array_get_item (&mca_base_vars, vari);
+    if (NULL == var || !var_name_equal (var->mbv_full_name, names, count)) {
+        return WW_ERR_NOT_FOUND;
+    }
+
+    return vari;
+}
+
+static void var_frozen_index_free (mca_base_var_frozen_index_t *index)
+{
+    if (NULL != index) {
+        free (index->seeds);
+        free (index->slots);
+        free (index);
+    }
+}
+
+/* registration is open again */
+static void var_index_thaw (void)
+{
+    var_frozen_index_free (mca_base_var_frozen_index);
+    mca_base_var_frozen_index = NULL;
+}
+
+/* try to place every bucket with nslots slots */
+static int var_frozen_build (mca_base_var_frozen_index_t *index, const uint64_t *hashes,
+                             const int *varis, int count)
+{
+    uint32_t *order, *bucket_count, *bucket_first, *members, *placed, nplaced;
+    int ret = WW_ERR_OUT_OF_RESOURCE;
+    uint32_t b, i, j, slot, seed, tmp;
+
+    order = calloc (index->nbuckets, sizeof (uint32_t));
+    bucket_count = calloc (index->nbuckets, sizeof (uint32_t));
+    bucket_first = calloc (index->nbuckets + 1, sizeof (uint32_t));
+    members = calloc (count + 1, sizeof (uint32_t));
+    placed = calloc (count + 1, sizeof (uint32_t));
+    if (NULL == order || NULL == bucket_count || NULL == bucket_first ||
+        NULL == members || NULL == placed) {
+        goto out;
+    }
+
+    for (i = 0 ; i < index->nslots ; ++i) {
+        index->slots[i] = -1;
+    }
+
+    /* gather the names by bucket */
+    for (i = 0 ; i < (uint32_t) count ; ++i) {
+        bucket_count[var_frozen_bucket (index, hashes[i])]++;
+    }
+    for (b = 0 ; b < index->nbuckets ; ++b) {
+        bucket_first[b + 1] = bucket_first[b] + bucket_count[b];
+        bucket_count[b] = 0;
+        order[b] = b;
+    }
+    for (i = 0 ; i < (uint32_t) count ; ++i) {
+        b = var_frozen_bucket (index, hashes[i]);
+        members[bucket_first[b] + bucket_count[b]++] = i;
+    }
+
+    /* place the largest buckets first, while there is most room.
+       There are only as many buckets as half the variables, so an
+       insertion sort will do */
+    for (i = 1 ; i < index->nbuckets ; ++i) {
+        tmp = order[i];
+        for (j = i ; j > 0 && bucket_count[order[j - 1]] < bucket_count[tmp] ; --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = tmp;
+    }
+
+    ret = WW_ERR_NOT_FOUND;
+    for (i = 0 ; i < index->nbuckets ; ++i) {
+        b = order[i];
+        if (0 == bucket_count[b]) {
+            break;
+        }
+
+        for (seed = 0 ; seed < (1u << 16) ; ++seed) {
+            nplaced = 0;
+            for (j = 0 ; j < bucket_count[b] ; ++j) {
+                slot = var_frozen_slot (index, hashes[members[bucket_first[b] + j]], seed);
+                if (0 <= index->slots[slot]) {
+                    break;
+                }
+                index->slots[slot] = varis[members[bucket_first[b] + j]];
+                placed[nplaced++] = slot;
+            }
+            if (j == bucket_count[b]) {
+                break;
+            }
+            /* collision - undo and try the next seed */
+            while (nplaced) {
+                index->slots[placed[--nplaced]] = -1;
+            }
+        }
+        if (seed == (1u << 16)) {
+            goto out;
+        }
+        index->seeds[b] = seed;
+    }
+
+    ret = WW_SUCCESS;
+
+out:
+    free (order);
+    free (bucket_count);
+    free (bucket_first);
+    free (members);
+    free (placed);
+    return ret;
+}
+
+int mca_base_var_index_freeze (void)
+{
+    mca_base_var_frozen_index_t *index;
+    uint64_t *hashes;
+    mca_base_var_t *var;
+    int *varis, size, count = 0, ret;
+
+    if (!mca_base_var_initialized) {
+        return WW_ERROR;
+    }
+    if (NULL != mca_base_var_frozen_index) {
+        /* nothing registered since */
+        return WW_SUCCESS;
+    }
+
+    size = ww_pointer_array_get_size (&mca_base_vars);
+    hashes = malloc ((size + 1) * sizeof (uint64_t));
+    varis = malloc ((size + 1) * sizeof (int));
+    index = calloc (1, sizeof (*index));
+    if (NULL == hashes || NULL == varis || NULL == index) {
+        ret = WW_ERR_OUT_OF_RESOURCE;
+        goto out;
+    }
+
+    for (int i = 0 ; i < size ; ++i) {
+        var = ww_pointer_array_get_item (&mca_base_vars, i);
+        if (NULL != var && NULL != var->mbv_full_name) {
+            const char *name = var->mbv_full_name;
+            hashes[count] = var_name_hash (&name, 1);
+            varis[count++] = i;
+        }
+    }
+
+    /* about two names to a bucket, and a fifth of the slots spare.
+       Should the seeds run out - two names with the same hash - fall
+       back to the hash table */
+    index->nbuckets = count / 2 + 1;
+    index->nslots = count + count / 4 + 1;
+    index->seeds = calloc (index->nbuckets, sizeof (uint32_t));
+    index->slots = malloc (index->nslots * sizeof (int));
+    if (NULL == index->seeds || NULL == index->slots) {
+        ret = WW_ERR_OUT_OF_RESOURCE;
+        goto out;
+    }
+
+    ret = var_frozen_build (index, hashes, varis, count);
+    if (WW_SUCCESS == ret) {
+        mca_base_var_frozen_index = index;
+        index = NULL;
+    }
+
+out:
+    var_frozen_index_free (index);
+    free (hashes);
+    free (varis);
+    return ret;
+}
+
 /*
  * Find the index for an MCA parameter based on its names.
  */
@@ -913,10 +1192,18 @@ static int var_find_by_name (const char *full_name, int *vari, bool invalidok)
     void *tmp;
     int rc;
 
-    rc = ww_hash_table_get_value_ptr (&mca_base_var_index_hash, full_name, strlen (full_name),
-                                        &tmp);
-    if (WW_SUCCESS != rc) {
-        return rc;
+    if (NULL != mca_base_var_frozen_index) {
+        rc = var_frozen_find (&full_name, 1);
+        if (0 > rc) {
+            return rc;
+        }
+        tmp = (void *)(uintptr_t) rc;
+    } else {
+        rc = ww_hash_table_get_value_ptr (&mca_base_var_index_hash, full_name, strlen (full_name),
+                                          &tmp);
+        if (WW_SUCCESS != rc) {
+            return rc;
+        }
     }
 
     (void) var_get ((int)(uintptr_t) tmp, &var, false);
@@ -933,20 +1220,55 @@ static int var_find (const char *project_name, const char *framework_name,
                      const char *component_name, const char *variable_name,
                      bool invalidok)
 {
-    char *full_name;
+    const char * const names[] = {framework_name, component_name, variable_name};
+    char buffer[MCA_BASE_VAR_FIND_NAME_MAX], *full_name = buffer;
+    mca_base_var_t *var = NULL;
+    size_t len = 0, plen;
     int ret, vari;
 
-    ret = mca_base_var_generate_full_name4 (NULL, framework_name, component_name,
-                                            variable_name, &full_name);
-    if (WW_SUCCESS != ret) {
-        return WW_ERROR;
+    /* NTH: should we verify the name components match? */
+
+    if (NULL != mca_base_var_frozen_index) {
+        vari = var_frozen_find (names, 3);
+        if (0 > vari) {
+            return vari;
+        }
+        (void) var_get (vari, &var, false);
+        return (invalidok || VAR_IS_VALID(var[0])) ? vari : WW_ERR_NOT_FOUND;
     }
 
-    ret = var_find_by_name(full_name, &vari, invalidok);
+    /* not frozen - assemble the full name, on the stack if it fits */
+    for (int i = 0 ; i < 3 ; ++i) {
+        if (NULL == names[i]) {
+            continue;
+        }
+        plen = strlen (names[i]);
+        if (len + plen + 2 > sizeof (buffer)) {
+            full_name = NULL;
+            break;
+        }
+        if (0 < len) {
+            buffer[len++] = '_';
+        }
+        memcpy (buffer + len, names[i], plen);
+        len += plen;
+    }
 
-    /* NTH: should we verify the name components match? */
+    if (NULL == full_name) {
+        ret = mca_base_var_generate_full_name4 (NULL, framework_name, component_name,
+                                                variable_name, &full_name);
+        if (WW_SUCCESS != ret) {
+            return WW_ERROR;
+        }
+    } else {
+        buffer[len] = '\0';
+    }
+
+    ret = var_find_by_name(full_name, &vari, invalidok);
 
-    free (full_name);
+    if (buffer != full_name) {
+        free (full_name);
+    }
 
     if (WW_SUCCESS != ret) {
         return ret;
@@ -1154,6 +1476,7 @@ int mca_base_var_finalize(void)
         (void) mca_base_var_group_finalize ();
 
         WW_DESTRUCT(&mca_base_var_index_hash);
+        var_index_thaw ();
 
         free (mca_base_envar_files);
         mca_base_envar_files = NULL;
@@ -1427,6 +1750,7 @@ static int register_variable (const char *project_name, const char *framework_na
 
         ww_hash_table_set_value_ptr (&mca_base_var_index_hash, var->mbv_full_name, strlen (var->mbv_full_name),
                                        (void *)(uintptr_t) var_index);
+        var_index_thaw ();
     } else {
         ret = var_get (var_index, &var, false);
         if (WW_SUCCESS != ret) {
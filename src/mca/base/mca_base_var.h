@@ -589,6 +589,20 @@ WW_DECLSPEC int mca_base_var_find (const char *project_name,
  */
 WW_DECLSPEC int mca_base_var_find_by_name (const char *full_name, int *vari);
 
+/**
+ * Freeze the variable name index
+ *
+ * Builds a perfect hash table over the names of all variables
+ * registered so far, so that mca_base_var_find() and
+ * mca_base_var_find_by_name() take constant time and do not allocate.
+ * To be called once registration is complete - a variable registered
+ * afterwards discards the table, and lookups fall back to the general
+ * hash table until this is called again.
+ *
+ * @retval WW_SUCCESS if the table was built (or is still current)
+ */
+WW_DECLSPEC int mca_base_var_index_freeze (void);
+
 /**
  * Check that two MCA variables were not both set to non-default
  * values.
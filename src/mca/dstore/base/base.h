@@ -38,6 +38,7 @@
 #include "src/mca/base/mca_base_framework.h"
 
 #include "src/mca/dstore/dstore.h"
+#include "src/runtime/ww_coro.h"
 
 
  BEGIN_C_DECLS
@@ -52,6 +53,14 @@
  */
  WW_DECLSPEC ww_status_t ww_dstore_base_select(void);
 
+/* add a module to the active list in priority order. Selection does
+ * this for every component that offers a module; it may also be
+ * called after ww_init with a module that was not loaded through the
+ * MCA, e.g., one a benchmark provides. The component and module must
+ * outlive the framework */
+WW_DECLSPEC ww_status_t ww_dstore_base_add_module(ww_dstore_base_component_t *component,
+                                                  ww_dstore_module_t *module, int priority);
+
 /**
  * Track an active component / module
  */
@@ -69,18 +78,117 @@ WW_CLASS_DECLARATION(ww_dstore_base_active_module_t);
 struct ww_dstore_globals_t {
   ww_list_t actives;
   bool initialized;
+  /* configuration cache */
+  size_t cache_limit;           // memory budget in bytes - zero disables the cache
+  int cache_shards;             // number of independently locked shards
+  size_t cache_hits;
+  size_t cache_misses;
+  size_t cache_evictions;
+  /* group commit */
+  bool group_commit;            // coalesce concurrent commits into one durable write
+  int group_commit_window;      // usec the group leader waits for more commits to arrive
+  /* shared-memory publication */
+  bool shmem_publish;           // publish each committed configuration to shared memory
+  bool shmem_attach;            // serve loads from published configurations when available
 };
 typedef struct ww_dstore_globals_t ww_dstore_globals_t;
 
-extern ww_dstore_globals_t ww_dstore_globals;
+WW_DECLSPEC extern ww_dstore_globals_t ww_dstore_globals;
+
+/**
+ * Cache of loaded configurations, keyed by configuration name.
+ *
+ * The cache holds a private copy of each configuration it is given,
+ * and lookups return a fresh copy that belongs to the caller - who may
+ * change it freely, and must release it.
+ * Entries are evicted in LRU order once the memory budget is exceeded,
+ * dropped whenever the configuration is committed, and revalidated
+ * against the dstore-reported version/mtime on each hit if the owning
+ * dstore supports the stat API.
+ */
+typedef struct {
+    ww_list_item_t super;
+    char *name;
+    ww_configuration_t *config;
+    size_t size;
+    /* snapshot of the metadata reported by the dstore that
+     * supplied the configuration when it was cached */
+    char *dstore;
+    char *version;
+    char *mtime;
+} ww_dstore_base_cache_entry_t;
+WW_CLASS_DECLARATION(ww_dstore_base_cache_entry_t);
+
+ww_status_t ww_dstore_base_cache_init(void);
+void ww_dstore_base_cache_finalize(void);
+ww_configuration_t* ww_dstore_base_cache_lookup(const char *name);
+void ww_dstore_base_cache_store(ww_configuration_t *config);
+void ww_dstore_base_cache_invalidate(const char *name);
+
+/**
+ * Group commit
+ *
+ * Callers of ww_dstore_base_commit queue a request and the first one
+ * to find no commit in progress becomes the leader for everything
+ * queued so far - including anything that arrives during the optional
+ * collection window or while the previous group is being flushed. The
+ * leader writes every request in the group, flushes each dstore that
+ * was written once, and then releases all of the callers.
+ */
+typedef struct {
+    ww_list_item_t super;
+    ww_configuration_t *config;
+    ww_list_t *directives;
+    ww_status_t status;
+    bool done;
+} ww_dstore_base_commit_req_t;
+WW_CLASS_DECLARATION(ww_dstore_base_commit_req_t);
+
+void ww_dstore_base_commit_init(void);
+void ww_dstore_base_commit_finalize(void);
+
+/**
+ * Shared-memory publication
+ *
+ * A publisher writes each committed configuration into a read-only
+ * shared-memory segment, one segment per generation, and advertises
+ * the current generation through a small control segment guarded by
+ * a sequence lock. Any number of local readers can then attach to the
+ * current generation without going through a dstore. Segments that
+ * are not owned by our effective uid, or that others can write, are
+ * ignored. Each attach returns a configuration of the caller's own,
+ * but its strings live in the mapping: change it only through
+ * ww_dstore_base_set, which replaces key-values rather than editing
+ * them. It is released with WW_RELEASE like any other loaded
+ * configuration.
+ */
+void ww_dstore_base_shmem_init(void);
+void ww_dstore_base_shmem_finalize(void);
+ww_status_t ww_dstore_base_shmem_publish(ww_configuration_t *config);
+ww_configuration_t* ww_dstore_base_shmem_attach(const char *name);
 
 ww_configuration_t* ww_dstore_base_load(char *name, ww_list_t *directives);
 
 ww_status_t ww_dstore_base_commit(ww_configuration_t *config,
                                   ww_list_t *directives);
 
+/**
+ * Non-blocking commit. The commit is carried out on the asynchronous
+ * I/O worker pool, and cbfunc is then run on the progress thread
+ * associated with the name - see ww_aio.h. The configuration is
+ * retained until then; the directives must stay valid until the
+ * callback has been called.
+ */
+typedef void (*ww_dstore_base_commit_cbfunc_t)(ww_status_t status, void *cbdata);
+
+WW_DECLSPEC ww_status_t ww_dstore_base_commit_nb(ww_configuration_t *config,
+                                                 ww_list_t *directives,
+                                                 const char *name,
+                                                 ww_dstore_base_commit_cbfunc_t cbfunc,
+                                                 void *cbdata);
+
 ww_status_t ww_dstore_base_find(ww_configuration_t *config,
-                                char *key, char *type,
+                                char *type, char *key,
                                 ww_list_t *directives,
                                 ww_list_t *results);
 
@@ -91,6 +199,22 @@ ww_value_cmp_t ww_dstore_base_compare(ww_configuration_t *config1,
                                       ww_configuration_t *config2,
                                       ww_list_t *directives);
 
+/**
+ * Coroutine versions of load, commit and find. The call is run on
+ * the coroutine offload pool, and the calling coroutine is suspended
+ * until it returns - see ww_coro.h.
+ */
+WW_DECLSPEC ww_configuration_t* ww_dstore_base_load_await(ww_coro_t *co, char *name,
+                                                          ww_list_t *directives);
+
+WW_DECLSPEC ww_status_t ww_dstore_base_commit_await(ww_coro_t *co, ww_configuration_t *config,
+                                                    ww_list_t *directives);
+
+WW_DECLSPEC ww_status_t ww_dstore_base_find_await(ww_coro_t *co, ww_configuration_t *config,
+                                                  char *type, char *key,
+                                                  ww_list_t *directives,
+                                                  ww_list_t *results);
+
 END_C_DECLS
 
 #endif
@@ -0,0 +1,108 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Coroutine-awaitable dstore calls.
+ *
+ * Loads, commits and searches may go to disk or across the network,
+ * so a coroutine must not make them on its progress thread. These
+ * wrappers run the call on the coroutine offload pool and suspend
+ * the caller until it returns, leaving the progress thread free in
+ * the meantime.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include "src/runtime/ww_coro.h"
+
+#include "src/mca/dstore/base/base.h"
+
+typedef struct {
+    char *name;
+    ww_configuration_t *config;
+    char *type;
+    char *key;
+    ww_list_t *directives;
+    ww_list_t *results;
+    ww_configuration_t *loaded;
+    ww_status_t status;
+} ww_dstore_base_await_t;
+
+static void load_fn(void *arg)
+{
+    ww_dstore_base_await_t *aw = (ww_dstore_base_await_t*)arg;
+
+    aw->loaded = ww_dstore.load(aw->name, aw->directives);
+}
+
+static void commit_fn(void *arg)
+{
+    ww_dstore_base_await_t *aw = (ww_dstore_base_await_t*)arg;
+
+    aw->status = ww_dstore.commit(aw->config, aw->directives);
+}
+
+static void find_fn(void *arg)
+{
+    ww_dstore_base_await_t *aw = (ww_dstore_base_await_t*)arg;
+
+    aw->status = ww_dstore.find(aw->config, aw->type, aw->key,
+                                aw->directives, aw->results);
+}
+
+ww_configuration_t* ww_dstore_base_load_await(ww_coro_t *co, char *name,
+                                              ww_list_t *directives)
+{
+    ww_dstore_base_await_t aw;
+
+    aw.name = name;
+    aw.directives = directives;
+    aw.loaded = NULL;
+    if (WW_SUCCESS != ww_coro_offload(co, load_fn, &aw)) {
+        return NULL;
+    }
+    return aw.loaded;
+}
+
+ww_status_t ww_dstore_base_commit_await(ww_coro_t *co, ww_configuration_t *config,
+                                        ww_list_t *directives)
+{
+    ww_dstore_base_await_t aw;
+    ww_status_t rc;
+
+    aw.config = config;
+    aw.directives = directives;
+    aw.status = WW_ERROR;
+    if (WW_SUCCESS != (rc = ww_coro_offload(co, commit_fn, &aw))) {
+        return rc;
+    }
+    return aw.status;
+}
+
+ww_status_t ww_dstore_base_find_await(ww_coro_t *co, ww_configuration_t *config,
+                                      char *type, char *key,
+                                      ww_list_t *directives,
+                                      ww_list_t *results)
+{
+    ww_dstore_base_await_t aw;
+    ww_status_t rc;
+
+    aw.config = config;
+    aw.type = type;
+    aw.key = key;
+    aw.directives = directives;
+    aw.results = results;
+    aw.status = WW_ERROR;
+    if (WW_SUCCESS != (rc = ww_coro_offload(co, find_fn, &aw))) {
+        return rc;
+    }
+    return aw.status;
+}
@@ -0,0 +1,437 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "src/class/ww_hash_table.h"
+#include "src/class/ww_list.h"
+#include "src/include/hash_string.h"
+#include "src/threads/threads.h"
+#include "src/sys/atomic.h"
+#include "src/util/argv.h"
+#include "src/util/output.h"
+
+#include "src/mca/dstore/base/base.h"
+
+/* The cache is split into independently locked shards so that
+ * concurrent loads of different configurations do not serialize
+ * on a single lock. Each shard has its own slice of the memory
+ * budget and its own LRU list - least recently used entries are
+ * at the head of the list.
+ *
+ * Configurations are mutable, so the cache never shares one with a
+ * caller: it keeps a private copy of what it is given, and hands out
+ * a fresh copy on every hit. That still saves the trip to the dstore,
+ * and no caller can change what another one sees */
+typedef struct {
+    ww_mutex_t lock;
+    ww_hash_table_t table;
+    ww_list_t lru;
+    size_t size;
+    size_t limit;
+} ww_dstore_cache_shard_t;
+
+static ww_dstore_cache_shard_t *shards = NULL;
+static int nshards = 0;
+
+static inline ww_dstore_cache_shard_t* get_shard(const char *name)
+{
+    uint32_t hash;
+
+    WW_HASH_STR(name, hash);
+    return &shards[hash % nshards];
+}
+
+/* estimate the memory footprint of a configuration so we can
+ * charge it against the cache budget */
+static size_t config_size(ww_configuration_t *config)
+{
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    ww_kval_t *kv;
+    size_t sz;
+    int i, j, k, n;
+
+    sz = sizeof(ww_configuration_t);
+    if (NULL != config->name) {
+        sz += strlen(config->name) + 1;
+    }
+    for (i=0; i < config->types.size; i++) {
+        if (NULL == (typ = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, i))) {
+            continue;
+        }
+        sz += sizeof(ww_type_object_t);
+        for (j=0; j < typ->blocks.size; j++) {
+            if (NULL == (blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, j))) {
+                continue;
+            }
+            sz += sizeof(ww_building_block_t);
+            if (NULL != blk->uuid) {
+                sz += strlen(blk->uuid) + 1;
+            }
+            for (k=0; k < blk->keyvals.size; k++) {
+                if (NULL == (kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, k))) {
+                    continue;
+                }
+                sz += sizeof(ww_kval_t);
+                if (NULL != kv->key) {
+                    sz += strlen(kv->key) + 1;
+                }
+                if (NULL != kv->values) {
+                    for (n=0; NULL != kv->values[n]; n++) {
+                        sz += sizeof(char*) + strlen(kv->values[n]) + 1;
+                    }
+                }
+            }
+        }
+    }
+    return sz;
+}
+
+static char* dupstr(const char *str)
+{
+    return (NULL == str) ? NULL : strdup(str);
+}
+
+static ww_kval_t* copy_kval(ww_kval_t *src)
+{
+    ww_kval_t *kv;
+
+    kv = WW_NEW(ww_kval_t);
+    kv->key = dupstr(src->key);
+    kv->values = ww_argv_copy(src->values);
+    return kv;
+}
+
+/* make a deep copy of a configuration */
+static ww_configuration_t* copy_config(ww_configuration_t *src)
+{
+    ww_configuration_t *config;
+    ww_type_object_t *styp, *typ;
+    ww_building_block_t *sblk, *blk;
+    ww_dsmeta_t *smeta, *meta;
+    ww_kval_t *kv;
+    int i, j, k;
+
+    config = WW_NEW(ww_configuration_t);
+    config->name = dupstr(src->name);
+    config->modified = src->modified;
+    WW_LIST_FOREACH(smeta, &src->dstores, ww_dsmeta_t) {
+        meta = WW_NEW(ww_dsmeta_t);
+        meta->name = dupstr(smeta->name);
+        meta->version = dupstr(smeta->version);
+        meta->atime = dupstr(smeta->atime);
+        meta->mtime = dupstr(smeta->mtime);
+        meta->ctime = dupstr(smeta->ctime);
+        ww_list_append(&config->dstores, &meta->super);
+    }
+    config->ww_metadata.ww_version_cnt = src->ww_metadata.ww_version_cnt;
+    config->ww_metadata.atime = dupstr(src->ww_metadata.atime);
+    config->ww_metadata.mtime = dupstr(src->ww_metadata.mtime);
+    config->ww_metadata.ctime = dupstr(src->ww_metadata.ctime);
+    WW_LIST_FOREACH(kv, &src->attributes, ww_kval_t) {
+        ww_list_append(&config->attributes, &copy_kval(kv)->super);
+    }
+
+    for (i=0; i < src->types.size; i++) {
+        if (NULL == (styp = (ww_type_object_t*)ww_pointer_array_get_item(&src->types, i))) {
+            continue;
+        }
+        typ = WW_NEW(ww_type_object_t);
+        typ->type = dupstr(styp->type);
+        for (j=0; j < styp->blocks.size; j++) {
+            if (NULL == (sblk = (ww_building_block_t*)ww_pointer_array_get_item(&styp->blocks, j))) {
+                continue;
+            }
+            blk = WW_NEW(ww_building_block_t);
+            blk->uuid = dupstr(sblk->uuid);
+            /* callers may be setting values in the original */
+            ww_mutex_lock(&sblk->mutex);
+            for (k=0; k < sblk->keyvals.size; k++) {
+                if (NULL != (kv = (ww_kval_t*)ww_pointer_array_get_item(&sblk->keyvals, k))) {
+                    ww_pointer_array_add(&blk->keyvals, copy_kval(kv));
+                    blk->nkvals++;
+                }
+            }
+            ww_mutex_unlock(&sblk->mutex);
+            ww_pointer_array_add(&typ->blocks, blk);
+            typ->nblocks++;
+        }
+        ww_pointer_array_add(&config->types, typ);
+    }
+    return config;
+}
+
+/* must be called with the shard lock held */
+static ww_dstore_base_cache_entry_t* find_entry(ww_dstore_cache_shard_t *shard,
+                                                const char *name)
+{
+    ww_dstore_base_cache_entry_t *entry;
+
+    if (WW_SUCCESS != ww_hash_table_get_value_ptr(&shard->table, name, strlen(name),
+                                                  (void**)&entry)) {
+        return NULL;
+    }
+    return entry;
+}
+
+/* must be called with the shard lock held */
+static void remove_entry(ww_dstore_cache_shard_t *shard,
+                         ww_dstore_base_cache_entry_t *entry)
+{
+    ww_hash_table_remove_value_ptr(&shard->table, entry->name, strlen(entry->name));
+    ww_list_remove_item(&shard->lru, &entry->super);
+    shard->size -= entry->size;
+    WW_RELEASE(entry);
+}
+
+/* check the cached snapshot against what the owning dstore
+ * currently reports - returns false if the entry is stale */
+static bool entry_is_current(ww_dstore_base_cache_entry_t *entry)
+{
+    ww_dstore_base_active_module_t *active;
+    ww_dsmeta_t *meta;
+    bool current;
+
+    if (NULL == entry->dstore) {
+        return true;
+    }
+    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+        if (0 != strcmp(entry->dstore, active->component->base.mca_component_name)) {
+            continue;
+        }
+        if (NULL == active->module->stat) {
+            /* nothing we can check - rely on commit to invalidate */
+            return true;
+        }
+        if (NULL == (meta = active->module->stat(entry->name))) {
+            /* the configuration is gone */
+            return false;
+        }
+        current = true;
+        if (NULL != entry->version &&
+            (NULL == meta->version || 0 != strcmp(entry->version, meta->version))) {
+            current = false;
+        }
+        if (NULL != entry->mtime &&
+            (NULL == meta->mtime || 0 != strcmp(entry->mtime, meta->mtime))) {
+            current = false;
+        }
+        WW_RELEASE(meta);
+        return current;
+    }
+    /* the dstore that supplied it is no longer active */
+    return false;
+}
+
+ww_status_t ww_dstore_base_cache_init(void)
+{
+    int i;
+
+    if (0 == ww_dstore_globals.cache_limit) {
+        return WW_SUCCESS;
+    }
+    nshards = ww_dstore_globals.cache_shards;
+    if (nshards <= 0) {
+        nshards = 1;
+    }
+    shards = (ww_dstore_cache_shard_t*)calloc(nshards, sizeof(ww_dstore_cache_shard_t));
+    if (NULL == shards) {
+        nshards = 0;
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    for (i=0; i < nshards; i++) {
+        WW_CONSTRUCT(&shards[i].lock, ww_mutex_t);
+        WW_CONSTRUCT(&shards[i].table, ww_hash_table_t);
+        ww_hash_table_init(&shards[i].table, 32);
+        WW_CONSTRUCT(&shards[i].lru, ww_list_t);
+        shards[i].size = 0;
+        shards[i].limit = ww_dstore_globals.cache_limit / nshards;
+    }
+    return WW_SUCCESS;
+}
+
+void ww_dstore_base_cache_finalize(void)
+{
+    int i;
+
+    if (NULL == shards) {
+        return;
+    }
+    for (i=0; i < nshards; i++) {
+        WW_LIST_DESTRUCT(&shards[i].lru);
+        WW_DESTRUCT(&shards[i].table);
+        WW_DESTRUCT(&shards[i].lock);
+    }
+    free(shards);
+    shards = NULL;
+    nshards = 0;
+}
+
+ww_configuration_t* ww_dstore_base_cache_lookup(const char *name)
+{
+    ww_dstore_cache_shard_t *shard;
+    ww_dstore_base_cache_entry_t *entry = NULL;
+    ww_configuration_t *config;
+
+    if (NULL == shards || NULL == name) {
+        return NULL;
+    }
+
+    shard = get_shard(name);
+    ww_mutex_lock(&shard->lock);
+    if (NULL == (entry = find_entry(shard, name))) {
+        ww_mutex_unlock(&shard->lock);
+        ww_atomic_add_size_t(&ww_dstore_globals.cache_misses, 1);
+        return NULL;
+    }
+    /* hold the entry while we talk to the dstore */
+    WW_RETAIN(entry);
+    ww_mutex_unlock(&shard->lock);
+
+    if (!entry_is_current(entry)) {
+        ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                          "dstore:cache: dropping stale configuration %s", name);
+        ww_mutex_lock(&shard->lock);
+        if (entry == find_entry(shard, name)) {
+            /* still cached - nobody else got here first */
+            remove_entry(shard, entry);
+        }
+        ww_mutex_unlock(&shard->lock);
+        WW_RELEASE(entry);
+        ww_atomic_add_size_t(&ww_dstore_globals.cache_misses, 1);
+        return NULL;
+    }
+
+    ww_mutex_lock(&shard->lock);
+    if (entry == find_entry(shard, name)) {
+        /* move to the most-recently-used end */
+        ww_list_remove_item(&shard->lru, &entry->super);
+        ww_list_append(&shard->lru, &entry->super);
+    }
+    ww_mutex_unlock(&shard->lock);
+
+    /* the cached copy never changes once stored, so it can be
+     * copied without the shard lock */
+    config = copy_config(entry->config);
+    WW_RELEASE(entry);
+    ww_atomic_add_size_t(&ww_dstore_globals.cache_hits, 1);
+    return config;
+}
+
+void ww_dstore_base_cache_store(ww_configuration_t *config)
+{
+    ww_dstore_cache_shard_t *shard;
+    ww_dstore_base_cache_entry_t *entry, *old;
+    ww_dsmeta_t *meta;
+
+    if (NULL == shards || NULL == config || NULL == config->name) {
+        return;
+    }
+
+    entry = WW_NEW(ww_dstore_base_cache_entry_t);
+    entry->name = strdup(config->name);
+    entry->size = config_size(config);
+    /* snapshot the metadata of the dstore that supplied it */
+    if (NULL != (meta = (ww_dsmeta_t*)ww_list_get_first(&config->dstores)) &&
+        meta != (ww_dsmeta_t*)ww_list_get_end(&config->dstores)) {
+        if (NULL != meta->name) {
+            entry->dstore = strdup(meta->name);
+        }
+        if (NULL != meta->version) {
+            entry->version = strdup(meta->version);
+        }
+        if (NULL != meta->mtime) {
+            entry->mtime = strdup(meta->mtime);
+        }
+    }
+
+    shard = get_shard(entry->name);
+    if (entry->size > shard->limit) {
+        /* would never fit */
+        WW_RELEASE(entry);
+        return;
+    }
+    /* the caller still has the original to change as it pleases */
+    entry->config = copy_config(config);
+
+    ww_mutex_lock(&shard->lock);
+    if (NULL != (old = find_entry(shard, entry->name))) {
+        remove_entry(shard, old);
+    }
+    /* evict from the cold end until the new entry fits */
+    while (shard->size + entry->size > shard->limit &&
+           NULL != (old = (ww_dstore_base_cache_entry_t*)ww_list_get_first(&shard->lru)) &&
+           old != (ww_dstore_base_cache_entry_t*)ww_list_get_end(&shard->lru)) {
+        ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                          "dstore:cache: evicting configuration %s", old->name);
+        remove_entry(shard, old);
+        ww_atomic_add_size_t(&ww_dstore_globals.cache_evictions, 1);
+    }
+    ww_hash_table_set_value_ptr(&shard->table, entry->name, strlen(entry->name), entry);
+    ww_list_append(&shard->lru, &entry->super);
+    shard->size += entry->size;
+    ww_mutex_unlock(&shard->lock);
+}
+
+void ww_dstore_base_cache_invalidate(const char *name)
+{
+    ww_dstore_cache_shard_t *shard;
+    ww_dstore_base_cache_entry_t *entry;
+
+    if (NULL == shards || NULL == name) {
+        return;
+    }
+
+    shard = get_shard(name);
+    ww_mutex_lock(&shard->lock);
+    if (NULL != (entry = find_entry(shard, name))) {
+        remove_entry(shard, entry);
+    }
+    ww_mutex_unlock(&shard->lock);
+}
+
+static void centcon(ww_dstore_base_cache_entry_t *p)
+{
+    p->name = NULL;
+    p->config = NULL;
+    p->size = 0;
+    p->dstore = NULL;
+    p->version = NULL;
+    p->mtime = NULL;
+}
+static void centdes(ww_dstore_base_cache_entry_t *p)
+{
+    if (NULL != p->name) {
+        free(p->name);
+    }
+    if (NULL != p->config) {
+        WW_RELEASE(p->config);
+    }
+    if (NULL != p->dstore) {
+        free(p->dstore);
+    }
+    if (NULL != p->version) {
+        free(p->version);
+    }
+    if (NULL != p->mtime) {
+        free(p->mtime);
+    }
+}
+WW_CLASS_INSTANCE(ww_dstore_base_cache_entry_t,
+                  ww_list_item_t,
+                  centcon, centdes);
@@ -0,0 +1,371 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "src/class/ww_list.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/output.h"
+#include "src/runtime/ww_aio.h"
+
+#include "src/mca/dstore/base/base.h"
+
+/* group commit state */
+static ww_mutex_t commit_lock;
+static ww_condition_t commit_cond;
+static ww_list_t pending;
+static bool committing = false;
+
+static ww_kval_t* get_directive(ww_list_t *directives, const char *key)
+{
+    ww_kval_t *kv;
+
+    if (NULL == directives) {
+        return NULL;
+    }
+    WW_LIST_FOREACH(kv, directives, ww_kval_t) {
+        if (0 == strcmp(kv->key, key)) {
+            return kv;
+        }
+    }
+    return NULL;
+}
+
+/* write a configuration to the dstore(s) selected by the directives,
+ * flagging each dstore written in the used array */
+static ww_status_t write_config(ww_configuration_t *config,
+                                ww_list_t *directives,
+                                bool *used)
+{
+    ww_dstore_base_active_module_t *active;
+    ww_kval_t *reqd, *pref;
+    bool all;
+    ww_status_t rc, ret = WW_ERR_NOT_AVAILABLE;
+    int n;
+
+    all = (NULL != get_directive(directives, WW_ALL_DSTORES));
+    reqd = get_directive(directives, WW_REQUIRED_DSTORE);
+    pref = get_directive(directives, WW_PREFERRED_DSTORE);
+
+    /* give the preferred dstore the first shot */
+    if (!all && NULL == reqd && NULL != pref && NULL != pref->values) {
+        n = 0;
+        WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+            if (0 == strcmp(pref->values[0], active->component->base.mca_component_name) &&
+                NULL != active->module->commit) {
+                if (WW_SUCCESS == active->module->commit(config, directives)) {
+                    used[n] = true;
+                    return WW_SUCCESS;
+                }
+                break;
+            }
+            n++;
+        }
+    }
+
+    n = 0;
+    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+        if (NULL == active->module->commit ||
+            (NULL != reqd && NULL != reqd->values &&
+             0 != strcmp(reqd->values[0], active->component->base.mca_component_name))) {
+            n++;
+            continue;
+        }
+        rc = active->module->commit(config, directives);
+        if (WW_SUCCESS == rc) {
+            used[n] = true;
+            ret = WW_SUCCESS;
+            if (!all) {
+                break;
+            }
+        } else if (all) {
+            /* replication was requested - any failure fails the commit */
+            WW_ERROR_LOG(rc);
+            return rc;
+        }
+        n++;
+    }
+    return ret;
+}
+
+/* make the newly committed configuration visible to local
+ * readers - failure to publish does not fail the commit since
+ * readers fall back to the dstores */
+static void publish(ww_configuration_t *config)
+{
+    ww_status_t rc;
+
+    if (!ww_dstore_globals.shmem_publish) {
+        return;
+    }
+    if (WW_SUCCESS != (rc = ww_dstore_base_shmem_publish(config))) {
+        WW_ERROR_LOG(rc);
+    }
+}
+
+/* write every request in the group, then make them durable with
+ * a single flush per dstore that was written. Groups are committed
+ * one at a time, so this is also where the results are made visible -
+ * in the order they were committed */
+static void commit_group(ww_list_t *group)
+{
+    ww_dstore_base_commit_req_t *req, *prev;
+    ww_dstore_base_active_module_t *active;
+    bool *used;
+    bool dup;
+    size_t nactive;
+    ww_status_t rc;
+    int n;
+
+    nactive = ww_list_get_size(&ww_dstore_globals.actives);
+    used = (bool*)calloc(nactive + 1, sizeof(bool));
+    if (NULL == used) {
+        WW_LIST_FOREACH(req, group, ww_dstore_base_commit_req_t) {
+            req->status = WW_ERR_OUT_OF_RESOURCE;
+        }
+        return;
+    }
+
+    WW_LIST_FOREACH(req, group, ww_dstore_base_commit_req_t) {
+        /* the same configuration may be committed more than once
+         * within a group - only the last write matters, and since they
+         * share the object, writing it once covers all of them */
+        dup = false;
+        if (NULL == req->directives || ww_list_is_empty(req->directives)) {
+            WW_LIST_FOREACH(prev, group, ww_dstore_base_commit_req_t) {
+                if (prev == req) {
+                    break;
+                }
+                if (prev->config == req->config &&
+                    (NULL == prev->directives || ww_list_is_empty(prev->directives))) {
+                    req->status = prev->status;
+                    dup = true;
+                    break;
+                }
+            }
+        }
+        if (!dup) {
+            req->status = write_config(req->config, req->directives, used);
+        }
+    }
+
+    n = 0;
+    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+        if (used[n] && NULL != active->module->flush) {
+            if (WW_SUCCESS != (rc = active->module->flush())) {
+                /* we cannot tell whose data failed to reach storage,
+                 * so nobody in the group can be told it is durable */
+                WW_ERROR_LOG(rc);
+                WW_LIST_FOREACH(req, group, ww_dstore_base_commit_req_t) {
+                    if (WW_SUCCESS == req->status) {
+                        req->status = rc;
+                    }
+                }
+            }
+        }
+        n++;
+    }
+    free(used);
+
+    WW_LIST_FOREACH(req, group, ww_dstore_base_commit_req_t) {
+        /* a configuration committed more than once in the group is
+         * published as of its last commit */
+        dup = false;
+        for (prev = (ww_dstore_base_commit_req_t*)ww_list_get_next(&req->super);
+             prev != (ww_dstore_base_commit_req_t*)ww_list_get_end(group);
+             prev = (ww_dstore_base_commit_req_t*)ww_list_get_next(&prev->super)) {
+            if (prev->config == req->config) {
+                dup = true;
+                break;
+            }
+        }
+        if (dup) {
+            continue;
+        }
+        /* only now is any cached copy out of date - dropping it
+         * before the write would let a concurrent load cache the
+         * old contents again */
+        ww_dstore_base_cache_invalidate(req->config->name);
+        if (WW_SUCCESS == req->status) {
+            publish(req->config);
+        }
+    }
+
+    ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                      "dstore:commit: committed group of %d",
+                      (int)ww_list_get_size(group));
+}
+
+ww_status_t ww_dstore_base_commit(ww_configuration_t *config,
+                                  ww_list_t *directives)
+{
+    ww_dstore_base_commit_req_t req;
+    ww_list_t group;
+    ww_list_item_t *item;
+    ww_status_t rc;
+
+    if (!ww_dstore_globals.initialized) {
+        return WW_ERR_INIT;
+    }
+
+    WW_CONSTRUCT(&req, ww_dstore_base_commit_req_t);
+    req.config = config;
+    req.directives = directives;
+
+    if (!ww_dstore_globals.group_commit) {
+        /* a group of one - still one at a time, so that commits
+         * are published in the order they were made */
+        WW_CONSTRUCT(&group, ww_list_t);
+        ww_list_append(&group, &req.super);
+        ww_mutex_lock(&commit_lock);
+        commit_group(&group);
+        ww_mutex_unlock(&commit_lock);
+        ww_list_remove_item(&group, &req.super);
+        WW_DESTRUCT(&group);
+        rc = req.status;
+        WW_DESTRUCT(&req);
+        return rc;
+    }
+
+    ww_mutex_lock(&commit_lock);
+    ww_list_append(&pending, &req.super);
+    while (!req.done) {
+        if (committing) {
+            /* someone else is leading - they or a successor
+             * will pick up our request */
+            ww_condition_wait(&commit_cond, &commit_lock);
+            continue;
+        }
+
+        /* become the leader */
+        committing = true;
+        if (0 < ww_dstore_globals.group_commit_window) {
+            /* give concurrent committers a chance to join us */
+            ww_mutex_unlock(&commit_lock);
+            usleep(ww_dstore_globals.group_commit_window);
+            ww_mutex_lock(&commit_lock);
+        }
+        WW_CONSTRUCT(&group, ww_list_t);
+        while (NULL != (item = ww_list_remove_first(&pending))) {
+            ww_list_append(&group, item);
+        }
+        ww_mutex_unlock(&commit_lock);
+
+        commit_group(&group);
+
+        /* release everyone in the group - the requests belong to the
+         * callers, so they must be off our list before done is set */
+        ww_mutex_lock(&commit_lock);
+        while (NULL != (item = ww_list_remove_first(&group))) {
+            ((ww_dstore_base_commit_req_t*)item)->done = true;
+        }
+        WW_DESTRUCT(&group);
+        committing = false;
+        ww_condition_broadcast(&commit_cond);
+    }
+    ww_mutex_unlock(&commit_lock);
+
+    rc = req.status;
+    WW_DESTRUCT(&req);
+    return rc;
+}
+
+typedef struct {
+    ww_configuration_t *config;
+    ww_list_t *directives;
+    ww_dstore_base_commit_cbfunc_t cbfunc;
+    void *cbdata;
+} ww_dstore_base_nbcommit_t;
+
+static ww_status_t nbcommit_fn(void *arg)
+{
+    ww_dstore_base_nbcommit_t *nb = (ww_dstore_base_nbcommit_t*)arg;
+
+    return ww_dstore_base_commit(nb->config, nb->directives);
+}
+
+static void nbcommit_cbfunc(ww_status_t status, size_t nbytes, void *cbdata)
+{
+    ww_dstore_base_nbcommit_t *nb = (ww_dstore_base_nbcommit_t*)cbdata;
+
+    if (NULL != nb->cbfunc) {
+        nb->cbfunc(status, nb->cbdata);
+    }
+    WW_RELEASE(nb->config);
+    free(nb);
+}
+
+ww_status_t ww_dstore_base_commit_nb(ww_configuration_t *config,
+                                     ww_list_t *directives,
+                                     const char *name,
+                                     ww_dstore_base_commit_cbfunc_t cbfunc,
+                                     void *cbdata)
+{
+    ww_dstore_base_nbcommit_t *nb;
+    ww_status_t rc;
+
+    if (!ww_dstore_globals.initialized) {
+        return WW_ERR_INIT;
+    }
+    if (NULL == (nb = (ww_dstore_base_nbcommit_t*)malloc(sizeof(*nb)))) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    WW_RETAIN(config);
+    nb->config = config;
+    nb->directives = directives;
+    nb->cbfunc = cbfunc;
+    nb->cbdata = cbdata;
+
+    /* concurrent non-blocking commits land on different pool threads,
+     * where they are coalesced by group commit like any others */
+    if (WW_SUCCESS != (rc = ww_aio_call(nbcommit_fn, nb, name,
+                                        nbcommit_cbfunc, nb))) {
+        WW_RELEASE(config);
+        free(nb);
+    }
+    return rc;
+}
+
+void ww_dstore_base_commit_init(void)
+{
+    WW_CONSTRUCT(&commit_lock, ww_mutex_t);
+    WW_CONSTRUCT(&commit_cond, ww_condition_t);
+    WW_CONSTRUCT(&pending, ww_list_t);
+    committing = false;
+}
+
+void ww_dstore_base_commit_finalize(void)
+{
+    WW_DESTRUCT(&pending);
+    WW_DESTRUCT(&commit_cond);
+    WW_DESTRUCT(&commit_lock);
+}
+
+static void creqcon(ww_dstore_base_commit_req_t *p)
+{
+    p->config = NULL;
+    p->directives = NULL;
+    p->status = WW_SUCCESS;
+    p->done = false;
+}
+WW_CLASS_INSTANCE(ww_dstore_base_commit_req_t,
+                  ww_list_item_t,
+                  creqcon, NULL);
@@ -24,6 +24,12 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_FNMATCH_H
+#include <fnmatch.h>
+#endif
 
 #include "src/class/ww_pointer_array.h"
 #include "src/util/argv.h"
@@ -40,42 +46,154 @@ ww_configuration_t* ww_dstore_base_load(char *name, ww_list_t *directives)
         return NULL;
     }
 
+    /* directives can change which dstore or version we return,
+     * so only plain loads are served from the cache */
+    if (NULL == directives || ww_list_is_empty(directives)) {
+        /* a published copy shares its pages with every other local reader */
+        if (ww_dstore_globals.shmem_attach &&
+            NULL != (config = ww_dstore_base_shmem_attach(name))) {
+            return config;
+        }
+        if (NULL != (config = ww_dstore_base_cache_lookup(name))) {
+            return config;
+        }
+    }
+
     /* check the directives */
     WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
         if (NULL != (config = active->module->load(name, directives))) {
+            if (NULL == directives || ww_list_is_empty(directives)) {
+                ww_dstore_base_cache_store(config);
+            }
             return config;
         }
     }
     return NULL;
 }
 
-ww_status_t ww_dstore_base_commit(ww_configuration_t *config,
-                                  ww_list_t *directives)
+static ww_kval_t* get_directive(ww_list_t *directives, const char *key)
 {
-    ww_dstore_base_active_module_t *active;
-    ww_status_t rc;
+    ww_kval_t *kv;
 
-    if (!ww_dstore_globals.initialized) {
-        return WW_ERR_INIT;
+    if (NULL == directives) {
+        return NULL;
+    }
+    WW_LIST_FOREACH(kv, directives, ww_kval_t) {
+        if (0 == strcmp(kv->key, key)) {
+            return kv;
+        }
     }
+    return NULL;
+}
 
-    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+/* return the index of the key-value with the given key, or -1 */
+static int find_key(ww_building_block_t *block, const char *key)
+{
+    ww_kval_t *kv;
+    int i;
+
+    for (i=0; i < block->keyvals.size; i++) {
+        if (NULL != (kv = (ww_kval_t*)ww_pointer_array_get_item(&block->keyvals, i)) &&
+            NULL != kv->key && 0 == strcmp(kv->key, key)) {
+            return i;
+        }
     }
-    return WW_SUCCESS;
+    return -1;
+}
+
+/* check whether any of the stored values satisfies any
+ * of the search criteria */
+static bool match_values(char **values, ww_kval_t *criteria, int mode)
+{
+    int i, j;
+
+    if (NULL == criteria || NULL == criteria->values) {
+        /* just the presence of the key was requested */
+        return true;
+    }
+    if (NULL == values) {
+        return false;
+    }
+    for (i=0; NULL != values[i]; i++) {
+        for (j=0; NULL != criteria->values[j]; j++) {
+            switch (mode) {
+                case 1:
+                    if (NULL != strstr(values[i], criteria->values[j])) {
+                        return true;
+                    }
+                    break;
+                case 2:
+#ifdef HAVE_FNMATCH_H
+                    if (0 == fnmatch(criteria->values[j], values[i], 0)) {
+                        return true;
+                    }
+                    break;
+#endif
+                default:
+                    if (0 == strcmp(values[i], criteria->values[j])) {
+                        return true;
+                    }
+                    break;
+            }
+        }
+    }
+    return false;
 }
 
 ww_status_t ww_dstore_base_find(ww_configuration_t *config,
-                                char *key, char *type,
+                                char *type, char *key,
                                 ww_list_t *directives,
                                 ww_list_t *results)
 {
-    ww_dstore_base_active_module_t *active;
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    ww_kval_t *kv, *criteria;
+    ww_result_t *res;
+    int i, j, k, mode;
 
     if (!ww_dstore_globals.initialized) {
         return WW_ERR_INIT;
     }
+    if (NULL == config || NULL == results) {
+        return WW_ERR_BAD_PARAM;
+    }
 
-    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+    /* exact matching is the default if values are given */
+    mode = 0;
+    if (NULL == (criteria = get_directive(directives, WW_SRCH_EXACT_MATCH))) {
+        if (NULL != (criteria = get_directive(directives, WW_SRCH_PARTIAL_MATCH))) {
+            mode = 1;
+        } else if (NULL != (criteria = get_directive(directives, WW_SRCH_TEMPLATE_MATCH))) {
+            mode = 2;
+        }
+    }
+
+    for (i=0; i < config->types.size; i++) {
+        if (NULL == (typ = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, i))) {
+            continue;
+        }
+        if (NULL != type && (NULL == typ->type || 0 != strcmp(type, typ->type))) {
+            continue;
+        }
+        for (j=0; j < typ->blocks.size; j++) {
+            if (NULL == (blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, j))) {
+                continue;
+            }
+            if (NULL != key) {
+                ww_mutex_lock(&blk->mutex);
+                k = find_key(blk, key);
+                kv = (0 > k) ? NULL : (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, k);
+                if (NULL == kv || !match_values(kv->values, criteria, mode)) {
+                    ww_mutex_unlock(&blk->mutex);
+                    continue;
+                }
+                ww_mutex_unlock(&blk->mutex);
+            }
+            res = WW_NEW(ww_result_t);
+            WW_RETAIN(blk);
+            res->block = blk;
+            ww_list_append(results, &res->super);
+        }
     }
     return WW_SUCCESS;
 }
@@ -83,14 +201,64 @@ ww_status_t ww_dstore_base_find(ww_configuration_t *config,
 ww_status_t ww_dstore_base_set(ww_building_block_t *block,
                                ww_kval_t *kv, ww_list_t *directives)
 {
-    ww_dstore_base_active_module_t *active;
+    ww_kval_t *old, *new;
+    char **values = NULL;
+    int i, idx;
+    bool append, prepend;
 
     if (!ww_dstore_globals.initialized) {
         return WW_ERR_INIT;
     }
+    if (NULL == block || NULL == kv || NULL == kv->key) {
+        return WW_ERR_BAD_PARAM;
+    }
+    append = (NULL != get_directive(directives, WW_SET_APPEND_DATA));
+    prepend = (NULL != get_directive(directives, WW_SET_PREPEND_DATA));
 
-    WW_LIST_FOREACH(active, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+    ww_mutex_lock(&block->mutex);
+    idx = find_key(block, kv->key);
+    old = (0 > idx) ? NULL : (ww_kval_t*)ww_pointer_array_get_item(&block->keyvals, idx);
+
+    if (NULL == old && NULL != get_directive(directives, WW_SET_UPDATE_ONLY)) {
+        ww_mutex_unlock(&block->mutex);
+        return WW_ERR_NOT_FOUND;
+    }
+    if (NULL != old && NULL != get_directive(directives, WW_SET_OVERWRITE_ERROR) &&
+        !append && !prepend) {
+        ww_mutex_unlock(&block->mutex);
+        return WW_EXISTS;
+    }
+
+    /* always install a fresh copy rather than editing the old one in
+     * place - the old values may be shared with other holders of the
+     * configuration (e.g., one attached from shared memory) */
+    if (NULL != old && NULL != old->values && append) {
+        for (i=0; NULL != old->values[i]; i++) {
+            ww_argv_append_nosize(&values, old->values[i]);
+        }
+    }
+    if (NULL != kv->values) {
+        for (i=0; NULL != kv->values[i]; i++) {
+            ww_argv_append_nosize(&values, kv->values[i]);
+        }
+    }
+    if (NULL != old && NULL != old->values && prepend && !append) {
+        for (i=0; NULL != old->values[i]; i++) {
+            ww_argv_append_nosize(&values, old->values[i]);
+        }
+    }
+    new = WW_NEW(ww_kval_t);
+    new->key = strdup(kv->key);
+    new->values = values;
+
+    if (NULL == old) {
+        ww_pointer_array_add(&block->keyvals, new);
+        block->nkvals++;
+    } else {
+        ww_pointer_array_set_item(&block->keyvals, idx, new);
+        WW_RELEASE(old);
     }
+    ww_mutex_unlock(&block->mutex);
     return WW_SUCCESS;
 }
 
@@ -17,6 +17,7 @@
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
+#include <limits.h>
 
 #include "src/mca/base/mca_base_var.h"
 #include "src/class/ww_list.h"
@@ -42,6 +43,84 @@ ww_dstore_API_t ww_dstore = {
     .compare = ww_dstore_base_compare
 };
 
+static int ww_dstore_register(mca_base_register_flag_t flags)
+{
+    ww_dstore_globals.cache_limit = 16 * 1024 * 1024;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "cache_size",
+                                           "Maximum number of bytes of loaded configurations to retain "
+                                           "in the configuration cache (0 disables the cache)",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.cache_limit);
+
+    ww_dstore_globals.cache_shards = 8;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "cache_shards",
+                                           "Number of independently locked shards in the configuration cache",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.cache_shards);
+
+    /* statistics - these are not settable, but reflect the current
+     * counts whenever they are read */
+    ww_dstore_globals.cache_hits = 0;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "cache_hits",
+                                           "Number of loads satisfied from the configuration cache",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0,
+                                           MCA_BASE_VAR_FLAG_DEFAULT_ONLY,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.cache_hits);
+
+    ww_dstore_globals.cache_misses = 0;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "cache_misses",
+                                           "Number of loads that had to be passed to a dstore component",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0,
+                                           MCA_BASE_VAR_FLAG_DEFAULT_ONLY,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.cache_misses);
+
+    ww_dstore_globals.cache_evictions = 0;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "cache_evictions",
+                                           "Number of configurations evicted from the cache to stay within its size",
+                                           MCA_BASE_VAR_TYPE_SIZE_T, NULL, 0,
+                                           MCA_BASE_VAR_FLAG_DEFAULT_ONLY,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.cache_evictions);
+
+    ww_dstore_globals.group_commit = true;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "group_commit",
+                                           "Coalesce concurrent commits into a single durable write",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.group_commit);
+
+    ww_dstore_globals.group_commit_window = 0;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "group_commit_window",
+                                           "Time (in microseconds) to wait for additional commits to join "
+                                           "a group before writing it (0 only coalesces commits that arrive "
+                                           "while a prior group is being written)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.group_commit_window);
+
+    ww_dstore_globals.shmem_publish = false;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "shmem_publish",
+                                           "Publish each committed configuration to shared memory "
+                                           "so that local readers can attach to it",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.shmem_publish);
+
+    ww_dstore_globals.shmem_attach = false;
+    (void) mca_base_framework_var_register(&ww_dstore_base_framework, "shmem_attach",
+                                           "Load configurations from shared memory when a published "
+                                           "copy is available, falling back to the dstores otherwise",
+                                           MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_dstore_globals.shmem_attach);
+
+    return WW_SUCCESS;
+}
+
 static ww_status_t ww_dstore_close(void)
 {
     ww_dstore_base_active_module_t *active;
@@ -58,6 +137,10 @@ static ww_status_t ww_dstore_close(void)
     }
     WW_LIST_DESTRUCT(&ww_dstore_globals.actives);
 
+    ww_dstore_base_cache_finalize();
+    ww_dstore_base_shmem_finalize();
+    ww_dstore_base_commit_finalize();
+
     return WW_SUCCESS;
 }
 
@@ -66,11 +149,13 @@ static ww_status_t ww_dstore_open(mca_base_open_flag_t flags)
   /* initialize globals */
   ww_dstore_globals.initialized = true;
   WW_CONSTRUCT(&ww_dstore_globals.actives, ww_list_t);
-  return WW_SUCCESS;
+  ww_dstore_base_commit_init();
+  ww_dstore_base_shmem_init();
+  return ww_dstore_base_cache_init();
 }
 
 MCA_BASE_FRAMEWORK_DECLARE(ww, dstore, "Warewulf Datastore Operations",
-                           NULL, ww_dstore_open, ww_dstore_close,
+                           ww_dstore_register, ww_dstore_open, ww_dstore_close,
                            mca_dstore_base_static_components, 0);
 
 /**
@@ -94,6 +179,146 @@ WW_CLASS_INSTANCE(ww_kval_t,
                   ww_list_item_t,
                   kvcon, kvdes);
 
+static void dsmcon(ww_dsmeta_t *p)
+{
+    p->name = NULL;
+    p->version = NULL;
+    p->atime = NULL;
+    p->mtime = NULL;
+    p->ctime = NULL;
+}
+static void dsmdes(ww_dsmeta_t *p)
+{
+    if (NULL != p->name) {
+        free(p->name);
+    }
+    if (NULL != p->version) {
+        free(p->version);
+    }
+    if (NULL != p->atime) {
+        free(p->atime);
+    }
+    if (NULL != p->mtime) {
+        free(p->mtime);
+    }
+    if (NULL != p->ctime) {
+        free(p->ctime);
+    }
+}
+WW_CLASS_INSTANCE(ww_dsmeta_t,
+                  ww_list_item_t,
+                  dsmcon, dsmdes);
+
+static void tpcon(ww_type_object_t *p)
+{
+    p->type = NULL;
+    WW_CONSTRUCT(&p->blocks, ww_pointer_array_t);
+    ww_pointer_array_init(&p->blocks, 8, INT_MAX, 8);
+    p->nblocks = 0;
+}
+static void tpdes(ww_type_object_t *p)
+{
+    ww_building_block_t *blk;
+    int i;
+
+    if (NULL != p->type) {
+        free(p->type);
+    }
+    for (i=0; i < p->blocks.size; i++) {
+        if (NULL != (blk = (ww_building_block_t*)ww_pointer_array_get_item(&p->blocks, i))) {
+            WW_RELEASE(blk);
+        }
+    }
+    WW_DESTRUCT(&p->blocks);
+}
+WW_CLASS_INSTANCE(ww_type_object_t,
+                  ww_object_t,
+                  tpcon, tpdes);
+
+static void bbcon(ww_building_block_t *p)
+{
+    WW_CONSTRUCT(&p->mutex, ww_mutex_t);
+    WW_CONSTRUCT(&p->cond, ww_condition_t);
+    p->uuid = NULL;
+    WW_CONSTRUCT(&p->keyvals, ww_pointer_array_t);
+    ww_pointer_array_init(&p->keyvals, 8, INT_MAX, 8);
+    p->nkvals = 0;
+}
+static void bbdes(ww_building_block_t *p)
+{
+    ww_kval_t *kv;
+    int i;
+
+    WW_DESTRUCT(&p->mutex);
+    WW_DESTRUCT(&p->cond);
+    if (NULL != p->uuid) {
+        free(p->uuid);
+    }
+    for (i=0; i < p->keyvals.size; i++) {
+        if (NULL != (kv = (ww_kval_t*)ww_pointer_array_get_item(&p->keyvals, i))) {
+            WW_RELEASE(kv);
+        }
+    }
+    WW_DESTRUCT(&p->keyvals);
+}
+WW_CLASS_INSTANCE(ww_building_block_t,
+                  ww_object_t,
+                  bbcon, bbdes);
+
+static void cfgcon(ww_configuration_t *p)
+{
+    p->name = NULL;
+    p->modified = false;
+    WW_CONSTRUCT(&p->dstores, ww_list_t);
+    memset(&p->ww_metadata, 0, sizeof(ww_metadata_t));
+    WW_CONSTRUCT(&p->attributes, ww_list_t);
+    WW_CONSTRUCT(&p->types, ww_pointer_array_t);
+    ww_pointer_array_init(&p->types, 2, INT_MAX, 2);
+}
+static void cfgdes(ww_configuration_t *p)
+{
+    ww_type_object_t *typ;
+    int i;
+
+    if (NULL != p->name) {
+        free(p->name);
+    }
+    WW_LIST_DESTRUCT(&p->dstores);
+    if (NULL != p->ww_metadata.atime) {
+        free(p->ww_metadata.atime);
+    }
+    if (NULL != p->ww_metadata.mtime) {
+        free(p->ww_metadata.mtime);
+    }
+    if (NULL != p->ww_metadata.ctime) {
+        free(p->ww_metadata.ctime);
+    }
+    WW_LIST_DESTRUCT(&p->attributes);
+    for (i=0; i < p->types.size; i++) {
+        if (NULL != (typ = (ww_type_object_t*)ww_pointer_array_get_item(&p->types, i))) {
+            WW_RELEASE(typ);
+        }
+    }
+    WW_DESTRUCT(&p->types);
+}
+WW_CLASS_INSTANCE(ww_configuration_t,
+                  ww_object_t,
+                  cfgcon, cfgdes);
+
+static void rescon(ww_result_t *p)
+{
+    p->block = NULL;
+}
+static void resdes(ww_result_t *p)
+{
+    if (NULL != p->block) {
+        WW_RELEASE(p->block);
+    }
+}
+WW_CLASS_INSTANCE(ww_result_t,
+                  ww_list_item_t,
+                  rescon, resdes);
+
 WW_CLASS_INSTANCE(ww_dstore_base_active_module_t,
                   ww_list_item_t,
                   NULL, NULL);
@@ -29,6 +29,37 @@
 
 static bool selected = false;
 
+ww_status_t ww_dstore_base_add_module(ww_dstore_base_component_t *component,
+                                      ww_dstore_module_t *module, int priority)
+{
+    ww_dstore_base_active_module_t *newmodule, *mod;
+    bool inserted;
+
+    if (NULL == component || NULL == module) {
+        return WW_ERR_BAD_PARAM;
+    }
+    newmodule = WW_NEW(ww_dstore_base_active_module_t);
+    newmodule->pri = priority;
+    newmodule->module = module;
+    newmodule->component = component;
+
+    /* maintain priority order */
+    inserted = false;
+    WW_LIST_FOREACH(mod, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
+        if (priority > mod->pri) {
+            ww_list_insert_pos(&ww_dstore_globals.actives,
+                                 (ww_list_item_t*)mod, &newmodule->super);
+            inserted = true;
+            break;
+        }
+    }
+    if (!inserted) {
+        /* must be lowest priority - add to end */
+        ww_list_append(&ww_dstore_globals.actives, &newmodule->super);
+    }
+    return WW_SUCCESS;
+}
+
 /* Function for selecting a prioritized list of components
  * from all those that are available. */
 int ww_dstore_base_select(void)
@@ -36,10 +67,8 @@ int ww_dstore_base_select(void)
     mca_base_component_list_item_t *cli = NULL;
     mca_base_component_t *component = NULL;
     mca_base_module_t *module = NULL;
-    ww_dstore_module_t *nmodule;
-    ww_dstore_base_active_module_t *newmodule, *mod;
+    ww_dstore_base_active_module_t *mod;
     int rc, priority;
-    bool inserted;
 
     if (selected) {
         /* ensure we don't do this twice */
@@ -77,27 +106,8 @@ int ww_dstore_base_select(void)
         }
 
         /* If we got a module, keep it */
-        nmodule = (ww_dstore_module_t*) module;
-        /* add to the list of selected modules */
-        newmodule = WW_NEW(ww_dstore_base_active_module_t);
-        newmodule->pri = priority;
-        newmodule->module = nmodule;
-        newmodule->component = (ww_dstore_base_component_t*)cli->cli_component;
-
-        /* maintain priority order */
-        inserted = false;
-        WW_LIST_FOREACH(mod, &ww_dstore_globals.actives, ww_dstore_base_active_module_t) {
-            if (priority > mod->pri) {
-                ww_list_insert_pos(&ww_dstore_globals.actives,
-                                     (ww_list_item_t*)mod, &newmodule->super);
-                inserted = true;
-                break;
-            }
-        }
-        if (!inserted) {
-            /* must be lowest priority - add to end */
-            ww_list_append(&ww_dstore_globals.actives, &newmodule->super);
-        }
+        ww_dstore_base_add_module((ww_dstore_base_component_t*)cli->cli_component,
+                                  (ww_dstore_module_t*)module, priority);
     }
 
     if (4 < ww_output_get_verbosity(ww_dstore_base_framework.framework_output)) {
@@ -0,0 +1,992 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Shared-memory publication of committed configurations.
+ *
+ * Each published configuration is described by a small control
+ * segment that is rewritten in place under a seqlock, and which names
+ * the current data segment. Data segments are written once per
+ * generation and never modified afterwards, so readers can map them
+ * read-only and point directly into them - every process attached to
+ * the same generation shares the same physical pages. When a new
+ * generation is published, the old data segment is unlinked; readers
+ * that still have it mapped keep it alive until they notice the new
+ * generation and remap, and the kernel frees it when the last of
+ * them lets go.
+ *
+ * Any number of processes may publish under the same name. Each takes
+ * a generation number of its own from the control segment, writes a
+ * data segment that nobody else can have created, and then switches
+ * the control segment over under the seqlock - unless a later
+ * generation got there first, in which case its own is discarded.
+ * The seqlock records the pid of the process holding it, so that a
+ * publisher that dies mid-update can be recovered from.
+ *
+ * All references inside a data segment are byte offsets from the
+ * start of the segment, so the layout does not depend on where it
+ * is mapped. The configuration a reader gets has every string - names,
+ * keys and values - pointing straight into the segment; only the
+ * object skeleton is allocated. Each segment is mapped once per
+ * generation per process, but every caller gets a skeleton of its
+ * own, so one caller setting values never changes what another sees.
+ *
+ * The segments live in a directory anybody can write to, under names
+ * anybody can guess, so nothing is used unless it belongs to our
+ * effective uid and nobody else can write it - and every offset in a
+ * data segment is checked against its size before it is followed.
+ * Somebody who takes a name first can still keep us from publishing
+ * under it; readers then fall back to the dstore.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "src/class/ww_hash_table.h"
+#include "src/sys/atomic.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/output.h"
+
+#include "src/mca/dstore/base/base.h"
+
+#define WW_DSTORE_SHMEM_MAGIC   0x57574453      // "WWDS"
+#define WW_DSTORE_SHMEM_LAYOUT  2
+#define WW_DSTORE_SHMEM_NAMELEN 256
+/* how many times to look at a seqlock held by somebody else, 10us
+ * apart, before concluding that its holder is gone */
+#define WW_DSTORE_SHMEM_SPINS   100000
+
+/* control segment - rewritten in place for each generation */
+typedef struct {
+    volatile uint32_t magic;
+    uint32_t layout;
+    volatile int64_t seq;               // odd while an update is in progress
+    volatile int64_t writer;            // pid of the process holding seq odd
+    volatile int64_t reserved;          // last generation number handed out
+    int64_t generation;
+    uint64_t size;                      // size of the current data segment
+    char data[WW_DSTORE_SHMEM_NAMELEN]; // name of the current data segment
+} ww_dstore_shmem_ctl_t;
+
+/* data segment contents - all offsets are relative to the
+ * start of the segment */
+typedef struct {
+    uint32_t magic;
+    uint32_t ntypes;
+    uint64_t name;
+    uint64_t types;
+} ww_dstore_shmem_hdr_t;
+
+typedef struct {
+    uint64_t name;
+    uint64_t nblocks;
+    uint64_t blocks;
+} ww_dstore_shmem_type_t;
+
+typedef struct {
+    uint64_t uuid;
+    uint64_t nkvals;
+    uint64_t kvals;
+} ww_dstore_shmem_block_t;
+
+typedef struct {
+    uint64_t key;
+    uint64_t nvalues;
+    uint64_t values;                    // array of nvalues string offsets
+} ww_dstore_shmem_kval_t;
+
+/* a mapped data segment - retained by every configuration built on it */
+typedef struct {
+    ww_object_t super;
+    void *base;
+    size_t size;
+    uint64_t nptrs;                     // value pointers a configuration built on it needs
+} ww_dstore_shmem_seg_t;
+static void segcon(ww_dstore_shmem_seg_t *p)
+{
+    p->base = NULL;
+    p->size = 0;
+    p->nptrs = 0;
+}
+static void segdes(ww_dstore_shmem_seg_t *p)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (NULL != p->base) {
+        munmap(p->base, p->size);
+    }
+#endif
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_seg_t,
+                         ww_object_t,
+                         segcon, segdes);
+
+/* key-values whose strings live in a data segment, and whose values
+ * array is a slice of the configuration's */
+typedef struct {
+    ww_kval_t super;
+} ww_dstore_shmem_kv_t;
+static void shkvdes(ww_dstore_shmem_kv_t *p)
+{
+    /* keep the parent destructor away from the shared strings */
+    p->super.key = NULL;
+    p->super.values = NULL;
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_kv_t,
+                         ww_kval_t,
+                         NULL, shkvdes);
+
+/* type and block objects whose names live in a data segment */
+typedef struct {
+    ww_type_object_t super;
+} ww_dstore_shmem_typeobj_t;
+static void shtypdes(ww_dstore_shmem_typeobj_t *p)
+{
+    p->super.type = NULL;
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_typeobj_t,
+                         ww_type_object_t,
+                         NULL, shtypdes);
+
+typedef struct {
+    ww_building_block_t super;
+} ww_dstore_shmem_blockobj_t;
+static void shblkdes(ww_dstore_shmem_blockobj_t *p)
+{
+    p->super.uuid = NULL;
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_blockobj_t,
+                         ww_building_block_t,
+                         NULL, shblkdes);
+
+/* a configuration built on a data segment */
+typedef struct {
+    ww_configuration_t super;
+    ww_dstore_shmem_seg_t *seg;
+    char **values;                      // the values arrays of all the kvals
+} ww_dstore_shmem_config_t;
+static void shcfgcon(ww_dstore_shmem_config_t *p)
+{
+    p->seg = NULL;
+    p->values = NULL;
+}
+static void shcfgdes(ww_dstore_shmem_config_t *p)
+{
+    /* the objects only reference the segment and the values, they
+     * never touch them on destruction, so it is safe to drop them
+     * first */
+    p->super.name = NULL;
+    if (NULL != p->values) {
+        free(p->values);
+    }
+    if (NULL != p->seg) {
+        WW_RELEASE(p->seg);
+    }
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_config_t,
+                         ww_configuration_t,
+                         shcfgcon, shcfgdes);
+
+/* per-process tracking of attached configurations */
+typedef struct {
+    ww_object_t super;
+    char *name;
+    ww_dstore_shmem_ctl_t *ctl;         // read-only for readers, read-write for the publisher
+    int64_t generation;
+    ww_dstore_shmem_seg_t *seg;         // reader: the current generation, checked and mapped
+} ww_dstore_shmem_tracker_t;
+static void trkcon(ww_dstore_shmem_tracker_t *p)
+{
+    p->name = NULL;
+    p->ctl = NULL;
+    p->generation = -1;
+    p->seg = NULL;
+}
+static void trkdes(ww_dstore_shmem_tracker_t *p)
+{
+    if (NULL != p->name) {
+        free(p->name);
+    }
+#ifdef HAVE_SYS_MMAN_H
+    if (NULL != p->ctl) {
+        munmap(p->ctl, sizeof(ww_dstore_shmem_ctl_t));
+    }
+#endif
+    if (NULL != p->seg) {
+        WW_RELEASE(p->seg);
+    }
+}
+static WW_CLASS_INSTANCE(ww_dstore_shmem_tracker_t,
+                         ww_object_t,
+                         trkcon, trkdes);
+
+static ww_mutex_t shmem_lock;
+static ww_hash_table_t readers;
+static ww_hash_table_t publishers;
+static bool shmem_inited = false;
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* shm names cannot contain a slash beyond the leading one */
+static char* ctl_name(const char *name)
+{
+    char *nm, *p;
+
+    if (0 > asprintf(&nm, "/ww.%lu.%s", (unsigned long)geteuid(), name)) {
+        return NULL;
+    }
+    for (p=nm+1; '\0' != *p; p++) {
+        if ('/' == *p) {
+            *p = '_';
+        }
+    }
+    return nm;
+}
+
+/* something nobody else can guess, so that nobody can take the name
+ * of a data segment before we create it */
+static uint64_t name_tag(void)
+{
+    uint64_t tag = 0;
+    int fd;
+
+    if (0 <= (fd = open("/dev/urandom", O_RDONLY))) {
+        if (sizeof(tag) != read(fd, &tag, sizeof(tag))) {
+            tag = 0;
+        }
+        close(fd);
+    }
+    if (0 == tag) {
+        tag = ((uint64_t)getpid() << 32) ^ (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)&tag;
+    }
+    return tag;
+}
+
+/* lay out the configuration starting at offset 0. If base is NULL,
+ * nothing is written and only the required size is computed */
+static size_t layout(ww_configuration_t *config, char *base)
+{
+    ww_dstore_shmem_hdr_t *hdr = NULL;
+    ww_dstore_shmem_type_t *st = NULL;
+    ww_dstore_shmem_block_t *sb = NULL;
+    ww_dstore_shmem_kval_t *sk = NULL;
+    uint64_t *sv;
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    ww_kval_t *kv;
+    size_t off, len;
+    uint64_t ntypes, nblocks, nkvals, nvals;
+    int i, j, k, n;
+
+#define WW_SHMEM_ALIGN(o)   (((o) + 7) & ~((size_t)7))
+#define WW_SHMEM_STRING(dst, str)                               \
+    do {                                                        \
+        len = strlen((str)) + 1;                                \
+        if (NULL != base) {                                     \
+            memcpy(base + off, (str), len);                     \
+            (dst) = off;                                        \
+        }                                                       \
+        off += len;                                             \
+    } while (0)
+
+    off = sizeof(ww_dstore_shmem_hdr_t);
+    ntypes = 0;
+    for (i=0; i < config->types.size; i++) {
+        if (NULL != ww_pointer_array_get_item(&config->types, i)) {
+            ntypes++;
+        }
+    }
+    if (NULL != base) {
+        hdr = (ww_dstore_shmem_hdr_t*)base;
+        hdr->magic = WW_DSTORE_SHMEM_MAGIC;
+        hdr->ntypes = ntypes;
+        hdr->types = off;
+        st = (ww_dstore_shmem_type_t*)(base + off);
+    }
+    off += ntypes * sizeof(ww_dstore_shmem_type_t);
+    if (NULL != base) {
+        hdr->name = 0;
+    }
+    if (NULL != config->name) {
+        WW_SHMEM_STRING(hdr->name, config->name);
+    }
+
+    for (i=0; i < config->types.size; i++) {
+        if (NULL == (typ = (ww_type_object_t*)ww_pointer_array_get_item(&config->types, i))) {
+            continue;
+        }
+        nblocks = 0;
+        for (j=0; j < typ->blocks.size; j++) {
+            if (NULL != ww_pointer_array_get_item(&typ->blocks, j)) {
+                nblocks++;
+            }
+        }
+        off = WW_SHMEM_ALIGN(off);
+        if (NULL != base) {
+            st->name = 0;
+            st->nblocks = nblocks;
+            st->blocks = off;
+            sb = (ww_dstore_shmem_block_t*)(base + off);
+        }
+        off += nblocks * sizeof(ww_dstore_shmem_block_t);
+        if (NULL != typ->type) {
+            WW_SHMEM_STRING(st->name, typ->type);
+        }
+
+        for (j=0; j < typ->blocks.size; j++) {
+            if (NULL == (blk = (ww_building_block_t*)ww_pointer_array_get_item(&typ->blocks, j))) {
+                continue;
+            }
+            nkvals = 0;
+            for (k=0; k < blk->keyvals.size; k++) {
+                if (NULL != ww_pointer_array_get_item(&blk->keyvals, k)) {
+                    nkvals++;
+                }
+            }
+            off = WW_SHMEM_ALIGN(off);
+            if (NULL != base) {
+                sb->uuid = 0;
+                sb->nkvals = nkvals;
+                sb->kvals = off;
+                sk = (ww_dstore_shmem_kval_t*)(base + off);
+            }
+            off += nkvals * sizeof(ww_dstore_shmem_kval_t);
+            if (NULL != blk->uuid) {
+                WW_SHMEM_STRING(sb->uuid, blk->uuid);
+            }
+
+            for (k=0; k < blk->keyvals.size; k++) {
+                if (NULL == (kv = (ww_kval_t*)ww_pointer_array_get_item(&blk->keyvals, k))) {
+                    continue;
+                }
+                nvals = 0;
+                if (NULL != kv->values) {
+                    while (NULL != kv->values[nvals]) {
+                        nvals++;
+                    }
+                }
+                off = WW_SHMEM_ALIGN(off);
+                sv = NULL;
+                if (NULL != base) {
+                    sk->key = 0;
+                    sk->nvalues = nvals;
+                    sk->values = off;
+                    sv = (uint64_t*)(base + off);
+                }
+                off += nvals * sizeof(uint64_t);
+                if (NULL != kv->key) {
+                    WW_SHMEM_STRING(sk->key, kv->key);
+                }
+                for (n=0; n < (int)nvals; n++) {
+                    WW_SHMEM_STRING(sv[n], kv->values[n]);
+                }
+                if (NULL != base) {
+                    sk++;
+                }
+            }
+            if (NULL != base) {
+                sb++;
+            }
+        }
+        if (NULL != base) {
+            st++;
+        }
+    }
+#undef WW_SHMEM_STRING
+#undef WW_SHMEM_ALIGN
+
+    return off;
+}
+
+typedef enum {
+    WW_SHMEM_CREATE,        // create - fails if it already exists
+    WW_SHMEM_WRITE,         // open an existing segment read-write
+    WW_SHMEM_READ           // open an existing segment read-only
+} ww_dstore_shmem_mode_t;
+
+static void* map_segment(const char *name, size_t size, ww_dstore_shmem_mode_t mode)
+{
+    struct stat buf;
+    void *base;
+    int fd, flags;
+
+    switch (mode) {
+    case WW_SHMEM_CREATE:
+        flags = O_RDWR | O_CREAT | O_EXCL;
+        break;
+    case WW_SHMEM_WRITE:
+        flags = O_RDWR;
+        break;
+    default:
+        flags = O_RDONLY;
+        break;
+    }
+    /* only our own processes have any business with them */
+    if (0 > (fd = shm_open(name, flags, 0600))) {
+        return NULL;
+    }
+    if (WW_SHMEM_CREATE == mode) {
+        if (0 != ftruncate(fd, size)) {
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        }
+    } else {
+        if (0 != fstat(fd, &buf)) {
+            close(fd);
+            return NULL;
+        }
+        if (buf.st_uid != geteuid() || 0 != (buf.st_mode & 077)) {
+            /* somebody else put it there - never trust it */
+            ww_output_verbose(2, ww_dstore_base_framework.framework_output,
+                              "dstore:shmem: ignoring %s, which is not ours alone", name);
+            close(fd);
+            errno = EACCES;
+            return NULL;
+        }
+        if ((size_t)buf.st_size < size) {
+            /* not (yet) what we expect - touching it would fault */
+            close(fd);
+            return NULL;
+        }
+    }
+    base = mmap(NULL, size, (WW_SHMEM_READ == mode) ? PROT_READ : (PROT_READ | PROT_WRITE),
+                MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base) {
+        if (WW_SHMEM_CREATE == mode) {
+            shm_unlink(name);
+        }
+        return NULL;
+    }
+    return base;
+}
+
+/* a string must start inside the segment and end before it does -
+ * an offset of zero means there is none */
+static bool check_string(ww_dstore_shmem_seg_t *seg, uint64_t off)
+{
+    if (0 == off) {
+        return true;
+    }
+    return (off < seg->size &&
+            NULL != memchr((char*)seg->base + off, '\0', seg->size - off));
+}
+
+/* an array of count records of the given size must be aligned and
+ * lie entirely inside the segment */
+static bool check_array(ww_dstore_shmem_seg_t *seg, uint64_t off,
+                        uint64_t count, size_t size)
+{
+    if (0 != (off & 7) || off > seg->size) {
+        return false;
+    }
+    return (count <= (seg->size - off) / size);
+}
+
+/* check every offset and count in a newly mapped segment before
+ * anything is built on it, and count the value pointers that a
+ * configuration built on it needs. Data segments are never modified
+ * once written, so this only has to be done once per mapping */
+static bool check_segment(ww_dstore_shmem_seg_t *seg)
+{
+    char *base = (char*)seg->base;
+    ww_dstore_shmem_hdr_t *hdr = (ww_dstore_shmem_hdr_t*)base;
+    ww_dstore_shmem_type_t *st;
+    ww_dstore_shmem_block_t *sb;
+    ww_dstore_shmem_kval_t *sk;
+    uint64_t *sv;
+    uint64_t i, j, k, n, nptrs;
+
+    if (seg->size < sizeof(ww_dstore_shmem_hdr_t) || WW_DSTORE_SHMEM_MAGIC != hdr->magic ||
+        !check_string(seg, hdr->name) ||
+        !check_array(seg, hdr->types, hdr->ntypes, sizeof(ww_dstore_shmem_type_t))) {
+        return false;
+    }
+    nptrs = 0;
+    st = (ww_dstore_shmem_type_t*)(base + hdr->types);
+    for (i=0; i < hdr->ntypes; i++, st++) {
+        if (!check_string(seg, st->name) ||
+            !check_array(seg, st->blocks, st->nblocks, sizeof(ww_dstore_shmem_block_t))) {
+            return false;
+        }
+        sb = (ww_dstore_shmem_block_t*)(base + st->blocks);
+        for (j=0; j < st->nblocks; j++, sb++) {
+            if (!check_string(seg, sb->uuid) ||
+                !check_array(seg, sb->kvals, sb->nkvals, sizeof(ww_dstore_shmem_kval_t))) {
+                return false;
+            }
+            sk = (ww_dstore_shmem_kval_t*)(base + sb->kvals);
+            for (k=0; k < sb->nkvals; k++, sk++) {
+                if (!check_string(seg, sk->key) ||
+                    !check_array(seg, sk->values, sk->nvalues, sizeof(uint64_t))) {
+                    return false;
+                }
+                sv = (uint64_t*)(base + sk->values);
+                for (n=0; n < sk->nvalues; n++) {
+                    if (0 == sv[n] || !check_string(seg, sv[n])) {
+                        return false;
+                    }
+                }
+                if (SIZE_MAX / sizeof(char*) - nptrs <= sk->nvalues) {
+                    return false;
+                }
+                nptrs += sk->nvalues + 1;
+            }
+        }
+    }
+    seg->nptrs = nptrs;
+    return true;
+}
+
+/* build a configuration whose strings point into a checked segment */
+static ww_dstore_shmem_config_t* build_config(ww_dstore_shmem_seg_t *seg)
+{
+    char *base = (char*)seg->base;
+    ww_dstore_shmem_hdr_t *hdr = (ww_dstore_shmem_hdr_t*)base;
+    ww_dstore_shmem_type_t *st;
+    ww_dstore_shmem_block_t *sb;
+    ww_dstore_shmem_kval_t *sk;
+    uint64_t *sv;
+    ww_dstore_shmem_config_t *config;
+    ww_type_object_t *typ;
+    ww_building_block_t *blk;
+    ww_dstore_shmem_kv_t *kv;
+    char **vp;
+    uint64_t i, j, k, n;
+
+    config = WW_NEW(ww_dstore_shmem_config_t);
+    config->seg = seg;
+    WW_RETAIN(seg);
+    /* the values arrays are the only thing the segment cannot hold
+     * for us, as they are arrays of pointers - one array holds all
+     * of them */
+    if (0 < seg->nptrs &&
+        NULL == (config->values = (char**)malloc(seg->nptrs * sizeof(char*)))) {
+        WW_RELEASE(config);
+        return NULL;
+    }
+    vp = config->values;
+    if (0 != hdr->name) {
+        config->super.name = base + hdr->name;
+    }
+
+    st = (ww_dstore_shmem_type_t*)(base + hdr->types);
+    for (i=0; i < hdr->ntypes; i++, st++) {
+        typ = (ww_type_object_t*)WW_NEW(ww_dstore_shmem_typeobj_t);
+        if (0 != st->name) {
+            typ->type = base + st->name;
+        }
+        sb = (ww_dstore_shmem_block_t*)(base + st->blocks);
+        for (j=0; j < st->nblocks; j++, sb++) {
+            blk = (ww_building_block_t*)WW_NEW(ww_dstore_shmem_blockobj_t);
+            if (0 != sb->uuid) {
+                blk->uuid = base + sb->uuid;
+            }
+            sk = (ww_dstore_shmem_kval_t*)(base + sb->kvals);
+            for (k=0; k < sb->nkvals; k++, sk++) {
+                kv = WW_NEW(ww_dstore_shmem_kv_t);
+                if (0 != sk->key) {
+                    kv->super.key = base + sk->key;
+                }
+                kv->super.values = vp;
+                sv = (uint64_t*)(base + sk->values);
+                for (n=0; n < sk->nvalues; n++) {
+                    *vp++ = base + sv[n];
+                }
+                *vp++ = NULL;
+                ww_pointer_array_add(&blk->keyvals, kv);
+                blk->nkvals++;
+            }
+            ww_pointer_array_add(&typ->blocks, blk);
+            typ->nblocks++;
+        }
+        ww_pointer_array_add(&config->super.types, typ);
+    }
+    return config;
+}
+
+static void shmem_pause(void)
+{
+    struct timespec ts = {0, 10000};
+
+    nanosleep(&ts, NULL);
+}
+
+/* read a consistent snapshot of the control segment. Returns false
+ * if a publisher has held it for too long - it may have died, and
+ * only a publisher can recover it */
+static bool read_ctl(ww_dstore_shmem_ctl_t *ctl, int64_t *generation,
+                     uint64_t *size, char *data)
+{
+    int64_t s1, s2;
+    int spins = 0;
+
+    do {
+        while ((s1 = ctl->seq) & 1) {
+            /* publisher is mid-update */
+            if (WW_DSTORE_SHMEM_SPINS < ++spins) {
+                return false;
+            }
+            shmem_pause();
+        }
+        ww_atomic_rmb();
+        *generation = ctl->generation;
+        *size = ctl->size;
+        memcpy(data, ctl->data, WW_DSTORE_SHMEM_NAMELEN);
+        ww_atomic_rmb();
+        s2 = ctl->seq;
+    } while (s1 != s2);
+    data[WW_DSTORE_SHMEM_NAMELEN-1] = '\0';
+    return true;
+}
+
+/* take the seqlock for writing, across processes. If its holder has
+ * died - or has held it for far longer than an update takes - take it
+ * over: the update it was making is simply replaced by ours */
+static bool lock_ctl(ww_dstore_shmem_ctl_t *ctl)
+{
+    int64_t s, held = -1, pid;
+    int spins = 0;
+
+    for (;;) {
+        s = ctl->seq;
+        if (0 == (s & 1)) {
+            if (ww_atomic_cmpset_acq_64(&ctl->seq, s, s + 1)) {
+                break;
+            }
+            continue;
+        }
+        if (s != held) {
+            /* somebody new holds it - give them their full time */
+            held = s;
+            spins = 0;
+        }
+        pid = ctl->writer;
+        if ((0 < pid && 0 != kill((pid_t)pid, 0) && ESRCH == errno) ||
+            WW_DSTORE_SHMEM_SPINS < ++spins) {
+            /* keep it odd, but move it on so that anyone else who
+             * saw the dead holder does not take it over as well */
+            if (ww_atomic_cmpset_acq_64(&ctl->seq, s, s + 2)) {
+                ww_output_verbose(2, ww_dstore_base_framework.framework_output,
+                                  "dstore:shmem: recovered control segment from publisher %ld",
+                                  (long)pid);
+                break;
+            }
+            continue;
+        }
+        shmem_pause();
+    }
+    ctl->writer = (int64_t)getpid();
+    ww_atomic_wmb();
+    return true;
+}
+
+static void unlock_ctl(ww_dstore_shmem_ctl_t *ctl)
+{
+    ctl->writer = 0;
+    ww_atomic_wmb();
+    ww_atomic_add_64(&ctl->seq, 1);
+}
+
+/* map the control segment for publishing, creating it if need be */
+static ww_dstore_shmem_ctl_t* publish_ctl(const char *cname)
+{
+    ww_dstore_shmem_ctl_t *ctl;
+    int spins;
+
+    ctl = (ww_dstore_shmem_ctl_t*)map_segment(cname, sizeof(ww_dstore_shmem_ctl_t), WW_SHMEM_CREATE);
+    if (NULL != ctl) {
+        /* ours - the kernel has zeroed it */
+        ctl->layout = WW_DSTORE_SHMEM_LAYOUT;
+        ww_atomic_wmb();
+        ctl->magic = WW_DSTORE_SHMEM_MAGIC;
+        return ctl;
+    }
+    if (EEXIST != errno) {
+        return NULL;
+    }
+
+    /* somebody else created it - wait for them to finish, which
+     * includes it growing to its full size */
+    for (spins=0; spins < WW_DSTORE_SHMEM_SPINS; spins++) {
+        ctl = (ww_dstore_shmem_ctl_t*)map_segment(cname, sizeof(ww_dstore_shmem_ctl_t), WW_SHMEM_WRITE);
+        if (NULL != ctl || EACCES == errno) {
+            /* it is not going to become ours by waiting */
+            break;
+        }
+        shmem_pause();
+    }
+    if (NULL == ctl) {
+        return NULL;
+    }
+    for (spins=0; WW_DSTORE_SHMEM_MAGIC != ctl->magic && spins < WW_DSTORE_SHMEM_SPINS; spins++) {
+        shmem_pause();
+    }
+    ww_atomic_rmb();
+    if (WW_DSTORE_SHMEM_MAGIC != ctl->magic || WW_DSTORE_SHMEM_LAYOUT != ctl->layout) {
+        /* left behind by an incompatible version */
+        ww_output_verbose(2, ww_dstore_base_framework.framework_output,
+                          "dstore:shmem: control segment %s has an unknown layout", cname);
+        munmap(ctl, sizeof(ww_dstore_shmem_ctl_t));
+        return NULL;
+    }
+    return ctl;
+}
+
+ww_status_t ww_dstore_base_shmem_publish(ww_configuration_t *config)
+{
+    ww_dstore_shmem_tracker_t *trk = NULL;
+    char *cname = NULL, *dname = NULL, prior[WW_DSTORE_SHMEM_NAMELEN];
+    void *base = NULL;
+    size_t size;
+    int64_t gen;
+    bool current;
+    int tries;
+    ww_status_t rc = WW_SUCCESS;
+
+    if (!shmem_inited || NULL == config || NULL == config->name) {
+        return WW_ERR_BAD_PARAM;
+    }
+
+    ww_mutex_lock(&shmem_lock);
+    if (NULL == (cname = ctl_name(config->name))) {
+        rc = WW_ERR_OUT_OF_RESOURCE;
+        goto done;
+    }
+    if (WW_SUCCESS != ww_hash_table_get_value_ptr(&publishers, config->name,
+                                                  strlen(config->name), (void**)&trk)) {
+        trk = WW_NEW(ww_dstore_shmem_tracker_t);
+        trk->name = strdup(config->name);
+        if (NULL == (trk->ctl = publish_ctl(cname))) {
+            rc = (EACCES == errno) ? WW_ERR_PERM : WW_ERR_OUT_OF_RESOURCE;
+            WW_RELEASE(trk);
+            goto done;
+        }
+        ww_hash_table_set_value_ptr(&publishers, trk->name, strlen(trk->name), trk);
+    }
+
+    /* write the new generation into a segment of its own. The number
+     * is ours alone and the tag cannot be guessed, so the name can
+     * only be taken by a leftover from a publisher that died before
+     * unlinking it */
+    size = layout(config, NULL);
+    for (tries=0; NULL == base && tries < 2; tries++) {
+        gen = ww_atomic_add_64(&trk->ctl->reserved, 1);
+        if (NULL != dname) {
+            free(dname);
+        }
+        if (0 > asprintf(&dname, "%s.%ld.%016llx", cname, (long)gen,
+                         (unsigned long long)name_tag())) {
+            dname = NULL;
+            rc = WW_ERR_OUT_OF_RESOURCE;
+            goto done;
+        }
+        if (WW_DSTORE_SHMEM_NAMELEN <= strlen(dname)) {
+            rc = WW_ERR_BAD_PARAM;
+            goto done;
+        }
+        if (NULL == (base = map_segment(dname, size, WW_SHMEM_CREATE)) && EEXIST == errno) {
+            shm_unlink(dname);
+        }
+    }
+    if (NULL == base) {
+        rc = WW_ERR_OUT_OF_RESOURCE;
+        goto done;
+    }
+    layout(config, (char*)base);
+    munmap(base, size);
+
+    /* switch readers over to it - unless somebody published a later
+     * generation while we were writing ours */
+    lock_ctl(trk->ctl);
+    current = (gen > trk->ctl->generation);
+    if (current) {
+        memcpy(prior, trk->ctl->data, WW_DSTORE_SHMEM_NAMELEN);
+        trk->ctl->generation = gen;
+        trk->ctl->size = size;
+        strncpy(trk->ctl->data, dname, WW_DSTORE_SHMEM_NAMELEN);
+    }
+    unlock_ctl(trk->ctl);
+
+    if (!current) {
+        shm_unlink(dname);
+        ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                          "dstore:shmem: %s generation %ld superseded before publication",
+                          config->name, (long)gen);
+        goto done;
+    }
+
+    /* the prior generation goes away once its last reader unmaps it -
+     * whichever process published it */
+    prior[WW_DSTORE_SHMEM_NAMELEN-1] = '\0';
+    if ('\0' != prior[0]) {
+        shm_unlink(prior);
+    }
+
+    ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                      "dstore:shmem: published %s generation %ld (%lu bytes)",
+                      config->name, (long)gen, (unsigned long)size);
+
+  done:
+    ww_mutex_unlock(&shmem_lock);
+    if (NULL != cname) {
+        free(cname);
+    }
+    if (NULL != dname) {
+        free(dname);
+    }
+    return rc;
+}
+
+ww_configuration_t* ww_dstore_base_shmem_attach(const char *name)
+{
+    ww_dstore_shmem_tracker_t *trk = NULL;
+    ww_dstore_shmem_seg_t *seg;
+    ww_dstore_shmem_config_t *config = NULL;
+    char *cname, data[WW_DSTORE_SHMEM_NAMELEN];
+    int64_t gen;
+    uint64_t size;
+    int tries;
+
+    if (!shmem_inited || NULL == name) {
+        return NULL;
+    }
+
+    ww_mutex_lock(&shmem_lock);
+    if (WW_SUCCESS != ww_hash_table_get_value_ptr(&readers, name, strlen(name), (void**)&trk)) {
+        if (NULL == (cname = ctl_name(name))) {
+            goto done;
+        }
+        trk = WW_NEW(ww_dstore_shmem_tracker_t);
+        trk->name = strdup(name);
+        trk->ctl = (ww_dstore_shmem_ctl_t*)map_segment(cname, sizeof(ww_dstore_shmem_ctl_t), WW_SHMEM_READ);
+        free(cname);
+        if (NULL == trk->ctl || WW_DSTORE_SHMEM_MAGIC != trk->ctl->magic ||
+            WW_DSTORE_SHMEM_LAYOUT != trk->ctl->layout) {
+            /* nothing has been published under this name */
+            WW_RELEASE(trk);
+            goto done;
+        }
+        ww_hash_table_set_value_ptr(&readers, trk->name, strlen(trk->name), trk);
+    }
+
+    /* the common case - nothing has changed since we last looked */
+    if (NULL == trk->seg || trk->ctl->generation != trk->generation ||
+        0 != (trk->ctl->seq & 1)) {
+        seg = WW_NEW(ww_dstore_shmem_seg_t);
+        for (tries=0; tries < 2; tries++) {
+            if (!read_ctl(trk->ctl, &gen, &size, data) || 0 == gen) {
+                break;
+            }
+            seg->size = size;
+            if (NULL != (seg->base = map_segment(data, size, WW_SHMEM_READ))) {
+                break;
+            }
+            /* a newer generation replaced it while we were looking */
+        }
+        if (NULL == seg->base || !check_segment(seg)) {
+            /* the caller will fall back to the dstore */
+            if (NULL != seg->base) {
+                ww_output_verbose(2, ww_dstore_base_framework.framework_output,
+                                  "dstore:shmem: %s generation %ld is corrupt",
+                                  name, (long)gen);
+            }
+            WW_RELEASE(seg);
+            goto done;
+        }
+        if (NULL != trk->seg) {
+            WW_RELEASE(trk->seg);
+        }
+        trk->seg = seg;
+        trk->generation = gen;
+
+        ww_output_verbose(5, ww_dstore_base_framework.framework_output,
+                          "dstore:shmem: attached %s generation %ld",
+                          name, (long)gen);
+    }
+
+    /* a skeleton of the caller's own on the shared segment */
+    config = build_config(trk->seg);
+
+  done:
+    ww_mutex_unlock(&shmem_lock);
+    return (ww_configuration_t*)config;
+}
+
+#else
+
+ww_status_t ww_dstore_base_shmem_publish(ww_configuration_t *config)
+{
+    return WW_ERR_NOT_SUPPORTED;
+}
+
+ww_configuration_t* ww_dstore_base_shmem_attach(const char *name)
+{
+    return NULL;
+}
+
+#endif  /* HAVE_SYS_MMAN_H */
+
+void ww_dstore_base_shmem_init(void)
+{
+    WW_CONSTRUCT(&shmem_lock, ww_mutex_t);
+    WW_CONSTRUCT(&readers, ww_hash_table_t);
+    ww_hash_table_init(&readers, 16);
+    WW_CONSTRUCT(&publishers, ww_hash_table_t);
+    ww_hash_table_init(&publishers, 16);
+    shmem_inited = true;
+}
+
+static void release_trackers(ww_hash_table_t *table)
+{
+    ww_dstore_shmem_tracker_t *trk;
+    void *key, *node;
+    size_t keylen;
+    int rc;
+
+    rc = ww_hash_table_get_first_key_ptr(table, &key, &keylen, (void**)&trk, &node);
+    while (WW_SUCCESS == rc) {
+        WW_RELEASE(trk);
+        rc = ww_hash_table_get_next_key_ptr(table, &key, &keylen, (void**)&trk, node, &node);
+    }
+    WW_DESTRUCT(table);
+}
+
+void ww_dstore_base_shmem_finalize(void)
+{
+    if (!shmem_inited) {
+        return;
+    }
+    shmem_inited = false;
+    release_trackers(&readers);
+    /* leave the last published generation in place so readers that
+     * start after we exit can still attach to it */
+    release_trackers(&publishers);
+    WW_DESTRUCT(&shmem_lock);
+}
@@ -52,6 +52,27 @@ typedef ww_configuration_t* (*ww_dstore_base_module_load_fn_t)(char *name, ww_li
 typedef ww_status_t (*ww_dstore_base_module_commit_fn_t)(ww_configuration_t *config,
                                                          ww_list_t *directives);
 
+/* Make the data from all prior commits durable. Components that
+ * provide this entry point may return from commit once the data has
+ * been written but before it has been synced to stable storage - the
+ * base will coalesce commits that arrive close together and call
+ * flush once for the whole group before releasing any of the callers.
+ * Components that do not provide it must make each commit durable
+ * before returning.
+ */
+typedef ww_status_t (*ww_dstore_base_module_flush_fn_t)(void);
+
+/* Report the dstore's current metadata for the named configuration
+ * without loading it. This is used by the base to cheaply check whether
+ * a cached copy of the configuration is still current - components
+ * that cannot answer this without a full load may leave it NULL, in
+ * which case cached copies are only invalidated by a commit.
+ *
+ * A NULL value will be returned if the configuration is not found.
+ * The caller is responsible for releasing the returned object.
+ */
+typedef ww_dsmeta_t* (*ww_dstore_base_module_stat_fn_t)(char *name);
+
 /* Search and return all ww_building_block_t from the specified type
  * in the given configuration that satisfy the specified search criteria.
  * Only one key can be provided, but the key can contain multiple values
@@ -122,11 +143,14 @@ typedef ww_value_cmp_t (*ww_dstore_base_module_cmp_fn_t)(ww_configuration_t *con
 /**
  * Structure for a DSTORE module - the individual plugins
  * really only need to provide the load and commit APIs. All
- * other support should be common across them.
+ * other support should be common across them. The stat
+ * and flush APIs are optional.
  */
 struct ww_dstore_module_t {
     ww_dstore_base_module_load_fn_t     load;
     ww_dstore_base_module_commit_fn_t   commit;
+    ww_dstore_base_module_stat_fn_t     stat;
+    ww_dstore_base_module_flush_fn_t    flush;
 };
 typedef struct ww_dstore_module_t ww_dstore_module_t;
 
@@ -144,7 +168,7 @@ typedef struct ww_dstore_API_t {
 } ww_dstore_API_t;
 
 /* a set of base functions for executing calls */
-extern ww_dstore_API_t ww_dstore;
+WW_DECLSPEC extern ww_dstore_API_t ww_dstore;
 
 /*
  * the standard component data structure
@@ -45,7 +45,7 @@ typedef struct {
     char *key;
     char **values;
 } ww_kval_t;
-WW_CLASS_DECLARATION(ww_kval_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_kval_t);
 
 /* Warewulf-maintained configuration metadata
  * NOTE: times are stored as strings since the clock of
@@ -70,7 +70,7 @@ typedef struct ww_dsmeta_t {
     char *mtime;            // last modifcation time recorded by the dstore, if available
     char *ctime;            // when this config was initially committed to this dstore
 } ww_dsmeta_t;
-WW_CLASS_DECLARATION(ww_dsmeta_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_dsmeta_t);
 
 /* define a high-level object for storing types of building
  * blocks. The configuration is assumed to be defined
@@ -84,7 +84,7 @@ typedef struct ww_type_object_t {
     ww_pointer_array_t blocks;
     size_t nblocks;
 } ww_type_object_t;
-WW_CLASS_DECLARATION(ww_type_object_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_type_object_t);
 
 /* define a middle-level object for storing the key-value
  * descriptions of a building block. For example, an object
@@ -100,7 +100,7 @@ typedef struct ww_building_block_t {
     ww_pointer_array_t keyvals;
     size_t nkvals;
 } ww_building_block_t;
-WW_CLASS_DECLARATION(ww_building_block_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_building_block_t);
 
 /* define the master object that contains the entire configuration */
 typedef struct ww_configuration_t {
@@ -112,7 +112,7 @@ typedef struct ww_configuration_t {
     ww_list_t attributes;           // list of ww_kval_t attributes describing this configuration
     ww_pointer_array_t types;       // array of ww_type_object_t
 } ww_configuration_t;
-WW_CLASS_DECLARATION(ww_configuration_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_configuration_t);
 
 /* define an object for returning results from a find request
  * We need this to allow us to return the building blocks on
@@ -125,7 +125,7 @@ typedef struct ww_result_t {
     ww_list_item_t super;
     ww_building_block_t *block;
 } ww_result_t;
-WW_CLASS_DECLARATION(ww_result_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_result_t);
 
 
 /****    Warewulf Defined Directives    ****/
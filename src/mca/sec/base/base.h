@@ -39,6 +39,7 @@
 #include "src/mca/base/mca_base_framework.h"
 
 #include "src/mca/sec/sec.h"
+#include "src/runtime/ww_coro.h"
 
 
  BEGIN_C_DECLS
@@ -62,6 +63,116 @@ WW_DECLSPEC ww_sec_module_t* ww_sec_base_assign_module(const char *options);
  * when done */
 WW_DECLSPEC char* ww_sec_base_get_available_modules(void);
 
+/* ask the kernel who is on the other end of a Unix-domain socket.
+ * Returns false if it cannot tell us, e.g., because sd is not a
+ * local socket */
+WW_DECLSPEC bool ww_sec_base_peer_creds(int sd, uid_t *uid, gid_t *gid);
+
+/****    SESSIONS    ****/
+/* length of the key a handshake establishes for a connection */
+#define WW_SEC_SESSION_KEYLEN   16
+/* largest blob we will accept from a peer during a handshake */
+#define WW_SEC_MAX_BLOB         8192
+
+WW_DECLSPEC void ww_sec_base_session_init(void);
+WW_DECLSPEC void ww_sec_base_session_finalize(void);
+
+/* fill a buffer from the system's source of randomness */
+WW_DECLSPEC ww_status_t ww_sec_base_random(void *buf, size_t len);
+
+/* exchange a length-prefixed blob over a blocking socket - the
+ * received blob is NUL-terminated, and the caller must free it */
+WW_DECLSPEC ww_status_t ww_sec_base_send_blob(int sd, const void *buf, uint32_t len);
+WW_DECLSPEC ww_status_t ww_sec_base_recv_blob(int sd, void **buf, uint32_t *len);
+
+/* bind a session key to the connection on sd. The server flag tells
+ * us which direction our own messages travel */
+WW_DECLSPEC ww_status_t ww_sec_base_session_create(int sd, const uint8_t *key, bool server);
+/* drop the session on sd - call before closing the connection. A
+ * session whose connection has gone away is also dropped the next
+ * time sd is used, so a new connection that is handed the same
+ * descriptor never inherits it */
+WW_DECLSPEC void ww_sec_base_session_close(int sd);
+
+/* compute the MAC for the next message we send on sd, and check
+ * the MAC on the next message we receive on it. Messages must be
+ * verified in the order they were signed */
+WW_DECLSPEC ww_status_t ww_sec_base_sign(int sd, const void *msg, size_t len, uint64_t *tag);
+WW_DECLSPEC ww_status_t ww_sec_base_verify(int sd, const void *msg, size_t len, uint64_t tag);
+
+/* final step of a handshake - the server proves it holds the
+ * session key, and the client checks that proof */
+WW_DECLSPEC ww_status_t ww_sec_base_session_confirm(int sd);
+WW_DECLSPEC ww_status_t ww_sec_base_session_await(int sd);
+
+/****    ASYNCHRONOUS VALIDATION    ****/
+/* callback delivering the result of a validation */
+typedef void (*ww_sec_base_validate_cbfunc_t)(ww_status_t status,
+                                              ww_peer_t *peer,
+                                              void *cbdata);
+
+WW_DECLSPEC void ww_sec_base_validate_init(void);
+WW_DECLSPEC void ww_sec_base_validate_finalize(void);
+
+/* validate a credential on a worker thread. The callback is run on
+ * the given event base, and this must be called from the thread
+ * progressing that base. If evbase is NULL, or no workers were
+ * requested, the credential is validated and the callback run before
+ * returning. The cred is copied and the peer retained, so the caller
+ * need not keep them. Returns WW_ERR_RESOURCE_BUSY, without calling
+ * the callback, if the peer's uid is over its admission limits.
+ * The base must keep running until every callback it is owed has
+ * run - requests still queued at finalize are failed with
+ * WW_ERR_NOT_AVAILABLE, but still answered on their base */
+WW_DECLSPEC ww_status_t ww_sec_base_validate_cred_nb(ww_sec_module_t *module,
+                                                     ww_peer_t *peer, const char *cred,
+                                                     ww_event_base_t *evbase,
+                                                     ww_sec_base_validate_cbfunc_t cbfunc,
+                                                     void *cbdata);
+
+/* validate a credential from a coroutine, which is suspended until
+ * the answer is in - returns the result of the validation */
+WW_DECLSPEC ww_status_t ww_sec_base_validate_cred_await(ww_coro_t *co,
+                                                        ww_sec_module_t *module,
+                                                        ww_peer_t *peer, const char *cred);
+
+/****    ADMISSION CONTROL    ****/
+WW_DECLSPEC void ww_sec_base_admit_init(void);
+WW_DECLSPEC void ww_sec_base_admit_finalize(void);
+
+/* the key a peer's requests are accounted under - the uid the kernel
+ * reports for its connection, never the one it claims. A remote
+ * connection is accounted under the address it comes from, and one
+ * with neither under a key shared by all such connections */
+WW_DECLSPEC uint64_t ww_sec_base_admit_key(ww_peer_t *peer);
+
+/* charge a request to a key - returns false if the key has exceeded
+ * its rate and the request should be refused */
+WW_DECLSPEC bool ww_sec_base_admit(uint64_t key);
+
+/****    AUTHORIZATION    ****/
+WW_DECLSPEC void ww_sec_base_authz_init(void);
+WW_DECLSPEC void ww_sec_base_authz_finalize(void);
+
+/* start resolving the groups of a peer's uid in the background, so
+ * that the answer is cached by the time it is needed. A uid already
+ * queued or being resolved is not queued again. Returns
+ * WW_ERR_RESOURCE_BUSY if the queue is full */
+WW_DECLSPEC ww_status_t ww_sec_base_authz_prefetch(ww_peer_t *peer);
+
+/* check whether a validated peer belongs to a group. Returns
+ * WW_SUCCESS if it does and WW_ERR_PERM if not. If the answer is not
+ * cached, it is resolved on the caller's thread - or, if another
+ * thread is already resolving it, the caller waits for that. An
+ * answer that has only just expired is used while it is refreshed
+ * in the background. The peer keeps a
+ * reference to the cached answer, so a peer must not be checked
+ * from more than one thread at a time */
+WW_DECLSPEC ww_status_t ww_sec_base_authz_check(ww_peer_t *peer, gid_t gid);
+
+/* discard everything cached, e.g., after the directory changed */
+WW_DECLSPEC void ww_sec_base_authz_flush(void);
+
 /**
  * Track an active component / module
  */
@@ -79,6 +190,14 @@ WW_CLASS_DECLARATION(ww_sec_base_active_module_t);
 struct ww_sec_globals_t {
   ww_list_t actives;
   bool initialized;
+  int validate_threads;
+  int authz_ttl;
+  int authz_negative_ttl;
+  int authz_queue_depth;
+  int admit_rate;
+  int admit_burst;
+  int admit_buckets;
+  int admit_queue_depth;
 };
 typedef struct ww_sec_globals_t ww_sec_globals_t;
 
@@ -0,0 +1,192 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Per-uid admission control.
+ *
+ * Requests are charged to the uid the kernel reports for the peer's
+ * connection - the uid a peer claims is exactly what an attacker
+ * would vary to dodge its limit. Remote connections, for which the
+ * kernel cannot vouch, are charged to the address they come from, so
+ * that opening a new connection does not buy a new bucket. Anything
+ * that is neither shares a single bucket. Nothing is kept per
+ * connection, so a descriptor that is closed and reused never
+ * inherits another connection's standing.
+ *
+ * Each uid gets a token bucket that refills at admit_rate requests
+ * per second and holds at most admit_burst of them. The bucket is
+ * kept in its equivalent single-number form (GCRA): the time at
+ * which the bucket would be full again. Admitting a request pushes
+ * that time out by one interval, and the request is refused if that
+ * would put it more than a burst ahead of now. That makes a check a
+ * single compare-and-swap, with no locks and no allocation.
+ *
+ * Buckets live in a fixed table indexed by a hash of the uid. Two
+ * uids that hash alike share a bucket, so the table should be sized
+ * well above the number of users expected to be active at once.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#include "src/runtime/ww_rte.h"
+#include "src/sys/atomic.h"
+#include "src/util/output.h"
+
+#include "src/mca/sec/base/base.h"
+
+static volatile int64_t *buckets = NULL;
+static int nbuckets = 0;
+static int64_t interval = 0;     // usec per token
+static int64_t tolerance = 0;    // usec a bucket may run ahead
+
+static int64_t now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* keys for peers with no kernel-reported uid - kept apart
+ * from every uid */
+#define WW_SEC_ADMIT_ADDR   (1ULL << 32)    // low bits identify the remote address
+#define WW_SEC_ADMIT_ANON   (1ULL << 33)    // nothing to identify it by
+
+/* the key of the address a remote connection comes from. An IPv6
+ * host is identified by its /64, as a single host can typically pick
+ * any address within it */
+static bool addr_key(int sd, uint64_t *key)
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    uint64_t prefix;
+
+    if (0 != getpeername(sd, (struct sockaddr*)&addr, &len)) {
+        return false;
+    }
+    if (AF_INET == addr.ss_family) {
+        *key = WW_SEC_ADMIT_ADDR | (uint64_t)((struct sockaddr_in*)&addr)->sin_addr.s_addr;
+        return true;
+    }
+#ifdef AF_INET6
+    if (AF_INET6 == addr.ss_family) {
+        struct in6_addr *a6 = &((struct sockaddr_in6*)&addr)->sin6_addr;
+        uint32_t v4;
+
+        if (IN6_IS_ADDR_V4MAPPED(a6)) {
+            memcpy(&v4, &a6->s6_addr[12], sizeof(v4));
+            *key = WW_SEC_ADMIT_ADDR | (uint64_t)v4;
+        } else {
+            memcpy(&prefix, a6->s6_addr, sizeof(prefix));
+            *key = WW_SEC_ADMIT_ADDR | ((prefix ^ (prefix >> 32)) & 0xffffffffULL);
+        }
+        return true;
+    }
+#endif
+    return false;
+}
+
+uint64_t ww_sec_base_admit_key(ww_peer_t *peer)
+{
+    uid_t uid;
+    gid_t gid;
+    uint64_t key;
+
+    if (0 > peer->sd) {
+        /* asked from within this process - nothing to verify */
+        return (uint64_t)peer->uid;
+    }
+    if (ww_sec_base_peer_creds(peer->sd, &uid, &gid)) {
+        return (uint64_t)uid;
+    }
+    if (addr_key(peer->sd, &key)) {
+        return key;
+    }
+    return WW_SEC_ADMIT_ANON;
+}
+
+static inline volatile int64_t* bucket(uint64_t key)
+{
+    uint64_t h = key;
+
+    /* mix the bits so that consecutive uids spread out */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return &buckets[h % (uint64_t)nbuckets];
+}
+
+bool ww_sec_base_admit(uint64_t key)
+{
+    volatile int64_t *b;
+    int64_t now, tat, next;
+
+    if (NULL == buckets) {
+        /* admission control is off */
+        return true;
+    }
+
+    b = bucket(key);
+    now = now_usec();
+    do {
+        tat = *b;
+        next = ((tat > now) ? tat : now) + interval;
+        if (next - now > tolerance) {
+            ww_output_verbose(5, ww_sec_base_framework.framework_output,
+                              "sec: rate limiting %s %lu",
+                              (WW_SEC_ADMIT_ANON & key) ? "unidentified peers" :
+                              ((WW_SEC_ADMIT_ADDR & key) ? "address key" : "uid"),
+                              (unsigned long)(key & 0xffffffffULL));
+            return false;
+        }
+    } while (!ww_atomic_cmpset_64(b, tat, next));
+    return true;
+}
+
+void ww_sec_base_admit_init(void)
+{
+    if (0 >= ww_sec_globals.admit_rate) {
+        return;
+    }
+    if (0 >= ww_sec_globals.admit_burst) {
+        ww_sec_globals.admit_burst = 1;
+    }
+    if (0 >= ww_sec_globals.admit_buckets) {
+        ww_sec_globals.admit_buckets = 1024;
+    }
+    nbuckets = ww_sec_globals.admit_buckets;
+    buckets = (volatile int64_t*)calloc(nbuckets, sizeof(int64_t));
+    interval = 1000000 / ww_sec_globals.admit_rate;
+    if (0 == interval) {
+        interval = 1;
+    }
+    tolerance = interval * ww_sec_globals.admit_burst;
+}
+
+void ww_sec_base_admit_finalize(void)
+{
+    if (NULL != buckets) {
+        free((void*)buckets);
+        buckets = NULL;
+    }
+    nbuckets = 0;
+}
@@ -0,0 +1,474 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Authorization cache.
+ *
+ * Deciding what a validated peer may do means knowing which groups
+ * its uid belongs to, and that takes a trip through NSS - possibly
+ * to an LDAP server. The answer is cached per uid for a while so
+ * that checking a request is a lookup, and users that do not resolve
+ * are cached too (for a shorter time) so that they cannot be used to
+ * hammer the directory.
+ *
+ * Entries are immutable once published: a refresh builds a new entry
+ * and swaps it in. A peer keeps a reference to the entry it last
+ * used, so repeat checks from a connection do not even need the
+ * table. Lookups can be started ahead of time on a resolver thread,
+ * typically as soon as a peer's credential has been accepted.
+ *
+ * Only one resolve per uid is ever in flight: anyone else who needs
+ * that uid waits for its answer rather than asking the directory
+ * again. An entry that has just expired is still answered from while
+ * the resolver refreshes it, so a busy uid does not stall every
+ * caller each time its entry runs out.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <grp.h>
+
+#include "src/class/ww_hash_table.h"
+#include "src/class/ww_list.h"
+#include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/output.h"
+
+#include "src/mca/sec/base/base.h"
+
+typedef struct {
+    ww_object_t super;
+    uid_t uid;
+    bool found;         // false if the uid does not resolve
+    gid_t *groups;      // sorted, including the primary group
+    int ngroups;
+    time_t expires;
+} ww_sec_base_authz_t;
+
+static void authzcon(ww_sec_base_authz_t *p)
+{
+    p->found = false;
+    p->groups = NULL;
+    p->ngroups = 0;
+    p->expires = 0;
+}
+static void authzdes(ww_sec_base_authz_t *p)
+{
+    if (NULL != p->groups) {
+        free(p->groups);
+    }
+}
+static WW_CLASS_INSTANCE(ww_sec_base_authz_t,
+                         ww_object_t,
+                         authzcon, authzdes);
+
+/* a uid being worked on - it is listed in the in-flight table for
+ * as long as it is queued for the resolver or being resolved */
+typedef struct {
+    ww_list_item_t super;
+    uid_t uid;
+    bool queued;        // on the resolver's queue
+    bool resolving;     // somebody is asking NSS about it
+} ww_sec_base_authz_req_t;
+static WW_CLASS_INSTANCE(ww_sec_base_authz_req_t,
+                         ww_list_item_t,
+                         NULL, NULL);
+
+static ww_mutex_t lock;
+static ww_condition_t cond;     // work for the resolver
+static ww_condition_t done;     // a resolve has finished
+static ww_hash_table_t cache;
+static ww_hash_table_t inflight;
+static ww_list_t queue;
+static ww_thread_t resolver;
+static bool resolver_started = false;
+static volatile bool active = false;
+static bool initialized = false;
+
+static int cmp_gid(const void *a, const void *b)
+{
+    gid_t x = *(const gid_t*)a;
+    gid_t y = *(const gid_t*)b;
+
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* ask NSS about a uid - this is the slow part, so it is never
+ * called with the lock held */
+static ww_sec_base_authz_t* resolve(uid_t uid)
+{
+    ww_sec_base_authz_t *az;
+    struct passwd pw, *result = NULL;
+    char *buf;
+    long bufsize;
+    int rc;
+#ifdef HAVE_GETGROUPLIST
+    gid_t *groups;
+    int ngroups;
+#endif
+
+    az = WW_NEW(ww_sec_base_authz_t);
+    az->uid = uid;
+
+    if (0 >= (bufsize = sysconf(_SC_GETPW_R_SIZE_MAX))) {
+        bufsize = 16384;
+    }
+    while (true) {
+        if (NULL == (buf = (char*)malloc(bufsize))) {
+            WW_RELEASE(az);
+            return NULL;
+        }
+        rc = getpwuid_r(uid, &pw, buf, bufsize, &result);
+        if (ERANGE != rc) {
+            break;
+        }
+        free(buf);
+        bufsize *= 2;
+    }
+
+    if (0 != rc || NULL == result) {
+        /* unknown user - remember that, but not for as long */
+        free(buf);
+        az->expires = time(NULL) + ww_sec_globals.authz_negative_ttl;
+        return az;
+    }
+
+#ifdef HAVE_GETGROUPLIST
+    ngroups = 32;
+    while (true) {
+        if (NULL == (groups = (gid_t*)malloc(ngroups * sizeof(gid_t)))) {
+            free(buf);
+            WW_RELEASE(az);
+            return NULL;
+        }
+        if (-1 != getgrouplist(pw.pw_name, pw.pw_gid, groups, &ngroups)) {
+            break;
+        }
+        /* ngroups now holds the number needed */
+        free(groups);
+        ngroups *= 2;
+    }
+    az->groups = groups;
+    az->ngroups = ngroups;
+#else
+    /* all we can vouch for is the primary group */
+    if (NULL != (az->groups = (gid_t*)malloc(sizeof(gid_t)))) {
+        az->groups[0] = pw.pw_gid;
+        az->ngroups = 1;
+    }
+#endif
+    free(buf);
+
+    qsort(az->groups, az->ngroups, sizeof(gid_t), cmp_gid);
+    az->found = true;
+    az->expires = time(NULL) + ww_sec_globals.authz_ttl;
+    return az;
+}
+
+/* replace whatever is cached for the entry's uid - must be
+ * called with the lock held */
+static void publish(ww_sec_base_authz_t *az)
+{
+    ww_sec_base_authz_t *old;
+
+    if (WW_SUCCESS == ww_hash_table_get_value_uint64(&cache, (uint64_t)az->uid, (void**)&old)) {
+        WW_RELEASE(old);
+    }
+    WW_RETAIN(az);
+    ww_hash_table_set_value_uint64(&cache, (uint64_t)az->uid, az);
+}
+
+/* forget a uid once nobody is working on it any more - must be
+ * called with the lock held */
+static void settle(ww_sec_base_authz_req_t *req)
+{
+    if (!req->queued && !req->resolving) {
+        ww_hash_table_remove_value_uint64(&inflight, (uint64_t)req->uid);
+        WW_RELEASE(req);
+    }
+}
+
+static void* resolver_engine(ww_object_t *obj)
+{
+    ww_sec_base_authz_req_t *req;
+    ww_sec_base_authz_t *az, *cur;
+    time_t now;
+
+    while (true) {
+        ww_mutex_lock(&lock);
+        while (active && ww_list_is_empty(&queue)) {
+            ww_condition_wait(&cond, &lock);
+        }
+        if (!active) {
+            ww_mutex_unlock(&lock);
+            break;
+        }
+        req = (ww_sec_base_authz_req_t*)ww_list_remove_first(&queue);
+        req->queued = false;
+        /* it may have been resolved since it was queued, or a
+         * caller may be resolving it right now */
+        now = time(NULL);
+        if (req->resolving ||
+            (WW_SUCCESS == ww_hash_table_get_value_uint64(&cache, (uint64_t)req->uid, (void**)&cur) &&
+             now < cur->expires)) {
+            settle(req);
+            ww_mutex_unlock(&lock);
+            continue;
+        }
+        req->resolving = true;
+        ww_mutex_unlock(&lock);
+
+        az = resolve(req->uid);
+
+        ww_mutex_lock(&lock);
+        if (NULL != az) {
+            publish(az);
+        }
+        req->resolving = false;
+        settle(req);
+        ww_condition_broadcast(&done);
+        ww_mutex_unlock(&lock);
+        if (NULL != az) {
+            WW_RELEASE(az);
+        }
+    }
+    return WW_THREAD_CANCELLED;
+}
+
+/* hand a uid to the resolver unless it is already being worked
+ * on - must be called with the lock held */
+static ww_status_t enqueue(uid_t uid)
+{
+    ww_sec_base_authz_req_t *req;
+    int rc;
+
+    if (WW_SUCCESS == ww_hash_table_get_value_uint64(&inflight, (uint64_t)uid, (void**)&req)) {
+        return WW_SUCCESS;
+    }
+    if (0 < ww_sec_globals.authz_queue_depth &&
+        (size_t)ww_sec_globals.authz_queue_depth <= ww_list_get_size(&queue)) {
+        return WW_ERR_RESOURCE_BUSY;
+    }
+    if (!resolver_started) {
+        active = true;
+        WW_CONSTRUCT(&resolver, ww_thread_t);
+        resolver.t_run = resolver_engine;
+        resolver.t_arg = NULL;
+        if (WW_SUCCESS != (rc = ww_thread_start(&resolver))) {
+            active = false;
+            WW_DESTRUCT(&resolver);
+            return rc;
+        }
+        resolver_started = true;
+    }
+    req = WW_NEW(ww_sec_base_authz_req_t);
+    req->uid = uid;
+    req->queued = true;
+    ww_hash_table_set_value_uint64(&inflight, (uint64_t)uid, req);
+    ww_list_append(&queue, &req->super);
+    ww_condition_signal(&cond);
+    return WW_SUCCESS;
+}
+
+/* return a current entry for the peer, holding a reference */
+static ww_sec_base_authz_t* lookup(ww_peer_t *peer)
+{
+    ww_sec_base_authz_t *az;
+    ww_sec_base_authz_req_t *req;
+    time_t now = time(NULL);
+
+    /* entries are immutable, so one the peer already holds can
+     * be used without the lock */
+    az = (ww_sec_base_authz_t*)peer->authz;
+    if (NULL != az && az->uid == peer->uid && now < az->expires) {
+        WW_RETAIN(az);
+        return az;
+    }
+
+    ww_mutex_lock(&lock);
+    while (true) {
+        now = time(NULL);
+        if (WW_SUCCESS == ww_hash_table_get_value_uint64(&cache, (uint64_t)peer->uid, (void**)&az)) {
+            if (now < az->expires) {
+                WW_RETAIN(az);
+                break;
+            }
+            /* only just expired - answer from it for up to another
+             * authz_ttl while the resolver refreshes it. If the
+             * queue is full, it is refreshed on a later check */
+            if (now < az->expires + ww_sec_globals.authz_ttl) {
+                (void)enqueue(peer->uid);
+                WW_RETAIN(az);
+                break;
+            }
+        }
+        if (WW_SUCCESS != ww_hash_table_get_value_uint64(&inflight, (uint64_t)peer->uid, (void**)&req)) {
+            req = NULL;
+        } else if (req->resolving) {
+            /* somebody else is already asking - wait for their answer */
+            ww_condition_wait(&done, &lock);
+            continue;
+        }
+        /* nobody asked ahead of time, or it expired long ago - we
+         * have to wait for the answer ourselves */
+        if (NULL == req) {
+            req = WW_NEW(ww_sec_base_authz_req_t);
+            req->uid = peer->uid;
+            ww_hash_table_set_value_uint64(&inflight, (uint64_t)peer->uid, req);
+        }
+        req->resolving = true;
+        ww_mutex_unlock(&lock);
+
+        az = resolve(peer->uid);
+
+        ww_mutex_lock(&lock);
+        if (NULL != az) {
+            publish(az);
+        }
+        req->resolving = false;
+        settle(req);
+        ww_condition_broadcast(&done);
+        if (NULL == az) {
+            ww_mutex_unlock(&lock);
+            return NULL;
+        }
+        break;
+    }
+    ww_mutex_unlock(&lock);
+
+    /* remember it on the peer for next time */
+    if (NULL != peer->authz) {
+        WW_RELEASE(peer->authz);
+    }
+    WW_RETAIN(az);
+    peer->authz = &az->super;
+    return az;
+}
+
+ww_status_t ww_sec_base_authz_prefetch(ww_peer_t *peer)
+{
+    ww_sec_base_authz_t *az;
+    ww_status_t rc;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+
+    ww_mutex_lock(&lock);
+    if (WW_SUCCESS == ww_hash_table_get_value_uint64(&cache, (uint64_t)peer->uid, (void**)&az) &&
+        time(NULL) < az->expires) {
+        ww_mutex_unlock(&lock);
+        return WW_SUCCESS;
+    }
+    rc = enqueue(peer->uid);
+    ww_mutex_unlock(&lock);
+    return rc;
+}
+
+ww_status_t ww_sec_base_authz_check(ww_peer_t *peer, gid_t gid)
+{
+    ww_sec_base_authz_t *az;
+    ww_status_t rc;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    /* the validated primary group needs no lookup */
+    if (gid == peer->gid) {
+        return WW_SUCCESS;
+    }
+    if (NULL == (az = lookup(peer))) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    if (az->found && NULL != bsearch(&gid, az->groups, az->ngroups,
+                                     sizeof(gid_t), cmp_gid)) {
+        rc = WW_SUCCESS;
+    } else {
+        rc = WW_ERR_PERM;
+    }
+    WW_RELEASE(az);
+    return rc;
+}
+
+void ww_sec_base_authz_flush(void)
+{
+    ww_sec_base_authz_t *az;
+    uint64_t key;
+    void *node;
+    int rc;
+
+    if (!initialized) {
+        return;
+    }
+    ww_mutex_lock(&lock);
+    rc = ww_hash_table_get_first_key_uint64(&cache, &key, (void**)&az, &node);
+    while (WW_SUCCESS == rc) {
+        WW_RELEASE(az);
+        rc = ww_hash_table_get_next_key_uint64(&cache, &key, (void**)&az, node, &node);
+    }
+    ww_hash_table_remove_all(&cache);
+    ww_mutex_unlock(&lock);
+}
+
+void ww_sec_base_authz_init(void)
+{
+    WW_CONSTRUCT(&lock, ww_mutex_t);
+    WW_CONSTRUCT(&cond, ww_condition_t);
+    WW_CONSTRUCT(&done, ww_condition_t);
+    WW_CONSTRUCT(&cache, ww_hash_table_t);
+    ww_hash_table_init(&cache, 256);
+    WW_CONSTRUCT(&inflight, ww_hash_table_t);
+    ww_hash_table_init(&inflight, 64);
+    WW_CONSTRUCT(&queue, ww_list_t);
+    resolver_started = false;
+    active = false;
+    initialized = true;
+}
+
+void ww_sec_base_authz_finalize(void)
+{
+    ww_sec_base_authz_req_t *req;
+
+    if (!initialized) {
+        return;
+    }
+    if (resolver_started) {
+        ww_mutex_lock(&lock);
+        active = false;
+        ww_condition_broadcast(&cond);
+        ww_mutex_unlock(&lock);
+        ww_thread_join(&resolver, NULL);
+        WW_DESTRUCT(&resolver);
+        resolver_started = false;
+    }
+    /* whatever the resolver never got to - the in-flight table
+     * holds the only reference to each */
+    while (NULL != (req = (ww_sec_base_authz_req_t*)ww_list_remove_first(&queue))) {
+        req->queued = false;
+        settle(req);
+    }
+    ww_sec_base_authz_flush();
+    initialized = false;
+    WW_DESTRUCT(&queue);
+    WW_DESTRUCT(&inflight);
+    WW_DESTRUCT(&cache);
+    WW_DESTRUCT(&done);
+    WW_DESTRUCT(&cond);
+    WW_DESTRUCT(&lock);
+}
@@ -16,6 +16,13 @@
 #include <ww_types.h>
 #include "src/runtime/ww_rte.h"
 
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
 #include "src/class/ww_list.h"
 #include "src/util/argv.h"
 #include "src/util/output.h"
@@ -81,3 +88,29 @@ ww_sec_module_t* ww_sec_base_assign_module(const char *options)
     return NULL;
 }
 
+/* ask the kernel who is on the other end of a Unix-domain socket.
+ * Returns false if it cannot tell us, e.g., because sd is not a
+ * local socket */
+bool ww_sec_base_peer_creds(int sd, uid_t *uid, gid_t *gid)
+{
+#if defined(SO_PEERCRED) && defined(HAVE_STRUCT_UCRED)
+    struct ucred ucred;
+    socklen_t len = sizeof(ucred);
+
+    if (0 != getsockopt(sd, SOL_SOCKET, SO_PEERCRED, &ucred, &len) ||
+        sizeof(ucred) != len) {
+        return false;
+    }
+    /* sockets of other families report no process */
+    if (0 == ucred.pid) {
+        return false;
+    }
+    *uid = ucred.uid;
+    *gid = ucred.gid;
+    return true;
+#elif defined(HAVE_GETPEEREID)
+    return (0 == getpeereid(sd, uid, gid));
+#else
+    return false;
+#endif
+}
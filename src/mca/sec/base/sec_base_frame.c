@@ -31,6 +31,7 @@
 #include <string.h>
 #endif
 
+#include "src/mca/base/mca_base_var.h"
 #include "src/class/ww_list.h"
 #include "src/mca/sec/base/base.h"
 
@@ -45,6 +46,70 @@
 /* Instantiate the global vars */
 ww_sec_globals_t ww_sec_globals;
 
+static int ww_sec_register(mca_base_register_flag_t flags)
+{
+    ww_sec_globals.validate_threads = 4;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "validate_threads",
+                                           "Number of threads validating credentials on behalf of "
+                                           "the event loop (0 validates them on the caller's thread)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.validate_threads);
+
+    ww_sec_globals.authz_ttl = 300;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "authz_ttl",
+                                           "Time (in seconds) to cache the groups a user belongs to",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.authz_ttl);
+
+    ww_sec_globals.authz_negative_ttl = 30;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "authz_negative_ttl",
+                                           "Time (in seconds) to remember that a uid has no user entry",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.authz_negative_ttl);
+
+    ww_sec_globals.authz_queue_depth = 1024;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "authz_queue_depth",
+                                           "Maximum number of uids waiting for their groups to be "
+                                           "resolved in the background (0 for no limit)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.authz_queue_depth);
+
+    ww_sec_globals.admit_rate = 0;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "admit_rate",
+                                           "Sustained number of credential validations per second "
+                                           "admitted from any one uid (0 disables admission control)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.admit_rate);
+
+    ww_sec_globals.admit_burst = 100;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "admit_burst",
+                                           "Number of validations a uid may make in a burst above admit_rate",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.admit_burst);
+
+    ww_sec_globals.admit_buckets = 1024;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "admit_buckets",
+                                           "Number of rate-limiting buckets that uids are hashed across",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.admit_buckets);
+
+    ww_sec_globals.admit_queue_depth = 0;
+    (void) mca_base_framework_var_register(&ww_sec_base_framework, "admit_queue_depth",
+                                           "Maximum number of validations any one uid may have waiting "
+                                           "for a worker (0 for no limit)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &ww_sec_globals.admit_queue_depth);
+    return WW_SUCCESS;
+}
+
 static ww_status_t ww_sec_close(void)
 {
   ww_sec_base_active_module_t *active;
@@ -54,12 +119,18 @@ static ww_status_t ww_sec_close(void)
     }
     ww_sec_globals.initialized = false;
 
+    /* the workers may be inside a module, so stop them first */
+    ww_sec_base_validate_finalize();
+    ww_sec_base_authz_finalize();
+    ww_sec_base_admit_finalize();
+
     WW_LIST_FOREACH(active, &ww_sec_globals.actives, ww_sec_base_active_module_t) {
       if (NULL != active->component->finalize) {
         active->component->finalize();
       }
     }
     WW_DESTRUCT(&ww_sec_globals.actives);
+    ww_sec_base_session_finalize();
 
     return WW_SUCCESS;
 }
@@ -69,11 +140,15 @@ static ww_status_t ww_sec_open(mca_base_open_flag_t flags)
   /* initialize globals */
   ww_sec_globals.initialized = true;
   WW_CONSTRUCT(&ww_sec_globals.actives, ww_list_t);
+  ww_sec_base_session_init();
+  ww_sec_base_validate_init();
+  ww_sec_base_authz_init();
+  ww_sec_base_admit_init();
   return WW_SUCCESS;
 }
 
 MCA_BASE_FRAMEWORK_DECLARE(ww, sec, "Warewulf Security Operations",
-                           NULL, ww_sec_open, ww_sec_close,
+                           ww_sec_register, ww_sec_open, ww_sec_close,
                            mca_sec_base_static_components, 0);
 
 WW_CLASS_INSTANCE(ww_sec_base_active_module_t,
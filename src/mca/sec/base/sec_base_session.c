@@ -0,0 +1,346 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Per-connection sessions established by a sec handshake.
+ *
+ * A handshake leaves both ends of a connection holding the same
+ * session key. Every message sent afterwards carries a MAC over the
+ * direction of travel, a per-direction sequence number and the
+ * message itself, so the receiver can tell that it came from the
+ * authenticated peer, was not altered, and is neither a replay nor
+ * a reflection of its own traffic. Checking a MAC is a keyed hash,
+ * which is far cheaper than presenting and validating a credential
+ * on every message.
+ *
+ * Sessions are found by descriptor, and a descriptor is reused as soon
+ * as its connection is closed. Each session therefore remembers which
+ * socket it was made on, and is dropped the moment its descriptor
+ * turns out to be closed or to name a different socket - a new
+ * connection never inherits an old one's key. A peer closing its end
+ * drops the session as well.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "src/class/ww_hash_table.h"
+#include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/fd.h"
+#include "src/util/output.h"
+#include "src/util/siphash.h"
+
+#include "src/mca/sec/base/base.h"
+
+#define WW_SEC_DIR_CLIENT   'C'
+#define WW_SEC_DIR_SERVER   'S'
+#define WW_SEC_CONFIRM      "ww.handshake"
+
+typedef struct {
+    ww_object_t super;
+    uint8_t key[WW_SEC_SESSION_KEYLEN];
+    bool server;
+    uint64_t send_seq;
+    uint64_t recv_seq;
+    /* the socket the session was made on */
+    dev_t dev;
+    ino_t ino;
+} ww_sec_base_session_t;
+static WW_CLASS_INSTANCE(ww_sec_base_session_t,
+                         ww_object_t,
+                         NULL, NULL);
+
+static ww_mutex_t lock;
+static ww_hash_table_t sessions;
+static bool initialized = false;
+
+static uint64_t compute_tag(ww_sec_base_session_t *ses, char dir, uint64_t seq,
+                            const void *msg, size_t len)
+{
+    ww_siphash_t st;
+    uint8_t hdr[9];
+    int i;
+
+    hdr[0] = (uint8_t)dir;
+    for (i=0; i < 8; i++) {
+        hdr[i+1] = (uint8_t)(seq >> (8 * i));
+    }
+    ww_siphash_init(&st, ses->key);
+    ww_siphash_update(&st, hdr, sizeof(hdr));
+    ww_siphash_update(&st, msg, len);
+    return ww_siphash_final(&st);
+}
+
+/* must be called with the lock held */
+static void session_remove(int sd, ww_sec_base_session_t *ses)
+{
+    ww_hash_table_remove_value_uint64(&sessions, (uint64_t)sd);
+    memset(ses->key, 0, sizeof(ses->key));
+    WW_RELEASE(ses);
+}
+
+/* find the session of the connection currently on sd - must be
+ * called with the lock held */
+static ww_sec_base_session_t* session_find(int sd)
+{
+    ww_sec_base_session_t *ses;
+    struct stat buf;
+
+    if (WW_SUCCESS != ww_hash_table_get_value_uint64(&sessions, (uint64_t)sd, (void**)&ses)) {
+        return NULL;
+    }
+    if (0 != fstat(sd, &buf) || buf.st_dev != ses->dev || buf.st_ino != ses->ino) {
+        /* its connection was closed, and perhaps the descriptor
+         * handed to another */
+        session_remove(sd, ses);
+        return NULL;
+    }
+    return ses;
+}
+
+void ww_sec_base_session_init(void)
+{
+    WW_CONSTRUCT(&lock, ww_mutex_t);
+    WW_CONSTRUCT(&sessions, ww_hash_table_t);
+    ww_hash_table_init(&sessions, 64);
+    initialized = true;
+}
+
+void ww_sec_base_session_finalize(void)
+{
+    ww_sec_base_session_t *ses;
+    uint64_t key;
+    void *node;
+    int rc;
+
+    if (!initialized) {
+        return;
+    }
+    rc = ww_hash_table_get_first_key_uint64(&sessions, &key, (void**)&ses, &node);
+    while (WW_SUCCESS == rc) {
+        /* wipe the key before the memory is reused */
+        memset(ses->key, 0, sizeof(ses->key));
+        WW_RELEASE(ses);
+        rc = ww_hash_table_get_next_key_uint64(&sessions, &key, (void**)&ses, node, &node);
+    }
+    WW_DESTRUCT(&sessions);
+    WW_DESTRUCT(&lock);
+    initialized = false;
+}
+
+ww_status_t ww_sec_base_random(void *buf, size_t len)
+{
+    ww_status_t rc;
+    int fd;
+
+    if (0 > (fd = open("/dev/urandom", O_RDONLY))) {
+        return WW_ERR_NOT_SUPPORTED;
+    }
+    rc = ww_fd_read(fd, (int)len, buf);
+    close(fd);
+    return rc;
+}
+
+ww_status_t ww_sec_base_send_blob(int sd, const void *buf, uint32_t len)
+{
+    uint32_t nlen;
+    ww_status_t rc;
+
+    if (WW_SEC_MAX_BLOB < len) {
+        return WW_ERR_BAD_PARAM;
+    }
+    nlen = htonl(len);
+    if (WW_SUCCESS != (rc = ww_fd_write(sd, sizeof(nlen), &nlen))) {
+        return rc;
+    }
+    if (0 < len) {
+        rc = ww_fd_write(sd, (int)len, buf);
+    }
+    return rc;
+}
+
+ww_status_t ww_sec_base_recv_blob(int sd, void **buf, uint32_t *len)
+{
+    uint32_t nlen;
+    char *data;
+    ww_status_t rc;
+
+    *buf = NULL;
+    *len = 0;
+    if (WW_SUCCESS != (rc = ww_fd_read(sd, sizeof(nlen), &nlen))) {
+        if (WW_ERR_TIMEOUT == rc) {
+            /* the peer closed the connection */
+            ww_sec_base_session_close(sd);
+        }
+        return rc;
+    }
+    nlen = ntohl(nlen);
+    /* do not let a peer make us allocate whatever it likes */
+    if (WW_SEC_MAX_BLOB < nlen) {
+        return WW_ERR_HANDSHAKE_FAILED;
+    }
+    /* leave room to terminate it, since most blobs are strings */
+    if (NULL == (data = (char*)malloc(nlen + 1))) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    if (0 < nlen && WW_SUCCESS != (rc = ww_fd_read(sd, (int)nlen, data))) {
+        free(data);
+        if (WW_ERR_TIMEOUT == rc) {
+            ww_sec_base_session_close(sd);
+        }
+        return rc;
+    }
+    data[nlen] = '\0';
+    *buf = data;
+    *len = nlen;
+    return WW_SUCCESS;
+}
+
+ww_status_t ww_sec_base_session_create(int sd, const uint8_t *key, bool server)
+{
+    ww_sec_base_session_t *ses, *old;
+    struct stat buf;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    if (0 != fstat(sd, &buf)) {
+        return WW_ERR_BAD_PARAM;
+    }
+    ses = WW_NEW(ww_sec_base_session_t);
+    memcpy(ses->key, key, WW_SEC_SESSION_KEYLEN);
+    ses->server = server;
+    ses->send_seq = 0;
+    ses->recv_seq = 0;
+    ses->dev = buf.st_dev;
+    ses->ino = buf.st_ino;
+
+    ww_mutex_lock(&lock);
+    /* a descriptor that is being reused belongs to a new connection */
+    if (WW_SUCCESS == ww_hash_table_get_value_uint64(&sessions, (uint64_t)sd, (void**)&old)) {
+        memset(old->key, 0, sizeof(old->key));
+        WW_RELEASE(old);
+    }
+    ww_hash_table_set_value_uint64(&sessions, (uint64_t)sd, ses);
+    ww_mutex_unlock(&lock);
+    return WW_SUCCESS;
+}
+
+void ww_sec_base_session_close(int sd)
+{
+    ww_sec_base_session_t *ses;
+
+    if (!initialized) {
+        return;
+    }
+    ww_mutex_lock(&lock);
+    if (WW_SUCCESS == ww_hash_table_get_value_uint64(&sessions, (uint64_t)sd, (void**)&ses)) {
+        session_remove(sd, ses);
+    }
+    ww_mutex_unlock(&lock);
+}
+
+ww_status_t ww_sec_base_sign(int sd, const void *msg, size_t len, uint64_t *tag)
+{
+    ww_sec_base_session_t *ses;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    ww_mutex_lock(&lock);
+    if (NULL == (ses = session_find(sd))) {
+        ww_mutex_unlock(&lock);
+        return WW_ERR_NOT_FOUND;
+    }
+    *tag = compute_tag(ses, ses->server ? WW_SEC_DIR_SERVER : WW_SEC_DIR_CLIENT,
+                       ses->send_seq++, msg, len);
+    ww_mutex_unlock(&lock);
+    return WW_SUCCESS;
+}
+
+ww_status_t ww_sec_base_verify(int sd, const void *msg, size_t len, uint64_t tag)
+{
+    ww_sec_base_session_t *ses;
+    uint64_t expected;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    ww_mutex_lock(&lock);
+    if (NULL == (ses = session_find(sd))) {
+        ww_mutex_unlock(&lock);
+        return WW_ERR_NOT_FOUND;
+    }
+    /* we expect the tag the other end would have computed */
+    expected = compute_tag(ses, ses->server ? WW_SEC_DIR_CLIENT : WW_SEC_DIR_SERVER,
+                           ses->recv_seq, msg, len);
+    if (0 != (expected ^ tag)) {
+        ww_mutex_unlock(&lock);
+        return WW_ERR_INVALID_CRED;
+    }
+    /* only advance on success, so a forged message cannot
+     * knock the two ends out of step */
+    ses->recv_seq++;
+    ww_mutex_unlock(&lock);
+    return WW_SUCCESS;
+}
+
+ww_status_t ww_sec_base_session_confirm(int sd)
+{
+    uint64_t tag;
+    uint8_t buf[8];
+    ww_status_t rc;
+    int i;
+
+    if (WW_SUCCESS != (rc = ww_sec_base_sign(sd, WW_SEC_CONFIRM,
+                                             strlen(WW_SEC_CONFIRM), &tag))) {
+        return rc;
+    }
+    for (i=0; i < 8; i++) {
+        buf[i] = (uint8_t)(tag >> (8 * i));
+    }
+    return ww_sec_base_send_blob(sd, buf, sizeof(buf));
+}
+
+ww_status_t ww_sec_base_session_await(int sd)
+{
+    uint8_t *buf;
+    uint32_t len;
+    uint64_t tag = 0;
+    ww_status_t rc;
+    int i;
+
+    if (WW_SUCCESS != (rc = ww_sec_base_recv_blob(sd, (void**)&buf, &len))) {
+        return rc;
+    }
+    if (8 != len) {
+        /* the server rejected us - it sends an empty blob */
+        free(buf);
+        return WW_ERR_HANDSHAKE_FAILED;
+    }
+    for (i=0; i < 8; i++) {
+        tag |= ((uint64_t)buf[i]) << (8 * i);
+    }
+    free(buf);
+    if (WW_SUCCESS != (rc = ww_sec_base_verify(sd, WW_SEC_CONFIRM,
+                                               strlen(WW_SEC_CONFIRM), tag))) {
+        return WW_ERR_HANDSHAKE_FAILED;
+    }
+    return WW_SUCCESS;
+}
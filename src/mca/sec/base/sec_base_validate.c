@@ -0,0 +1,525 @@
+/* -*- Mode: C; c-basic-offset:4 ; indent-tabs-mode:nil -*- */
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Asynchronous credential validation.
+ *
+ * Validating a credential can take a round trip to an external
+ * daemon (e.g., munged), and a server that validates on its event
+ * thread stalls every other connection while it waits. Requests are
+ * therefore queued to a pool of worker threads, which validate them
+ * concurrently and hand the results back to the event base that
+ * made the request.
+ *
+ * Libevent is not set up for use from multiple threads, so the
+ * workers never touch an event base. Each requesting base instead
+ * gets a completion queue and a pipe, with a persistent read event
+ * on the pipe. A worker appends the result to the queue and writes
+ * to the pipe only if the queue was empty - the event then fires on
+ * the base's own thread and runs every completed callback.
+ *
+ * A completion queue lives only while its base has requests
+ * outstanding. The callback that delivers the last of them also
+ * removes the event and frees the queue, so the event is only ever
+ * touched on the base's own thread, and nothing is left pointing at
+ * a base once it has no more answers coming. A base must therefore
+ * not be freed while it has requests outstanding.
+ *
+ * Requests are queued per uid, and admitted through the per-uid rate
+ * limiter. Both go by the uid the kernel reports for the connection
+ * rather than the one the peer claims, and a request turned away for
+ * a full queue is not charged against the rate. The workers serve the
+ * uids round-robin, so one client flooding the server only lengthens
+ * its own queue - everyone else still gets a turn at the workers.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include WW_EVENT_HEADER
+
+#include "src/class/ww_hash_table.h"
+#include "src/class/ww_list.h"
+#include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/fd.h"
+#include "src/util/output.h"
+
+#include "src/mca/sec/base/base.h"
+
+/* completed requests waiting to be returned to one event base */
+typedef struct {
+    ww_list_item_t super;
+    ww_event_base_t *evbase;
+    int wakeup[2];
+    ww_event_t ev;
+    bool ev_active;
+    int outstanding;                // only touched on the base's thread
+    bool listed;                    // protected by comp_lock
+    ww_mutex_t lock;
+    ww_list_t done;
+} ww_sec_base_completion_t;
+
+typedef struct {
+    ww_list_item_t super;
+    ww_sec_module_t *module;
+    ww_peer_t *peer;
+    char *cred;
+    ww_sec_base_completion_t *completion;
+    ww_sec_base_validate_cbfunc_t cbfunc;
+    void *cbdata;
+    ww_status_t status;
+} ww_sec_base_validate_req_t;
+
+/* the queued requests of one uid */
+typedef struct {
+    ww_list_item_t super;
+    uint64_t key;                   // as given by ww_sec_base_admit_key
+    ww_list_t reqs;
+} ww_sec_base_flow_t;
+
+static void compcon(ww_sec_base_completion_t *p)
+{
+    p->evbase = NULL;
+    p->wakeup[0] = -1;
+    p->wakeup[1] = -1;
+    p->ev_active = false;
+    p->outstanding = 0;
+    p->listed = false;
+    WW_CONSTRUCT(&p->lock, ww_mutex_t);
+    WW_CONSTRUCT(&p->done, ww_list_t);
+}
+/* the event must already have been deleted on the base's thread */
+static void compdes(ww_sec_base_completion_t *p)
+{
+    if (0 <= p->wakeup[0]) {
+        close(p->wakeup[0]);
+    }
+    if (0 <= p->wakeup[1]) {
+        close(p->wakeup[1]);
+    }
+    WW_LIST_DESTRUCT(&p->done);
+    WW_DESTRUCT(&p->lock);
+}
+static WW_CLASS_INSTANCE(ww_sec_base_completion_t,
+                         ww_list_item_t,
+                         compcon, compdes);
+
+static void reqcon(ww_sec_base_validate_req_t *p)
+{
+    p->module = NULL;
+    p->peer = NULL;
+    p->cred = NULL;
+    p->completion = NULL;
+    p->cbfunc = NULL;
+    p->cbdata = NULL;
+    p->status = WW_ERR_INVALID_CRED;
+}
+static void reqdes(ww_sec_base_validate_req_t *p)
+{
+    if (NULL != p->peer) {
+        WW_RELEASE(p->peer);
+    }
+    if (NULL != p->cred) {
+        free(p->cred);
+    }
+}
+static WW_CLASS_INSTANCE(ww_sec_base_validate_req_t,
+                         ww_list_item_t,
+                         reqcon, reqdes);
+
+static void flowcon(ww_sec_base_flow_t *p)
+{
+    WW_CONSTRUCT(&p->reqs, ww_list_t);
+}
+static void flowdes(ww_sec_base_flow_t *p)
+{
+    WW_LIST_DESTRUCT(&p->reqs);
+}
+static WW_CLASS_INSTANCE(ww_sec_base_flow_t,
+                         ww_list_item_t,
+                         flowcon, flowdes);
+
+static ww_mutex_t lock;
+static ww_condition_t cond;
+static ww_hash_table_t flows;   // key -> flow, for flows with requests queued
+static ww_list_t ready;         // the same flows, in the order they are served
+/* completions outlive finalize until their last request is delivered,
+ * so the list is guarded by a lock that is never torn down */
+static ww_mutex_t comp_lock = WW_MUTEX_STATIC_INIT;
+static ww_list_t completions;
+static ww_thread_t *workers = NULL;
+static int nworkers = 0;
+static volatile bool active = false;
+static bool initialized = false;
+
+/* runs on the requesting event base */
+static void deliver(int fd, short args, void *cbdata)
+{
+    ww_sec_base_completion_t *comp = (ww_sec_base_completion_t*)cbdata;
+    ww_sec_base_validate_req_t *req;
+    ww_list_item_t *item;
+    ww_list_t ready;
+    bool listed;
+    char buf[64];
+
+    while (0 < read(fd, buf, sizeof(buf))) {
+    }
+
+    /* take everything in one go so the workers are not
+     * held up while the callbacks run */
+    WW_CONSTRUCT(&ready, ww_list_t);
+    ww_mutex_lock(&comp->lock);
+    while (NULL != (item = ww_list_remove_first(&comp->done))) {
+        ww_list_append(&ready, item);
+    }
+    ww_mutex_unlock(&comp->lock);
+
+    while (NULL != (item = ww_list_remove_first(&ready))) {
+        req = (ww_sec_base_validate_req_t*)item;
+        req->cbfunc(req->status, req->peer, req->cbdata);
+        WW_RELEASE(req);
+        comp->outstanding--;
+    }
+    WW_DESTRUCT(&ready);
+
+    if (0 < comp->outstanding) {
+        return;
+    }
+    /* nothing more is coming back to this base - new requests are
+     * only made on this thread, so none can be racing us here. Every
+     * worker that touched the completion has also finished with it,
+     * as they only let go of its lock once they are done */
+    ww_mutex_lock(&comp_lock);
+    listed = comp->listed;
+    if (listed) {
+        ww_list_remove_item(&completions, &comp->super);
+        comp->listed = false;
+    }
+    ww_mutex_unlock(&comp_lock);
+    ww_event_del(&comp->ev);
+    comp->ev_active = false;
+    WW_RELEASE(comp);
+}
+
+/* hand a request back to the base that made it */
+static void complete(ww_sec_base_validate_req_t *req)
+{
+    ww_sec_base_completion_t *comp = req->completion;
+    bool wake;
+
+    ww_mutex_lock(&comp->lock);
+    wake = ww_list_is_empty(&comp->done);
+    ww_list_append(&comp->done, &req->super);
+    /* the base is already due to run if the list was not empty. Wake
+     * it while still holding the lock - once we let go, the base may
+     * deliver the last request and free the completion */
+    if (wake && 1 != write(comp->wakeup[1], "", 1)) {
+        /* the pipe is full - a wakeup is already pending */
+    }
+    ww_mutex_unlock(&comp->lock);
+}
+
+static void* validate_engine(ww_object_t *obj)
+{
+    ww_sec_base_validate_req_t *req;
+    ww_sec_base_flow_t *flow;
+
+    while (true) {
+        ww_mutex_lock(&lock);
+        while (active && ww_list_is_empty(&ready)) {
+            ww_condition_wait(&cond, &lock);
+        }
+        if (!active) {
+            ww_mutex_unlock(&lock);
+            break;
+        }
+        /* take one request from the next uid in line, and send
+         * that uid to the back if it has more */
+        flow = (ww_sec_base_flow_t*)ww_list_remove_first(&ready);
+        req = (ww_sec_base_validate_req_t*)ww_list_remove_first(&flow->reqs);
+        if (ww_list_is_empty(&flow->reqs)) {
+            ww_hash_table_remove_value_uint64(&flows, flow->key);
+            WW_RELEASE(flow);
+        } else {
+            ww_list_append(&ready, &flow->super);
+        }
+        ww_mutex_unlock(&lock);
+
+        req->status = req->module->validate_cred(req->peer, req->cred);
+        if (WW_SUCCESS == req->status) {
+            /* the peer's requests will need authorizing next */
+            ww_sec_base_authz_prefetch(req->peer);
+        }
+
+        complete(req);
+    }
+    return WW_THREAD_CANCELLED;
+}
+
+/* must be called with the lock held */
+static ww_status_t start_workers(void)
+{
+    int i;
+
+    workers = (ww_thread_t*)calloc(ww_sec_globals.validate_threads, sizeof(ww_thread_t));
+    if (NULL == workers) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    active = true;
+    for (i=0; i < ww_sec_globals.validate_threads; i++) {
+        WW_CONSTRUCT(&workers[i], ww_thread_t);
+        workers[i].t_run = validate_engine;
+        workers[i].t_arg = NULL;
+        if (WW_SUCCESS != ww_thread_start(&workers[i])) {
+            WW_DESTRUCT(&workers[i]);
+            break;
+        }
+    }
+    nworkers = i;
+    if (0 == nworkers) {
+        active = false;
+        free(workers);
+        workers = NULL;
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    return WW_SUCCESS;
+}
+
+/* must be called on the thread running evbase - a completion found
+ * here cannot go away under us, as only that thread frees it */
+static ww_sec_base_completion_t* get_completion(ww_event_base_t *evbase)
+{
+    ww_sec_base_completion_t *comp;
+
+    ww_mutex_lock(&comp_lock);
+    WW_LIST_FOREACH(comp, &completions, ww_sec_base_completion_t) {
+        if (comp->evbase == evbase) {
+            ww_mutex_unlock(&comp_lock);
+            return comp;
+        }
+    }
+    ww_mutex_unlock(&comp_lock);
+
+    comp = WW_NEW(ww_sec_base_completion_t);
+    comp->evbase = evbase;
+    if (0 != pipe(comp->wakeup)) {
+        WW_RELEASE(comp);
+        return NULL;
+    }
+    ww_fd_set_cloexec(comp->wakeup[0]);
+    ww_fd_set_cloexec(comp->wakeup[1]);
+    fcntl(comp->wakeup[0], F_SETFL, fcntl(comp->wakeup[0], F_GETFL) | O_NONBLOCK);
+    fcntl(comp->wakeup[1], F_SETFL, fcntl(comp->wakeup[1], F_GETFL) | O_NONBLOCK);
+    /* we are running on the requesting base, so it is safe to
+     * add an event to it */
+    ww_event_set(evbase, &comp->ev, comp->wakeup[0], EV_READ | WW_EV_PERSIST,
+                 deliver, comp);
+    ww_event_add(&comp->ev, NULL);
+    comp->ev_active = true;
+    ww_mutex_lock(&comp_lock);
+    comp->listed = true;
+    ww_list_append(&completions, &comp->super);
+    ww_mutex_unlock(&comp_lock);
+    return comp;
+}
+
+ww_status_t ww_sec_base_validate_cred_nb(ww_sec_module_t *module,
+                                         ww_peer_t *peer, const char *cred,
+                                         ww_event_base_t *evbase,
+                                         ww_sec_base_validate_cbfunc_t cbfunc,
+                                         void *cbdata)
+{
+    ww_sec_base_validate_req_t *req;
+    ww_sec_base_completion_t *comp;
+    ww_sec_base_flow_t *flow;
+    uint64_t key;
+    ww_status_t rc;
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    if (NULL == module || NULL == module->validate_cred ||
+        NULL == peer || NULL == cred || NULL == cbfunc) {
+        return WW_ERR_BAD_PARAM;
+    }
+    key = ww_sec_base_admit_key(peer);
+
+    if (NULL == evbase || 0 >= ww_sec_globals.validate_threads) {
+        /* nowhere to return an answer to, or no pool - do it now */
+        if (!ww_sec_base_admit(key)) {
+            return WW_ERR_RESOURCE_BUSY;
+        }
+        rc = module->validate_cred(peer, (char*)cred);
+        cbfunc(rc, peer, cbdata);
+        return WW_SUCCESS;
+    }
+
+    req = WW_NEW(ww_sec_base_validate_req_t);
+    req->module = module;
+    WW_RETAIN(peer);
+    req->peer = peer;
+    req->cred = strdup(cred);
+    req->cbfunc = cbfunc;
+    req->cbdata = cbdata;
+
+    ww_mutex_lock(&lock);
+    /* clients rarely validate anything, so only pay for
+     * the workers once someone does */
+    if (NULL == workers && WW_SUCCESS != (rc = start_workers())) {
+        ww_mutex_unlock(&lock);
+        WW_RELEASE(req);
+        return rc;
+    }
+    if (WW_SUCCESS != ww_hash_table_get_value_uint64(&flows, key, (void**)&flow)) {
+        flow = NULL;
+    } else if (0 < ww_sec_globals.admit_queue_depth &&
+               ww_sec_globals.admit_queue_depth <= (int)ww_list_get_size(&flow->reqs)) {
+        /* this uid already has all the backlog it is allowed */
+        ww_mutex_unlock(&lock);
+        WW_RELEASE(req);
+        return WW_ERR_RESOURCE_BUSY;
+    }
+    /* only charge the rate for requests we actually take */
+    if (!ww_sec_base_admit(key)) {
+        ww_mutex_unlock(&lock);
+        WW_RELEASE(req);
+        return WW_ERR_RESOURCE_BUSY;
+    }
+    /* only create a completion for a request that will be answered -
+     * one left with nothing outstanding would never be freed */
+    if (NULL == (comp = get_completion(evbase))) {
+        ww_mutex_unlock(&lock);
+        WW_RELEASE(req);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    comp->outstanding++;
+    if (NULL == flow) {
+        flow = WW_NEW(ww_sec_base_flow_t);
+        flow->key = key;
+        ww_hash_table_set_value_uint64(&flows, key, flow);
+        ww_list_append(&ready, &flow->super);
+    }
+    req->completion = comp;
+    ww_list_append(&flow->reqs, &req->super);
+    ww_condition_signal(&cond);
+    ww_mutex_unlock(&lock);
+
+    return WW_SUCCESS;
+}
+
+void ww_sec_base_validate_init(void)
+{
+    WW_CONSTRUCT(&lock, ww_mutex_t);
+    WW_CONSTRUCT(&cond, ww_condition_t);
+    WW_CONSTRUCT(&flows, ww_hash_table_t);
+    ww_hash_table_init(&flows, 256);
+    WW_CONSTRUCT(&ready, ww_list_t);
+    WW_CONSTRUCT(&completions, ww_list_t);
+    workers = NULL;
+    nworkers = 0;
+    active = false;
+    initialized = true;
+}
+
+void ww_sec_base_validate_finalize(void)
+{
+    ww_sec_base_validate_req_t *req;
+    ww_sec_base_completion_t *comp;
+    ww_sec_base_flow_t *flow;
+    ww_list_item_t *item;
+    int i;
+
+    if (!initialized) {
+        return;
+    }
+    initialized = false;
+
+    if (NULL != workers) {
+        ww_mutex_lock(&lock);
+        active = false;
+        ww_condition_broadcast(&cond);
+        ww_mutex_unlock(&lock);
+        for (i=0; i < nworkers; i++) {
+            ww_thread_join(&workers[i], NULL);
+            WW_DESTRUCT(&workers[i]);
+        }
+        free(workers);
+        workers = NULL;
+        nworkers = 0;
+    }
+
+    /* fail whatever the workers never got to. The answers go back
+     * like any other, so the callbacks still run on the bases that
+     * made the requests - we cannot run them here, nor touch those
+     * bases from this thread */
+    while (NULL != (item = ww_list_remove_first(&ready))) {
+        flow = (ww_sec_base_flow_t*)item;
+        while (NULL != (item = ww_list_remove_first(&flow->reqs))) {
+            req = (ww_sec_base_validate_req_t*)item;
+            req->status = WW_ERR_NOT_AVAILABLE;
+            complete(req);
+        }
+        ww_hash_table_remove_value_uint64(&flows, flow->key);
+        WW_RELEASE(flow);
+    }
+    WW_DESTRUCT(&flows);
+    WW_DESTRUCT(&ready);
+
+    /* completions still waiting to be delivered now belong to their
+     * bases, which free them once the last answer is in */
+    ww_mutex_lock(&comp_lock);
+    while (NULL != (item = ww_list_remove_first(&completions))) {
+        comp = (ww_sec_base_completion_t*)item;
+        comp->listed = false;
+    }
+    ww_mutex_unlock(&comp_lock);
+    WW_DESTRUCT(&completions);
+    WW_DESTRUCT(&cond);
+    WW_DESTRUCT(&lock);
+}
+
+/* result of a validation awaited by a coroutine */
+typedef struct {
+    ww_coro_t *co;
+    ww_status_t status;
+} ww_sec_base_await_t;
+
+static void await_cb(ww_status_t status, ww_peer_t *peer, void *cbdata)
+{
+    ww_sec_base_await_t *aw = (ww_sec_base_await_t*)cbdata;
+
+    aw->status = status;
+    ww_coro_resume(aw->co);
+}
+
+ww_status_t ww_sec_base_validate_cred_await(ww_coro_t *co,
+                                            ww_sec_module_t *module,
+                                            ww_peer_t *peer, const char *cred)
+{
+    ww_sec_base_await_t aw;
+    ww_status_t rc;
+
+    aw.co = co;
+    aw.status = WW_ERROR;
+    /* the answer comes back on our own thread's event base */
+    if (WW_SUCCESS != (rc = ww_sec_base_validate_cred_nb(module, peer, cred,
+                                                         ww_coro_evbase(co),
+                                                         await_cb, &aw))) {
+        return rc;
+    }
+    ww_coro_suspend(co);
+    return aw.status;
+}
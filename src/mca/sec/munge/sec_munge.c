@@ -14,37 +14,231 @@
 
 #include <ww_types.h>
 
+#include "src/class/ww_hash_table.h"
+#include "src/class/ww_list.h"
 #include "src/runtime/ww_rte.h"
+#include "src/threads/threads.h"
 #include "src/util/argv.h"
+#include "src/util/error.h"
 #include "src/util/output.h"
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef HAVE_SYS_TYPES_H
 #include <sys/types.h>
 #endif
 #include <munge.h>
 
-#include "ww_sec.h"
-#include "ww_munge.h"
+#include "src/mca/sec/sec.h"
+#include "src/mca/sec/base/base.h"
+#include "sec_munge.h"
 
 static int munge_init(void);
 static void munge_finalize(void);
 static char* create_cred(void);
 static int validate_cred(ww_peer_t *peer, char *cred);
+static void set_token(const char *token);
+static char* issue_token(ww_peer_t *peer);
+static ww_status_t client_handshake(int sd);
+static ww_status_t server_handshake(ww_peer_t *peer);
 
 ww_sec_module_t ww_munge_module = {
     "munge",
     munge_init,
     munge_finalize,
     create_cred,
-    NULL,
+    client_handshake,
     validate_cred,
-    NULL
+    server_handshake,
+    set_token,
+    issue_token
 };
 
+/* session tokens are distinguished from munge credentials by
+ * their prefix, which munge never generates */
+#define WW_MUNGE_TOKEN_PREFIX   "ww-token:"
+#define WW_MUNGE_TOKEN_BYTES    16
+
+/* Everything the server remembers about a credential or token it
+ * has seen, keyed on the whole string - two different credentials
+ * never share an entry. Every entry in a table shares the same TTL,
+ * so the insertion-ordered list is also ordered by expiration and the
+ * oldest entry is always at its head */
+typedef struct {
+    ww_list_item_t super;
+    char *cred;
+    size_t len;
+    /* replays only hold the uid/gid once the credential decodes */
+    uid_t uid;
+    gid_t gid;
+    time_t expires;
+    /* tokens only: the connection it was issued on, and whether the
+     * kernel vouched for the uid/gid of that connection */
+    ww_peer_t *peer;
+    bool verified;
+} ww_munge_cache_entry_t;
+static void mcecon(ww_munge_cache_entry_t *p)
+{
+    p->cred = NULL;
+    p->peer = NULL;
+    p->verified = false;
+}
+static void mcedes(ww_munge_cache_entry_t *p)
+{
+    if (NULL != p->cred) {
+        free(p->cred);
+    }
+    if (NULL != p->peer) {
+        WW_RELEASE(p->peer);
+    }
+}
+static WW_CLASS_INSTANCE(ww_munge_cache_entry_t,
+                         ww_list_item_t,
+                         mcecon, mcedes);
+
+typedef struct {
+    ww_hash_table_t table;
+    ww_list_t fifo;
+    int ttl;
+} ww_munge_cache_t;
+
 static char *mycred = NULL;
 static bool initialized = false;
 static bool refresh = false;
+static ww_mutex_t lock;
+static ww_munge_cache_t replays;
+static ww_munge_cache_t tokens;
+static char *mytoken = NULL;
+static time_t mytoken_expires = 0;
+static int randfd = -1;
+
+static void cache_init(ww_munge_cache_t *cache, int ttl)
+{
+    WW_CONSTRUCT(&cache->table, ww_hash_table_t);
+    ww_hash_table_init(&cache->table, 256);
+    WW_CONSTRUCT(&cache->fifo, ww_list_t);
+    cache->ttl = ttl;
+}
+
+static void cache_finalize(ww_munge_cache_t *cache)
+{
+    WW_LIST_DESTRUCT(&cache->fifo);
+    WW_DESTRUCT(&cache->table);
+}
+
+/* must be called with the lock held */
+static void cache_remove(ww_munge_cache_t *cache, ww_munge_cache_entry_t *entry)
+{
+    ww_hash_table_remove_value_ptr(&cache->table, entry->cred, entry->len);
+    ww_list_remove_item(&cache->fifo, &entry->super);
+    WW_RELEASE(entry);
+}
+
+/* drop expired entries, and the oldest ones if we are still at the
+ * size limit - must be called with the lock held */
+static void cache_trim(ww_munge_cache_t *cache, time_t now)
+{
+    ww_munge_cache_entry_t *entry;
+
+    while (NULL != (entry = (ww_munge_cache_entry_t*)ww_list_get_first(&cache->fifo)) &&
+           entry != (ww_munge_cache_entry_t*)ww_list_get_end(&cache->fifo)) {
+        if (entry->expires > now &&
+            (int)ww_list_get_size(&cache->fifo) < mca_sec_munge_component.cache_size) {
+            break;
+        }
+        cache_remove(cache, entry);
+    }
+}
+
+/* must be called with the lock held */
+static ww_munge_cache_entry_t* cache_lookup(ww_munge_cache_t *cache,
+                                            const char *cred, time_t now)
+{
+    ww_munge_cache_entry_t *entry;
+
+    if (WW_SUCCESS != ww_hash_table_get_value_ptr(&cache->table, cred, strlen(cred),
+                                                  (void**)&entry)) {
+        return NULL;
+    }
+    if (entry->expires <= now) {
+        cache_remove(cache, entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* must be called with the lock held */
+static ww_munge_cache_entry_t* cache_insert(ww_munge_cache_t *cache, const char *cred,
+                                            uid_t uid, gid_t gid, time_t now)
+{
+    ww_munge_cache_entry_t *entry;
+
+    if (0 >= mca_sec_munge_component.cache_size) {
+        return NULL;
+    }
+    if (NULL != cache_lookup(cache, cred, now)) {
+        /* still live - callers check before inserting */
+        return NULL;
+    }
+    cache_trim(cache, now);
+    entry = WW_NEW(ww_munge_cache_entry_t);
+    if (NULL == (entry->cred = strdup(cred))) {
+        WW_RELEASE(entry);
+        return NULL;
+    }
+    entry->len = strlen(cred);
+    entry->uid = uid;
+    entry->gid = gid;
+    entry->expires = now + cache->ttl;
+    if (WW_SUCCESS != ww_hash_table_set_value_ptr(&cache->table, entry->cred,
+                                                  entry->len, entry)) {
+        WW_RELEASE(entry);
+        return NULL;
+    }
+    ww_list_append(&cache->fifo, &entry->super);
+    return entry;
+}
+
+/* record that a credential has been presented - returns false if it
+ * already was, i.e., this is a replay, along with whose it was if that
+ * is known yet. The check and the record are made under one hold of
+ * the lock, so that of two concurrent presentations of the same
+ * credential only one gets through */
+static bool replay_claim(const char *cred, time_t now, uid_t *uid, gid_t *gid)
+{
+    ww_munge_cache_entry_t *entry;
+    bool fresh = false;
+
+    ww_mutex_lock(&lock);
+    if (NULL == (entry = cache_lookup(&replays, cred, now))) {
+        /* remember it whether or not it turns out to be valid -
+         * it has been used either way. Whose it is only becomes
+         * known once munged has decoded it */
+        cache_insert(&replays, cred, (uid_t)-1, (gid_t)-1, now);
+        fresh = true;
+    } else {
+        *uid = entry->uid;
+        *gid = entry->gid;
+    }
+    ww_mutex_unlock(&lock);
+    return fresh;
+}
+
+/* note who a claimed credential turned out to belong to */
+static void replay_record(const char *cred, uid_t uid, gid_t gid)
+{
+    ww_munge_cache_entry_t *entry;
+
+    ww_mutex_lock(&lock);
+    if (NULL != (entry = cache_lookup(&replays, cred, time(NULL)))) {
+        entry->uid = uid;
+        entry->gid = gid;
+    }
+    ww_mutex_unlock(&lock);
+}
 
 static int munge_init(void)
 {
@@ -63,6 +257,21 @@ static int munge_init(void)
                             munge_strerror(rc));
         return WW_ERR_SERVER_NOT_AVAIL;
     }
+
+    WW_CONSTRUCT(&lock, ww_mutex_t);
+    cache_init(&replays, mca_sec_munge_component.cache_ttl);
+    cache_init(&tokens, mca_sec_munge_component.token_ttl);
+    if (0 < mca_sec_munge_component.token_ttl) {
+        /* without a source of randomness we cannot issue
+         * tokens, but credentials still work */
+        randfd = open("/dev/urandom", O_RDONLY);
+    }
+    if (WW_SUCCESS != (rc = ww_sec_munge_pool_init())) {
+        /* not fatal - we just mint every credential on demand */
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: munge credential pool unavailable: %s",
+                            WW_Error_string(rc));
+    }
     initialized = true;
 
     return WW_SUCCESS;
@@ -73,10 +282,23 @@ static void munge_finalize(void)
     ww_output_verbose(2, ww_globals.debug_output,
                         "sec: munge finalize");
     if (initialized) {
+        ww_sec_munge_pool_finalize();
         if (NULL != mycred) {
             free(mycred);
             mycred = NULL;
         }
+        if (NULL != mytoken) {
+            free(mytoken);
+            mytoken = NULL;
+        }
+        if (0 <= randfd) {
+            close(randfd);
+            randfd = -1;
+        }
+        cache_finalize(&replays);
+        cache_finalize(&tokens);
+        WW_DESTRUCT(&lock);
+        initialized = false;
     }
 }
 
@@ -89,9 +311,24 @@ static char* create_cred(void)
                         "sec: munge create_cred");
 
     if (initialized) {
+        /* a session token saves the server a trip to munged */
+        ww_mutex_lock(&lock);
+        if (NULL != mytoken) {
+            if (time(NULL) < mytoken_expires) {
+                resp = strdup(mytoken);
+                ww_mutex_unlock(&lock);
+                return resp;
+            }
+            free(mytoken);
+            mytoken = NULL;
+        }
+        ww_mutex_unlock(&lock);
+
         if (!refresh) {
             refresh = true;
             resp = strdup(mycred);
+        } else if (NULL != (resp = ww_sec_munge_pool_get())) {
+            /* nothing more to do - the pool minted it ahead of time */
         } else {
             /* munge does not allow reuse of a credential, so we have to
              * refresh it for every use */
@@ -110,6 +347,35 @@ static char* create_cred(void)
     return resp;
 }
 
+/* A token is a bearer secret, so it is only honored where its holder
+ * could not have stolen it: on the connection it was issued on, or on
+ * another local connection the kernel reports as the same uid/gid */
+static int validate_token(ww_peer_t *peer, char *cred)
+{
+    ww_munge_cache_entry_t *entry;
+    uid_t uid;
+    gid_t gid;
+    bool local;
+    int rc = WW_ERR_INVALID_CRED;
+
+    /* ask the kernel before taking the lock */
+    local = (0 <= peer->sd && ww_sec_base_peer_creds(peer->sd, &uid, &gid));
+
+    ww_mutex_lock(&lock);
+    if (NULL != (entry = cache_lookup(&tokens, cred, time(NULL))) &&
+        entry->uid == peer->uid && entry->gid == peer->gid &&
+        (entry->peer == peer ||
+         (entry->verified && local && entry->uid == uid && entry->gid == gid))) {
+        rc = WW_SUCCESS;
+    }
+    ww_mutex_unlock(&lock);
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge session token %s",
+                        (WW_SUCCESS == rc) ? "valid" : "rejected");
+    return rc;
+}
+
 static int validate_cred(ww_peer_t *peer, char *cred)
 {
     uid_t uid;
@@ -119,6 +385,24 @@ static int validate_cred(ww_peer_t *peer, char *cred)
     ww_output_verbose(2, ww_globals.debug_output,
                         "sec: munge validate_cred %s", cred);
 
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+
+    if (0 == strncmp(cred, WW_MUNGE_TOKEN_PREFIX, strlen(WW_MUNGE_TOKEN_PREFIX))) {
+        return validate_token(peer, cred);
+    }
+
+    /* a credential can only be used once - if we have already
+     * seen it, then this is a replay and we can reject it
+     * without asking munged */
+    if (!replay_claim(cred, time(NULL), &uid, &gid)) {
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: munge rejected replayed credential of %lu:%lu",
+                            (unsigned long)uid, (unsigned long)gid);
+        return WW_ERR_INVALID_CRED;
+    }
+
     /* parse the inbound string */
     if (EMUNGE_SUCCESS != (rc = munge_decode(cred, NULL, NULL, NULL, &uid, &gid))) {
         ww_output_verbose(2, ww_globals.debug_output,
@@ -126,14 +410,15 @@ static int validate_cred(ww_peer_t *peer, char *cred)
                             munge_strerror(rc));
         return WW_ERR_INVALID_CRED;
     }
+    replay_record(cred, uid, gid);
 
     /* check uid */
-    if (uid != peer->info->uid) {
+    if (uid != peer->uid) {
         return WW_ERR_INVALID_CRED;
     }
 
     /* check guid */
-    if (gid != peer->info->gid) {
+    if (gid != peer->gid) {
         return WW_ERR_INVALID_CRED;
     }
 
@@ -142,3 +427,190 @@ static int validate_cred(ww_peer_t *peer, char *cred)
     return WW_SUCCESS;
 }
 
+static void set_token(const char *token)
+{
+    if (!initialized) {
+        return;
+    }
+    ww_mutex_lock(&lock);
+    if (NULL != mytoken) {
+        free(mytoken);
+        mytoken = NULL;
+    }
+    if (NULL != token) {
+        mytoken = strdup(token);
+        /* we cannot see the server's clock, so assume the token
+         * lives for our own configured lifetime */
+        mytoken_expires = time(NULL) + mca_sec_munge_component.token_ttl;
+    }
+    ww_mutex_unlock(&lock);
+}
+
+static char* issue_token(ww_peer_t *peer)
+{
+    unsigned char bytes[WW_MUNGE_TOKEN_BYTES];
+    char token[sizeof(WW_MUNGE_TOKEN_PREFIX) + 2*WW_MUNGE_TOKEN_BYTES];
+    ww_munge_cache_entry_t *entry;
+    uid_t uid;
+    gid_t gid;
+    bool verified;
+    char *p;
+    int i;
+
+    if (!initialized || 0 > randfd || 0 >= mca_sec_munge_component.token_ttl) {
+        return NULL;
+    }
+    if (sizeof(bytes) != read(randfd, bytes, sizeof(bytes))) {
+        return NULL;
+    }
+    p = token + strlen(WW_MUNGE_TOKEN_PREFIX);
+    memcpy(token, WW_MUNGE_TOKEN_PREFIX, strlen(WW_MUNGE_TOKEN_PREFIX));
+    for (i=0; i < WW_MUNGE_TOKEN_BYTES; i++) {
+        p += sprintf(p, "%02x", bytes[i]);
+    }
+
+    /* only a connection the kernel vouches for as the token's own
+     * uid/gid lets it be used on other connections */
+    verified = (0 <= peer->sd && ww_sec_base_peer_creds(peer->sd, &uid, &gid) &&
+                uid == peer->uid && gid == peer->gid);
+
+    ww_mutex_lock(&lock);
+    entry = cache_insert(&tokens, token, peer->uid, peer->gid, time(NULL));
+    if (NULL != entry) {
+        WW_RETAIN(peer);
+        entry->peer = peer;
+        entry->verified = verified;
+    }
+    ww_mutex_unlock(&lock);
+    if (NULL == entry) {
+        /* nowhere to remember it, so it could never be honored */
+        return NULL;
+    }
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge issued session token to %lu:%lu",
+                        (unsigned long)peer->uid, (unsigned long)peer->gid);
+    return strdup(token);
+}
+
+/* The client mints a credential carrying a fresh session key as its
+ * payload. Only munged can create a credential that decodes, so the
+ * server learns both who we are and a key that nobody else on the
+ * wire has seen */
+static ww_status_t client_handshake(int sd)
+{
+    uint8_t key[WW_SEC_SESSION_KEYLEN];
+    char *cred;
+    munge_err_t mrc;
+    ww_status_t rc;
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge client_handshake");
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_random(key, sizeof(key)))) {
+        return rc;
+    }
+    if (EMUNGE_SUCCESS != (mrc = munge_encode(&cred, NULL, key, sizeof(key)))) {
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: munge failed to create credential: %s",
+                            munge_strerror(mrc));
+        memset(key, 0, sizeof(key));
+        return WW_ERR_HANDSHAKE_FAILED;
+    }
+    rc = ww_sec_base_send_blob(sd, cred, strlen(cred));
+    free(cred);
+    if (WW_SUCCESS == rc) {
+        rc = ww_sec_base_session_create(sd, key, false);
+    }
+    memset(key, 0, sizeof(key));
+    if (WW_SUCCESS != rc) {
+        return rc;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_session_await(sd))) {
+        ww_sec_base_session_close(sd);
+        return rc;
+    }
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge session established");
+    return WW_SUCCESS;
+}
+
+static ww_status_t server_handshake(ww_peer_t *peer)
+{
+    char *cred;
+    void *payload = NULL;
+    int plen = 0;
+    uint32_t len;
+    uid_t uid;
+    gid_t gid;
+    munge_err_t mrc;
+    ww_status_t rc;
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge server_handshake");
+
+    if (!initialized) {
+        return WW_ERR_INIT;
+    }
+    if (0 > peer->sd) {
+        return WW_ERR_BAD_PARAM;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_recv_blob(peer->sd, (void**)&cred, &len))) {
+        return rc;
+    }
+
+    /* the same replay protection as a plain credential */
+    if (!replay_claim(cred, time(NULL), &uid, &gid)) {
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: munge rejected replayed handshake of %lu:%lu",
+                            (unsigned long)uid, (unsigned long)gid);
+        rc = WW_ERR_INVALID_CRED;
+        goto reject;
+    }
+
+    if (EMUNGE_SUCCESS != (mrc = munge_decode(cred, NULL, &payload, &plen, &uid, &gid))) {
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: munge failed to decode credential: %s",
+                            munge_strerror(mrc));
+        rc = WW_ERR_INVALID_CRED;
+        goto reject;
+    }
+    replay_record(cred, uid, gid);
+
+    if (uid != peer->uid || gid != peer->gid ||
+        WW_SEC_SESSION_KEYLEN != plen) {
+        rc = WW_ERR_INVALID_CRED;
+        goto reject;
+    }
+    rc = ww_sec_base_session_create(peer->sd, (uint8_t*)payload, true);
+    memset(payload, 0, plen);
+    free(payload);
+    payload = NULL;
+    free(cred);
+    if (WW_SUCCESS != rc) {
+        return rc;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_session_confirm(peer->sd))) {
+        ww_sec_base_session_close(peer->sd);
+        return rc;
+    }
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: munge session established with %lu:%lu",
+                        (unsigned long)peer->uid, (unsigned long)peer->gid);
+    return WW_SUCCESS;
+
+  reject:
+    if (NULL != payload) {
+        memset(payload, 0, plen);
+        free(payload);
+    }
+    free(cred);
+    /* let the client know rather than leave it waiting */
+    ww_sec_base_send_blob(peer->sd, NULL, 0);
+    return rc;
+}
@@ -11,13 +11,32 @@
 #ifndef WW_MUNGE_H
 #define WW_MUNGE_H
 
+#include <src/include/ww_config.h>
+
+#include "src/mca/sec/sec.h"
+
 BEGIN_C_DECLS
 
-#include <src/include/ww_config.h>
+typedef struct {
+    ww_sec_base_component_t super;
+    int cache_size;     // max number of validated credentials and tokens remembered
+    int cache_ttl;      // seconds a validated credential is remembered to reject replays
+    int token_ttl;      // seconds an issued session token remains valid - zero disables tokens
+    int pool_low;       // refill the credential pool when it drops below this many
+    int pool_high;      // number of credentials to keep pre-minted - zero disables the pool
+    int pool_max_age;   // seconds before a pre-minted credential is discarded unused
+} ww_sec_munge_component_t;
 
+extern ww_sec_munge_component_t mca_sec_munge_component;
 
 extern ww_sec_module_t ww_munge_module;
 
+/* pre-minted credential pool - get returns NULL if the
+ * pool is disabled or currently empty */
+ww_status_t ww_sec_munge_pool_init(void);
+void ww_sec_munge_pool_finalize(void);
+char* ww_sec_munge_pool_get(void);
+
 END_C_DECLS
 
 #endif
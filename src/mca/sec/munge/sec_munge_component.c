@@ -30,9 +30,11 @@
 #include "ww_types.h"
 
 
+#include "src/mca/base/mca_base_var.h"
 #include "src/mca/sec/sec.h"
 #include "sec_munge.h"
 
+static int component_register(void);
 static ww_status_t component_open(void);
 static ww_status_t component_close(void);
 static ww_status_t component_query(mca_base_module_t **module, int *priority);
@@ -41,27 +43,82 @@ static ww_status_t component_query(mca_base_module_t **module, int *priority);
  * Instantiate the public struct with all of our public information
  * and pointers to our public functions in it
  */
-ww_sec_base_component_t mca_ww_sec_component = {
-    .base = {
-        WW_SEC_BASE_VERSION_1_0_0,
-
-        /* Component name and version */
-        .mca_component_name = "munge",
-        MCA_BASE_MAKE_VERSION(component, WW_MAJOR_VERSION, WW_MINOR_VERSION,
-                              WW_RELEASE_VERSION),
-
-        /* Component open and close functions */
-        .mca_open_component = component_open,
-        .mca_close_component = component_close,
-        .mca_query_component = component_query,
-    },
-    .data = {
-        /* The component is checkpoint ready */
-        MCA_BASE_METADATA_PARAM_CHECKPOINT
+ww_sec_munge_component_t mca_sec_munge_component = {
+    .super = {
+        .base = {
+            WW_SEC_BASE_VERSION_1_0_0,
+
+            /* Component name and version */
+            .mca_component_name = "munge",
+            MCA_BASE_MAKE_VERSION(component, WW_MAJOR_VERSION, WW_MINOR_VERSION,
+                                  WW_RELEASE_VERSION),
+
+            /* Component open and close functions */
+            .mca_register_component_params = component_register,
+            .mca_open_component = component_open,
+            .mca_close_component = component_close,
+            .mca_query_component = component_query,
+        },
+        .data = {
+            /* The component is checkpoint ready */
+            MCA_BASE_METADATA_PARAM_CHECKPOINT
+        },
     },
+    .cache_size = 4096,
+    .cache_ttl = 300,
+    .token_ttl = 600,
+    .pool_low = 16,
+    .pool_high = 64,
+    .pool_max_age = 60
 };
 
 
+static int component_register(void)
+{
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "cache_size",
+                                           "Maximum number of validated credentials and session "
+                                           "tokens to remember",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.cache_size);
+
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "cache_ttl",
+                                           "Time (in seconds) a validated credential is remembered "
+                                           "so that replays can be rejected without contacting munged",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.cache_ttl);
+
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "token_ttl",
+                                           "Time (in seconds) a session token issued to an authenticated "
+                                           "peer remains valid (0 disables session tokens)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.token_ttl);
+
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "pool_high",
+                                           "Number of credentials to keep pre-minted by a background "
+                                           "thread (0 creates every credential on demand)",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.pool_high);
+
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "pool_low",
+                                           "Refill the pre-minted credential pool when it drops "
+                                           "below this many credentials",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.pool_low);
+
+    (void) mca_base_component_var_register(&mca_sec_munge_component.super.base, "pool_max_age",
+                                           "Time (in seconds) after which an unused pre-minted credential "
+                                           "is discarded - must be less than the munged credential TTL",
+                                           MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                           WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                           &mca_sec_munge_component.pool_max_age);
+    return WW_SUCCESS;
+}
+
 static int component_open(void)
 {
     return WW_SUCCESS;
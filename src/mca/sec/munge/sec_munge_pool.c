@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ *
+ * NOTE: THE MUNGE CLIENT LIBRARY (libmunge) IS LICENSED AS LGPL
+ *
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* Pool of pre-minted munge credentials.
+ *
+ * Munge credentials cannot be reused, so every request needs a fresh
+ * one - and minting one means a round trip to munged. To keep that
+ * off the caller's path, a dedicated progress thread keeps a ring of
+ * credentials topped up. Callers pop from the ring without taking a
+ * lock: the ring has a single producer (the progress thread) and any
+ * number of consumers, which claim a slot by advancing the head with
+ * a compare-and-swap. The counters never wrap, so a consumer that
+ * loses a race simply retries.
+ *
+ * The producer is woken through a pipe when a pop leaves the ring
+ * below the low watermark, and refills it to the high watermark. A
+ * periodic sweep discards credentials that have sat unused long
+ * enough that munged might reject them as expired. The producer
+ * blocks in poll rather than on an event base so that it can be
+ * woken from any thread.
+ */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <munge.h>
+
+#include "src/runtime/ww_rte.h"
+#include "src/sys/atomic.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/fd.h"
+#include "src/util/output.h"
+
+#include "src/mca/sec/sec.h"
+#include "sec_munge.h"
+
+typedef struct {
+    char *cred;
+    time_t minted;
+} ww_munge_pooled_t;
+
+static ww_munge_pooled_t * volatile *ring = NULL;
+static int64_t nslots = 0;
+static volatile int64_t head = 0;       // next slot to pop - advanced by consumers
+static volatile int64_t tail = 0;       // next slot to fill - advanced by the producer
+static volatile int32_t refill_pending = 0;
+static volatile bool active = false;
+static ww_thread_t engine;
+static int wakeup[2] = {-1, -1};
+
+static ww_munge_pooled_t* pop(void)
+{
+    ww_munge_pooled_t *item;
+    int64_t h;
+
+    do {
+        h = head;
+        if (h >= tail) {
+            return NULL;
+        }
+        ww_atomic_rmb();
+        item = ring[h % nslots];
+    } while (!ww_atomic_cmpset_64(&head, h, h + 1));
+    return item;
+}
+
+static void release_item(ww_munge_pooled_t *item)
+{
+    free(item->cred);
+    free(item);
+}
+
+/* only called from the progress thread */
+static void fill(void)
+{
+    ww_munge_pooled_t *item;
+    munge_err_t rc;
+    char *cred;
+    int64_t t;
+
+    t = tail;
+    while (t - head < nslots) {
+        if (EMUNGE_SUCCESS != (rc = munge_encode(&cred, NULL, NULL, 0))) {
+            ww_output_verbose(2, ww_globals.debug_output,
+                                "sec: munge pool failed to create credential: %s",
+                                munge_strerror(rc));
+            break;
+        }
+        if (NULL == (item = (ww_munge_pooled_t*)malloc(sizeof(ww_munge_pooled_t)))) {
+            free(cred);
+            break;
+        }
+        item->cred = cred;
+        item->minted = time(NULL);
+        ring[t % nslots] = item;
+        /* the slot must be visible before the consumers can reach it */
+        ww_atomic_wmb();
+        tail = ++t;
+    }
+}
+
+/* discard stale credentials - only called from the progress thread */
+static void sweep(void)
+{
+    ww_munge_pooled_t *item;
+    time_t oldest;
+    int64_t t;
+
+    /* credentials are minted in order, so everything stale is at
+     * the head. We cannot look at a slot without claiming it, since
+     * a consumer could take and free it under us - so pop, and hand
+     * the first fresh credential back at the tail. Consumers check
+     * the age of what they pop, so the ordering is only a hint */
+    oldest = time(NULL) - mca_sec_munge_component.pool_max_age;
+    while (NULL != (item = pop())) {
+        if (item->minted > oldest) {
+            t = tail;
+            ring[t % nslots] = item;
+            ww_atomic_wmb();
+            tail = t + 1;
+            break;
+        }
+        release_item(item);
+    }
+}
+
+static void* progress_engine(ww_object_t *obj)
+{
+    struct pollfd pfd;
+    char buf[64];
+    int timeout;
+
+    timeout = (1 < mca_sec_munge_component.pool_max_age) ?
+              500 * mca_sec_munge_component.pool_max_age : 1000;
+    pfd.fd = wakeup[0];
+    pfd.events = POLLIN;
+
+    fill();
+    while (active) {
+        if (0 < poll(&pfd, 1, timeout)) {
+            /* drain the pipe - one refill covers every wakeup */
+            while (0 < read(wakeup[0], buf, sizeof(buf))) {
+            }
+            refill_pending = 0;
+            ww_atomic_wmb();
+        } else {
+            sweep();
+        }
+        if (active) {
+            fill();
+        }
+    }
+    return WW_THREAD_CANCELLED;
+}
+
+char* ww_sec_munge_pool_get(void)
+{
+    ww_munge_pooled_t *item;
+    char *cred;
+    time_t oldest;
+
+    if (NULL == ring) {
+        return NULL;
+    }
+
+    oldest = time(NULL) - mca_sec_munge_component.pool_max_age;
+    while (NULL != (item = pop())) {
+        if (item->minted > oldest) {
+            break;
+        }
+        /* the sweep has not reached this one yet */
+        release_item(item);
+    }
+
+    if (tail - head < mca_sec_munge_component.pool_low &&
+        ww_atomic_cmpset_32(&refill_pending, 0, 1)) {
+        if (1 != write(wakeup[1], "", 1) && EAGAIN != errno) {
+            refill_pending = 0;
+        }
+    }
+
+    if (NULL == item) {
+        return NULL;
+    }
+    cred = item->cred;
+    free(item);
+    return cred;
+}
+
+ww_status_t ww_sec_munge_pool_init(void)
+{
+    if (0 >= mca_sec_munge_component.pool_high) {
+        return WW_SUCCESS;
+    }
+    nslots = mca_sec_munge_component.pool_high;
+    if (mca_sec_munge_component.pool_low > nslots) {
+        mca_sec_munge_component.pool_low = nslots;
+    }
+
+    if (0 != pipe(wakeup)) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    ww_fd_set_cloexec(wakeup[0]);
+    ww_fd_set_cloexec(wakeup[1]);
+    fcntl(wakeup[0], F_SETFL, fcntl(wakeup[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeup[1], F_SETFL, fcntl(wakeup[1], F_GETFL) | O_NONBLOCK);
+
+    ring = (ww_munge_pooled_t * volatile *)calloc(nslots, sizeof(ww_munge_pooled_t*));
+    if (NULL == ring) {
+        close(wakeup[0]);
+        close(wakeup[1]);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    head = 0;
+    tail = 0;
+
+    /* the thread fills the ring as soon as it starts */
+    active = true;
+    WW_CONSTRUCT(&engine, ww_thread_t);
+    engine.t_run = progress_engine;
+    engine.t_arg = NULL;
+    if (WW_SUCCESS != ww_thread_start(&engine)) {
+        active = false;
+        WW_DESTRUCT(&engine);
+        free((void*)ring);
+        ring = NULL;
+        close(wakeup[0]);
+        close(wakeup[1]);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    return WW_SUCCESS;
+}
+
+void ww_sec_munge_pool_finalize(void)
+{
+    ww_munge_pooled_t *item;
+
+    if (NULL == ring) {
+        return;
+    }
+    active = false;
+    ww_atomic_wmb();
+    if (1 != write(wakeup[1], "", 1)) {
+        /* the pipe is full, so the thread is about to wake anyway */
+    }
+    ww_thread_join(&engine, NULL);
+    WW_DESTRUCT(&engine);
+
+    while (NULL != (item = pop())) {
+        release_item(item);
+    }
+    free((void*)ring);
+    ring = NULL;
+    close(wakeup[0]);
+    close(wakeup[1]);
+    wakeup[0] = wakeup[1] = -1;
+}
@@ -17,26 +17,38 @@
 #include "src/util/error.h"
 #include "src/util/output.h"
 
+#include <string.h>
 #include <unistd.h>
 #ifdef HAVE_SYS_TYPES_H
 #include <sys/types.h>
 #endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_UN_H
+#include <sys/un.h>
+#endif
 
 #include "src/mca/sec/sec.h"
+#include "src/mca/sec/base/base.h"
 #include "sec_native.h"
 
 static int native_init(void);
 static void native_finalize(void);
 static char* create_cred(void);
 static int validate_cred(ww_peer_t *peer, char *cred);
+static ww_status_t client_handshake(int sd);
+static ww_status_t server_handshake(ww_peer_t *peer);
 
 ww_sec_module_t ww_native_module = {
     "native",
     native_init,
     native_finalize,
     create_cred,
-    NULL,
+    client_handshake,
     validate_cred,
+    server_handshake,
+    NULL,
     NULL
 };
 
@@ -78,6 +90,17 @@ static int validate_cred(ww_peer_t *peer, char *cred)
     gid_t gid;
     char **vals;
 
+    /* on a local socket the kernel vouches for the peer, so there
+     * is no need to parse - or trust - the string it sent */
+    if (0 <= peer->sd && ww_sec_base_peer_creds(peer->sd, &uid, &gid)) {
+        if (uid != peer->uid || gid != peer->gid) {
+            ww_output_verbose(2, ww_globals.debug_output,
+                                "sec: native peer credentials do not match");
+            return WW_ERR_INVALID_CRED;
+        }
+        return WW_SUCCESS;
+    }
+
     ww_output_verbose(2, ww_globals.debug_output,
                         "sec: native validate_cred %s", cred);
 
@@ -108,3 +131,110 @@ static int validate_cred(ww_peer_t *peer, char *cred)
     return WW_SUCCESS;
 }
 
+
+/* The native handshake sends our credential followed by the session
+ * key in the clear. That is only acceptable on a local connection,
+ * where nobody else can see the traffic - it offers no protection on
+ * a network, so both ends refuse to run it on anything but a
+ * Unix-domain socket */
+static bool local_socket(int sd)
+{
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+
+    if (0 != getsockname(sd, (struct sockaddr*)&addr, &len)) {
+        return false;
+    }
+    if (AF_UNIX != addr.ss_family) {
+        ww_output_verbose(2, ww_globals.debug_output,
+                            "sec: native refusing handshake on a non-local socket");
+        return false;
+    }
+    return true;
+}
+
+static ww_status_t client_handshake(int sd)
+{
+    uint8_t key[WW_SEC_SESSION_KEYLEN];
+    char *cred, *msg;
+    size_t len;
+    ww_status_t rc;
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: native client_handshake");
+
+    if (!local_socket(sd)) {
+        return WW_ERR_NOT_SUPPORTED;
+    }
+    if (NULL == (cred = create_cred())) {
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_random(key, sizeof(key)))) {
+        free(cred);
+        return rc;
+    }
+    /* credential, its terminator, then the key */
+    len = strlen(cred) + 1;
+    if (NULL == (msg = (char*)malloc(len + sizeof(key)))) {
+        free(cred);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    memcpy(msg, cred, len);
+    memcpy(msg + len, key, sizeof(key));
+    free(cred);
+
+    rc = ww_sec_base_send_blob(sd, msg, len + sizeof(key));
+    memset(msg, 0, len + sizeof(key));
+    free(msg);
+    if (WW_SUCCESS == rc) {
+        rc = ww_sec_base_session_create(sd, key, false);
+    }
+    memset(key, 0, sizeof(key));
+    if (WW_SUCCESS != rc) {
+        return rc;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_session_await(sd))) {
+        ww_sec_base_session_close(sd);
+    }
+    return rc;
+}
+
+static ww_status_t server_handshake(ww_peer_t *peer)
+{
+    char *msg;
+    uint32_t len;
+    size_t clen;
+    ww_status_t rc;
+
+    ww_output_verbose(2, ww_globals.debug_output,
+                        "sec: native server_handshake");
+
+    if (0 > peer->sd) {
+        return WW_ERR_BAD_PARAM;
+    }
+    if (!local_socket(peer->sd)) {
+        /* let the client know rather than leave it waiting - it
+         * will have refused to send its key anyway */
+        ww_sec_base_send_blob(peer->sd, NULL, 0);
+        return WW_ERR_NOT_SUPPORTED;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_recv_blob(peer->sd, (void**)&msg, &len))) {
+        return rc;
+    }
+    clen = strnlen(msg, len);
+    if (clen + 1 + WW_SEC_SESSION_KEYLEN != len) {
+        rc = WW_ERR_INVALID_CRED;
+    } else if (WW_SUCCESS == (rc = validate_cred(peer, msg))) {
+        rc = ww_sec_base_session_create(peer->sd, (uint8_t*)msg + clen + 1, true);
+    }
+    memset(msg, 0, len);
+    free(msg);
+    if (WW_SUCCESS != rc) {
+        ww_sec_base_send_blob(peer->sd, NULL, 0);
+        return rc;
+    }
+    if (WW_SUCCESS != (rc = ww_sec_base_session_confirm(peer->sd))) {
+        ww_sec_base_session_close(peer->sd);
+    }
+    return rc;
+}
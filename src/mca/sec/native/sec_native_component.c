@@ -41,7 +41,7 @@ static ww_status_t component_query(mca_base_module_t **module, int *priority);
  * Instantiate the public struct with all of our public information
  * and pointers to our public functions in it
  */
-ww_sec_base_component_t mca_ww_sec_component = {
+ww_sec_base_component_t mca_sec_native_component = {
     .base = {
         WW_SEC_BASE_VERSION_1_0_0,
 
@@ -62,6 +62,13 @@ typedef char* (*ww_sec_base_module_create_cred_fn_t)(void);
  * for one of them to be NULL */
 typedef ww_status_t (*ww_sec_base_module_client_hndshk_fn_t)(int sd);
 
+/**
+ * Store a session token issued by the server. Once a token is held,
+ * create_cred returns it in place of a full credential until it
+ * expires. Passing NULL discards any token being held. Optional.
+ */
+typedef void (*ww_sec_base_module_set_token_fn_t)(const char *token);
+
 
 /****    SERVER-SIDE FUNCTIONS    ****/
 /**
@@ -76,6 +83,16 @@ typedef ww_status_t (*ww_sec_base_module_validate_cred_fn_t)(ww_peer_t *peer, ch
  * for one of them to be NULL */
 typedef ww_status_t (*ww_sec_base_module_server_hndshk_fn_t)(ww_peer_t *peer);
 
+/**
+ * Issue a session token to a peer whose credential has just been
+ * validated. The token is bound to the peer's uid/gid and to its
+ * connection, and later calls to validate_cred will accept it in place
+ * of a full credential until it expires - on that connection, or on
+ * another local one the kernel reports as the same uid/gid. Caller
+ * must free the returned string. Optional.
+ */
+typedef char* (*ww_sec_base_module_issue_token_fn_t)(ww_peer_t *peer);
+
 /**
  * Base structure for a SEC module
  */
@@ -90,6 +107,9 @@ typedef struct {
     /** Server-side */
     ww_sec_base_module_validate_cred_fn_t  validate_cred;
     ww_sec_base_module_server_hndshk_fn_t  server_handshake;
+    /** Session tokens */
+    ww_sec_base_module_set_token_fn_t      set_token;
+    ww_sec_base_module_issue_token_fn_t    issue_token;
 } ww_sec_module_t;
 
 
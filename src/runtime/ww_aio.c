@@ -0,0 +1,787 @@
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/ww_config.h>
+#include "ww_types.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_SYSCALL_H) && defined(HAVE_SYS_EVENTFD_H)
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(MAP_POPULATE)
+#define WW_AIO_URING 1
+#endif
+#endif
+#ifndef WW_AIO_URING
+#define WW_AIO_URING 0
+#endif
+
+#include "src/class/ww_object.h"
+#include "src/sys/atomic.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+#include "src/util/fd.h"
+#include "src/util/output.h"
+
+#include "src/runtime/ww_params.h"
+#include "src/runtime/ww_progress_threads.h"
+#include "src/runtime/ww_aio.h"
+
+#define WW_AIO_POOL     "WW aio pool"
+
+const char ww_aio_direct[] = "direct";
+
+typedef enum {
+    WW_AIO_OP_READ,
+    WW_AIO_OP_WRITE,
+    WW_AIO_OP_FSYNC,
+    WW_AIO_OP_CALL
+} ww_aio_op_t;
+
+typedef struct ww_aio_req_t {
+    ww_object_t super;
+    /* link on the submission queue and the ring backlog */
+    struct ww_aio_req_t *next;
+    ww_aio_op_t op;
+    int fd;
+    char *buf;
+    size_t len;
+    off_t offset;
+    /* bytes transferred so far - short transfers are continued */
+    size_t done;
+#if WW_AIO_URING
+    struct iovec iov;
+#endif
+    ww_aio_fn_t fn;
+    void *arg;
+    /* where to complete - NULL to run the callback directly */
+    ww_progress_handle_t *thread;
+    ww_aio_cbfunc_t cbfunc;
+    void *cbdata;
+    ww_status_t status;
+    ww_progress_task_t task;
+} ww_aio_req_t;
+
+static void req_con(ww_aio_req_t *req)
+{
+    req->next = NULL;
+    req->buf = NULL;
+    req->len = 0;
+    req->offset = 0;
+    req->done = 0;
+    req->fn = NULL;
+    req->arg = NULL;
+    req->thread = NULL;
+    req->cbfunc = NULL;
+    req->cbdata = NULL;
+    req->status = WW_SUCCESS;
+}
+static void req_des(ww_aio_req_t *req)
+{
+    if (NULL != req->thread) {
+        ww_progress_thread_release_handle(req->thread);
+    }
+}
+static WW_CLASS_INSTANCE(ww_aio_req_t,
+                         ww_object_t,
+                         req_con, req_des);
+
+static bool aio_enabled = false;
+static bool use_ring = false;
+
+/* the worker pool runs ww_aio_call() work, and all I/O when there is
+ * no ring - it is started on first use */
+static ww_mutex_t pool_lock = WW_MUTEX_STATIC_INIT;
+static bool pool_started = false;
+
+/* requests not yet complete, so that finalize can wait for them */
+static volatile int32_t outstanding = 0;
+static ww_mutex_t drain_lock;
+static ww_condition_t drain_cond;
+
+static ww_status_t errno_status(int err)
+{
+    switch (err) {
+    case ENOMEM:
+    case ENOSPC:
+#ifdef EDQUOT
+    case EDQUOT:
+#endif
+        return WW_ERR_OUT_OF_RESOURCE;
+    case EBADF:
+    case EINVAL:
+    case EFAULT:
+        return WW_ERR_BAD_PARAM;
+    case EACCES:
+    case EPERM:
+        return WW_ERR_NO_PERMISSIONS;
+    default:
+        return WW_ERROR;
+    }
+}
+
+static void complete_task(void *arg)
+{
+    ww_aio_req_t *req = (ww_aio_req_t*)arg;
+
+    if (NULL != req->cbfunc) {
+        req->cbfunc(req->status, req->done, req->cbdata);
+    }
+    WW_RELEASE(req);
+}
+
+/* the operation is over - hand the result to whoever wants it */
+static void complete(ww_aio_req_t *req)
+{
+    /* the I/O itself is done, which is all finalize waits for - the
+     * progress thread the callback is bound for may already be gone */
+    if (0 == ww_atomic_sub_32(&outstanding, 1)) {
+        ww_mutex_lock(&drain_lock);
+        ww_condition_broadcast(&drain_cond);
+        ww_mutex_unlock(&drain_lock);
+    }
+
+    if (NULL != req->thread) {
+        WW_PROGRESS_TASK_SET(&req->task, complete_task, req);
+        if (WW_SUCCESS == ww_progress_thread_shift_to(req->thread, &req->task)) {
+            return;
+        }
+    }
+    complete_task(req);
+}
+
+/* carry out a request with blocking calls - on a pool thread */
+static void run_req(void *arg)
+{
+    ww_aio_req_t *req = (ww_aio_req_t*)arg;
+    ssize_t rc;
+
+    switch (req->op) {
+    case WW_AIO_OP_READ:
+    case WW_AIO_OP_WRITE:
+        while (req->done < req->len) {
+            if (WW_AIO_OP_READ == req->op) {
+                rc = pread(req->fd, req->buf + req->done, req->len - req->done,
+                           req->offset + req->done);
+            } else {
+                rc = pwrite(req->fd, req->buf + req->done, req->len - req->done,
+                            req->offset + req->done);
+            }
+            if (0 > rc) {
+                if (EINTR == errno || EAGAIN == errno) {
+                    continue;
+                }
+                req->status = errno_status(errno);
+                break;
+            }
+            if (0 == rc) {
+                /* end of file */
+                break;
+            }
+            req->done += rc;
+        }
+        break;
+    case WW_AIO_OP_FSYNC:
+        if (0 != fsync(req->fd)) {
+            req->status = errno_status(errno);
+        }
+        break;
+    case WW_AIO_OP_CALL:
+        req->status = req->fn(req->arg);
+        break;
+    }
+    complete(req);
+}
+
+static int pool_start(void)
+{
+    int rc = WW_SUCCESS;
+
+    ww_mutex_lock(&pool_lock);
+    if (!pool_started) {
+        rc = ww_progress_thread_pool_init(WW_AIO_POOL,
+                                          (0 < ww_aio_threads) ? ww_aio_threads : 1);
+        pool_started = (WW_SUCCESS == rc);
+    }
+    ww_mutex_unlock(&pool_lock);
+    return rc;
+}
+
+#if WW_AIO_URING
+
+/*
+ * The ring. Only the I/O thread touches it: other threads push their
+ * requests onto the submitted stack and poke the eventfd, which the
+ * ring always has a poll outstanding on, so that the I/O thread can
+ * block in the kernel waiting for completions and still hear about
+ * new work.
+ */
+typedef struct {
+    int fd;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    unsigned cq_entries;
+    struct io_uring_cqe *cqes;
+
+    /* wakeup for the I/O thread */
+    int efd;
+    bool poll_armed;
+    /* entries handed to the kernel that have yet to complete - kept
+     * within the completion queue so that it can never overflow */
+    unsigned inkernel;
+    /* entries queued that the kernel has yet to accept */
+    unsigned unsubmitted;
+    /* requests waiting for room in the ring, oldest first */
+    ww_aio_req_t *backlog;
+    ww_aio_req_t *backlog_tail;
+
+    ww_thread_t engine;
+    volatile bool active;
+} ww_aio_ring_t;
+
+static ww_aio_ring_t ring;
+static ww_aio_req_t * volatile submitted = NULL;
+
+static void ring_unmap(void)
+{
+    if (NULL != ring.sqes) {
+        munmap(ring.sqes, ring.sqes_size);
+    }
+    if (NULL != ring.cq_ptr) {
+        munmap(ring.cq_ptr, ring.cq_size);
+    }
+    if (NULL != ring.sq_ptr) {
+        munmap(ring.sq_ptr, ring.sq_size);
+    }
+    if (0 <= ring.efd) {
+        close(ring.efd);
+    }
+    if (0 <= ring.fd) {
+        close(ring.fd);
+    }
+}
+
+static int ring_setup(unsigned depth)
+{
+    struct io_uring_params p;
+    void *ptr;
+
+    memset(&ring, 0, sizeof(ring));
+    ring.efd = -1;
+    memset(&p, 0, sizeof(p));
+    if (0 > (ring.fd = syscall(__NR_io_uring_setup, depth, &p))) {
+        /* old kernel, or forbidden by seccomp */
+        return WW_ERR_NOT_SUPPORTED;
+    }
+
+    /* the two rings are mapped separately, which every kernel with
+     * io_uring supports */
+    ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == ptr) {
+        goto error;
+    }
+    ring.sq_ptr = ptr;
+    ptr = mmap(NULL, ring.cq_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == ptr) {
+        goto error;
+    }
+    ring.cq_ptr = ptr;
+    ptr = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+    if (MAP_FAILED == ptr) {
+        goto error;
+    }
+    ring.sqes = (struct io_uring_sqe*)ptr;
+
+    ring.sq_head = (unsigned*)((char*)ring.sq_ptr + p.sq_off.head);
+    ring.sq_tail = (unsigned*)((char*)ring.sq_ptr + p.sq_off.tail);
+    ring.sq_mask = *(unsigned*)((char*)ring.sq_ptr + p.sq_off.ring_mask);
+    ring.sq_entries = p.sq_entries;
+    ring.sq_array = (unsigned*)((char*)ring.sq_ptr + p.sq_off.array);
+    ring.cq_head = (unsigned*)((char*)ring.cq_ptr + p.cq_off.head);
+    ring.cq_tail = (unsigned*)((char*)ring.cq_ptr + p.cq_off.tail);
+    ring.cq_mask = *(unsigned*)((char*)ring.cq_ptr + p.cq_off.ring_mask);
+    ring.cq_entries = p.cq_entries;
+    ring.cqes = (struct io_uring_cqe*)((char*)ring.cq_ptr + p.cq_off.cqes);
+
+    if (0 > (ring.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+        goto error;
+    }
+    return WW_SUCCESS;
+
+  error:
+    ring_unmap();
+    return WW_ERR_NOT_SUPPORTED;
+}
+
+/* claim the next submission entry, if there is room for one */
+static struct io_uring_sqe* ring_get_sqe(void)
+{
+    unsigned tail = *ring.sq_tail;
+    unsigned idx;
+
+    if (ring.inkernel + ring.unsubmitted >= ring.cq_entries ||
+        tail - *(volatile unsigned*)ring.sq_head >= ring.sq_entries) {
+        return NULL;
+    }
+    idx = tail & ring.sq_mask;
+    ring.sq_array[idx] = idx;
+    memset(&ring.sqes[idx], 0, sizeof(struct io_uring_sqe));
+    /* make the entry visible before the kernel can see the new tail */
+    ww_atomic_wmb();
+    *(volatile unsigned*)ring.sq_tail = tail + 1;
+    ring.unsubmitted++;
+    return &ring.sqes[idx];
+}
+
+static void ring_prep(struct io_uring_sqe *sqe, ww_aio_req_t *req)
+{
+    sqe->fd = req->fd;
+    sqe->user_data = (uint64_t)(uintptr_t)req;
+    switch (req->op) {
+    case WW_AIO_OP_READ:
+    case WW_AIO_OP_WRITE:
+        /* the vectored forms go back furthest */
+        sqe->opcode = (WW_AIO_OP_READ == req->op) ? IORING_OP_READV : IORING_OP_WRITEV;
+        req->iov.iov_base = req->buf + req->done;
+        req->iov.iov_len = req->len - req->done;
+        sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+        sqe->len = 1;
+        sqe->off = (uint64_t)(req->offset + req->done);
+        break;
+    case WW_AIO_OP_FSYNC:
+        sqe->opcode = IORING_OP_FSYNC;
+        break;
+    default:
+        /* calls never come to the ring */
+        sqe->opcode = IORING_OP_NOP;
+        break;
+    }
+}
+
+static void ring_backlog(ww_aio_req_t *req)
+{
+    req->next = NULL;
+    if (NULL == ring.backlog) {
+        ring.backlog = req;
+    } else {
+        ring.backlog_tail->next = req;
+    }
+    ring.backlog_tail = req;
+}
+
+/* move everything submitted since we last looked onto the backlog */
+static void ring_take(void)
+{
+    ww_aio_req_t *list, *fifo = NULL, *req;
+
+    do {
+        list = submitted;
+    } while (NULL != list && !ww_atomic_cmpset_ptr(&submitted, list, NULL));
+
+    /* it was built newest first */
+    while (NULL != list) {
+        req = list;
+        list = list->next;
+        req->next = fifo;
+        fifo = req;
+    }
+    while (NULL != fifo) {
+        req = fifo;
+        fifo = fifo->next;
+        ring_backlog(req);
+    }
+}
+
+static void ring_reap(void)
+{
+    unsigned head = *ring.cq_head;
+    unsigned tail = *(volatile unsigned*)ring.cq_tail;
+    struct io_uring_cqe *cqe;
+    ww_aio_req_t *req;
+    uint64_t count;
+    int res;
+
+    /* read the entries only after seeing the tail */
+    ww_atomic_rmb();
+    while (head != tail) {
+        cqe = &ring.cqes[head & ring.cq_mask];
+        req = (ww_aio_req_t*)(uintptr_t)cqe->user_data;
+        res = cqe->res;
+        head++;
+        ring.inkernel--;
+
+        if (NULL == req) {
+            /* the wakeup poll fired */
+            while (0 < read(ring.efd, &count, sizeof(count))) {
+            }
+            ring.poll_armed = false;
+            continue;
+        }
+        if (0 > res) {
+            if (-EINTR == res || -EAGAIN == res) {
+                ring_backlog(req);
+                continue;
+            }
+            req->status = errno_status(-res);
+        } else if (WW_AIO_OP_READ == req->op || WW_AIO_OP_WRITE == req->op) {
+            req->done += res;
+            if (0 < res && req->done < req->len) {
+                /* short transfer - go again for the rest */
+                ring_backlog(req);
+                continue;
+            }
+        }
+        complete(req);
+    }
+    /* we are done with the entries before the kernel may reuse them */
+    ww_atomic_mb();
+    *(volatile unsigned*)ring.cq_head = head;
+}
+
+static void* ring_engine(ww_object_t *obj)
+{
+    struct io_uring_sqe *sqe;
+    ww_aio_req_t *req;
+    int rc;
+
+    while (ring.active) {
+        ring_take();
+
+        if (!ring.poll_armed && NULL != (sqe = ring_get_sqe())) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = ring.efd;
+            sqe->poll_events = POLLIN;
+            sqe->user_data = 0;
+            ring.poll_armed = true;
+        }
+        /* everything that fits goes in with the one system call */
+        while (NULL != ring.backlog && NULL != (sqe = ring_get_sqe())) {
+            req = ring.backlog;
+            if (NULL == (ring.backlog = req->next)) {
+                ring.backlog_tail = NULL;
+            }
+            req->next = NULL;
+            ring_prep(sqe, req);
+        }
+
+        rc = syscall(__NR_io_uring_enter, ring.fd, ring.unsubmitted, 1,
+                     IORING_ENTER_GETEVENTS, NULL, 0);
+        if (0 <= rc) {
+            ring.unsubmitted -= rc;
+            ring.inkernel += rc;
+        } else if (EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+            WW_ERROR_LOG(errno_status(errno));
+        }
+        ring_reap();
+    }
+    return WW_THREAD_CANCELLED;
+}
+
+static void ring_push(ww_aio_req_t *req)
+{
+    ww_aio_req_t *head;
+    uint64_t one = 1;
+    ssize_t rc;
+
+    do {
+        head = submitted;
+        req->next = head;
+    } while (!ww_atomic_cmpset_ptr(&submitted, head, req));
+
+    /* the I/O thread takes the whole stack at once, so only the
+     * first request onto an empty stack needs to wake it */
+    if (NULL == head) {
+        rc = write(ring.efd, &one, sizeof(one));
+        (void)rc;
+    }
+}
+
+static int ring_start(void)
+{
+    int rc;
+
+    if (WW_SUCCESS != (rc = ring_setup((0 < ww_aio_queue_depth) ?
+                                       ww_aio_queue_depth : 128))) {
+        return rc;
+    }
+    ring.active = true;
+    WW_CONSTRUCT(&ring.engine, ww_thread_t);
+    ring.engine.t_run = ring_engine;
+    ring.engine.t_arg = NULL;
+    if (WW_SUCCESS != (rc = ww_thread_start(&ring.engine))) {
+        WW_DESTRUCT(&ring.engine);
+        ring_unmap();
+        return rc;
+    }
+    return WW_SUCCESS;
+}
+
+static void ring_stop(void)
+{
+    uint64_t one = 1;
+    ssize_t rc;
+
+    ring.active = false;
+    ww_atomic_mb();
+    rc = write(ring.efd, &one, sizeof(one));
+    (void)rc;
+    ww_thread_join(&ring.engine, NULL);
+    WW_DESTRUCT(&ring.engine);
+    ring_unmap();
+}
+
+#endif
+
+/* queue a request on whichever backend we have */
+static int submit(ww_aio_req_t *req, const char *name,
+                  ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    int rc;
+
+    req->cbfunc = cbfunc;
+    req->cbdata = cbdata;
+    /* without the thread, the callback runs directly */
+    if (WW_AIO_DIRECT != name) {
+        req->thread = ww_progress_thread_get_handle(name);
+    }
+
+    ww_atomic_add_32(&outstanding, 1);
+#if WW_AIO_URING
+    if (use_ring && WW_AIO_OP_CALL != req->op) {
+        ring_push(req);
+        return WW_SUCCESS;
+    }
+#endif
+    if (WW_SUCCESS != (rc = pool_start()) ||
+        WW_SUCCESS != (rc = ww_progress_thread_post(WW_AIO_POOL, run_req, req))) {
+        ww_atomic_sub_32(&outstanding, 1);
+        WW_RELEASE(req);
+        return rc;
+    }
+    return WW_SUCCESS;
+}
+
+static int rw(ww_aio_op_t op, int fd, void *buf, size_t len, off_t offset,
+              const char *name, ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    ww_aio_req_t *req;
+
+    if (!aio_enabled) {
+        return WW_ERR_NOT_AVAILABLE;
+    }
+    if (0 > fd || (NULL == buf && 0 < len) || 0 > offset) {
+        return WW_ERR_BAD_PARAM;
+    }
+    req = WW_NEW(ww_aio_req_t);
+    req->op = op;
+    req->fd = fd;
+    req->buf = (char*)buf;
+    req->len = len;
+    req->offset = offset;
+    return submit(req, name, cbfunc, cbdata);
+}
+
+int ww_aio_read(int fd, void *buf, size_t len, off_t offset,
+                const char *name,
+                ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    return rw(WW_AIO_OP_READ, fd, buf, len, offset, name, cbfunc, cbdata);
+}
+
+int ww_aio_write(int fd, const void *buf, size_t len, off_t offset,
+                 const char *name,
+                 ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    return rw(WW_AIO_OP_WRITE, fd, (void*)buf, len, offset, name, cbfunc, cbdata);
+}
+
+int ww_aio_fsync(int fd, const char *name,
+                 ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    return rw(WW_AIO_OP_FSYNC, fd, NULL, 0, 0, name, cbfunc, cbdata);
+}
+
+int ww_aio_call(ww_aio_fn_t fn, void *arg, const char *name,
+                ww_aio_cbfunc_t cbfunc, void *cbdata)
+{
+    ww_aio_req_t *req;
+
+    if (!aio_enabled) {
+        return WW_ERR_NOT_AVAILABLE;
+    }
+    if (NULL == fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+    req = WW_NEW(ww_aio_req_t);
+    req->op = WW_AIO_OP_CALL;
+    req->fn = fn;
+    req->arg = arg;
+    return submit(req, name, cbfunc, cbdata);
+}
+
+/* output file writes still in flight */
+static volatile int32_t output_pending = 0;
+
+static void output_written(ww_status_t status, size_t nbytes, void *cbdata)
+{
+    free(cbdata);
+    if (0 == ww_atomic_sub_32(&output_pending, 1)) {
+        ww_mutex_lock(&drain_lock);
+        ww_condition_broadcast(&drain_cond);
+        ww_mutex_unlock(&drain_lock);
+    }
+}
+
+/* a file is about to be closed - don't let our writes land in
+ * whatever reuses the descriptor */
+static void output_drain(int fd)
+{
+    ww_mutex_lock(&drain_lock);
+    while (0 < output_pending) {
+        ww_condition_wait(&drain_cond, &drain_lock);
+    }
+    ww_mutex_unlock(&drain_lock);
+}
+
+/* writer for output files. Each line claims its place in the file
+ * by moving the descriptor's position past it - the position is
+ * shared by every stream writing there - so lines land in the order
+ * they were output even if the writes complete out of order */
+static void output_write(int fd, const char *buf, size_t len)
+{
+    char *copy;
+    off_t end;
+    ssize_t rc;
+
+    if (0 > (end = lseek(fd, len, SEEK_CUR))) {
+        /* not seekable, so it has to be written in order */
+        (void)ww_fd_write(fd, len, buf);
+        return;
+    }
+    if (NULL == (copy = (char*)malloc(len))) {
+        rc = pwrite(fd, buf, len, end - len);
+        (void)rc;
+        return;
+    }
+    memcpy(copy, buf, len);
+    ww_atomic_add_32(&output_pending, 1);
+    if (WW_SUCCESS != ww_aio_write(fd, copy, len, end - len,
+                                   WW_AIO_DIRECT, output_written, copy)) {
+        rc = pwrite(fd, copy, len, end - len);
+        (void)rc;
+        output_written(WW_SUCCESS, len, copy);
+    }
+}
+
+int ww_aio_init(void)
+{
+    int rc;
+
+    if (aio_enabled) {
+        return WW_SUCCESS;
+    }
+    if (NULL != ww_aio_backend && 0 == strcmp(ww_aio_backend, "none")) {
+        return WW_SUCCESS;
+    }
+
+    WW_CONSTRUCT(&drain_lock, ww_mutex_t);
+    WW_CONSTRUCT(&drain_cond, ww_condition_t);
+
+    use_ring = false;
+#if WW_AIO_URING
+    if (NULL == ww_aio_backend || 0 != strcmp(ww_aio_backend, "threads")) {
+        use_ring = (WW_SUCCESS == ring_start());
+    }
+#endif
+    if (!use_ring) {
+        if (NULL != ww_aio_backend && 0 == strcmp(ww_aio_backend, "uring")) {
+            ww_output_verbose(1, 0, "aio: io_uring is not available - using threads");
+        }
+        if (WW_SUCCESS != (rc = pool_start())) {
+            WW_DESTRUCT(&drain_cond);
+            WW_DESTRUCT(&drain_lock);
+            return rc;
+        }
+    }
+    aio_enabled = true;
+
+    if (ww_aio_output) {
+        ww_output_set_file_writer(output_write, output_drain);
+    }
+    return WW_SUCCESS;
+}
+
+bool ww_aio_enabled(void)
+{
+    return aio_enabled;
+}
+
+void ww_aio_finalize(void)
+{
+    if (!aio_enabled) {
+        return;
+    }
+
+    /* output goes back to being written directly, then we let
+     * whatever is in flight finish */
+    ww_output_set_file_writer(NULL, NULL);
+    aio_enabled = false;
+    ww_atomic_mb();
+    ww_mutex_lock(&drain_lock);
+    while (0 < outstanding) {
+        ww_condition_wait(&drain_cond, &drain_lock);
+    }
+    ww_mutex_unlock(&drain_lock);
+
+#if WW_AIO_URING
+    if (use_ring) {
+        ring_stop();
+        use_ring = false;
+    }
+#endif
+    ww_mutex_lock(&pool_lock);
+    if (pool_started) {
+        (void)ww_progress_thread_pool_finalize(WW_AIO_POOL);
+        pool_started = false;
+    }
+    ww_mutex_unlock(&pool_lock);
+
+    WW_DESTRUCT(&drain_cond);
+    WW_DESTRUCT(&drain_lock);
+}
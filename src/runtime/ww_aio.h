@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Asynchronous file I/O.
+ *
+ * Reads, writes and syncs of regular files block the calling thread
+ * for as long as the storage takes, which on a progress thread stalls
+ * every other event it carries. The calls here start the operation
+ * and return at once; the completion callback is later run on a
+ * progress thread of the caller's choosing.
+ *
+ * Where the kernel supports it, requests go through an io_uring: one
+ * I/O thread owns the ring, and everything queued since it last ran
+ * is submitted to the kernel with a single system call. Otherwise -
+ * or if the aio_backend MCA parameter says so - each request is run
+ * with ordinary blocking calls on a small worker pool. Callers cannot
+ * tell the difference.
+ *
+ * Requests are independent of one another: two requests on the same
+ * descriptor may be carried out in either order, so writers that care
+ * about order must give each request its own offset.
+ */
+
+#ifndef WW_AIO_H
+#define WW_AIO_H
+
+#include "ww_config.h"
+#include "ww_types.h"
+
+#include <sys/types.h>
+
+#include "src/runtime/ww_progress_threads.h"
+
+BEGIN_C_DECLS
+
+/**
+ * Completion callback. The status is WW_SUCCESS or the error, and
+ * nbytes the number of bytes transferred - for a read, fewer than
+ * requested only if end of file was reached.
+ */
+typedef void (*ww_aio_cbfunc_t)(ww_status_t status, size_t nbytes, void *cbdata);
+
+/**
+ * A blocking function for ww_aio_call()
+ */
+typedef ww_status_t (*ww_aio_fn_t)(void *arg);
+
+/**
+ * Pass as the progress thread name to have the callback run directly
+ * on the thread that saw the completion. Such callbacks must be short
+ * and must not block, as they hold up other completions.
+ */
+WW_DECLSPEC extern const char ww_aio_direct[];
+#define WW_AIO_DIRECT   ww_aio_direct
+
+/**
+ * Start the I/O layer, choosing the backend from the aio_backend MCA
+ * parameter. Called by ww_init().
+ */
+WW_DECLSPEC int ww_aio_init(void);
+
+/**
+ * Returns true if the I/O layer is running.
+ */
+WW_DECLSPEC bool ww_aio_enabled(void);
+
+/**
+ * Read len bytes at offset into buf, then run cbfunc(cbdata) on the
+ * progress thread associated with the name (the shared progress thread
+ * for NULL). If that thread is not running from when the read is
+ * submitted until it completes, the callback is run directly instead.
+ * The buffer must stay valid until the callback has been called.
+ *
+ * Returns WW_ERR_NOT_AVAILABLE if the I/O layer is not running, in
+ * which case the callback will not be called.
+ */
+WW_DECLSPEC int ww_aio_read(int fd, void *buf, size_t len, off_t offset,
+                            const char *name,
+                            ww_aio_cbfunc_t cbfunc, void *cbdata);
+
+/**
+ * Write len bytes from buf at offset, completing as for ww_aio_read().
+ */
+WW_DECLSPEC int ww_aio_write(int fd, const void *buf, size_t len, off_t offset,
+                             const char *name,
+                             ww_aio_cbfunc_t cbfunc, void *cbdata);
+
+/**
+ * Make everything written to the descriptor so far durable - writes
+ * still in progress when this is called are not covered.
+ */
+WW_DECLSPEC int ww_aio_fsync(int fd, const char *name,
+                             ww_aio_cbfunc_t cbfunc, void *cbdata);
+
+/**
+ * Run fn(arg) on the I/O worker pool and pass its return to the
+ * callback. For work that has no asynchronous form - e.g., a dstore
+ * commit - so that it need not block the caller.
+ */
+WW_DECLSPEC int ww_aio_call(ww_aio_fn_t fn, void *arg, const char *name,
+                            ww_aio_cbfunc_t cbfunc, void *cbdata);
+
+/**
+ * Wait for every outstanding request to complete, then stop the I/O
+ * layer. Called by ww_finalize().
+ */
+WW_DECLSPEC void ww_aio_finalize(void);
+
+END_C_DECLS
+
+#endif
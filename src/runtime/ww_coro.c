@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+#include <src/include/ww_config.h>
+#include "ww_types.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if defined(HAVE_UCONTEXT_H) && defined(HAVE_MAKECONTEXT)
+#include <ucontext.h>
+#define WW_CORO_SUPPORTED 1
+#else
+#define WW_CORO_SUPPORTED 0
+#endif
+#include WW_EVENT_HEADER
+
+#include "src/class/ww_object.h"
+#include "src/threads/threads.h"
+#include "src/util/error.h"
+
+#include "src/runtime/ww_params.h"
+#include "src/runtime/ww_progress_threads.h"
+#include "src/runtime/ww_coro.h"
+
+#define WW_CORO_OFFLOAD_POOL    "WW coroutine offload pool"
+
+struct ww_coro_t {
+    ww_object_t super;
+#if WW_CORO_SUPPORTED
+    ucontext_t ctx;         // the coroutine
+    ucontext_t caller;      // the progress thread, while it runs us
+#endif
+    void *stack;
+    size_t stacksize;
+    bool mapped;
+    ww_coro_fn_t fn;
+    void *arg;
+    bool done;
+
+    /* where we run */
+    ww_progress_handle_t *thread;
+    ww_event_base_t *evbase;
+    /* used to get us run - by spawn, and by every resume */
+    ww_progress_task_t task;
+
+    /* for waiting on a timer or descriptor */
+    ww_event_t ev;
+    short ev_what;
+};
+
+static void coro_con(ww_coro_t *co)
+{
+    co->stack = NULL;
+    co->stacksize = 0;
+    co->mapped = false;
+    co->fn = NULL;
+    co->arg = NULL;
+    co->done = false;
+    co->thread = NULL;
+    co->evbase = NULL;
+    co->ev_what = 0;
+}
+static void coro_des(ww_coro_t *co)
+{
+    if (NULL != co->stack && !co->mapped) {
+        free(co->stack);
+    }
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+    if (NULL != co->stack && co->mapped) {
+        munmap(co->stack, co->stacksize);
+    }
+#endif
+    if (NULL != co->thread) {
+        ww_progress_thread_release_handle(co->thread);
+    }
+}
+static WW_CLASS_INSTANCE(ww_coro_t,
+                         ww_object_t,
+                         coro_con, coro_des);
+
+/* the offload pool is started on first use */
+static ww_mutex_t offload_lock = WW_MUTEX_STATIC_INIT;
+static bool offload_started = false;
+
+typedef struct {
+    ww_coro_t *co;
+    ww_progress_fn_t fn;
+    void *arg;
+} ww_coro_offload_t;
+
+#if WW_CORO_SUPPORTED
+
+/* switch into the coroutine - this is the task that runs it on its
+ * progress thread, and it returns when the coroutine next suspends
+ * or finishes */
+static void coro_run(void *arg)
+{
+    ww_coro_t *co = (ww_coro_t*)arg;
+
+    swapcontext(&co->caller, &co->ctx);
+    if (co->done) {
+        WW_RELEASE(co);
+    }
+}
+
+/* makecontext can only pass ints, so the pointer comes in halves */
+static void coro_main(unsigned int hi, unsigned int lo)
+{
+    ww_coro_t *co = (ww_coro_t*)(uintptr_t)(((uint64_t)hi << 32) | (uint64_t)lo);
+
+    co->fn(co, co->arg);
+    /* returning follows uc_link back to the progress thread */
+    co->done = true;
+}
+
+static void* stack_alloc(size_t *size, bool *mapped)
+{
+    void *stack;
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (0 < page) {
+        /* add a guard page below the stack, so that an overflow
+         * faults instead of trampling the heap */
+        *size = ((*size + page - 1) / page + 1) * page;
+        stack = mmap(NULL, *size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED != stack) {
+            (void)mprotect(stack, page, PROT_NONE);
+            *mapped = true;
+            return stack;
+        }
+    }
+#endif
+    *mapped = false;
+    return malloc(*size);
+}
+
+#endif
+
+int ww_coro_spawn(const char *name, ww_coro_fn_t fn,
+                  void *arg, size_t stacksize)
+{
+#if WW_CORO_SUPPORTED
+    ww_coro_t *co;
+    uint64_t p;
+    int rc;
+
+    if (NULL == fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+
+    co = WW_NEW(ww_coro_t);
+    co->fn = fn;
+    co->arg = arg;
+    if (NULL == (co->evbase = ww_progress_thread_get_base(name))) {
+        WW_RELEASE(co);
+        return WW_ERR_NOT_FOUND;
+    }
+    if (NULL == (co->thread = ww_progress_thread_get_handle(name))) {
+        WW_RELEASE(co);
+        return WW_ERR_NOT_FOUND;
+    }
+    co->stacksize = (0 < stacksize) ? stacksize : WW_CORO_STACK_SIZE;
+    if (NULL == (co->stack = stack_alloc(&co->stacksize, &co->mapped))) {
+        WW_RELEASE(co);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+
+    if (0 != getcontext(&co->ctx)) {
+        WW_RELEASE(co);
+        return WW_ERROR;
+    }
+    co->ctx.uc_stack.ss_sp = co->stack;
+    co->ctx.uc_stack.ss_size = co->stacksize;
+    co->ctx.uc_link = &co->caller;
+    p = (uint64_t)(uintptr_t)co;
+    makecontext(&co->ctx, (void (*)(void))coro_main, 2,
+                (unsigned int)(p >> 32), (unsigned int)(p & 0xffffffff));
+
+    WW_PROGRESS_TASK_SET(&co->task, coro_run, co);
+    if (WW_SUCCESS != (rc = ww_progress_thread_shift_to(co->thread, &co->task))) {
+        WW_RELEASE(co);
+        return rc;
+    }
+    return WW_SUCCESS;
+#else
+    return WW_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ww_event_base_t *ww_coro_evbase(ww_coro_t *co)
+{
+    return co->evbase;
+}
+
+void ww_coro_suspend(ww_coro_t *co)
+{
+#if WW_CORO_SUPPORTED
+    swapcontext(&co->ctx, &co->caller);
+#endif
+}
+
+void ww_coro_resume(ww_coro_t *co)
+{
+    /* always go through the thread's task queue - that works from any
+     * thread, and as the queue is only run by the thread the coroutine
+     * is running on, it cannot be resumed before it has suspended */
+    WW_PROGRESS_TASK_SET(&co->task, coro_run, co);
+    (void)ww_progress_thread_shift_to(co->thread, &co->task);
+}
+
+void ww_coro_yield(ww_coro_t *co)
+{
+    ww_coro_resume(co);
+    ww_coro_suspend(co);
+}
+
+static void coro_event_cb(int fd, short what, void *arg)
+{
+    ww_coro_t *co = (ww_coro_t*)arg;
+
+    co->ev_what = what;
+    ww_coro_resume(co);
+}
+
+void ww_coro_sleep(ww_coro_t *co, const struct timeval *tv)
+{
+    ww_event_set(co->evbase, &co->ev, -1, 0, coro_event_cb, co);
+    ww_event_add(&co->ev, tv);
+    ww_coro_suspend(co);
+}
+
+int ww_coro_wait_fd(ww_coro_t *co, int fd, short events,
+                    const struct timeval *timeout)
+{
+    ww_event_set(co->evbase, &co->ev, fd, events, coro_event_cb, co);
+    ww_event_add(&co->ev, timeout);
+    ww_coro_suspend(co);
+    return (co->ev_what & EV_TIMEOUT) ? WW_ERR_TIMEOUT : WW_SUCCESS;
+}
+
+static void offload_run(void *arg)
+{
+    ww_coro_offload_t *off = (ww_coro_offload_t*)arg;
+
+    off->fn(off->arg);
+    ww_coro_resume(off->co);
+}
+
+int ww_coro_offload(ww_coro_t *co, ww_progress_fn_t fn, void *arg)
+{
+    ww_coro_offload_t off;
+    int rc;
+
+    ww_mutex_lock(&offload_lock);
+    if (!offload_started) {
+        if (WW_SUCCESS != (rc = ww_progress_thread_pool_init(WW_CORO_OFFLOAD_POOL,
+                                                             (0 < ww_coro_offload_threads) ?
+                                                             ww_coro_offload_threads : 1))) {
+            ww_mutex_unlock(&offload_lock);
+            return rc;
+        }
+        offload_started = true;
+    }
+    ww_mutex_unlock(&offload_lock);
+
+    /* the request lives on our stack, which stays put while we wait */
+    off.co = co;
+    off.fn = fn;
+    off.arg = arg;
+    if (WW_SUCCESS != (rc = ww_progress_thread_post(WW_CORO_OFFLOAD_POOL, offload_run, &off))) {
+        return rc;
+    }
+    ww_coro_suspend(co);
+    return WW_SUCCESS;
+}
+
+void ww_coro_finalize(void)
+{
+    ww_mutex_lock(&offload_lock);
+    if (offload_started) {
+        (void)ww_progress_thread_pool_finalize(WW_CORO_OFFLOAD_POOL);
+        offload_started = false;
+    }
+    ww_mutex_unlock(&offload_lock);
+}
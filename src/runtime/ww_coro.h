@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016      Intel, Inc.  All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/** @file
+ *
+ * Coroutines on progress threads.
+ *
+ * A coroutine is a function with its own stack that runs on a
+ * progress thread and can suspend itself part way through - while it
+ * waits for a descriptor, a timer or the result of an asynchronous
+ * call - without blocking the thread. Other coroutines and events on
+ * the thread run in the meantime. This lets a multi-step flow be
+ * written as straight-line code instead of a chain of callbacks,
+ * without paying for a thread per request.
+ *
+ * Coroutines are cooperative: one only gives up the thread when it
+ * yields, suspends or returns, so anything that blocks still blocks
+ * the whole thread. Work that has no asynchronous form can be handed
+ * to a worker pool with ww_coro_offload(), which suspends the
+ * coroutine until the work is done.
+ *
+ * Every function taking a coroutine must be called from that
+ * coroutine, except ww_coro_resume(), which may be called from any
+ * thread.
+ */
+
+#ifndef WW_CORO_H
+#define WW_CORO_H
+
+#include "ww_config.h"
+#include "ww_types.h"
+
+#include <sys/time.h>
+
+#include "src/runtime/ww_progress_threads.h"
+
+BEGIN_C_DECLS
+
+typedef struct ww_coro_t ww_coro_t;
+
+/**
+ * Body of a coroutine. The coroutine finishes when it returns.
+ */
+typedef void (*ww_coro_fn_t)(ww_coro_t *co, void *arg);
+
+/* Default stack size for a coroutine */
+#define WW_CORO_STACK_SIZE  (64 * 1024)
+
+/**
+ * Start fn(co, arg) as a coroutine on the progress thread associated
+ * with this name (or the shared progress thread for NULL), which
+ * must already have been started with ww_progress_thread_init().
+ * It first runs once the thread gets to it - spawn returns at once.
+ *
+ * A stacksize of 0 selects WW_CORO_STACK_SIZE.
+ *
+ * Returns WW_ERR_NOT_FOUND if the progress thread name does not exist,
+ * and WW_ERR_NOT_SUPPORTED if coroutines are not available on this
+ * platform.
+ */
+WW_DECLSPEC int ww_coro_spawn(const char *name, ww_coro_fn_t fn,
+                              void *arg, size_t stacksize);
+
+/**
+ * The event base of the progress thread the coroutine runs on, for
+ * passing to asynchronous APIs.
+ */
+WW_DECLSPEC ww_event_base_t *ww_coro_evbase(ww_coro_t *co);
+
+/**
+ * Give other work on the thread a chance to run, and continue once
+ * it has.
+ */
+WW_DECLSPEC void ww_coro_yield(ww_coro_t *co);
+
+/**
+ * Suspend the coroutine until ww_coro_resume() is called on it. This
+ * is the building block for making an asynchronous API awaitable: start
+ * the operation with a completion callback that calls ww_coro_resume(),
+ * then suspend. The resume may safely happen before the coroutine has
+ * actually suspended, but there must be exactly one resume per suspend.
+ */
+WW_DECLSPEC void ww_coro_suspend(ww_coro_t *co);
+
+/**
+ * Make a suspended coroutine runnable again. May be called from any
+ * thread.
+ */
+WW_DECLSPEC void ww_coro_resume(ww_coro_t *co);
+
+/**
+ * Suspend the coroutine for the given time.
+ */
+WW_DECLSPEC void ww_coro_sleep(ww_coro_t *co, const struct timeval *tv);
+
+/**
+ * Suspend the coroutine until the descriptor is ready for the given
+ * events (EV_READ and/or EV_WRITE), or until the timeout expires if
+ * one is given.
+ *
+ * Returns WW_SUCCESS if the descriptor is ready, or WW_ERR_TIMEOUT.
+ */
+WW_DECLSPEC int ww_coro_wait_fd(ww_coro_t *co, int fd, short events,
+                                const struct timeval *timeout);
+
+/**
+ * Run fn(arg) on the coroutine offload pool and suspend until it has
+ * returned. Use this for calls that may block and have no
+ * asynchronous form. The pool is started on first use, with the
+ * number of threads given by the coro_offload_threads MCA parameter.
+ */
+WW_DECLSPEC int ww_coro_offload(ww_coro_t *co, ww_progress_fn_t fn, void *arg);
+
+/**
+ * Stop the offload pool. Coroutines still suspended in
+ * ww_coro_offload() when this is called are never resumed.
+ */
+WW_DECLSPEC void ww_coro_finalize(void);
+
+END_C_DECLS
+
+#endif
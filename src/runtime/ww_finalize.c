@@ -36,6 +36,8 @@
 
 #include "src/runtime/ww_rte.h"
 #include "src/runtime/ww_progress_threads.h"
+#include "src/runtime/ww_coro.h"
+#include "src/runtime/ww_aio.h"
 
 extern int ww_initialized;
 extern bool ww_init_called;
@@ -60,6 +62,13 @@ int ww_finalize(void)
         return WW_SUCCESS;
     }
 
+    /* stop the coroutine offload pool before the frameworks its
+     * work may be using */
+    ww_coro_finalize();
+
+    /* let outstanding file I/O complete - dstore commits among it */
+    ww_aio_finalize();
+
     /* close the security framework */
     (void) mca_base_framework_close(&ww_sec_base_framework);
 
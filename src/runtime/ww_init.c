@@ -32,6 +32,7 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#include <time.h>
 
 #include "src/util/output.h"
 #include "src/util/show_help.h"
@@ -46,7 +47,9 @@
 #include "src/util/keyval_parse.h"
 
 #include "src/runtime/ww_rte.h"
+#include "src/runtime/ww_params.h"
 #include "src/runtime/ww_progress_threads.h"
+#include "src/runtime/ww_aio.h"
 
 #if WW_CC_USE_PRAGMA_IDENT
 #pragma ident WW_IDENT_STRING
@@ -59,6 +62,66 @@ int ww_initialized = 0;
 bool ww_init_called = false;
 ww_globals_t ww_globals;
 
+static void pcon(ww_peer_t *p)
+{
+    p->sd = -1;
+    p->uid = (uid_t)-1;
+    p->gid = (gid_t)-1;
+    p->authz = NULL;
+}
+static void pdes(ww_peer_t *p)
+{
+    if (NULL != p->authz) {
+        WW_RELEASE(p->authz);
+    }
+}
+WW_CLASS_INSTANCE(ww_peer_t,
+                  ww_object_t,
+                  pcon, pdes);
+
+/* how long each phase of ww_init took */
+#define WW_INIT_MAX_PHASES 16
+static struct {
+    const char *phase;
+    uint64_t usec;
+} init_phases[WW_INIT_MAX_PHASES];
+static int init_nphases = 0;
+static uint64_t init_start, init_mark;
+
+static uint64_t init_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* the phase that just ended */
+static void phase_done(const char *phase)
+{
+    uint64_t now = init_usec();
+
+    if (init_nphases < WW_INIT_MAX_PHASES) {
+        init_phases[init_nphases].phase = phase;
+        init_phases[init_nphases].usec = now - init_mark;
+        init_nphases++;
+    }
+    init_mark = now;
+}
+
+static void phase_report(void)
+{
+    int i;
+
+    for (i=0; i < init_nphases; i++) {
+        ww_output(0, "ww_init: %-28s %10.3f ms",
+                  init_phases[i].phase,
+                  (double)init_phases[i].usec / 1000.0);
+    }
+    ww_output(0, "ww_init: %-28s %10.3f ms", "total",
+              (double)(init_mark - init_start) / 1000.0);
+}
+
 int ww_init(int* pargc, char*** pargv)
 {
     int ret;
@@ -83,8 +146,12 @@ int ww_init(int* pargc, char*** pargv)
 
         ww_init_called = true;
 
+    init_nphases = 0;
+    init_start = init_mark = init_usec();
+
     /* initialize the output system */
     ww_output_init();
+    phase_done("output");
 
     /* initialize install dirs code */
     if (WW_SUCCESS != (ret = mca_base_framework_open(&ww_installdirs_base_framework, 0))) {
@@ -92,27 +159,32 @@ int ww_init(int* pargc, char*** pargv)
                 __FILE__, __LINE__, ret);
         return ret;
     }
+    phase_done("installdirs");
 
     /* initialize the help system */
     ww_show_help_init();
+    phase_done("show_help");
 
     /* keyval lex-based parser */
     if (WW_SUCCESS != (ret = ww_util_keyval_parse_init())) {
         error = "ww_util_keyval_parse_init";
         goto return_error;
     }
+    phase_done("keyval parser");
 
     /* Setup the parameter system */
     if (WW_SUCCESS != (ret = mca_base_var_init())) {
         error = "mca_base_var_init";
         goto return_error;
     }
+    phase_done("MCA variables");
 
     /* read any param files that were provided */
     if (WW_SUCCESS != (ret = mca_base_var_cache_files(false))) {
         error = "failed to cache files";
         goto return_error;
     }
+    phase_done("param files");
 
 
     /* register params for ww */
@@ -120,32 +192,56 @@ int ww_init(int* pargc, char*** pargv)
         error = "ww_register_params";
         goto return_error;
     }
+    phase_done("ww params");
 
     /* initialize the mca */
     if (WW_SUCCESS != (ret = mca_base_open())) {
         error = "mca_base_open";
         goto return_error;
     }
+    phase_done("MCA base");
+
+    /* start asynchronous file I/O - from here on, output files
+     * are written without blocking */
+    if (WW_SUCCESS != (ret = ww_aio_init())) {
+        error = "ww_aio_init";
+        goto return_error;
+    }
+    phase_done("aio");
 
     /* initialize the security framework */
     if( WW_SUCCESS != (ret = mca_base_framework_open(&ww_sec_base_framework, 0)) ) {
         error = "ww_sec_base_open";
         goto return_error;
     }
+    phase_done("sec open");
     if( WW_SUCCESS != (ret = ww_sec_base_select()) ) {
         error = "ww_sec_base_select";
         goto return_error;
     }
+    phase_done("sec select");
 
     /* initialize the dstore framework */
     if( WW_SUCCESS != (ret = mca_base_framework_open(&ww_dstore_base_framework, 0)) ) {
         error = "ww_dstore_base_open";
         goto return_error;
     }
+    phase_done("dstore open");
     if( WW_SUCCESS != (ret = ww_dstore_base_select()) ) {
         error = "ww_dstore_base_select";
         goto return_error;
     }
+    phase_done("dstore select");
+
+    /* everything is registered by now - freeze the variable index so
+     * that lookups from here on are constant time. Lookups still work
+     * if this fails, just more slowly */
+    (void)mca_base_var_index_freeze();
+    phase_done("MCA variable index");
+
+    if (ww_init_timing) {
+        phase_report();
+    }
 
     return WW_SUCCESS;
 
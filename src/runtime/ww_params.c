@@ -42,6 +42,18 @@ char *ww_timing_output = NULL;
 bool ww_timing_overhead = true;
 #endif
 
+bool ww_init_timing = false;
+char *ww_progress_thread_binding = NULL;
+bool ww_progress_thread_report_bindings = false;
+char *ww_progress_thread_busy_poll = NULL;
+bool ww_progress_thread_instrument = false;
+int ww_progress_thread_stall_threshold = 0;
+int ww_coro_offload_threads = 2;
+char *ww_aio_backend = NULL;
+int ww_aio_threads = 2;
+int ww_aio_queue_depth = 128;
+bool ww_aio_output = false;
+
 static bool ww_register_done = false;
 
 int ww_register_params(void)
@@ -80,6 +92,100 @@ int ww_register_params(void)
                                   &ww_timing_overhead);
 #endif
 
+    ww_init_timing = false;
+    (void) mca_base_var_register ("ww", "ww", NULL, "init_timing",
+                                  "Report how long each phase of ww_init took",
+                                  MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_init_timing);
+
+    ww_progress_thread_binding = NULL;
+    (void) mca_base_var_register ("ww", "ww", NULL, "progress_thread_binding",
+                                  "Where to run named progress threads, as a semicolon-separated list of "
+                                  "name=placement entries. The placement is either a list of CPUs (e.g., "
+                                  "0-3,8) or numa:N for the CPUs of NUMA node N. The name \"default\" "
+                                  "refers to the shared progress thread, and \"*\" to any thread not "
+                                  "otherwise listed. Threads of a pool are spread one per CPU when there "
+                                  "are enough of them.",
+                                  MCA_BASE_VAR_TYPE_STRING, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_progress_thread_binding);
+
+    ww_progress_thread_report_bindings = false;
+    (void) mca_base_var_register ("ww", "ww", NULL, "progress_thread_report_bindings",
+                                  "Report where each progress thread was placed",
+                                  MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_progress_thread_report_bindings);
+
+    ww_progress_thread_busy_poll = NULL;
+    (void) mca_base_var_register ("ww", "ww", NULL, "progress_thread_busy_poll",
+                                  "How long named progress threads keep polling after activity before "
+                                  "blocking, as a semicolon-separated list of name=usec entries. Polling "
+                                  "cuts wakeup latency at the cost of a busy CPU. The name \"default\" "
+                                  "refers to the shared progress thread, and \"*\" to any thread not "
+                                  "otherwise listed. Threads not listed always block.",
+                                  MCA_BASE_VAR_TYPE_STRING, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_progress_thread_busy_poll);
+
+    ww_progress_thread_instrument = false;
+    (void) mca_base_var_register ("ww", "ww", NULL, "progress_thread_instrument",
+                                  "Keep counts and histograms of the time progress threads spend "
+                                  "running shifted tasks and the time tasks wait to be run",
+                                  MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_progress_thread_instrument);
+
+    ww_progress_thread_stall_threshold = 0;
+    (void) mca_base_var_register ("ww", "ww", NULL, "progress_thread_stall_threshold",
+                                  "Report any task or event callback that blocks a progress thread for "
+                                  "longer than this many microseconds, naming the task's function "
+                                  "(0 = off). Idle progress threads wake every half a threshold. "
+                                  "Implies progress_thread_instrument.",
+                                  MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_progress_thread_stall_threshold);
+
+    ww_coro_offload_threads = 2;
+    (void) mca_base_var_register ("ww", "ww", NULL, "coro_offload_threads",
+                                  "Number of threads that run blocking calls offloaded by coroutines",
+                                  MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_coro_offload_threads);
+
+    ww_aio_backend = "auto";
+    (void) mca_base_var_register ("ww", "ww", NULL, "aio_backend",
+                                  "How asynchronous file I/O is carried out: \"uring\" submits it to an "
+                                  "io_uring where the kernel allows, \"threads\" runs blocking calls on a "
+                                  "worker pool, \"auto\" tries io_uring first, and \"none\" disables "
+                                  "asynchronous I/O",
+                                  MCA_BASE_VAR_TYPE_STRING, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_aio_backend);
+
+    ww_aio_threads = 2;
+    (void) mca_base_var_register ("ww", "ww", NULL, "aio_threads",
+                                  "Number of threads in the asynchronous I/O worker pool",
+                                  MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_aio_threads);
+
+    ww_aio_queue_depth = 128;
+    (void) mca_base_var_register ("ww", "ww", NULL, "aio_queue_depth",
+                                  "Number of submission queue entries in the io_uring",
+                                  MCA_BASE_VAR_TYPE_INT, NULL, 0, 0,
+                                  WW_INFO_LVL_9, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_aio_queue_depth);
+
+    ww_aio_output = false;
+    (void) mca_base_var_register ("ww", "ww", NULL, "aio_output",
+                                  "Write output files asynchronously, so that logging does not block "
+                                  "the caller (output not yet written is lost if the process dies)",
+                                  MCA_BASE_VAR_TYPE_BOOL, NULL, 0, 0,
+                                  WW_INFO_LVL_5, MCA_BASE_VAR_SCOPE_READONLY,
+                                  &ww_aio_output);
+
     return WW_SUCCESS;
 }
 
@@ -35,6 +35,25 @@ extern char *ww_timing_output;
 extern bool ww_timing_overhead;
 #endif
 
+/* startup */
+extern bool ww_init_timing;
+
+/* placement, polling and instrumentation of progress threads */
+extern char *ww_progress_thread_binding;
+extern bool ww_progress_thread_report_bindings;
+extern char *ww_progress_thread_busy_poll;
+extern bool ww_progress_thread_instrument;
+extern int ww_progress_thread_stall_threshold;
+
+/* coroutines */
+extern int ww_coro_offload_threads;
+
+/* asynchronous file I/O */
+extern char *ww_aio_backend;
+extern int ww_aio_threads;
+extern int ww_aio_queue_depth;
+extern bool ww_aio_output;
+
 WW_DECLSPEC extern int ww_initialized;
 WW_DECLSPEC int ww_register_params(void);
 WW_DECLSPEC int ww_deregister_params(void);
@@ -14,15 +14,32 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <pthread.h>
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#if WW_HAVE_DLADDR && defined(HAVE_DLFCN_H)
+#include <dlfcn.h>
+#endif
 #include WW_EVENT_HEADER
 
 #include "src/class/ww_list.h"
+#include "src/sys/atomic.h"
 #include "src/threads/threads.h"
+#include "src/util/argv.h"
 #include "src/util/error.h"
 #include "src/util/fd.h"
+#include "src/util/output.h"
 
+#include "src/runtime/ww_params.h"
 #include "src/runtime/ww_progress_threads.h"
 
 
@@ -45,8 +62,55 @@ typedef struct {
 
     bool engine_constructed;
     ww_thread_t engine;
+
+    /* set once the thread has been finalized, for handles that
+       still hold a reference to the tracker */
+    volatile bool gone;
+
+    /* the thread sets up the event base itself, so that it is
+       allocated close to where the thread runs */
+    ww_mutex_t lock;
+    ww_condition_t cond;
+    bool ready;
+
+    /* tasks shifted in from other threads, newest first */
+    ww_progress_task_t * volatile tasks;
+    /* set while the thread is (about to be) blocked in its event
+       loop, so only the first shift after that pays for a wakeup */
+    volatile int32_t sleeping;
+    int wakeup[2];
+    ww_event_t wakeup_ev;
+
+    /* how long to keep polling after activity before blocking */
+    uint64_t busy_poll_usec;
+    ww_progress_thread_stats_t stats;
+
+    /* time tasks, and publish the one that is running so that the
+       watchdog can see it */
+    bool instrument;
+    volatile ww_progress_fn_t cur_fn;
+    volatile uint64_t cur_start;
+    volatile uint64_t cur_seq;
+    uint64_t reported_seq;      // only touched by the watchdog
+
+    /* the same for passes through the event loop, whose callbacks
+       can block the thread just as well. A pass that may sleep is
+       allowed pass_idle usec of that on top of the threshold - the
+       thread never sleeps for longer than that while the watchdog
+       is running */
+    volatile bool in_pass;
+    volatile uint64_t pass_start;
+    volatile uint64_t pass_idle;
+    volatile uint64_t pass_seq;
+    uint64_t reported_pass;     // only touched by the watchdog
+    struct timeval block_timeout;
 } ww_progress_tracker_t;
 
+static struct timeval long_timeout = {
+    .tv_sec = 3600,
+    .tv_usec = 0
+};
+
 static void tracker_constructor(ww_progress_tracker_t *p)
 {
     p->refcount = 1;  // start at one since someone created it
@@ -54,21 +118,49 @@ static void tracker_constructor(ww_progress_tracker_t *p)
     p->ev_base = NULL;
     p->ev_active = false;
     p->engine_constructed = false;
+    p->gone = false;
+    WW_CONSTRUCT(&p->lock, ww_mutex_t);
+    WW_CONSTRUCT(&p->cond, ww_condition_t);
+    p->ready = false;
+    p->tasks = NULL;
+    p->sleeping = 0;
+    p->wakeup[0] = p->wakeup[1] = -1;
+    p->busy_poll_usec = 0;
+    memset(&p->stats, 0, sizeof(p->stats));
+    p->instrument = false;
+    p->cur_fn = NULL;
+    p->cur_start = 0;
+    p->cur_seq = 0;
+    p->reported_seq = 0;
+    p->in_pass = false;
+    p->pass_start = 0;
+    p->pass_idle = 0;
+    p->pass_seq = 0;
+    p->reported_pass = 0;
+    p->block_timeout = long_timeout;
 }
 
 static void tracker_destructor(ww_progress_tracker_t *p)
 {
-    ww_event_del(&p->block);
-
     if (NULL != p->name) {
         free(p->name);
     }
     if (NULL != p->ev_base) {
+        ww_event_del(&p->block);
+        ww_event_del(&p->wakeup_ev);
         ww_event_base_free(p->ev_base);
     }
+    if (0 <= p->wakeup[0]) {
+        close(p->wakeup[0]);
+        if (p->wakeup[1] != p->wakeup[0]) {
+            close(p->wakeup[1]);
+        }
+    }
     if (p->engine_constructed) {
         WW_DESTRUCT(&p->engine);
     }
+    WW_DESTRUCT(&p->cond);
+    WW_DESTRUCT(&p->lock);
 }
 
 static WW_CLASS_INSTANCE(ww_progress_tracker_t,
@@ -78,12 +170,308 @@ static WW_CLASS_INSTANCE(ww_progress_tracker_t,
 
 static bool inited = false;
 static ww_list_t tracking;
-static struct timeval long_timeout = {
-    .tv_sec = 3600,
-    .tv_usec = 0
-};
 static const char *shared_thread_name = "WW-wide async progress thread";
 
+/* the watchdog walks the tracking list from its own thread, so
+ * changes to the list are made under this lock. Handles hold
+ * references to trackers from any thread, so the object reference
+ * counts of trackers are only changed under it too */
+static ww_mutex_t tracking_lock;
+static ww_condition_t watchdog_cond;
+static ww_thread_t watchdog;
+static bool watchdog_running = false;
+static volatile bool watchdog_active = false;
+
+/* find the value given for a thread name in a list of name=value
+ * entries, if any - the caller must free it */
+static char* find_setting(const char *list, const char *name)
+{
+    char **entries, *eq;
+    const char *key;
+    int i, wild = -1, match = -1;
+    char *ret = NULL;
+
+    if (NULL == list) {
+        return NULL;
+    }
+    key = (0 == strcmp(name, shared_thread_name)) ? "default" : name;
+    entries = ww_argv_split(list, ';');
+    for (i=0; NULL != entries && NULL != entries[i]; i++) {
+        if (NULL == (eq = strchr(entries[i], '='))) {
+            continue;
+        }
+        *eq = '\0';
+        if (0 == strcmp(entries[i], key)) {
+            match = i;
+            break;
+        }
+        if (0 == strcmp(entries[i], "*") && 0 > wild) {
+            wild = i;
+        }
+    }
+    if (0 > match) {
+        match = wild;
+    }
+    if (0 <= match) {
+        ret = strdup(entries[match] + strlen(entries[match]) + 1);
+    }
+    ww_argv_free(entries);
+    return ret;
+}
+
+#ifdef HAVE_SCHED_SETAFFINITY
+/* parse a list of CPUs such as 0-3,8 into a set */
+static bool parse_cpulist(const char *list, cpu_set_t *set)
+{
+    char **ranges;
+    char *end;
+    long lo, hi, c;
+    int i;
+
+    CPU_ZERO(set);
+    ranges = ww_argv_split(list, ',');
+    for (i=0; NULL != ranges && NULL != ranges[i]; i++) {
+        lo = strtol(ranges[i], &end, 10);
+        hi = lo;
+        if ('-' == *end) {
+            hi = strtol(end + 1, &end, 10);
+        }
+        if (0 > lo || hi < lo || ('\0' != *end && '\n' != *end)) {
+            ww_argv_free(ranges);
+            return false;
+        }
+        for (c=lo; c <= hi && c < CPU_SETSIZE; c++) {
+            CPU_SET(c, set);
+        }
+    }
+    ww_argv_free(ranges);
+    return (0 < CPU_COUNT(set));
+}
+
+/* turn a placement - a CPU list or numa:N - into a set of CPUs */
+static bool parse_placement(const char *spec, cpu_set_t *set)
+{
+    char path[128], buf[1024];
+    FILE *fp;
+    bool ret;
+
+    if (0 != strncmp(spec, "numa:", 5)) {
+        return parse_cpulist(spec, set);
+    }
+    /* the kernel tells us which CPUs are on each node */
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             atoi(spec + 5));
+    if (NULL == (fp = fopen(path, "r"))) {
+        return false;
+    }
+    ret = (NULL != fgets(buf, sizeof(buf), fp) && parse_cpulist(buf, set));
+    fclose(fp);
+    return ret;
+}
+
+/* find the placement requested for a thread name, if any */
+static bool find_placement(const char *name, cpu_set_t *set)
+{
+    char *spec;
+    bool ret;
+
+    if (NULL == (spec = find_setting(ww_progress_thread_binding, name))) {
+        return false;
+    }
+    if (!(ret = parse_placement(spec, set))) {
+        ww_output(0, "Ignoring invalid placement \"%s\" for progress thread %s",
+                  spec, name);
+    }
+    free(spec);
+    return ret;
+}
+#endif
+
+/*
+ * Bind the calling thread - the idx'th of n threads sharing a name -
+ * to the placement requested for that name. Threads sharing a name
+ * get a CPU each if the placement has enough of them.
+ */
+static void bind_self(const char *name, int idx, int n)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+    cpu_set_t set, one;
+    char cpus[256];
+    size_t len = 0;
+    int c, k, ncpus;
+
+    if (!find_placement(name, &set)) {
+        return;
+    }
+    ncpus = CPU_COUNT(&set);
+    if (1 < n && n <= ncpus) {
+        CPU_ZERO(&one);
+        for (c=0, k=0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set) && k++ == idx) {
+                CPU_SET(c, &one);
+                break;
+            }
+        }
+        set = one;
+    }
+    if (0 != sched_setaffinity(0, sizeof(set), &set)) {
+        ww_output(0, "Could not bind progress thread %s[%d]", name, idx);
+        return;
+    }
+    if (ww_progress_thread_report_bindings) {
+        cpus[0] = '\0';
+        for (c=0; c < CPU_SETSIZE && len + 8 < sizeof(cpus); c++) {
+            if (CPU_ISSET(c, &set)) {
+                len += snprintf(cpus + len, sizeof(cpus) - len, "%s%d",
+                                (0 < len) ? "," : "", c);
+            }
+        }
+        ww_output(0, "Progress thread %s[%d] bound to CPUs %s", name, idx, cpus);
+    }
+#else
+    if (NULL != ww_progress_thread_binding && ww_progress_thread_report_bindings) {
+        ww_output(0, "Progress thread %s[%d] not bound: binding is not supported",
+                  name, idx);
+    }
+#endif
+}
+
+/*
+ * A thread blocked in its event loop is woken by making a descriptor
+ * watched by its own event base readable - an eventfd where there is
+ * one, otherwise a pipe. Either way fds[0] is read and fds[1] written.
+ */
+static int wakeup_open(int *fds)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    if (0 <= (fds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+        fds[1] = fds[0];
+        return WW_SUCCESS;
+    }
+#endif
+    if (0 != pipe(fds)) {
+        fds[0] = fds[1] = -1;
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+    ww_fd_set_cloexec(fds[0]);
+    ww_fd_set_cloexec(fds[1]);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    return WW_SUCCESS;
+}
+
+static void wakeup_signal(int *fds)
+{
+    uint64_t one = 1;
+    ssize_t rc;
+
+    if (fds[0] == fds[1]) {
+        rc = write(fds[1], &one, sizeof(one));
+    } else {
+        rc = write(fds[1], "", 1);
+    }
+    /* a full pipe or counter means a wakeup is already pending */
+    (void)rc;
+}
+
+static void wakeup_cb(int fd, short args, void *cbdata)
+{
+    char buf[64];
+
+    /* all we need is for the loop to return */
+    while (0 < read(fd, buf, sizeof(buf))) {
+    }
+}
+
+static uint64_t now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void hist_add(uint64_t *hist, uint64_t usec)
+{
+    int b = 0;
+
+    while (0 < usec && b < WW_PROGRESS_HIST_BUCKETS - 1) {
+        usec >>= 1;
+        b++;
+    }
+    hist[b]++;
+}
+
+/* run a task, timing it if asked to */
+static inline void run_task(ww_progress_tracker_t *trk, ww_progress_task_t *task)
+{
+    uint64_t start;
+
+    if (!trk->instrument) {
+        task->fn(task->arg);
+        return;
+    }
+    start = now_usec();
+    if (0 < task->queued_usec && task->queued_usec <= start) {
+        hist_add(trk->stats.wait_usec, start - task->queued_usec);
+    }
+    /* publish the start before the function, so the watchdog never
+     * pairs this function with an older start */
+    trk->cur_start = start;
+    trk->cur_seq++;
+    ww_atomic_wmb();
+    trk->cur_fn = task->fn;
+    task->fn(task->arg);
+    trk->cur_fn = NULL;
+    hist_add(trk->stats.task_usec, now_usec() - start);
+    trk->stats.tasks++;
+}
+
+/* make one pass through the event loop, publishing when it started
+ * if asked to, so that the watchdog can see callbacks stall too */
+static inline void loop_pass(ww_progress_tracker_t *trk, int flags)
+{
+    if (!trk->instrument) {
+        ww_event_loop(trk->ev_base, flags);
+        return;
+    }
+    trk->pass_idle = (WW_EVLOOP_ONCE == flags) ?
+        ((uint64_t)trk->block_timeout.tv_sec * 1000000 + trk->block_timeout.tv_usec) : 0;
+    trk->pass_start = now_usec();
+    trk->pass_seq++;
+    ww_atomic_wmb();
+    trk->in_pass = true;
+    ww_event_loop(trk->ev_base, flags);
+    trk->in_pass = false;
+}
+
+/* run everything that has been shifted to the thread so far */
+static void run_tasks(ww_progress_tracker_t *trk)
+{
+    ww_progress_task_t *list, *fifo = NULL, *task;
+
+    /* take the whole queue in one go - as nobody else ever removes
+     * from it, there is no ABA to worry about */
+    do {
+        list = trk->tasks;
+    } while (NULL != list && !ww_atomic_cmpset_ptr(&trk->tasks, list, NULL));
+
+    /* it was built newest first */
+    while (NULL != list) {
+        task = list;
+        list = list->next;
+        task->next = fifo;
+        fifo = task;
+    }
+    while (NULL != fifo) {
+        task = fifo;
+        /* the task may be shifted again as soon as it runs */
+        fifo = fifo->next;
+        task->next = NULL;
+        run_task(trk, task);
+    }
+}
+
 /*
  * If this event is fired, just restart it so that this event base
  * continues to have something to block on.
@@ -92,7 +480,7 @@ static void dummy_timeout_cb(int fd, short args, void *cbdata)
 {
     ww_progress_tracker_t *trk = (ww_progress_tracker_t*)cbdata;
 
-    ww_event_add(&trk->block, &long_timeout);
+    ww_event_add(&trk->block, &trk->block_timeout);
 }
 
 /*
@@ -102,9 +490,79 @@ static void* progress_engine(ww_object_t *obj)
 {
     ww_thread_t *t = (ww_thread_t*)obj;
     ww_progress_tracker_t *trk = (ww_progress_tracker_t*)t->t_arg;
+    uint64_t last, start;
+
+    /* bind before we touch any memory, so that it is allocated
+     * on our own NUMA node */
+    bind_self(trk->name, 0, 1);
 
+    ww_mutex_lock(&trk->lock);
+    if (NULL == trk->ev_base) {
+        if (NULL != (trk->ev_base = ww_event_base_create())) {
+            /* add an event to the new event base (if there are no events,
+               ww_event_loop() will return immediately) */
+            ww_event_set(trk->ev_base, &trk->block, -1, WW_EV_PERSIST,
+                           dummy_timeout_cb, trk);
+            ww_event_add(&trk->block, &trk->block_timeout);
+            ww_event_set(trk->ev_base, &trk->wakeup_ev, trk->wakeup[0],
+                         EV_READ | WW_EV_PERSIST, wakeup_cb, trk);
+            ww_event_add(&trk->wakeup_ev, NULL);
+        } else {
+            trk->ev_active = false;
+        }
+    }
+    trk->ready = true;
+    ww_condition_broadcast(&trk->cond);
+    ww_mutex_unlock(&trk->lock);
+
+    last = now_usec();
     while (trk->ev_active) {
-        ww_event_loop(trk->ev_base, WW_EVLOOP_ONCE);
+        if (NULL != trk->tasks) {
+            run_tasks(trk);
+            /* give the events a look-in between batches */
+            loop_pass(trk, WW_EVLOOP_NONBLOCK);
+            trk->stats.iterations++;
+            if (0 < trk->busy_poll_usec) {
+                last = now_usec();
+            }
+            continue;
+        }
+        if (0 < trk->busy_poll_usec) {
+            /* keep polling for a while after activity - more is
+             * likely to follow, and we can get to it without being
+             * woken. Producers see that we are not sleeping, so they
+             * do not signal us either */
+            start = last;
+            while (trk->ev_active && NULL == trk->tasks &&
+                   now_usec() - start < trk->busy_poll_usec) {
+                loop_pass(trk, WW_EVLOOP_NONBLOCK);
+                trk->stats.iterations++;
+            }
+            last = now_usec();
+            trk->stats.spin_usec += last - start;
+            if (NULL != trk->tasks) {
+                trk->stats.spin_hits++;
+                continue;
+            }
+            if (!trk->ev_active) {
+                break;
+            }
+            trk->stats.spin_misses++;
+        }
+        /* say we are going to sleep, then check once more so that
+         * a task shifted in the meantime cannot be missed */
+        trk->sleeping = 1;
+        ww_atomic_mb();
+        if (NULL != trk->tasks || !trk->ev_active) {
+            trk->sleeping = 0;
+            continue;
+        }
+        start = now_usec();
+        loop_pass(trk, WW_EVLOOP_ONCE);
+        trk->sleeping = 0;
+        trk->stats.iterations++;
+        last = now_usec();
+        trk->stats.sleep_usec += last - start;
     }
 
     return WW_THREAD_CANCELLED;
@@ -115,9 +573,11 @@ static void stop_progress_engine(ww_progress_tracker_t *trk)
     assert(trk->ev_active);
     trk->ev_active = false;
 
-    /* break the event loop - this will cause the loop to exit upon
-       completion of any current event */
-    ww_event_base_loopbreak(trk->ev_base);
+    /* the base is not ours to touch from here, so wake the thread
+       through its own wakeup event - it will see that it has been
+       stopped when the loop returns */
+    ww_atomic_mb();
+    wakeup_signal(trk->wakeup);
 
     ww_thread_join(&trk->engine, NULL);
 }
@@ -139,13 +599,187 @@ static int start_progress_engine(ww_progress_tracker_t *trk)
     return rc;
 }
 
+/* name a function as best we can */
+static void describe(ww_progress_fn_t fn, char *buf, size_t len)
+{
+#if WW_HAVE_DLADDR && defined(HAVE_DLFCN_H)
+    Dl_info info;
+
+    if (0 != dladdr((void*)(uintptr_t)fn, &info) && NULL != info.dli_sname) {
+        snprintf(buf, len, "%s+0x%lx (%s)", info.dli_sname,
+                 (unsigned long)((uintptr_t)fn - (uintptr_t)info.dli_saddr),
+                 (NULL != info.dli_fname) ? info.dli_fname : "?");
+        return;
+    }
+#endif
+    snprintf(buf, len, "%p", (void*)(uintptr_t)fn);
+}
+
+/*
+ * The watchdog wakes up a few times per threshold and looks at what
+ * each instrumented thread is running. A task that has been running
+ * for longer than the threshold is reported once, while it is still
+ * blocking the thread - which is when the culprit is easiest to find.
+ *
+ * Event callbacks are caught by the pass through the event loop that
+ * runs them. A pass that may sleep can spend up to pass_idle of its
+ * time waiting rather than running callbacks, so it is only reported
+ * once it has gone on for that much longer - libevent does not say
+ * which callback is running, so neither can we.
+ */
+/* a stall found by the watchdog, to be reported once it has let go
+ * of the tracking lock */
+typedef struct {
+    ww_progress_tracker_t *trk;
+    ww_progress_fn_t fn;        // NULL for an event callback
+    uint64_t usec;
+} ww_progress_stall_t;
+
+static void* watchdog_engine(ww_object_t *obj)
+{
+    ww_progress_tracker_t *trk;
+    ww_progress_fn_t fn;
+    ww_progress_stall_t *stalls = NULL, *tmp;
+    size_t nstalls, nalloc = 0, n, i;
+    uint64_t threshold, period, start, seq, idle, now;
+    struct timespec ts;
+    char desc[512];
+
+    threshold = (uint64_t)ww_progress_thread_stall_threshold;
+    period = threshold / 2;
+    if (period < 1000) {
+        period = 1000;
+    }
+
+    ww_mutex_lock(&tracking_lock);
+    while (watchdog_active) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += period / 1000000;
+        ts.tv_nsec += (period % 1000000) * 1000;
+        if (1000000000 <= ts.tv_nsec) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        ww_condition_timedwait(&watchdog_cond, &tracking_lock, &ts);
+        if (!watchdog_active) {
+            break;
+        }
+        /* each thread can be caught in a task and a pass at once */
+        n = 2 * ww_list_get_size(&tracking);
+        if (nalloc < n) {
+            if (NULL == (tmp = (ww_progress_stall_t*)realloc(stalls, n * sizeof(*stalls)))) {
+                continue;
+            }
+            stalls = tmp;
+            nalloc = n;
+        }
+        nstalls = 0;
+        now = now_usec();
+        WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+            if (NULL == (fn = trk->cur_fn)) {
+                continue;
+            }
+            ww_atomic_rmb();
+            start = trk->cur_start;
+            seq = trk->cur_seq;
+            if (start < now && threshold < now - start && seq != trk->reported_seq) {
+                trk->reported_seq = seq;
+                trk->stats.stalls++;
+                WW_RETAIN(trk);
+                stalls[nstalls].trk = trk;
+                stalls[nstalls].fn = fn;
+                stalls[nstalls].usec = now - start;
+                nstalls++;
+            }
+        }
+        WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+            if (!trk->in_pass) {
+                continue;
+            }
+            ww_atomic_rmb();
+            start = trk->pass_start;
+            idle = trk->pass_idle;
+            seq = trk->pass_seq;
+            if (start < now && threshold + idle < now - start && seq != trk->reported_pass) {
+                trk->reported_pass = seq;
+                trk->stats.stalls++;
+                WW_RETAIN(trk);
+                stalls[nstalls].trk = trk;
+                stalls[nstalls].fn = NULL;
+                stalls[nstalls].usec = now - start - idle;
+                nstalls++;
+            }
+        }
+        if (0 == nstalls) {
+            continue;
+        }
+
+        /* looking up symbols and writing the output can take a while,
+         * and nobody should have to wait for that to init, finalize
+         * or shift */
+        ww_mutex_unlock(&tracking_lock);
+        for (i = 0; i < nstalls; i++) {
+            if (NULL != stalls[i].fn) {
+                describe(stalls[i].fn, desc, sizeof(desc));
+                ww_output(0, "Progress thread %s has been blocked by %s for %lu usec",
+                          stalls[i].trk->name, desc, (unsigned long)stalls[i].usec);
+            } else {
+                ww_output(0, "Progress thread %s has been blocked by an event callback "
+                          "for over %lu usec", stalls[i].trk->name,
+                          (unsigned long)stalls[i].usec);
+            }
+        }
+        ww_mutex_lock(&tracking_lock);
+        for (i = 0; i < nstalls; i++) {
+            WW_RELEASE(stalls[i].trk);
+        }
+    }
+    ww_mutex_unlock(&tracking_lock);
+    if (NULL != stalls) {
+        free(stalls);
+    }
+
+    return WW_THREAD_CANCELLED;
+}
+
+static void watchdog_start(void)
+{
+    int rc;
+
+    watchdog_active = true;
+    WW_CONSTRUCT(&watchdog, ww_thread_t);
+    watchdog.t_run = watchdog_engine;
+    watchdog.t_arg = NULL;
+    if (WW_SUCCESS != (rc = ww_thread_start(&watchdog))) {
+        WW_ERROR_LOG(rc);
+        watchdog_active = false;
+        WW_DESTRUCT(&watchdog);
+        return;
+    }
+    watchdog_running = true;
+}
+
+static void watchdog_stop(void)
+{
+    ww_mutex_lock(&tracking_lock);
+    watchdog_active = false;
+    ww_condition_signal(&watchdog_cond);
+    ww_mutex_unlock(&tracking_lock);
+    ww_thread_join(&watchdog, NULL);
+    WW_DESTRUCT(&watchdog);
+    watchdog_running = false;
+}
+
 ww_event_base_t *ww_progress_thread_init(const char *name)
 {
     ww_progress_tracker_t *trk;
+    char *spec;
     int rc;
 
     if (!inited) {
         WW_CONSTRUCT(&tracking, ww_list_t);
+        WW_CONSTRUCT(&tracking_lock, ww_mutex_t);
+        WW_CONSTRUCT(&watchdog_cond, ww_condition_t);
         inited = true;
     }
 
@@ -170,37 +804,84 @@ ww_event_base_t *ww_progress_thread_init(const char *name)
     }
 
     trk->name = strdup(name);
-    if (NULL == trk->name) {
-        WW_ERROR_LOG(WW_ERR_OUT_OF_RESOURCE);
-        WW_RELEASE(trk);
-        return NULL;
+    if (NULL != trk->name &&
+        NULL != (spec = find_setting(ww_progress_thread_busy_poll, name))) {
+        trk->busy_poll_usec = strtoull(spec, NULL, 10);
+        free(spec);
     }
-
-    if (NULL == (trk->ev_base = ww_event_base_create())) {
+    trk->instrument = (ww_progress_thread_instrument ||
+                       0 < ww_progress_thread_stall_threshold);
+    if (0 < ww_progress_thread_stall_threshold) {
+        /* wake up at least every half a threshold, so that a pass
+         * that has run for much longer than that must be stuck in
+         * its callbacks rather than asleep */
+        trk->block_timeout.tv_sec = ww_progress_thread_stall_threshold / 2 / 1000000;
+        trk->block_timeout.tv_usec = ww_progress_thread_stall_threshold / 2 % 1000000;
+        if (0 == trk->block_timeout.tv_sec && 1000 > trk->block_timeout.tv_usec) {
+            trk->block_timeout.tv_usec = 1000;
+        }
+    }
+    if (NULL == trk->name ||
+        WW_SUCCESS != wakeup_open(trk->wakeup)) {
         WW_ERROR_LOG(WW_ERR_OUT_OF_RESOURCE);
         WW_RELEASE(trk);
         return NULL;
     }
 
-    /* add an event to the new event base (if there are no events,
-       ww_event_loop() will return immediately) */
-    ww_event_set(trk->ev_base, &trk->block, -1, WW_EV_PERSIST,
-                   dummy_timeout_cb, trk);
-    ww_event_add(&trk->block, &long_timeout);
-
-    /* construct the thread object */
+    /* construct the thread object - the thread creates the
+       event base once it is running where it belongs */
     WW_CONSTRUCT(&trk->engine, ww_thread_t);
     trk->engine_constructed = true;
     if (WW_SUCCESS != (rc = start_progress_engine(trk))) {
         WW_ERROR_LOG(rc);
+        trk->ev_active = false;
         WW_RELEASE(trk);
         return NULL;
     }
+    ww_mutex_lock(&trk->lock);
+    while (!trk->ready) {
+        ww_condition_wait(&trk->cond, &trk->lock);
+    }
+    ww_mutex_unlock(&trk->lock);
+    if (NULL == trk->ev_base) {
+        WW_ERROR_LOG(WW_ERR_OUT_OF_RESOURCE);
+        ww_thread_join(&trk->engine, NULL);
+        WW_RELEASE(trk);
+        return NULL;
+    }
+    ww_mutex_lock(&tracking_lock);
     ww_list_append(&tracking, &trk->super);
+    ww_mutex_unlock(&tracking_lock);
+    if (0 < ww_progress_thread_stall_threshold && !watchdog_running) {
+        watchdog_start();
+    }
 
     return trk->ev_base;
 }
 
+ww_event_base_t *ww_progress_thread_get_base(const char *name)
+{
+    ww_progress_tracker_t *trk;
+
+    if (!inited) {
+        return NULL;
+    }
+    if (NULL == name) {
+        name = shared_thread_name;
+    }
+
+    ww_mutex_lock(&tracking_lock);
+    WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+        if (0 == strcmp(name, trk->name)) {
+            ww_mutex_unlock(&tracking_lock);
+            return trk->ev_base;
+        }
+    }
+    ww_mutex_unlock(&tracking_lock);
+
+    return NULL;
+}
+
 int ww_progress_thread_finalize(const char *name)
 {
     ww_progress_tracker_t *trk;
@@ -230,8 +911,14 @@ int ww_progress_thread_finalize(const char *name)
                 stop_progress_engine(trk);
             }
 
+            ww_mutex_lock(&tracking_lock);
+            trk->gone = true;
             ww_list_remove_item(&tracking, &trk->super);
             WW_RELEASE(trk);
+            ww_mutex_unlock(&tracking_lock);
+            if (watchdog_running && ww_list_is_empty(&tracking)) {
+                watchdog_stop();
+            }
             return WW_SUCCESS;
         }
     }
@@ -295,3 +982,582 @@ int ww_progress_thread_resume(const char *name)
 
     return WW_ERR_NOT_FOUND;
 }
+
+int ww_progress_thread_get_stats(const char *name,
+                                 ww_progress_thread_stats_t *stats)
+{
+    ww_progress_tracker_t *trk;
+
+    if (!inited) {
+        return WW_ERR_NOT_FOUND;
+    }
+    if (NULL == name) {
+        name = shared_thread_name;
+    }
+
+    ww_mutex_lock(&tracking_lock);
+    WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+        if (0 == strcmp(name, trk->name)) {
+            *stats = trk->stats;
+            ww_mutex_unlock(&tracking_lock);
+            return WW_SUCCESS;
+        }
+    }
+    ww_mutex_unlock(&tracking_lock);
+
+    return WW_ERR_NOT_FOUND;
+}
+
+/* push a task onto a thread's queue, waking the thread if need be */
+static inline void enqueue(ww_progress_tracker_t *trk, ww_progress_task_t *task)
+{
+    ww_progress_task_t *head;
+
+    task->queued_usec = trk->instrument ? now_usec() : 0;
+    do {
+        head = trk->tasks;
+        task->next = head;
+    } while (!ww_atomic_cmpset_ptr(&trk->tasks, head, task));
+
+    /* only the first task to find the thread asleep wakes it */
+    ww_atomic_mb();
+    if (trk->sleeping && ww_atomic_cmpset_32(&trk->sleeping, 1, 0)) {
+        wakeup_signal(trk->wakeup);
+    }
+}
+
+int ww_progress_thread_shift(const char *name, ww_progress_task_t *task)
+{
+    ww_progress_tracker_t *trk;
+
+    if (NULL == task || NULL == task->fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+    if (!inited) {
+        return WW_ERR_NOT_FOUND;
+    }
+    if (NULL == name) {
+        name = shared_thread_name;
+    }
+
+    /* the tracker cannot be finalized while we hold the lock */
+    ww_mutex_lock(&tracking_lock);
+    WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+        if (0 == strcmp(name, trk->name)) {
+            enqueue(trk, task);
+            ww_mutex_unlock(&tracking_lock);
+            return WW_SUCCESS;
+        }
+    }
+    ww_mutex_unlock(&tracking_lock);
+
+    return WW_ERR_NOT_FOUND;
+}
+
+ww_progress_handle_t *ww_progress_thread_get_handle(const char *name)
+{
+    ww_progress_tracker_t *trk;
+
+    if (!inited) {
+        return NULL;
+    }
+    if (NULL == name) {
+        name = shared_thread_name;
+    }
+
+    ww_mutex_lock(&tracking_lock);
+    WW_LIST_FOREACH(trk, &tracking, ww_progress_tracker_t) {
+        if (0 == strcmp(name, trk->name)) {
+            WW_RETAIN(trk);
+            ww_mutex_unlock(&tracking_lock);
+            return (ww_progress_handle_t*)trk;
+        }
+    }
+    ww_mutex_unlock(&tracking_lock);
+
+    return NULL;
+}
+
+void ww_progress_thread_release_handle(ww_progress_handle_t *handle)
+{
+    ww_progress_tracker_t *trk = (ww_progress_tracker_t*)handle;
+
+    if (NULL == trk) {
+        return;
+    }
+    ww_mutex_lock(&tracking_lock);
+    WW_RELEASE(trk);
+    ww_mutex_unlock(&tracking_lock);
+}
+
+int ww_progress_thread_shift_to(ww_progress_handle_t *handle,
+                                ww_progress_task_t *task)
+{
+    ww_progress_tracker_t *trk = (ww_progress_tracker_t*)handle;
+
+    if (NULL == trk || NULL == task || NULL == task->fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+    /* our reference keeps the tracker around - a task that slips in
+     * as the thread is finalized never runs, as with shift */
+    if (trk->gone) {
+        return WW_ERR_NOT_FOUND;
+    }
+    enqueue(trk, task);
+
+    return WW_SUCCESS;
+}
+
+
+/*
+ * Progress thread pools
+ *
+ * A pool gives one name several event bases, each with its own
+ * thread. Besides running the events attached to its base, each
+ * thread serves a deque of posted work: the owner takes the newest
+ * item (which is most likely still in its cache) and, when it runs
+ * dry, steals the oldest item from another thread's deque before
+ * going back to sleep in its event loop.
+ *
+ * A sleeping thread is woken through a descriptor that is watched by
+ * its own event base, so the base is never touched from another
+ * thread.
+ * Threads advertise that they are about to sleep, then look for
+ * work one last time - a poster that finds a thread advertising
+ * wakes it, so work posted in between cannot be missed.
+ */
+
+typedef struct {
+    ww_list_item_t super;
+    ww_progress_fn_t fn;
+    void *arg;
+} ww_progress_work_t;
+static WW_CLASS_INSTANCE(ww_progress_work_t,
+                         ww_list_item_t,
+                         NULL, NULL);
+
+typedef struct ww_progress_pool_t ww_progress_pool_t;
+
+typedef struct {
+    ww_progress_pool_t *pool;
+    int idx;
+    ww_event_base_t *ev_base;
+    ww_event_t wakeup_ev;
+    int wakeup[2];
+    ww_mutex_t lock;
+    ww_list_t deque;
+    volatile int32_t sleeping;
+    ww_thread_t engine;
+    bool started;
+} ww_progress_worker_t;
+
+struct ww_progress_pool_t {
+    ww_list_item_t super;
+    int refcount;
+    char *name;
+    int nworkers;
+    ww_progress_worker_t *workers;
+    volatile bool active;
+    volatile int32_t next;      // round-robin target for outside posts
+    /* startup - each thread creates its own event base */
+    ww_mutex_t lock;
+    ww_condition_t cond;
+    int nready;
+};
+
+static void pool_constructor(ww_progress_pool_t *p)
+{
+    p->refcount = 1;
+    p->name = NULL;
+    p->nworkers = 0;
+    p->workers = NULL;
+    p->active = false;
+    p->next = 0;
+    WW_CONSTRUCT(&p->lock, ww_mutex_t);
+    WW_CONSTRUCT(&p->cond, ww_condition_t);
+    p->nready = 0;
+}
+static void pool_destructor(ww_progress_pool_t *p);
+static WW_CLASS_INSTANCE(ww_progress_pool_t,
+                         ww_list_item_t,
+                         pool_constructor, pool_destructor);
+
+/* pools are started on first use from any thread, so the list, the
+ * init counts and the object reference counts of pools are only
+ * changed under this lock */
+static ww_mutex_t pools_lock = WW_MUTEX_STATIC_INIT;
+static bool pools_inited = false;
+static ww_list_t pools;
+
+/* look a pool up with the lock held */
+static ww_progress_pool_t* find_pool_locked(const char *name)
+{
+    ww_progress_pool_t *pool;
+
+    if (!pools_inited) {
+        return NULL;
+    }
+    WW_LIST_FOREACH(pool, &pools, ww_progress_pool_t) {
+        if (0 == strcmp(name, pool->name)) {
+            return pool;
+        }
+    }
+    return NULL;
+}
+
+/* look a pool up and take a reference to it, so that it cannot be
+ * freed under us if it is finalized - release it with put_pool() */
+static ww_progress_pool_t* find_pool(const char *name)
+{
+    ww_progress_pool_t *pool;
+
+    ww_mutex_lock(&pools_lock);
+    if (NULL != (pool = find_pool_locked(name))) {
+        WW_RETAIN(pool);
+    }
+    ww_mutex_unlock(&pools_lock);
+    return pool;
+}
+
+static void put_pool(ww_progress_pool_t *pool)
+{
+    ww_mutex_lock(&pools_lock);
+    WW_RELEASE(pool);
+    ww_mutex_unlock(&pools_lock);
+}
+
+static ww_progress_work_t* take_own(ww_progress_worker_t *w)
+{
+    ww_progress_work_t *work;
+
+    ww_mutex_lock(&w->lock);
+    work = (ww_progress_work_t*)ww_list_remove_last(&w->deque);
+    ww_mutex_unlock(&w->lock);
+    return work;
+}
+
+static ww_progress_work_t* steal(ww_progress_worker_t *w)
+{
+    ww_progress_pool_t *pool = w->pool;
+    ww_progress_worker_t *victim;
+    ww_progress_work_t *work;
+    int i;
+
+    for (i=1; i < pool->nworkers; i++) {
+        victim = &pool->workers[(w->idx + i) % pool->nworkers];
+        /* a peek without the lock is only a hint, but it
+         * saves taking every lock in the pool when idle */
+        if (ww_list_is_empty(&victim->deque)) {
+            continue;
+        }
+        ww_mutex_lock(&victim->lock);
+        work = (ww_progress_work_t*)ww_list_remove_first(&victim->deque);
+        ww_mutex_unlock(&victim->lock);
+        if (NULL != work) {
+            return work;
+        }
+    }
+    return NULL;
+}
+
+static void wake(ww_progress_worker_t *w)
+{
+    if (ww_atomic_cmpset_32(&w->sleeping, 1, 0)) {
+        wakeup_signal(w->wakeup);
+    }
+}
+
+/* number of posted items to run before giving the
+ * events on the base a look-in */
+#define WW_PROGRESS_POOL_BATCH  16
+
+static void* pool_engine(ww_object_t *obj)
+{
+    ww_thread_t *t = (ww_thread_t*)obj;
+    ww_progress_worker_t *w = (ww_progress_worker_t*)t->t_arg;
+    ww_progress_work_t *work;
+    int ran = 0;
+
+    /* bind first, so the base is allocated on our own NUMA node */
+    bind_self(w->pool->name, w->idx, w->pool->nworkers);
+    if (NULL != (w->ev_base = ww_event_base_create())) {
+        /* the wakeup event also keeps the base from being empty */
+        ww_event_set(w->ev_base, &w->wakeup_ev, w->wakeup[0],
+                     EV_READ | WW_EV_PERSIST, wakeup_cb, w);
+        ww_event_add(&w->wakeup_ev, NULL);
+    }
+    ww_mutex_lock(&w->pool->lock);
+    w->pool->nready++;
+    ww_condition_broadcast(&w->pool->cond);
+    ww_mutex_unlock(&w->pool->lock);
+    if (NULL == w->ev_base) {
+        return WW_THREAD_CANCELLED;
+    }
+
+    while (w->pool->active) {
+        if (NULL != (work = take_own(w)) ||
+            NULL != (work = steal(w))) {
+            work->fn(work->arg);
+            WW_RELEASE(work);
+            /* a steady stream of work must not starve the events */
+            if (WW_PROGRESS_POOL_BATCH == ++ran) {
+                ww_event_loop(w->ev_base, WW_EVLOOP_NONBLOCK);
+                ran = 0;
+            }
+            continue;
+        }
+        ran = 0;
+        /* say we are going to sleep, then check once more so
+         * that we cannot miss work posted in the meantime */
+        ww_atomic_cmpset_32(&w->sleeping, 0, 1);
+        if (NULL != (work = take_own(w)) ||
+            NULL != (work = steal(w))) {
+            w->sleeping = 0;
+            work->fn(work->arg);
+            WW_RELEASE(work);
+            continue;
+        }
+        ww_event_loop(w->ev_base, WW_EVLOOP_ONCE);
+        w->sleeping = 0;
+    }
+    return WW_THREAD_CANCELLED;
+}
+
+/* stop the threads of a pool - anyone still holding a reference can
+ * post to it, but that work is never run */
+static void pool_stop(ww_progress_pool_t *p)
+{
+    ww_progress_worker_t *w;
+    int i;
+
+    if (NULL == p->workers) {
+        return;
+    }
+    p->active = false;
+    ww_atomic_mb();
+    for (i=0; i < p->nworkers; i++) {
+        w = &p->workers[i];
+        if (w->started) {
+            w->sleeping = 1;
+            wake(w);
+            ww_thread_join(&w->engine, NULL);
+            w->started = false;
+        }
+    }
+}
+
+static void pool_destructor(ww_progress_pool_t *p)
+{
+    ww_progress_worker_t *w;
+    int i;
+
+    if (NULL != p->workers) {
+        pool_stop(p);
+        for (i=0; i < p->nworkers; i++) {
+            w = &p->workers[i];
+            if (NULL != w->ev_base) {
+                ww_event_del(&w->wakeup_ev);
+                ww_event_base_free(w->ev_base);
+            }
+            if (0 <= w->wakeup[0]) {
+                close(w->wakeup[0]);
+                if (w->wakeup[1] != w->wakeup[0]) {
+                    close(w->wakeup[1]);
+                }
+            }
+            /* work that was never run is simply dropped */
+            WW_LIST_DESTRUCT(&w->deque);
+            WW_DESTRUCT(&w->lock);
+            WW_DESTRUCT(&w->engine);
+        }
+        free(p->workers);
+    }
+    if (NULL != p->name) {
+        free(p->name);
+    }
+    WW_DESTRUCT(&p->cond);
+    WW_DESTRUCT(&p->lock);
+}
+
+int ww_progress_thread_pool_init(const char *name, int nthreads)
+{
+    ww_progress_pool_t *pool, *other;
+    ww_progress_worker_t *w;
+    int i, rc;
+
+    if (NULL == name || 0 >= nthreads) {
+        return WW_ERR_BAD_PARAM;
+    }
+    ww_mutex_lock(&pools_lock);
+    if (!pools_inited) {
+        WW_CONSTRUCT(&pools, ww_list_t);
+        pools_inited = true;
+    }
+    if (NULL != (pool = find_pool_locked(name))) {
+        ++pool->refcount;
+        ww_mutex_unlock(&pools_lock);
+        return WW_SUCCESS;
+    }
+    ww_mutex_unlock(&pools_lock);
+
+    /* start the threads without the lock, as they may post
+     * to other pools as soon as they are running */
+
+    pool = WW_NEW(ww_progress_pool_t);
+    pool->name = strdup(name);
+    pool->nworkers = nthreads;
+    pool->workers = (ww_progress_worker_t*)calloc(nthreads, sizeof(ww_progress_worker_t));
+    if (NULL == pool->name || NULL == pool->workers) {
+        WW_RELEASE(pool);
+        return WW_ERR_OUT_OF_RESOURCE;
+    }
+
+    for (i=0; i < nthreads; i++) {
+        w = &pool->workers[i];
+        w->pool = pool;
+        w->idx = i;
+        w->wakeup[0] = w->wakeup[1] = -1;
+        WW_CONSTRUCT(&w->lock, ww_mutex_t);
+        WW_CONSTRUCT(&w->deque, ww_list_t);
+        WW_CONSTRUCT(&w->engine, ww_thread_t);
+    }
+    for (i=0; i < nthreads; i++) {
+        w = &pool->workers[i];
+        if (WW_SUCCESS != wakeup_open(w->wakeup)) {
+            WW_RELEASE(pool);
+            return WW_ERR_OUT_OF_RESOURCE;
+        }
+    }
+
+    pool->active = true;
+    for (i=0; i < nthreads; i++) {
+        w = &pool->workers[i];
+        w->engine.t_run = pool_engine;
+        w->engine.t_arg = w;
+        if (WW_SUCCESS != (rc = ww_thread_start(&w->engine))) {
+            WW_ERROR_LOG(rc);
+            WW_RELEASE(pool);
+            return rc;
+        }
+        w->started = true;
+    }
+
+    /* wait for every thread to have its event base */
+    ww_mutex_lock(&pool->lock);
+    while (pool->nready < nthreads) {
+        ww_condition_wait(&pool->cond, &pool->lock);
+    }
+    ww_mutex_unlock(&pool->lock);
+    for (i=0; i < nthreads; i++) {
+        if (NULL == pool->workers[i].ev_base) {
+            WW_ERROR_LOG(WW_ERR_OUT_OF_RESOURCE);
+            WW_RELEASE(pool);
+            return WW_ERR_OUT_OF_RESOURCE;
+        }
+    }
+
+    /* someone may have started the same pool meanwhile */
+    ww_mutex_lock(&pools_lock);
+    if (NULL != (other = find_pool_locked(name))) {
+        ++other->refcount;
+        ww_mutex_unlock(&pools_lock);
+        WW_RELEASE(pool);
+        return WW_SUCCESS;
+    }
+    ww_list_append(&pools, &pool->super);
+    ww_mutex_unlock(&pools_lock);
+    return WW_SUCCESS;
+}
+
+ww_event_base_t *ww_progress_thread_pool_get_base(const char *name, int idx)
+{
+    ww_progress_pool_t *pool;
+    ww_event_base_t *base;
+
+    if (NULL == name || 0 > idx || NULL == (pool = find_pool(name))) {
+        return NULL;
+    }
+    base = pool->workers[idx % pool->nworkers].ev_base;
+    put_pool(pool);
+    return base;
+}
+
+int ww_progress_thread_post(const char *name, ww_progress_fn_t fn, void *arg)
+{
+    ww_progress_pool_t *pool;
+    ww_progress_worker_t *w = NULL;
+    ww_progress_work_t *work;
+    int i;
+
+    if (NULL == name || NULL == fn) {
+        return WW_ERR_BAD_PARAM;
+    }
+    if (NULL == (pool = find_pool(name))) {
+        return WW_ERR_NOT_FOUND;
+    }
+
+    work = WW_NEW(ww_progress_work_t);
+    work->fn = fn;
+    work->arg = arg;
+
+    /* work posted from one of the pool's own threads stays with that
+     * thread, where its data is likely to be warm - anything else is
+     * spread round-robin */
+    for (i=0; i < pool->nworkers; i++) {
+        if (ww_thread_self_compare(&pool->workers[i].engine)) {
+            w = &pool->workers[i];
+            break;
+        }
+    }
+    if (NULL == w) {
+        i = ww_atomic_add_32(&pool->next, 1);
+        w = &pool->workers[(unsigned int)i % pool->nworkers];
+    }
+
+    ww_mutex_lock(&w->lock);
+    ww_list_append(&w->deque, &work->super);
+    ww_mutex_unlock(&w->lock);
+
+    /* make sure someone is awake to take it - preferably the
+     * thread we gave it to, but any sleeper can steal it */
+    ww_atomic_mb();
+    if (w->sleeping) {
+        wake(w);
+    } else {
+        for (i=0; i < pool->nworkers; i++) {
+            if (pool->workers[i].sleeping) {
+                wake(&pool->workers[i]);
+                break;
+            }
+        }
+    }
+    put_pool(pool);
+    return WW_SUCCESS;
+}
+
+int ww_progress_thread_pool_finalize(const char *name)
+{
+    ww_progress_pool_t *pool;
+
+    if (NULL == name) {
+        return WW_ERR_NOT_FOUND;
+    }
+    ww_mutex_lock(&pools_lock);
+    if (NULL == (pool = find_pool_locked(name))) {
+        ww_mutex_unlock(&pools_lock);
+        return WW_ERR_NOT_FOUND;
+    }
+    if (0 < --pool->refcount) {
+        ww_mutex_unlock(&pools_lock);
+        return WW_SUCCESS;
+    }
+    ww_list_remove_item(&pools, &pool->super);
+    ww_mutex_unlock(&pools_lock);
+
+    /* nobody can find it now, but a post may still be under way -
+     * stop the threads here, where they can still post to other
+     * pools, and leave the memory to the last reference */
+    pool_stop(pool);
+    put_pool(pool);
+    return WW_SUCCESS;
+}
@@ -13,6 +13,38 @@
 
 #include "ww_config.h"
 
+/**
+ * Function to be run by a progress thread or pool
+ */
+typedef void (*ww_progress_fn_t)(void *arg);
+
+/**
+ * A unit of work to be shifted into a progress thread. The caller
+ * owns it - typically it is embedded in the object the work is for -
+ * and must keep it alive until fn has been called. A task can be
+ * shifted again once its fn is running.
+ */
+typedef struct ww_progress_task_t {
+    struct ww_progress_task_t *next;
+    ww_progress_fn_t fn;
+    void *arg;
+    /* when it was shifted, if the thread is instrumented */
+    uint64_t queued_usec;
+} ww_progress_task_t;
+
+#define WW_PROGRESS_TASK_SET(t, f, a)           \
+    do {                                        \
+        (t)->next = NULL;                       \
+        (t)->fn = (f);                          \
+        (t)->arg = (a);                         \
+        (t)->queued_usec = 0;                   \
+    } while (0)
+
+/* Number of buckets in the progress thread histograms. Bucket 0
+ * counts times under 1 usec and bucket i times of at least 2^(i-1)
+ * and under 2^i usec; the last bucket also counts anything longer. */
+#define WW_PROGRESS_HIST_BUCKETS 24
+
 /**
  * Initialize a progress thread name; if a progress thread is not
  * already associated with that name, start a progress thread.
@@ -29,6 +61,15 @@
  */
 WW_DECLSPEC ww_event_base_t *ww_progress_thread_init(const char *name);
 
+/**
+ * Return the event base of the progress thread associated with this
+ * name (or the shared progress thread for NULL) without taking a
+ * reference to it.
+ *
+ * Returns NULL if the progress thread name does not exist.
+ */
+WW_DECLSPEC ww_event_base_t *ww_progress_thread_get_base(const char *name);
+
 /**
  * Finalize a progress thread name (reference counted).
  *
@@ -64,4 +105,139 @@ WW_DECLSPEC int ww_progress_thread_pause(const char *name);
  */
 WW_DECLSPEC int ww_progress_thread_resume(const char *name);
 
+/**
+ * Run task->fn(task->arg) on the progress thread associated with this
+ * name. This is the cheap way to get work into a progress thread: it
+ * does not allocate or touch the thread's event base, and a thread
+ * that is already awake is not signalled at all. Tasks run in the
+ * order they were shifted from any one thread, in batches between
+ * passes through the event loop.
+ *
+ * Tasks that are still queued when the progress thread is paused run
+ * once it is resumed; those queued when it is finalized never run.
+ *
+ * Will return WW_ERR_NOT_FOUND if the progress thread name does not
+ * exist; WW_SUCCESS otherwise.
+ */
+WW_DECLSPEC int ww_progress_thread_shift(const char *name, ww_progress_task_t *task);
+
+/**
+ * A reference to a progress thread, for callers that shift to it
+ * often. ww_progress_thread_shift() has to find the thread by name
+ * under a lock shared with everyone else; shifting through a handle
+ * takes no lock at all.
+ */
+typedef struct ww_progress_handle_t ww_progress_handle_t;
+
+/**
+ * Get a handle on the progress thread associated with this name (or
+ * the shared progress thread for NULL). The handle stays valid until
+ * it is released, even if the thread is finalized in the meantime -
+ * shifting through it then fails.
+ *
+ * Returns NULL if the progress thread name does not exist.
+ */
+WW_DECLSPEC ww_progress_handle_t *ww_progress_thread_get_handle(const char *name);
+
+/**
+ * Release a handle obtained from ww_progress_thread_get_handle().
+ */
+WW_DECLSPEC void ww_progress_thread_release_handle(ww_progress_handle_t *handle);
+
+/**
+ * As ww_progress_thread_shift(), but to the thread behind a handle.
+ *
+ * Will return WW_ERR_NOT_FOUND if the progress thread has been
+ * finalized; WW_SUCCESS otherwise.
+ */
+WW_DECLSPEC int ww_progress_thread_shift_to(ww_progress_handle_t *handle,
+                                            ww_progress_task_t *task);
+
+/**
+ * What a progress thread has been doing.
+ *
+ * Only threads that busy-poll (see the progress_thread_busy_poll MCA
+ * parameter) spend time spinning; the ratio of spin_usec to
+ * sleep_usec shows what the lower wakeup latency is costing.
+ *
+ * The task counters and histograms cover work shifted in with
+ * ww_progress_thread_shift(), and are only kept while the thread is
+ * instrumented (see the progress_thread_instrument and
+ * progress_thread_stall_threshold MCA parameters).
+ */
+typedef struct {
+    /* passes through the event loop */
+    uint64_t iterations;
+    /* time spent polling for work after activity */
+    uint64_t spin_usec;
+    /* time spent blocked in the event loop */
+    uint64_t sleep_usec;
+    /* times polling found work before the budget ran out */
+    uint64_t spin_hits;
+    /* times the budget ran out and the thread went to sleep */
+    uint64_t spin_misses;
+    /* tasks run */
+    uint64_t tasks;
+    /* tasks and event callbacks the watchdog caught blocking the thread */
+    uint64_t stalls;
+    /* how long tasks took to run */
+    uint64_t task_usec[WW_PROGRESS_HIST_BUCKETS];
+    /* how long tasks waited between being shifted and run */
+    uint64_t wait_usec[WW_PROGRESS_HIST_BUCKETS];
+} ww_progress_thread_stats_t;
+
+/**
+ * Get the statistics of the progress thread associated with
+ * this name. The counters are updated by the thread without locking,
+ * so they are only a snapshot.
+ *
+ * Will return WW_ERR_NOT_FOUND if the progress thread name does not
+ * exist; WW_SUCCESS otherwise.
+ */
+WW_DECLSPEC int ww_progress_thread_get_stats(const char *name,
+                                             ww_progress_thread_stats_t *stats);
+
+/**
+ * Initialize a progress thread pool name; if a pool is not already
+ * associated with that name, start one of nthreads threads, each
+ * progressing its own event base.
+ *
+ * As with single progress threads, the name is reference counted -
+ * a second call with the same name just takes another reference to
+ * the existing pool, regardless of nthreads. Pools and single progress
+ * threads have separate names, and pools cannot be paused.
+ */
+WW_DECLSPEC int ww_progress_thread_pool_init(const char *name, int nthreads);
+
+/**
+ * Return the event base of one of the pool's threads, for events
+ * that should be progressed by the pool. The index is taken modulo
+ * the number of threads, so callers can spread their events by
+ * passing a counter.
+ *
+ * Returns NULL if the pool name does not exist.
+ */
+WW_DECLSPEC ww_event_base_t *ww_progress_thread_pool_get_base(const char *name, int idx);
+
+/**
+ * Run fn(arg) on one of the pool's threads. Work posted from a pool
+ * thread is queued to that thread; other work is spread across them.
+ * Idle threads steal queued work from busy ones, so CPU-bound
+ * callbacks are shared out across the pool.
+ *
+ * Will return WW_ERR_NOT_FOUND if the pool name does not exist;
+ * WW_SUCCESS otherwise.
+ */
+WW_DECLSPEC int ww_progress_thread_post(const char *name, ww_progress_fn_t fn, void *arg);
+
+/**
+ * Finalize a progress thread pool name (reference counted). Once the
+ * last reference is gone, the threads are stopped and any work that
+ * had not yet run is discarded.
+ *
+ * Will return WW_ERR_NOT_FOUND if the pool name does not exist;
+ * WW_SUCCESS otherwise.
+ */
+WW_DECLSPEC int ww_progress_thread_pool_finalize(const char *name);
+
 #endif
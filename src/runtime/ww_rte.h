@@ -42,10 +42,12 @@ WW_DECLSPEC extern const char ww_version_string[];
 /* define a peer object */
 typedef struct ww_peer_t {
     ww_object_t super;
+    int sd;     // connection to the peer, -1 if none
     uid_t uid;
     gid_t gid;
+    ww_object_t *authz;     // cached authorization, owned by the sec base
 } ww_peer_t;
-WW_CLASS_DECLARATION(ww_peer_t);
+WW_DECLSPEC WW_CLASS_DECLARATION(ww_peer_t);
 
 typedef struct ww_globals_t {
     ww_event_base_t *evbase;
@@ -23,13 +23,13 @@
 
 static void ww_condition_construct(ww_condition_t *c)
 {
-    c->c_waiting = 0;
-    c->c_signaled = 0;
+    pthread_cond_init(&c->c_cond, NULL);
 }
 
 
 static void ww_condition_destruct(ww_condition_t *c)
 {
+    pthread_cond_destroy(&c->c_cond);
 }
 
 WW_CLASS_INSTANCE(ww_condition_t,
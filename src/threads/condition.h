@@ -34,111 +34,41 @@
 BEGIN_C_DECLS
 
 /*
- * Combine pthread support w/ polled progress to allow run-time selection
- * of threading vs. non-threading progress.
+ * Condition variables are backed by pthreads, and must be used with
+ * a ww_mutex_t, which is always a pthread mutex. Waiting releases
+ * the mutex for as long as the caller is blocked, so the thread that
+ * will signal the condition is free to take it.
  */
 
 struct ww_condition_t {
     ww_object_t super;
-    volatile int c_waiting;
-    volatile int c_signaled;
+    pthread_cond_t c_cond;
 };
 typedef struct ww_condition_t ww_condition_t;
 
 WW_DECLSPEC WW_CLASS_DECLARATION(ww_condition_t);
 
-static void ww_progress(void)
-{
-    /* provide a short quiet period so we
-     * don't hammer the cpu while waiting
-     */
-    struct timespec tp = {0, 100000};
-    nanosleep(&tp, NULL);
-}
-
 static inline int ww_condition_wait(ww_condition_t *c, ww_mutex_t *m)
 {
-    int rc = 0;
-    c->c_waiting++;
-
-    if (ww_using_threads()) {
-        if (c->c_signaled) {
-            c->c_waiting--;
-            ww_mutex_unlock(m);
-            ww_progress();
-            ww_mutex_lock(m);
-            return 0;
-        }
-        while (c->c_signaled == 0) {
-            ww_mutex_unlock(m);
-            ww_progress();
-            ww_mutex_lock(m);
-        }
-    } else {
-        while (c->c_signaled == 0) {
-            ww_progress();
-        }
-    }
-
-    c->c_signaled--;
-    c->c_waiting--;
-    return rc;
+    return pthread_cond_wait(&c->c_cond, &m->m_lock_pthread);
 }
 
+/* abstime is measured against the realtime clock, as from gettimeofday */
 static inline int ww_condition_timedwait(ww_condition_t *c,
                                            ww_mutex_t *m,
                                            const struct timespec *abstime)
 {
-    struct timeval tv;
-    struct timeval absolute;
-    int rc = 0;
-
-    c->c_waiting++;
-    if (ww_using_threads()) {
-        absolute.tv_sec = abstime->tv_sec;
-        absolute.tv_usec = abstime->tv_nsec / 1000;
-        gettimeofday(&tv,NULL);
-        if (c->c_signaled == 0) {
-            do {
-                ww_mutex_unlock(m);
-                ww_progress();
-                gettimeofday(&tv,NULL);
-                ww_mutex_lock(m);
-                } while (c->c_signaled == 0 &&
-                         (tv.tv_sec <= absolute.tv_sec ||
-                          (tv.tv_sec == absolute.tv_sec && tv.tv_usec < absolute.tv_usec)));
-        }
-    } else {
-        absolute.tv_sec = abstime->tv_sec;
-        absolute.tv_usec = abstime->tv_nsec / 1000;
-        gettimeofday(&tv,NULL);
-        if (c->c_signaled == 0) {
-            do {
-                ww_progress();
-                gettimeofday(&tv,NULL);
-                } while (c->c_signaled == 0 &&
-                         (tv.tv_sec <= absolute.tv_sec ||
-                          (tv.tv_sec == absolute.tv_sec && tv.tv_usec < absolute.tv_usec)));
-        }
-    }
-
-    if (c->c_signaled != 0) c->c_signaled--;
-    c->c_waiting--;
-    return rc;
+    return pthread_cond_timedwait(&c->c_cond, &m->m_lock_pthread, abstime);
 }
 
 static inline int ww_condition_signal(ww_condition_t *c)
 {
-    if (c->c_waiting) {
-        c->c_signaled++;
-    }
-    return 0;
+    return pthread_cond_signal(&c->c_cond);
 }
 
 static inline int ww_condition_broadcast(ww_condition_t *c)
 {
-    c->c_signaled = c->c_waiting;
-    return 0;
+    return pthread_cond_broadcast(&c->c_cond);
 }
 
 END_C_DECLS
@@ -42,6 +42,7 @@
 
 #include "src/util/ww_environ.h"
 #include "src/util/error.h"
+#include "src/util/fd.h"
 #include "src/util/output.h"
 
 /*
@@ -117,6 +118,8 @@ static size_t temp_str_len = 0;
 static bool syslog_opened = false;
 #endif
 static char *redirect_syslog_ident = NULL;
+static ww_output_file_writer_fn_t file_writer = NULL;
+static ww_output_file_drain_fn_t file_drain = NULL;
 
 WW_CLASS_INSTANCE(ww_output_stream_t, ww_object_t, construct, NULL);
 
@@ -470,6 +473,25 @@ void ww_output_set_output_file_info(const char *dir,
     }
 }
 
+/*
+ * Control how output files are written
+ */
+void ww_output_set_file_writer(ww_output_file_writer_fn_t writer,
+                               ww_output_file_drain_fn_t drain)
+{
+    file_writer = writer;
+    file_drain = (NULL == writer) ? NULL : drain;
+}
+
+static void write_file(int fd, const char *buf, size_t len)
+{
+    if (NULL != file_writer) {
+        file_writer(fd, buf, len);
+    } else {
+        (void)ww_fd_write(fd, (int)len, buf);
+    }
+}
+
 void ww_output_hexdump(int verbose_level, int output_id,
                          void *ptr, int buflen)
 {
@@ -818,6 +840,9 @@ static void free_descriptor(int output_id)
 	ldi = &info[output_id];
 
 	if (-1 != ldi->ldi_fd) {
+	    if (NULL != file_drain) {
+	        file_drain(ldi->ldi_fd);
+	    }
 	    close(ldi->ldi_fd);
 	}
 	ldi->ldi_used = false;
@@ -991,7 +1016,7 @@ static int output(int output_id, const char *format, va_list arglist)
                     snprintf(buffer, BUFSIZ - 1,
                              "[WARNING: %d lines lost because the Warewulf process session directory did\n not exist when ww_output() was invoked]\n",
                              ldi->ldi_file_num_lines_lost);
-                    write(ldi->ldi_fd, buffer, (int)strlen(buffer));
+                    write_file(ldi->ldi_fd, buffer, strlen(buffer));
                     ldi->ldi_file_num_lines_lost = 0;
                     if (out != buffer) {
                         free(out);
@@ -999,7 +1024,7 @@ static int output(int output_id, const char *format, va_list arglist)
                 }
             }
             if (ldi->ldi_fd != -1) {
-                write(ldi->ldi_fd, out, (int)strlen(out));
+                write_file(ldi->ldi_fd, out, strlen(out));
             }
         }
         free(str);
@@ -507,6 +507,29 @@ struct ww_output_stream_t {
                                                         char **olddir,
                                                         char **oldprefix);
 
+    /**
+     * Function that writes output to a stream's file.
+     */
+    typedef void (*ww_output_file_writer_fn_t)(int fd, const char *buf, size_t len);
+
+    /**
+     * Function called before a stream's file is closed, which must not
+     * return until the writer is done with the descriptor.
+     */
+    typedef void (*ww_output_file_drain_fn_t)(int fd);
+
+    /**
+     * Hand writes to output files to another function - e.g., one
+     * that writes asynchronously, so that logging does not stall the
+     * caller.  Passing a NULL writer goes back to writing directly.
+     *
+     * The writer is called with the same serialization as the rest of
+     * ww_output(), and must have finished with buf when it returns.
+     * Output to stdout, stderr and syslog is not affected.
+     */
+    WW_DECLSPEC void ww_output_set_file_writer(ww_output_file_writer_fn_t writer,
+                                               ww_output_file_drain_fn_t drain);
+
     /**
      * Same as ww_output_verbose(), but pointer to buffer and size.
      */
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* SipHash-2-4 as described by Aumasson and Bernstein. Multi-byte
+ * values are read and written little-endian regardless of the host
+ * byte order so that tags agree across architectures. */
+
+#include <src/include/ww_config.h>
+
+#include <ww_types.h>
+
+#include <string.h>
+
+#include "src/util/siphash.h"
+
+#define ROTL(x, b)  (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3)                                    \
+    do {                                                            \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32);   \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2;                      \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0;                      \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);   \
+    } while (0)
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    return ((uint64_t)p[0])       | ((uint64_t)p[1] << 8)  |
+           ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void compress(ww_siphash_t *st, uint64_t m)
+{
+    st->v3 ^= m;
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    st->v0 ^= m;
+}
+
+void ww_siphash_init(ww_siphash_t *st, const uint8_t key[WW_SIPHASH_KEYLEN])
+{
+    uint64_t k0 = load64(key);
+    uint64_t k1 = load64(key + 8);
+
+    st->v0 = k0 ^ 0x736f6d6570736575ULL;
+    st->v1 = k1 ^ 0x646f72616e646f6dULL;
+    st->v2 = k0 ^ 0x6c7967656e657261ULL;
+    st->v3 = k1 ^ 0x7465646279746573ULL;
+    st->nbuf = 0;
+    st->total = 0;
+}
+
+void ww_siphash_update(ww_siphash_t *st, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    size_t n;
+
+    if (0 == len) {
+        return;
+    }
+    st->total += len;
+    /* top up any partial word left from the last call */
+    if (0 < st->nbuf) {
+        n = sizeof(st->buf) - st->nbuf;
+        if (len < n) {
+            n = len;
+        }
+        memcpy(st->buf + st->nbuf, p, n);
+        st->nbuf += n;
+        p += n;
+        len -= n;
+        if (sizeof(st->buf) > st->nbuf) {
+            return;
+        }
+        compress(st, load64(st->buf));
+        st->nbuf = 0;
+    }
+    while (8 <= len) {
+        compress(st, load64(p));
+        p += 8;
+        len -= 8;
+    }
+    /* fewer than 8 bytes are left, and the buffer is empty */
+    memcpy(st->buf, p, len);
+    st->nbuf = len;
+}
+
+uint64_t ww_siphash_final(ww_siphash_t *st)
+{
+    uint64_t b = ((uint64_t)st->total) << 56;
+    size_t i;
+
+    for (i=0; i < st->nbuf; i++) {
+        b |= ((uint64_t)st->buf[i]) << (8 * i);
+    }
+    compress(st, b);
+    st->v2 ^= 0xff;
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    SIPROUND(st->v0, st->v1, st->v2, st->v3);
+    return st->v0 ^ st->v1 ^ st->v2 ^ st->v3;
+}
+
+uint64_t ww_siphash(const uint8_t key[WW_SIPHASH_KEYLEN],
+                    const void *data, size_t len)
+{
+    ww_siphash_t st;
+
+    ww_siphash_init(&st, key);
+    ww_siphash_update(&st, data, len);
+    return ww_siphash_final(&st);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2016      Intel, Inc. All rights reserved.
+ * $COPYRIGHT$
+ *
+ * Additional copyrights may follow
+ *
+ * $HEADER$
+ */
+
+/* @file */
+
+#ifndef WW_UTIL_SIPHASH_H_
+#define WW_UTIL_SIPHASH_H_
+
+#include <src/include/ww_config.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+BEGIN_C_DECLS
+
+#define WW_SIPHASH_KEYLEN   16
+
+/**
+ * SipHash-2-4 - a fast keyed hash that is suitable as a MAC for
+ * short messages, producing a 64-bit tag from a 128-bit key.
+ *
+ * The state may be fed incrementally, so that a tag can cover a
+ * header and a payload without copying them into one buffer.
+ */
+typedef struct {
+    uint64_t v0, v1, v2, v3;
+    uint8_t buf[8];     // bytes not yet absorbed
+    size_t nbuf;
+    size_t total;
+} ww_siphash_t;
+
+WW_DECLSPEC void ww_siphash_init(ww_siphash_t *st, const uint8_t key[WW_SIPHASH_KEYLEN]);
+WW_DECLSPEC void ww_siphash_update(ww_siphash_t *st, const void *data, size_t len);
+WW_DECLSPEC uint64_t ww_siphash_final(ww_siphash_t *st);
+
+/**
+ * Compute the tag of a single buffer
+ */
+WW_DECLSPEC uint64_t ww_siphash(const uint8_t key[WW_SIPHASH_KEYLEN],
+                                const void *data, size_t len);
+
+END_C_DECLS
+
+#endif